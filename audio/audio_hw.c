@@ -111,6 +111,9 @@
 #define HEADSET_VOLUME                        0
 #define HEADPHONE_VOLUME                      0 /* allow louder output for headphones */
 
+/* stream parameter reporting the last presented frame and its monotonic time */
+#define AUDIO_PARAMETER_STREAM_PRESENTATION_POSITION "presentation_position"
+
 /* product-specific defines */
 #define PRODUCT_DEVICE_PROPERTY "ro.product.device"
 #define PRODUCT_DEVICE_TYPE    "omap3evm"
@@ -259,6 +262,9 @@ struct omap3_stream_out {
     char *buffer;
     int standby;
     int write_threshold;
+    uint64_t written;           /* frames played or queued since the stream was opened */
+    uint64_t pcm_written;       /* frames written to the currently open pcm */
+    uint64_t presented;         /* highest position reported, never reported lower */
 
     struct omap3_audio_device *dev;
 };
@@ -292,6 +298,10 @@ static void select_input_device(struct omap3_audio_device *adev);
 static int adev_set_voice_volume(struct audio_hw_device *dev, float volume);
 static int do_input_standby(struct omap3_stream_in *in);
 static int do_output_standby(struct omap3_stream_out *out);
+static int out_get_queued_frames(struct omap3_stream_out *out, uint64_t *queued,
+                                 struct timespec *timestamp);
+static int out_get_position(struct omap3_stream_out *out, uint64_t *frames,
+                            struct timespec *timestamp);
 
 static int get_boardtype(struct omap3_audio_device *adev)
 {
@@ -550,6 +560,18 @@ static int do_output_standby(struct omap3_stream_out *out)
     LOGFUNC("%s(%p)", __FUNCTION__, out);
 
     if (!out->standby) {
+        uint64_t queued;
+        struct timespec timestamp;
+
+        /* frames still queued in the DMA buffer are dropped by pcm_close().
+           After an XRUN they are all counted as queued, but the DMA played
+           at least what was last reported */
+        out_get_queued_frames(out, &queued, &timestamp);
+        out->written -= queued;
+        if (out->written < out->presented)
+            out->written = out->presented;
+        out->pcm_written = 0;
+
         pcm_close(out->pcm);
         out->pcm = NULL;
         adev->active_output = 0;
@@ -589,11 +611,94 @@ static int out_set_parameters(struct audio_stream *stream, const char *kvpairs)
     return 0;
 }
 
+/* frames written to the pcm but not yet consumed by the DMA, and the time of
+ * the last DMA period interrupt. Returns -ENODATA when the DMA is not running.
+ * must be called with output stream mutex locked */
+static int out_get_queued_frames(struct omap3_stream_out *out, uint64_t *queued,
+                                 struct timespec *timestamp)
+{
+    unsigned int avail;
+
+    *queued = 0;
+    if (out->standby || !out->pcm)
+        return -ENODATA;
+
+    if (pcm_get_htimestamp(out->pcm, &avail, timestamp) < 0) {
+        /* not started yet, or stopped by an XRUN that out_write() has not
+           seen yet. The two cannot be told apart, so everything written is
+           counted as queued; out_get_position() keeps the position from
+           going backwards in the XRUN case */
+        *queued = out->pcm_written;
+        return -ENODATA;
+    }
+
+    *queued = pcm_get_buffer_size(out->pcm) - avail;
+    if (*queued > out->pcm_written)
+        *queued = out->pcm_written;
+    return 0;
+}
+
+/* frames presented so far, never less than a position reported before.
+ * Returns -ENODATA when the DMA is not running, with the position still set.
+ * must be called with output stream mutex locked */
+static int out_get_position(struct omap3_stream_out *out, uint64_t *frames,
+                            struct timespec *timestamp)
+{
+    uint64_t queued;
+    int ret;
+
+    ret = out_get_queued_frames(out, &queued, timestamp);
+    *frames = out->written - queued;
+    if (*frames < out->presented)
+        *frames = out->presented;
+    else
+        out->presented = *frames;
+    return ret;
+}
+
+static int out_get_presentation_position(const struct audio_stream_out *stream,
+                                         uint64_t *frames, struct timespec *timestamp)
+{
+    struct omap3_stream_out *out = (struct omap3_stream_out *)stream;
+    uint64_t position;
+    int ret;
+
+    LOGFUNC("%s(%p, %p, %p)", __FUNCTION__, stream, frames, timestamp);
+
+    pthread_mutex_lock(&out->lock);
+    ret = out_get_position(out, &position, timestamp);
+    if (ret == 0)
+        *frames = position;
+    pthread_mutex_unlock(&out->lock);
+
+    return ret;
+}
+
 static char * out_get_parameters(const struct audio_stream *stream, const char *keys)
 {
+    struct str_parms *query = str_parms_create_str(keys);
+    struct str_parms *reply = str_parms_create();
+    struct timespec timestamp;
+    uint64_t frames;
+    char value[64];
+    char *str;
+
     LOGFUNC("%s(%p, %s)", __FUNCTION__, stream, keys);
 
-    return strdup("");
+    if (str_parms_get_str(query, AUDIO_PARAMETER_STREAM_PRESENTATION_POSITION,
+                          value, sizeof(value)) >= 0 &&
+            out_get_presentation_position((const struct audio_stream_out *)stream,
+                                          &frames, &timestamp) == 0) {
+        /* <frames>,<CLOCK_MONOTONIC ns at which that frame was presented> */
+        snprintf(value, sizeof(value), "%llu,%lld", (unsigned long long)frames,
+                 (long long)timestamp.tv_sec * 1000000000LL + timestamp.tv_nsec);
+        str_parms_add_str(reply, AUDIO_PARAMETER_STREAM_PRESENTATION_POSITION, value);
+    }
+
+    str = str_parms_to_str(reply);
+    str_parms_destroy(reply);
+    str_parms_destroy(query);
+    return str;
 }
 
 static uint32_t out_get_latency(const struct audio_stream_out *stream)
@@ -601,7 +706,8 @@ static uint32_t out_get_latency(const struct audio_stream_out *stream)
     struct omap3_stream_out *out = (struct omap3_stream_out *)stream;
 
     LOGFUNC("%s(%p)", __FUNCTION__, stream);
-    return (SHORT_PERIOD_SIZE * PLAYBACK_PERIOD_COUNT * 1000) / out->config.rate;
+    return (out->config.period_size * out->config.period_count * 1000) /
+            out->config.rate;
 }
 
 static int out_set_volume(struct audio_stream_out *stream, float left,
@@ -671,6 +777,10 @@ do_over:
     } while (kernel_frames > out->write_threshold);
 
     ret = pcm_mmap_write(out->pcm, (void *)buf, out_frames * frame_size);
+    if (ret >= 0) {
+        out->written += out_frames;
+        out->pcm_written += out_frames;
+    }
 
 exit:
     pthread_mutex_unlock(&out->lock);
@@ -685,6 +795,9 @@ exit:
 	    LOGE("XRUN detected");
 	    pthread_mutex_lock(&adev->lock);
 	    pthread_mutex_lock(&out->lock);
+	    /* the DMA consumed everything it was given before stopping, so
+	       nothing is dropped by the standby below */
+	    out->pcm_written = 0;
 	    do_output_standby(out);
 	    pthread_mutex_unlock(&out->lock);
 	    pthread_mutex_unlock(&adev->lock);
@@ -697,9 +810,18 @@ exit:
 static int out_get_render_position(const struct audio_stream_out *stream,
                                    uint32_t *dsp_frames)
 {
+    struct omap3_stream_out *out = (struct omap3_stream_out *)stream;
+    struct timespec timestamp;
+    uint64_t position;
+
     LOGFUNC("%s(%p, %p)", __FUNCTION__, stream, dsp_frames);
 
-    return -EINVAL;
+    pthread_mutex_lock(&out->lock);
+    out_get_position(out, &position, &timestamp);
+    *dsp_frames = (uint32_t)position;
+    pthread_mutex_unlock(&out->lock);
+
+    return 0;
 }
 
 static int out_add_audio_effect(const struct audio_stream *stream, effect_handle_t effect)
@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2011 Texas Instruments
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Drives audio_hw.c on top of the pcm_sim stand-in and reports how the HAL
+ * paces the simulated card: end-to-end playback latency, write/read call
+ * jitter, underruns and the CPU time spent per second of audio.
+ *
+ * It also checks the presentation position reported by the HAL against the
+ * simulated DAC and fails when the two drift apart by a millisecond or more,
+ * or when the render position ever goes backwards. -s forces a standby
+ * every N writes to exercise position tracking across pcm reopens; -x
+ * stalls the writer every N writes until the DMA underruns, and checks the
+ * render position while the pcm is stopped by the XRUN.
+ *
+ * usage: audio_hw_test [-d seconds] [-s writes] [-x writes] [-o played.wav]
+ *                      [-c capture_src.wav] [-r captured.raw]
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <hardware/hardware.h>
+#include <system/audio.h>
+#include <hardware/audio.h>
+
+#include "pcm_sim.h"
+
+#define DEFAULT_DURATION_S 10
+#define TONE_HZ 1000
+#define MAX_POSITION_DRIFT_MS 1.0
+
+extern struct audio_module HAL_MODULE_INFO_SYM;
+
+struct run_stats {
+    unsigned int count;
+    double sum;
+    double sum_sq;
+    double min;
+    double max;
+};
+
+struct capture_args {
+    struct audio_stream_in *in;
+    const char *sink_path;
+    double duration_s;
+    struct run_stats interval_ms;
+    uint64_t frames;
+};
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static double cpu_ms(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000.0 +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000.0;
+}
+
+static void stats_add(struct run_stats *s, double v)
+{
+    if (s->count == 0 || v < s->min)
+        s->min = v;
+    if (s->count == 0 || v > s->max)
+        s->max = v;
+    s->count++;
+    s->sum += v;
+    s->sum_sq += v * v;
+}
+
+static void stats_print(const char *name, const struct run_stats *s)
+{
+    double mean, var;
+
+    if (s->count == 0) {
+        printf("  %-22s no samples\n", name);
+        return;
+    }
+    mean = s->sum / s->count;
+    var = s->sum_sq / s->count - mean * mean;
+    printf("  %-22s n=%u mean=%.3f stddev=%.3f min=%.3f max=%.3f ms\n",
+           name, s->count, mean, var > 0 ? sqrt(var) : 0.0, s->min, s->max);
+}
+
+/* presentation position as reported through the stream parameters */
+static int get_presentation_position(struct audio_stream_out *out,
+                                     uint64_t *frames, int64_t *time_ns)
+{
+    char *str = out->common.get_parameters(&out->common, "presentation_position");
+    char *value = str ? strchr(str, '=') : NULL;
+    unsigned long long f;
+    long long t;
+    int ret = -ENODATA;
+
+    if (value && sscanf(value + 1, "%llu,%lld", &f, &t) == 2) {
+        *frames = f;
+        *time_ns = t;
+        ret = 0;
+    }
+    free(str);
+    return ret;
+}
+
+static void *capture_thread(void *arg)
+{
+    struct capture_args *args = arg;
+    struct audio_stream_in *in = args->in;
+    size_t bytes = in->common.get_buffer_size(&in->common);
+    size_t frame_size = audio_stream_frame_size(&in->common);
+    void *buffer = malloc(bytes);
+    FILE *sink = NULL;
+    double start, prev, now;
+
+    if (!buffer)
+        return NULL;
+    if (args->sink_path)
+        sink = fopen(args->sink_path, "wb");
+
+    start = prev = now_ms();
+    do {
+        in->read(in, buffer, bytes);
+        now = now_ms();
+        stats_add(&args->interval_ms, now - prev);
+        prev = now;
+        args->frames += bytes / frame_size;
+        if (sink)
+            fwrite(buffer, 1, bytes, sink);
+    } while (now - start < args->duration_s * 1000.0);
+
+    if (sink)
+        fclose(sink);
+    free(buffer);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    struct audio_hw_device *adev;
+    struct audio_stream_out *out;
+    struct audio_stream_in *in = NULL;
+    struct capture_args capture;
+    struct pcm_sim_stats sim;
+    struct run_stats write_ms, interval_ms, latency_ms, drift_ms;
+    struct timespec play, when;
+    uint64_t pos_frames, truth;
+    int64_t pos_ns;
+    uint32_t render, last_render = 0;
+    unsigned int regressions = 0, standby_every = 0, xrun_every = 0, writes = 0;
+    double est, max_drift;
+    pthread_t capture_tid;
+    const char *capture_src = NULL;
+    double duration_s = DEFAULT_DURATION_S;
+    double start, cpu_start, prev, enter, now, period_ms, audio_s, phase = 0;
+    uint32_t channels = AUDIO_CHANNEL_OUT_STEREO, rate = 0;
+    int format = AUDIO_FORMAT_PCM_16_BIT;
+    size_t bytes, frames, frame_size, i;
+    int16_t *buffer;
+    int opt, ret;
+
+    memset(&capture, 0, sizeof(capture));
+    while ((opt = getopt(argc, argv, "d:s:x:o:c:r:")) != -1) {
+        switch (opt) {
+        case 'd':
+            duration_s = atof(optarg);
+            break;
+        case 's':
+            standby_every = atoi(optarg);
+            break;
+        case 'x':
+            xrun_every = atoi(optarg);
+            break;
+        case 'o':
+            setenv(PCM_SIM_OUT_FILE_ENV, optarg, 1);
+            break;
+        case 'c':
+            capture_src = optarg;
+            setenv(PCM_SIM_IN_FILE_ENV, optarg, 1);
+            break;
+        case 'r':
+            capture.sink_path = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-d seconds] [-s writes] [-x writes] [-o played.wav] "
+                    "[-c capture_src.wav] [-r captured.raw]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    ret = HAL_MODULE_INFO_SYM.common.methods->open(&HAL_MODULE_INFO_SYM.common,
+                AUDIO_HARDWARE_INTERFACE, (struct hw_device_t **)&adev);
+    if (ret) {
+        fprintf(stderr, "cannot open audio hw device: %d\n", ret);
+        return 1;
+    }
+
+    ret = adev->open_output_stream(adev, AUDIO_DEVICE_OUT_SPEAKER, &format,
+                                   &channels, &rate, &out);
+    if (ret) {
+        fprintf(stderr, "cannot open output stream: %d\n", ret);
+        return 1;
+    }
+
+    if (capture_src) {
+        uint32_t in_channels = AUDIO_CHANNEL_IN_STEREO, in_rate = 8000;
+        int in_format = AUDIO_FORMAT_PCM_16_BIT;
+
+        ret = adev->open_input_stream(adev, AUDIO_DEVICE_IN_BUILTIN_MIC,
+                                      &in_format, &in_channels, &in_rate, 0, &in);
+        if (ret) {
+            fprintf(stderr, "cannot open input stream: %d\n", ret);
+            return 1;
+        }
+        capture.in = in;
+        capture.duration_s = duration_s;
+    }
+
+    bytes = out->common.get_buffer_size(&out->common);
+    frame_size = audio_stream_frame_size(&out->common);
+    frames = bytes / frame_size;
+    period_ms = frames * 1000.0 / rate;
+    buffer = malloc(bytes);
+    if (!buffer)
+        return 1;
+
+    printf("playback: %u Hz, %zu frames per write (%.2f ms), %.1f s\n",
+           rate, frames, period_ms, duration_s);
+
+    memset(&write_ms, 0, sizeof(write_ms));
+    memset(&interval_ms, 0, sizeof(interval_ms));
+    memset(&latency_ms, 0, sizeof(latency_ms));
+    memset(&drift_ms, 0, sizeof(drift_ms));
+
+    cpu_start = cpu_ms();
+    if (in)
+        pthread_create(&capture_tid, NULL, capture_thread, &capture);
+
+    start = prev = now_ms();
+    audio_s = 0;
+    while (audio_s < duration_s) {
+        for (i = 0; i < frames; i++) {
+            int16_t s = (int16_t)(8192 * sin(phase));
+
+            buffer[2 * i] = buffer[2 * i + 1] = s;
+            phase += 2 * M_PI * TONE_HZ / rate;
+            if (phase > 2 * M_PI)
+                phase -= 2 * M_PI;
+        }
+
+        enter = now_ms();
+        out->write(out, buffer, bytes);
+        now = now_ms();
+
+        stats_add(&write_ms, now - enter);
+        if (write_ms.count > 1)
+            stats_add(&interval_ms, enter - prev);
+        prev = enter;
+        if (pcm_sim_last_write_play_time(&play) == 0)
+            stats_add(&latency_ms, play.tv_sec * 1000.0 +
+                      play.tv_nsec / 1000000.0 - enter);
+
+        if (get_presentation_position(out, &pos_frames, &pos_ns) == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &when);
+            truth = pcm_sim_frames_presented(&when);
+            est = pos_frames + ((int64_t)when.tv_sec * 1000000000LL + when.tv_nsec -
+                                pos_ns) * (double)rate / 1000000000.0;
+            stats_add(&drift_ms, (est - (double)truth) * 1000.0 / rate);
+        }
+        out->get_render_position(out, &render);
+        if (render < last_render)
+            regressions++;
+        last_render = render;
+
+        ++writes;
+        if (standby_every && writes % standby_every == 0)
+            out->common.standby(&out->common);
+        if (xrun_every && writes % xrun_every == 0) {
+            /* let the DMA drain the whole buffer and stop */
+            usleep((out->get_latency(out) + 2 * period_ms) * 1000);
+            out->get_render_position(out, &render);
+            if (render < last_render)
+                regressions++;
+            last_render = render;
+            prev = now_ms();
+        }
+        audio_s += period_ms / 1000.0;
+    }
+
+    if (in)
+        pthread_join(capture_tid, NULL);
+    now = now_ms();
+    pcm_sim_get_stats(&sim);
+
+    printf("playback:\n");
+    stats_print("write call", &write_ms);
+    stats_print("write interval", &interval_ms);
+    printf("  %-22s %.3f ms nominal, %.3f ms mean deviation\n", "write jitter",
+           period_ms, interval_ms.count ?
+           fabs(interval_ms.sum / interval_ms.count - period_ms) : 0.0);
+    stats_print("end-to-end latency", &latency_ms);
+    printf("  %-22s %llu written, %llu played, %u underruns, %u pcm opens\n",
+           "frames", (unsigned long long)sim.frames_written,
+           (unsigned long long)sim.frames_played, sim.underruns, sim.opens);
+    stats_print("position drift", &drift_ms);
+    max_drift = fabs(drift_ms.min) > fabs(drift_ms.max) ?
+            fabs(drift_ms.min) : fabs(drift_ms.max);
+    printf("  %-22s %u frames rendered, %u regressions, %u latency ms\n",
+           "render position", last_render, regressions, out->get_latency(out));
+    if (in) {
+        printf("capture:\n");
+        stats_print("read interval", &capture.interval_ms);
+        printf("  %-22s %llu read, %u overruns\n", "frames",
+               (unsigned long long)capture.frames, sim.overruns);
+    }
+    printf("wall time %.1f s for %.1f s of audio, cpu %.3f ms per second of audio\n",
+           (now - start) / 1000.0, audio_s, (cpu_ms() - cpu_start) / audio_s);
+
+    if (in)
+        adev->close_input_stream(adev, in);
+    adev->close_output_stream(adev, out);
+    adev->common.close(&adev->common);
+    free(buffer);
+
+    if (drift_ms.count == 0 || max_drift >= MAX_POSITION_DRIFT_MS || regressions) {
+        printf("FAIL: presentation position\n");
+        return 1;
+    }
+    printf("PASS: presentation position within %.3f ms of the DAC\n", max_drift);
+    return 0;
+}
@@ -0,0 +1,659 @@
+/*
+ * Copyright (C) 2011 Texas Instruments
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * File-backed stand-in for the tinyalsa calls used by audio_hw.c.
+ *
+ * A simulated DMA clock runs in real time from the moment a stream is
+ * started. Playback frames are drained from the ring buffer by that clock
+ * and appended to a WAV file; capture frames are produced by the same clock
+ * and taken from a WAV file (looped, or silence when no file is given).
+ * As on the real McBSP DMA the hardware pointer only moves on period
+ * boundaries, so pcm_get_htimestamp() reports the time of the last period
+ * interrupt.
+ */
+
+#define LOG_TAG "pcm_sim"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cutils/log.h>
+#include <tinyalsa/asoundlib.h>
+
+#include "pcm_sim.h"
+
+#define NSEC_PER_SEC 1000000000LL
+
+#define WAV_HEADER_SIZE 44
+#define SIM_MIXER_MAX_CTLS 32
+
+struct pcm {
+    unsigned int flags;
+    struct pcm_config config;
+    unsigned int frame_size;    /* bytes per frame */
+    unsigned int buffer_size;   /* frames */
+    char *ring;
+    int running;
+    int xrun;
+    int64_t start_ns;           /* time the DMA was (re)started */
+    uint64_t seg_base;          /* hw_ptr at the time the DMA was (re)started */
+    uint64_t hw_ptr;            /* frames moved by the DMA, in whole periods */
+    uint64_t appl_ptr;          /* frames moved by the application */
+    int64_t hw_tstamp_ns;       /* time of the last period interrupt */
+    uint64_t last_write_frame;  /* appl_ptr at the start of the last write */
+    char error[128];
+};
+
+struct mixer_ctl {
+    char name[64];
+    int values[2];
+    char enum_value[32];
+};
+
+struct mixer {
+    struct mixer_ctl ctls[SIM_MIXER_MAX_CTLS];
+    unsigned int count;
+};
+
+struct wav_file {
+    FILE *file;
+    unsigned int channels;
+    unsigned int rate;
+    long data_offset;
+    uint32_t data_bytes;
+};
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct pcm_sim_stats sim_stats;
+static struct pcm *sim_playback;
+static struct wav_file sim_out;
+static struct wav_file sim_in;
+static struct pcm bad_pcm = {
+    .error = "pcm_sim: out of memory",
+};
+static struct mixer sim_mixer;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void ns_to_timespec(int64_t ns, struct timespec *ts)
+{
+    ts->tv_sec = ns / NSEC_PER_SEC;
+    ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+static int64_t frames_to_ns(const struct pcm *pcm, uint64_t frames)
+{
+    return (int64_t)(frames * NSEC_PER_SEC / pcm->config.rate);
+}
+
+/** WAV file helpers **/
+
+static void put_le16(unsigned char *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_le32(unsigned char *p, uint32_t v)
+{
+    put_le16(p, v & 0xffff);
+    put_le16(p + 2, v >> 16);
+}
+
+static uint32_t get_le32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void wav_write_header(struct wav_file *wav)
+{
+    unsigned char hdr[WAV_HEADER_SIZE];
+
+    memcpy(hdr, "RIFF", 4);
+    put_le32(hdr + 4, 36 + wav->data_bytes);
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    put_le32(hdr + 16, 16);
+    put_le16(hdr + 20, 1);                              /* PCM */
+    put_le16(hdr + 22, wav->channels);
+    put_le32(hdr + 24, wav->rate);
+    put_le32(hdr + 28, wav->rate * wav->channels * 2);  /* byte rate */
+    put_le16(hdr + 32, wav->channels * 2);              /* block align */
+    put_le16(hdr + 34, 16);
+    memcpy(hdr + 36, "data", 4);
+    put_le32(hdr + 40, wav->data_bytes);
+
+    fseek(wav->file, 0, SEEK_SET);
+    fwrite(hdr, sizeof(hdr), 1, wav->file);
+    fseek(wav->file, 0, SEEK_END);
+    fflush(wav->file);
+}
+
+/* the output file is shared by every playback stream opened by the process */
+static void wav_open_out(const struct pcm_config *config)
+{
+    const char *path = getenv(PCM_SIM_OUT_FILE_ENV);
+
+    if (sim_out.file || !path)
+        return;
+
+    sim_out.file = fopen(path, "wb");
+    if (!sim_out.file) {
+        LOGE("cannot create %s: %s", path, strerror(errno));
+        return;
+    }
+    sim_out.channels = config->channels;
+    sim_out.rate = config->rate;
+    sim_out.data_bytes = 0;
+    wav_write_header(&sim_out);
+}
+
+static void wav_open_in(const struct pcm_config *config)
+{
+    const char *path = getenv(PCM_SIM_IN_FILE_ENV);
+    unsigned char chunk[8];
+    unsigned char fmt[16];
+    uint32_t size;
+
+    if (sim_in.file || !path)
+        return;
+
+    sim_in.file = fopen(path, "rb");
+    if (!sim_in.file) {
+        LOGE("cannot open %s: %s", path, strerror(errno));
+        return;
+    }
+
+    if (fread(chunk, 8, 1, sim_in.file) != 1 || memcmp(chunk, "RIFF", 4) ||
+            fread(chunk, 4, 1, sim_in.file) != 1 || memcmp(chunk, "WAVE", 4))
+        goto bad_file;
+
+    sim_in.channels = 0;
+    while (fread(chunk, 8, 1, sim_in.file) == 1) {
+        size = get_le32(chunk + 4);
+        if (!memcmp(chunk, "fmt ", 4) && size >= sizeof(fmt)) {
+            if (fread(fmt, sizeof(fmt), 1, sim_in.file) != 1)
+                goto bad_file;
+            /* only 16-bit PCM is supported */
+            if (fmt[0] != 1 || fmt[1] != 0 || fmt[14] != 16)
+                goto bad_file;
+            sim_in.channels = fmt[2] | (fmt[3] << 8);
+            sim_in.rate = get_le32(fmt + 4);
+            size -= sizeof(fmt);
+        } else if (!memcmp(chunk, "data", 4) && sim_in.channels) {
+            sim_in.data_offset = ftell(sim_in.file);
+            sim_in.data_bytes = size;
+            if (sim_in.rate != config->rate)
+                LOGW("%s is %u Hz, capture runs at %u Hz", path, sim_in.rate,
+                     config->rate);
+            return;
+        }
+        fseek(sim_in.file, (size + 1) & ~1, SEEK_CUR);
+    }
+
+bad_file:
+    LOGE("%s is not a 16-bit PCM WAV file, capturing silence", path);
+    fclose(sim_in.file);
+    sim_in.file = NULL;
+}
+
+/* read frames from the capture file, looping at its end */
+static void wav_read_frames(int16_t *dst, unsigned int frames, unsigned int channels)
+{
+    int16_t sample[8];
+    unsigned int i, c;
+
+    if (!sim_in.file || sim_in.channels > 8) {
+        memset(dst, 0, frames * channels * sizeof(int16_t));
+        return;
+    }
+
+    for (i = 0; i < frames; i++) {
+        if (fread(sample, sim_in.channels * sizeof(int16_t), 1, sim_in.file) != 1) {
+            fseek(sim_in.file, sim_in.data_offset, SEEK_SET);
+            if (fread(sample, sim_in.channels * sizeof(int16_t), 1, sim_in.file) != 1) {
+                memset(dst, 0, (frames - i) * channels * sizeof(int16_t));
+                return;
+            }
+        }
+        for (c = 0; c < channels; c++)
+            *dst++ = sample[c < sim_in.channels ? c : sim_in.channels - 1];
+    }
+}
+
+/** simulated DMA **/
+
+/* must be called with sim_lock held */
+static void pcm_sim_start(struct pcm *pcm, int64_t now)
+{
+    pcm->running = 1;
+    pcm->start_ns = now;
+    pcm->seg_base = pcm->hw_ptr;
+    pcm->hw_tstamp_ns = now;
+}
+
+/* must be called with sim_lock held */
+static void pcm_sim_stop(struct pcm *pcm)
+{
+    pcm->running = 0;
+    pcm->appl_ptr = pcm->hw_ptr;
+}
+
+/* write the frames between two hardware pointer positions to the output file */
+static void pcm_sim_drain(struct pcm *pcm, uint64_t from, uint64_t to)
+{
+    unsigned int offset, n;
+
+    sim_stats.frames_played += to - from;
+    while (from < to) {
+        offset = from % pcm->buffer_size;
+        n = pcm->buffer_size - offset;
+        if (n > to - from)
+            n = to - from;
+        if (sim_out.file) {
+            fwrite(pcm->ring + offset * pcm->frame_size, pcm->frame_size, n,
+                   sim_out.file);
+            sim_out.data_bytes += n * pcm->frame_size;
+        }
+        from += n;
+    }
+}
+
+/* advance the hardware pointer to the last period boundary before now,
+ * must be called with sim_lock held */
+static void pcm_sim_update(struct pcm *pcm, int64_t now)
+{
+    uint64_t elapsed, hw_ptr;
+
+    if (!pcm->running)
+        return;
+
+    elapsed = (uint64_t)(now - pcm->start_ns) * pcm->config.rate / NSEC_PER_SEC;
+    elapsed -= elapsed % pcm->config.period_size;
+    hw_ptr = pcm->seg_base + elapsed;
+    if (hw_ptr == pcm->hw_ptr)
+        return;
+
+    if (pcm->flags & PCM_IN) {
+        pcm->hw_ptr = hw_ptr;
+        pcm->hw_tstamp_ns = pcm->start_ns + frames_to_ns(pcm, elapsed);
+        if (pcm->hw_ptr - pcm->appl_ptr > pcm->buffer_size) {
+            /* the reader fell behind by more than the buffer: restart */
+            sim_stats.overruns++;
+            pcm_sim_stop(pcm);
+        }
+        return;
+    }
+
+    if (hw_ptr >= pcm->appl_ptr) {
+        /* the DMA ran out of data before the next write */
+        pcm_sim_drain(pcm, pcm->hw_ptr, pcm->appl_ptr);
+        pcm->hw_ptr = pcm->appl_ptr;
+        pcm->xrun = 1;
+        sim_stats.underruns++;
+        pcm_sim_stop(pcm);
+        return;
+    }
+
+    pcm_sim_drain(pcm, pcm->hw_ptr, hw_ptr);
+    pcm->hw_ptr = hw_ptr;
+    pcm->hw_tstamp_ns = pcm->start_ns + frames_to_ns(pcm, elapsed);
+}
+
+/* sleep until the next period interrupt, must be called with sim_lock held */
+static void pcm_sim_wait_period(struct pcm *pcm)
+{
+    struct timespec ts;
+    uint64_t period = pcm->config.period_size;
+    uint64_t next = (pcm->hw_ptr - pcm->seg_base) / period * period + period;
+
+    ns_to_timespec(pcm->start_ns + frames_to_ns(pcm, next), &ts);
+    pthread_mutex_unlock(&sim_lock);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    pthread_mutex_lock(&sim_lock);
+}
+
+static int pcm_sim_write(struct pcm *pcm, const void *data, unsigned int frames)
+{
+    const char *src = data;
+    unsigned int done = 0, avail, offset, n;
+    int64_t now;
+    int ret = 0;
+
+    if ((pcm->flags & PCM_IN) || !pcm_is_ready(pcm))
+        return -EINVAL;
+
+    pthread_mutex_lock(&sim_lock);
+    while (done < frames) {
+        now = now_ns();
+        pcm_sim_update(pcm, now);
+        if (pcm->xrun) {
+            pcm->xrun = 0;
+            ret = -EPIPE;
+            break;
+        }
+
+        avail = pcm->buffer_size - (pcm->appl_ptr - pcm->hw_ptr);
+        if (avail == 0) {
+            if (!pcm->running)
+                pcm_sim_start(pcm, now);
+            else
+                pcm_sim_wait_period(pcm);
+            continue;
+        }
+
+        if (done == 0)
+            pcm->last_write_frame = pcm->appl_ptr;
+
+        n = frames - done;
+        if (n > avail)
+            n = avail;
+        offset = pcm->appl_ptr % pcm->buffer_size;
+        if (n > pcm->buffer_size - offset)
+            n = pcm->buffer_size - offset;
+        memcpy(pcm->ring + offset * pcm->frame_size, src + done * pcm->frame_size,
+               n * pcm->frame_size);
+        pcm->appl_ptr += n;
+        done += n;
+        sim_stats.frames_written += n;
+
+        if (!pcm->running &&
+                pcm->appl_ptr - pcm->hw_ptr >= pcm->config.start_threshold)
+            pcm_sim_start(pcm, now);
+    }
+    pthread_mutex_unlock(&sim_lock);
+
+    return ret < 0 ? ret : (int)done;
+}
+
+/** tinyalsa interface **/
+
+struct pcm *pcm_open(unsigned int card, unsigned int device,
+                     unsigned int flags, struct pcm_config *config)
+{
+    struct pcm *pcm;
+
+    pcm = calloc(1, sizeof(struct pcm));
+    if (!pcm)
+        return &bad_pcm;
+
+    pcm->flags = flags;
+    if (config)
+        pcm->config = *config;
+    if (!config || !config->rate || !config->period_size || !config->period_count ||
+            config->format != PCM_FORMAT_S16_LE) {
+        snprintf(pcm->error, sizeof(pcm->error),
+                 "pcm_sim: unsupported config for card %u device %u", card, device);
+        return pcm;
+    }
+
+    /* same defaults as tinyalsa's software parameters */
+    if (!pcm->config.start_threshold)
+        pcm->config.start_threshold = config->period_count * config->period_size / 2;
+    if (!pcm->config.avail_min)
+        pcm->config.avail_min = config->period_size;
+
+    pcm->frame_size = config->channels * sizeof(int16_t);
+    pcm->buffer_size = config->period_size * config->period_count;
+    pcm->ring = calloc(pcm->buffer_size, pcm->frame_size);
+    if (!pcm->ring) {
+        snprintf(pcm->error, sizeof(pcm->error), "pcm_sim: out of memory");
+        return pcm;
+    }
+
+    pthread_mutex_lock(&sim_lock);
+    if (flags & PCM_IN) {
+        wav_open_in(config);
+    } else {
+        wav_open_out(config);
+        sim_playback = pcm;
+    }
+    sim_stats.opens++;
+    pthread_mutex_unlock(&sim_lock);
+
+    return pcm;
+}
+
+int pcm_close(struct pcm *pcm)
+{
+    if (!pcm || pcm == &bad_pcm)
+        return 0;
+
+    pthread_mutex_lock(&sim_lock);
+    if (!(pcm->flags & PCM_IN)) {
+        /* frames still queued are dropped, as on a real close */
+        pcm_sim_update(pcm, now_ns());
+        if (sim_out.file)
+            wav_write_header(&sim_out);
+        if (sim_playback == pcm)
+            sim_playback = NULL;
+    }
+    pthread_mutex_unlock(&sim_lock);
+
+    free(pcm->ring);
+    free(pcm);
+    return 0;
+}
+
+int pcm_is_ready(struct pcm *pcm)
+{
+    return pcm && pcm != &bad_pcm && pcm->error[0] == '\0';
+}
+
+const char *pcm_get_error(struct pcm *pcm)
+{
+    return pcm->error;
+}
+
+unsigned int pcm_get_buffer_size(struct pcm *pcm)
+{
+    return pcm->buffer_size;
+}
+
+int pcm_get_htimestamp(struct pcm *pcm, unsigned int *avail,
+                       struct timespec *tstamp)
+{
+    if (!pcm_is_ready(pcm))
+        return -1;
+
+    pthread_mutex_lock(&sim_lock);
+    pcm_sim_update(pcm, now_ns());
+    if (!pcm->running) {
+        pthread_mutex_unlock(&sim_lock);
+        return -1;
+    }
+    if (pcm->flags & PCM_IN)
+        *avail = pcm->hw_ptr - pcm->appl_ptr;
+    else
+        *avail = pcm->buffer_size - (pcm->appl_ptr - pcm->hw_ptr);
+    ns_to_timespec(pcm->hw_tstamp_ns, tstamp);
+    pthread_mutex_unlock(&sim_lock);
+
+    return 0;
+}
+
+int pcm_write(struct pcm *pcm, void *data, unsigned int count)
+{
+    int ret = pcm_sim_write(pcm, data, count / pcm->frame_size);
+
+    return ret < 0 ? ret : 0;
+}
+
+int pcm_mmap_write(struct pcm *pcm, void *data, unsigned int count)
+{
+    if ((~pcm->flags) & (PCM_OUT | PCM_MMAP))
+        return -ENOSYS;
+
+    return pcm_sim_write(pcm, data, count / pcm->frame_size);
+}
+
+int pcm_read(struct pcm *pcm, void *data, unsigned int count)
+{
+    char *dst = data;
+    unsigned int frames, done = 0, n;
+    int64_t now;
+
+    if (!(pcm->flags & PCM_IN) || !pcm_is_ready(pcm))
+        return -EINVAL;
+
+    frames = count / pcm->frame_size;
+
+    pthread_mutex_lock(&sim_lock);
+    while (done < frames) {
+        now = now_ns();
+        if (!pcm->running)
+            pcm_sim_start(pcm, now);
+        pcm_sim_update(pcm, now);
+        if (!pcm->running)
+            continue;
+
+        n = pcm->hw_ptr - pcm->appl_ptr;
+        if (n == 0) {
+            pcm_sim_wait_period(pcm);
+            continue;
+        }
+        if (n > frames - done)
+            n = frames - done;
+        wav_read_frames((int16_t *)(dst + done * pcm->frame_size), n,
+                        pcm->config.channels);
+        pcm->appl_ptr += n;
+        done += n;
+    }
+    sim_stats.frames_captured += done;
+    pthread_mutex_unlock(&sim_lock);
+
+    return 0;
+}
+
+struct mixer *mixer_open(unsigned int card)
+{
+    return &sim_mixer;
+}
+
+void mixer_close(struct mixer *mixer)
+{
+}
+
+/* every control exists on the simulated card; it is created on first lookup */
+struct mixer_ctl *mixer_get_ctl_by_name(struct mixer *mixer, const char *name)
+{
+    struct mixer_ctl *ctl = NULL;
+    unsigned int i;
+
+    pthread_mutex_lock(&sim_lock);
+    for (i = 0; i < mixer->count; i++) {
+        if (!strcmp(mixer->ctls[i].name, name)) {
+            ctl = &mixer->ctls[i];
+            break;
+        }
+    }
+    if (!ctl && mixer->count < SIM_MIXER_MAX_CTLS) {
+        ctl = &mixer->ctls[mixer->count++];
+        strncpy(ctl->name, name, sizeof(ctl->name) - 1);
+    }
+    pthread_mutex_unlock(&sim_lock);
+
+    return ctl;
+}
+
+unsigned int mixer_ctl_get_num_values(struct mixer_ctl *ctl)
+{
+    return 2;
+}
+
+int mixer_ctl_set_value(struct mixer_ctl *ctl, unsigned int id, int value)
+{
+    if (!ctl || id >= 2)
+        return -EINVAL;
+
+    ctl->values[id] = value;
+    return 0;
+}
+
+int mixer_ctl_set_enum_by_string(struct mixer_ctl *ctl, const char *string)
+{
+    if (!ctl)
+        return -EINVAL;
+
+    strncpy(ctl->enum_value, string, sizeof(ctl->enum_value) - 1);
+    return 0;
+}
+
+/** simulator queries **/
+
+void pcm_sim_get_stats(struct pcm_sim_stats *stats)
+{
+    pthread_mutex_lock(&sim_lock);
+    if (sim_playback)
+        pcm_sim_update(sim_playback, now_ns());
+    *stats = sim_stats;
+    pthread_mutex_unlock(&sim_lock);
+}
+
+uint64_t pcm_sim_frames_presented(const struct timespec *when)
+{
+    struct pcm *pcm;
+    int64_t t = (int64_t)when->tv_sec * NSEC_PER_SEC + when->tv_nsec;
+    uint64_t frames, pos;
+
+    pthread_mutex_lock(&sim_lock);
+    pcm = sim_playback;
+    if (pcm)
+        pcm_sim_update(pcm, now_ns());
+    frames = sim_stats.frames_played;
+    if (pcm && pcm->running && t > pcm->start_ns) {
+        /* frames_played stops at hw_ptr, add the part of the current period */
+        pos = pcm->seg_base +
+              (uint64_t)(t - pcm->start_ns) * pcm->config.rate / NSEC_PER_SEC;
+        if (pos > pcm->appl_ptr)
+            pos = pcm->appl_ptr;
+        frames = frames + pos - pcm->hw_ptr;
+    }
+    pthread_mutex_unlock(&sim_lock);
+
+    return frames;
+}
+
+int pcm_sim_last_write_play_time(struct timespec *play_time)
+{
+    struct pcm *pcm;
+    int ret = 0;
+
+    pthread_mutex_lock(&sim_lock);
+    pcm = sim_playback;
+    if (!pcm)
+        ret = -ENODEV;
+    else if (!pcm->running || pcm->last_write_frame < pcm->seg_base)
+        ret = -EAGAIN;
+    else
+        ns_to_timespec(pcm->start_ns +
+                       frames_to_ns(pcm, pcm->last_write_frame - pcm->seg_base),
+                       play_time);
+    pthread_mutex_unlock(&sim_lock);
+
+    return ret;
+}
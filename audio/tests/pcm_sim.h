@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2011 Texas Instruments
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PCM_SIM_H
+#define PCM_SIM_H
+
+#include <stdint.h>
+#include <time.h>
+
+/* environment variables naming the WAV files backing the simulated card */
+#define PCM_SIM_OUT_FILE_ENV "PCM_SIM_OUT_FILE"
+#define PCM_SIM_IN_FILE_ENV  "PCM_SIM_IN_FILE"
+
+struct pcm_sim_stats {
+    unsigned int opens;          /* pcm_open() calls that succeeded */
+    uint64_t frames_written;     /* frames queued by pcm_mmap_write/pcm_write */
+    uint64_t frames_played;      /* frames drained by the playback DMA */
+    uint64_t frames_captured;    /* frames returned by pcm_read */
+    unsigned int underruns;
+    unsigned int overruns;
+};
+
+/* snapshot of the counters accumulated since program start */
+void pcm_sim_get_stats(struct pcm_sim_stats *stats);
+
+/*
+ * Time at which the first frame of the most recent playback write reaches
+ * the DAC. Returns -EAGAIN while the stream has not been started yet (the
+ * write only primed the buffer) and -ENODEV when no playback stream is open.
+ */
+int pcm_sim_last_write_play_time(struct timespec *play_time);
+
+/*
+ * Number of playback frames that have reached the DAC at the given
+ * CLOCK_MONOTONIC time, summed over every playback stream. Unlike the
+ * hardware pointer this is not rounded to periods; it is the reference
+ * against which the HAL's presentation position is checked.
+ */
+uint64_t pcm_sim_frames_presented(const struct timespec *when);
+
+#endif /* PCM_SIM_H */
@@ -41,6 +41,22 @@
  *      -T: Set scriptable mode. If set, cexec will run to completion after
  *          loading and running a DSP target. User will not be able to stop 
  *          the loaded DSP target.
+ *      -c [stamp file]: cached boot. After a successful boot the identity
+ *          of the image (device, inode, size, mtime) is written to the stamp
+ *          file; when the DSP is found running and the stamp matches, Stop,
+ *          Load and Start are skipped. The DSP-side symbol resolution is done
+ *          by the loader in the driver, so this is what can be saved from
+ *          user space on repeat boots. Only use it when cexec is the sole
+ *          loader of base images.
+ *      -d: boot in the background. cexec returns at once and the boot
+ *          carries on in a child process; implies -T. Use -r or -s to learn
+ *          when it is done.
+ *      -r [file]: when the boot is done, write "ready" or "failed 0x<status>"
+ *          to this file (created atomically through a rename).
+ *      -s [socket]: when the boot is done, connect to this Unix stream
+ *          socket and send the same line.
+ *
+ *      The time taken by each boot phase is printed on a monotonic clock.
  *  
  *  Example:
  *      1.  Load and execute a DSP/BIOS Bridge base image, waiting for user to 
@@ -58,6 +74,12 @@
  *
  *          cexec -T chnltest_tiomap1510.x55l
  *
+ *      4.  Boot in the background at system start, skipping the reload when
+ *          the same image already runs, and report through a file.
+ *
+ *          cexec -d -c /data/dsp/baseimage.stamp -r /data/dsp/ready
+ *              baseimage.dof64P
+ *
  *! Revision History:
  *! ================
  *! 20-Oct-2002 map: 	Instrumented to measure performance on PROC_Load
@@ -71,7 +93,12 @@
     
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <dbdefs.h>
 /* #include <varargs.h> */ 
 #include <stdarg.h>
@@ -87,6 +114,15 @@
 /* function prototype. */ 
 VOID DisplayUsage();
 VOID PrintVerbose(PSTR pstrFmt,...);
+static unsigned long long Now(VOID);
+static VOID PrintPhase(PSTR pstrPhase, unsigned long long *pullStart);
+static bool GetImageStamp(PSTR pstrImage, UINT uProcId, CHAR *pStamp,
+			  UINT uSize);
+static bool ImageRunning(DSP_HPROCESSOR hProc, PSTR pstrStampFile,
+			 CHAR *pStamp);
+static VOID WriteFileAtomic(PSTR pstrFile, PSTR pstrText);
+static VOID NotifyReady(PSTR pstrReadyFile, PSTR pstrSocket,
+			DSP_STATUS status);
 
 /* global variables. */ 
 bool g_fVerbose = false;
@@ -102,34 +138,52 @@ INT main(INT argc, CHAR * argv[])
 	bool fError = false;
 	DSP_HPROCESSOR hProc;
 	DSP_STATUS status = DSP_SOK;
-	INT cArgc = 0;		/* local argc count. */
 	bool fScriptable = false;
+	bool fAsync = false;
+	PSTR pstrStampFile = NULL;
+	PSTR pstrReadyFile = NULL;
+	PSTR pstrSocket = NULL;
+	CHAR stamp[128];
+	unsigned long long ullBoot;
+	unsigned long long ullPhase;
+	pid_t pid;
 	extern char *optarg;
+	extern int optind;
 	struct DSP_PROCESSORINFO dspInfo;
 	UINT numProcs;
 	UINT index = 0;
-	while ((opt = getopt(argc, argv, "+T+v+w+?p:")) != EOF) {
+	while ((opt = getopt(argc, argv, "+T+v+w+d+?p:c:r:s:")) != EOF) {
 		switch (opt) {
 		case 'v':
 			/* verbose mode */ 
 			fprintf(stdout, "Verbose mode: ON\n");
 			g_fVerbose = true;
-			cArgc++;
 			break;
 		case 'w':
 			/* wait for user input to terminate */ 
 			fprintf(stdout, "Not supported \n");
 			fWaitForTerminate = true;
-			cArgc++;
 			break;
 		case 'T':
 			fScriptable = true;
-			cArgc++;
+			break;
+		case 'd':
+			/* boot in a background child */
+			fAsync = true;
+			fScriptable = true;
 			break;
 		case 'p':
 			/* user specified DSP processor ID (based on zero-index) */ 
 			uProcId = atoi(optarg);
-			cArgc++;
+			break;
+		case 'c':
+			pstrStampFile = optarg;
+			break;
+		case 'r':
+			pstrReadyFile = optarg;
+			break;
+		case 's':
+			pstrSocket = optarg;
 			break;
 		case '?':
 		default:
@@ -137,54 +191,70 @@ INT main(INT argc, CHAR * argv[])
 			break;
 		}
 	}
-	argv += cArgc + 1;
-	argc -= cArgc + 1;
-	if (fError) {
+	argv += optind;
+	argc -= optind;
+	if (fError || argc < 1) {
 		DisplayUsage();
-	} else {
-		status = (DBAPI)DspManager_Open(0, NULL);
-		if (DSP_FAILED(status)) {
-			PrintVerbose("DSPManager_Open failed \n");
-			return -1;
-		} 
-		while (DSP_SUCCEEDED(DSPManager_EnumProcessorInfo(index,&dspInfo,
-						(UINT)sizeof(struct DSP_PROCESSORINFO),&numProcs))) {
-			if ((dspInfo.uProcessorType == DSPTYPE_55) || 
-									(dspInfo.uProcessorType == DSPTYPE_64)) {
-				printf("DSP device detected !! \n");
-				uProcId = index;
-				status = DSP_SOK;
-				break;
-			}
-			index++;
+		return -1;
+	}
+	if (fAsync) {
+		pid = fork();
+		if (pid < 0) {
+			fprintf(stdout, "fork failed, booting in the foreground\n");
+		} else if (pid > 0) {
+			PrintVerbose("Booting in the background, pid %d.\n", pid);
+			return 0;
+		} else {
+			setsid();
+		}
+	}
+	ullBoot = ullPhase = Now();
+	status = (DBAPI)DspManager_Open(0, NULL);
+	if (DSP_FAILED(status)) {
+		PrintVerbose("DSPManager_Open failed \n");
+		NotifyReady(pstrReadyFile, pstrSocket, status);
+		return -1;
+	} 
+	PrintPhase("open", &ullPhase);
+	while (DSP_SUCCEEDED(DSPManager_EnumProcessorInfo(index,&dspInfo,
+					(UINT)sizeof(struct DSP_PROCESSORINFO),&numProcs))) {
+		if ((dspInfo.uProcessorType == DSPTYPE_55) || 
+								(dspInfo.uProcessorType == DSPTYPE_64)) {
+			printf("DSP device detected !! \n");
+			uProcId = index;
+			status = DSP_SOK;
+			break;
 		}
-		status = DSPProcessor_Attach(uProcId, NULL, &hProc);
-		if (DSP_SUCCEEDED(status)) {
-			PrintVerbose("DSPProcessor_Attach succeeded.\n");
+		index++;
+	}
+	status = DSPProcessor_Attach(uProcId, NULL, &hProc);
+	if (DSP_SUCCEEDED(status)) {
+		PrintVerbose("DSPProcessor_Attach succeeded.\n");
+		PrintPhase("attach", &ullPhase);
+		if (pstrStampFile &&
+			GetImageStamp(argv[0], uProcId, stamp, sizeof(stamp)) &&
+			ImageRunning(hProc, pstrStampFile, stamp)) {
+			fprintf(stdout, "%s already running, boot skipped.\n",
+																argv[0]);
+		} else {
+			/* the image is about to be replaced */
+			if (pstrStampFile)
+				unlink(pstrStampFile);
 			status = DSPProcessor_Stop(hProc);
 			if (DSP_SUCCEEDED(status)) {
 				PrintVerbose("DSPProcessor_Stop succeeded.\n");
+				PrintPhase("stop", &ullPhase);
 				status = DSPProcessor_Load(hProc,argc,(CONST CHAR **)argv,NULL);
 				if (DSP_SUCCEEDED(status)) {
 					PrintVerbose("DSPProcessor_Load succeeded.\n");
+					PrintPhase("load", &ullPhase);
 					status = DSPProcessor_Start(hProc);
 					if (DSP_SUCCEEDED(status)) {
 						fprintf(stdout,"DSPProcessor_Start succeeded.\n");
-#if 0                    
-						/* It seems Linux bridge does n't yet support
-						 * * DSPProcessor_GetTrace */ 
-						if (fWaitForTerminate) { 
-							/* wait for user */ 
-							fprintf(stdout,"Hit \"return\" to stop DSP and"
-													"dump trace buffer:\n");
-							(void)getchar();
-							status = DSPProcessor_GetTrace(hProc,
-												(BYTE *)&traceBuf,MAXTRACESIZE);
-							fprintf(stdout,"%s\n",traceBuf);
-						} else {
-							PrintVerbose("in run free mode...\n");
-						}
-#endif	/* 0 */
+						PrintPhase("start", &ullPhase);
+						if (pstrStampFile && GetImageStamp(argv[0], uProcId,
+											stamp, sizeof(stamp)))
+							WriteFileAtomic(pstrStampFile, stamp);
 					} else {
 						PrintVerbose("DSPProcessor_Start failed: 0x%x.\n",
 																		status);
@@ -192,21 +262,24 @@ INT main(INT argc, CHAR * argv[])
 				} else {
 					PrintVerbose("DSPProcessor_Load failed: 0x%x.\n",status);
 				}
-				DSPProcessor_Detach(hProc);
 			}
-		} else {
-			PrintVerbose("DSPProcessor_Attach failed: 0x%x.\n",status);
 		}
+		DSPProcessor_Detach(hProc);
+	} else {
+		PrintVerbose("DSPProcessor_Attach failed: 0x%x.\n",status);
 	}
+	PrintPhase("total", &ullBoot);
+	NotifyReady(pstrReadyFile, pstrSocket, status);
 	if (!fScriptable) {
 		/* Wait for user to hit any key before exiting. */ 
 		fprintf(stdout, "Hit any key to terminate cexec.\n");
 		(void)getchar();
 	}
-	status = DspManager_Close(0, NULL);
-	if (DSP_FAILED(status)) {
+	if (DSP_FAILED(DspManager_Close(0, NULL))) {
 		printf("\nERROR: DSPManager Close FAILED\n");
+		status = DSP_EFAIL;
 	}
+	/* a failed boot must fail the startup script too */
 	return (DSP_SUCCEEDED(status) ? 0 : -1);
 }
 
@@ -219,6 +292,12 @@ VOID DisplayUsage()
 	fprintf(stdout, "\t-w: Waits for user to hit enter key before\n");
 	fprintf(stdout, "\t    terminating. Displays trace buffer\n");
 	fprintf(stdout, "\t-p [processor]: User-specified processor #\n");
+	fprintf(stdout, "\t-T: Scriptable mode, exit once the DSP is started\n");
+	fprintf(stdout, "\t-c [stamp file]: Skip the boot when the DSP already\n");
+	fprintf(stdout, "\t    runs the image recorded in the stamp file\n");
+	fprintf(stdout, "\t-d: Boot in the background\n");
+	fprintf(stdout, "\t-r [file]: Write the boot result to a file\n");
+	fprintf(stdout, "\t-s [socket]: Send the boot result to a Unix socket\n");
 	fprintf(stdout, "\n\t[required arguments]:\n");
 	fprintf(stdout, "\t<dsp program>\n");
 	fprintf(stdout, "\n\tExample: cexec -w -p 1 prog.x55l\n\n");
@@ -239,4 +318,127 @@ VOID PrintVerbose(PSTR pstrFmt,...)
 	}
 }
 
+/*
+ * ======== Now ========
+ *  Monotonic time in ns.
+ */
+static unsigned long long Now(VOID)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * ======== PrintPhase ========
+ *  Print the time since *pullStart and restart the clock.
+ */
+static VOID PrintPhase(PSTR pstrPhase, unsigned long long *pullStart)
+{
+	unsigned long long ullNow = Now();
+
+	fprintf(stdout, "cexec: %-8s %10.3f ms\n", pstrPhase,
+			(ullNow - *pullStart) / 1e6);
+	fflush(stdout);
+	*pullStart = ullNow;
+}
 
+/*
+ * ======== GetImageStamp ========
+ *  Identity of the image file, as recorded in the stamp file.
+ */
+static bool GetImageStamp(PSTR pstrImage, UINT uProcId, CHAR *pStamp,
+			  UINT uSize)
+{
+	struct stat st;
+
+	if (stat(pstrImage, &st) != 0) {
+		PrintVerbose("Cannot stat %s.\n", pstrImage);
+		return false;
+	}
+	snprintf(pStamp, uSize, "%u %lu %lu %lld %ld\n", uProcId,
+			(unsigned long)st.st_dev, (unsigned long)st.st_ino,
+			(long long)st.st_size, (long)st.st_mtime);
+	return true;
+}
+
+/*
+ * ======== ImageRunning ========
+ *  True when the DSP runs and the stamp file names the same image.
+ */
+static bool ImageRunning(DSP_HPROCESSOR hProc, PSTR pstrStampFile,
+			 CHAR *pStamp)
+{
+	struct DSP_PROCESSORSTATE procState;
+	CHAR buf[128];
+	FILE *fp;
+	bool fMatch = false;
+
+	if (DSP_FAILED(DSPProcessor_GetState(hProc, &procState,
+						sizeof(procState))) ||
+		procState.iState != PROC_RUNNING)
+		return false;
+
+	fp = fopen(pstrStampFile, "r");
+	if (fp) {
+		fMatch = fgets(buf, sizeof(buf), fp) && !strcmp(buf, pStamp);
+		fclose(fp);
+	}
+	return fMatch;
+}
+
+/*
+ * ======== WriteFileAtomic ========
+ *  Replace pstrFile with pstrText, so readers never see a partial file.
+ */
+static VOID WriteFileAtomic(PSTR pstrFile, PSTR pstrText)
+{
+	CHAR tmpName[256];
+	FILE *fp;
+
+	snprintf(tmpName, sizeof(tmpName), "%s.tmp", pstrFile);
+	fp = fopen(tmpName, "w");
+	if (fp == NULL) {
+		fprintf(stdout, "Cannot write %s\n", tmpName);
+		return;
+	}
+	fputs(pstrText, fp);
+	if (fclose(fp) != 0 || rename(tmpName, pstrFile) != 0) {
+		fprintf(stdout, "Cannot write %s\n", pstrFile);
+		unlink(tmpName);
+	}
+}
+
+/*
+ * ======== NotifyReady ========
+ *  Report the outcome of the boot through the ready file and/or socket.
+ */
+static VOID NotifyReady(PSTR pstrReadyFile, PSTR pstrSocket,
+			DSP_STATUS status)
+{
+	struct sockaddr_un addr;
+	CHAR msg[32];
+	INT sock;
+
+	if (DSP_SUCCEEDED(status))
+		snprintf(msg, sizeof(msg), "ready\n");
+	else
+		snprintf(msg, sizeof(msg), "failed 0x%x\n", (UINT)status);
+
+	if (pstrReadyFile)
+		WriteFileAtomic(pstrReadyFile, msg);
+
+	if (pstrSocket) {
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, pstrSocket, sizeof(addr.sun_path) - 1);
+		sock = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (sock < 0 ||
+			connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+			write(sock, msg, strlen(msg)) < 0)
+			fprintf(stdout, "Cannot notify %s\n", pstrSocket);
+		if (sock >= 0)
+			close(sock);
+	}
+}
@@ -23,6 +23,7 @@
  *
  *  Public Functions:
  *      DSPProcessor_Attach
+ *      DSPProcessor_CacheOperations
  *      DSPProcessor_Detach
  *      DSPProcessor_EnumNodes
  *      DSPProcessor_FlushMemory
@@ -178,6 +179,35 @@ extern "C" {
                                               PVOID pMpuAddr,
 	                                             ULONG ulSize);
 
+/*
+ *  ======== DSPProcessor_CacheOperations ========
+ *  Purpose:
+ *      Flushes and invalidates several buffers in one call.
+ *  Parameters:
+ *      hProcessor      :   The processor handle.
+ *      aOps            :   The ranges, each with its DSP_CACHEOP_ operation
+ *                          and, for flushes, the DSPProcessor_FlushMemory
+ *                          flags.
+ *      uCount          :   Number of entries in aOps.
+ *  Returns:
+ *      DSP_SOK         :   Success.
+ *      DSP_EHANDLE     :   Invalid processor handle.
+ *      DSP_EPOINTER    :   aOps is NULL while uCount is not 0.
+ *      DSP_EVALUE      :   An entry has an unknown operation.
+ *      DSP_EFAIL       :   General failure.
+ *  Requires:
+ *      PROC Initialized.
+ *  Ensures:
+ *  Details:
+ *      The whole array goes to the driver in a single call. With a driver
+ *      that does not know the command the entries are applied one at a
+ *      time with DSPProcessor_FlushMemory and DSPProcessor_InvalidateMemory,
+ *      stopping at the first failure.
+ */
+	extern DBAPI DSPProcessor_CacheOperations(DSP_HPROCESSOR hProcessor,
+						  IN struct DSP_CACHEOP *aOps,
+						  UINT uCount);
+
 /*
  *  ======== DSPProcessor_GetResourceInfo ========
  *  Purpose:
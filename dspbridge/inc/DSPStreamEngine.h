@@ -0,0 +1,195 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ * 
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+/*
+ *  ======== DSPStreamEngine.h ========
+ *  Description:
+ *      Streaming engine on top of the DSP/BIOS Bridge stream module, for
+ *      moving PCM or bitstream data to and from a task node without node
+ *      messages.
+ *
+ *      The engine keeps a fixed set of buffers in flight on each of its
+ *      streams, waits on all of them at once with DSPStream_Select and
+ *      hands every buffer that comes back to the callback of its stream,
+ *      which refills or consumes it and decides whether it is issued
+ *      again. Buffers are allocated and prepared once, when the stream is
+ *      added, and recycled until the engine is deleted.
+ *
+ *      An engine is driven by one thread at a time; the callbacks run on
+ *      that thread.
+ *
+ *  Public Functions:
+ *      DSPStreamEngine_AddStream
+ *      DSPStreamEngine_Create
+ *      DSPStreamEngine_Delete
+ *      DSPStreamEngine_Pump
+ *      DSPStreamEngine_Run
+ *
+ *  Notes:
+ *
+ *! Revision History:
+ *! ================
+ */
+
+#include <host_os.h>
+
+#ifndef DSPSTREAMENGINE_
+#define DSPSTREAMENGINE_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* DSPStream_Select reports at most this many streams */
+#define DSPSTRMENG_MAXSTREAMS   32
+
+	struct DSPSTRMENG_OBJECT;
+	typedef struct DSPSTRMENG_OBJECT *DSP_HSTRMENGINE;
+
+/*
+ *  ======== DSPSTRMENG_FXN ========
+ *  Purpose:
+ *      Completion callback of a stream.
+ *  Parameters:
+ *      pArg:               As passed to DSPStreamEngine_AddStream.
+ *      hStream:            The stream the buffer belongs to.
+ *      pBuffer:            The buffer.
+ *      ulBytes:            DSP_FROMNODE: the data the node produced.
+ *                          DSP_TONODE: the data it was issued with, 0 for
+ *                          a buffer that has not been issued yet.
+ *      ulBufSize:          Size of the buffer.
+ *      pulIssue:           Bytes to issue the buffer with again, preset to
+ *                          ulBufSize. A DSP_TONODE callback sets it to
+ *                          the data it put in the buffer.
+ *  Returns:
+ *      DSP_SOK:            Issue the buffer again.
+ *      DSP_SFALSE:         Keep the buffer back. A stream ends once all of
+ *                          its buffers have been kept back.
+ *      Other:              Failure, returned by DSPStreamEngine_Pump.
+ */
+	typedef DSP_STATUS(*DSPSTRMENG_FXN) (PVOID pArg, DSP_HSTREAM hStream,
+					     BYTE *pBuffer, ULONG ulBytes,
+					     ULONG ulBufSize,
+					     OUT ULONG *pulIssue);
+
+/*
+ *  ======== DSPStreamEngine_AddStream ========
+ *  Purpose:
+ *      Open a stream of a node and give it uNumBufs buffers of uBufSize
+ *      bytes, allocated with DSPStream_AllocateBuffers and prepared.
+ *  Parameters:
+ *      hEngine:            The engine handle.
+ *      hNode:              The node handle.
+ *      uDirection:         DSP_TONODE or DSP_FROMNODE.
+ *      uIndex:             Stream index of the node.
+ *      pAttrIn:            Stream attributes (optional); uNumBufs is
+ *                          replaced with the uNumBufs argument.
+ *      uNumBufs:           Buffers kept in flight, 2 for double buffering.
+ *      uBufSize:           Size of each buffer.
+ *      pfnComplete:        Callback for the buffers of this stream.
+ *      pArg:               Passed to pfnComplete.
+ *      phStream:           Location to store the stream handle (optional).
+ *  Returns:
+ *      DSP_SOK:            Success.
+ *      DSP_EHANDLE:        Invalid engine handle.
+ *      DSP_EPOINTER:       pfnComplete is NULL.
+ *      DSP_EVALUE:         uNumBufs or uBufSize is 0.
+ *      DSP_ERANGE:         The engine already has DSPSTRMENG_MAXSTREAMS
+ *                          streams.
+ *      DSP_EMEMORY:        Insufficient memory.
+ *      Errors of DSPStream_Open and DSPStream_AllocateBuffers.
+ *  Details:
+ *      Nothing is issued before the next DSPStreamEngine_Pump.
+ */
+	extern DBAPI DSPStreamEngine_AddStream(DSP_HSTRMENGINE hEngine,
+				DSP_HNODE hNode, UINT uDirection, UINT uIndex,
+				IN OPTIONAL struct DSP_STREAMATTRIN *pAttrIn,
+				UINT uNumBufs, UINT uBufSize,
+				DSPSTRMENG_FXN pfnComplete, PVOID pArg,
+				OUT OPTIONAL DSP_HSTREAM *phStream);
+
+/*
+ *  ======== DSPStreamEngine_Create ========
+ *  Purpose:
+ *      Create an engine without streams.
+ *  Parameters:
+ *      phEngine:           Location to store the engine handle.
+ *  Returns:
+ *      DSP_SOK:            Success.
+ *      DSP_EPOINTER:       phEngine is NULL.
+ *      DSP_EMEMORY:        Insufficient memory.
+ */
+	extern DBAPI DSPStreamEngine_Create(OUT DSP_HSTRMENGINE *phEngine);
+
+/*
+ *  ======== DSPStreamEngine_Delete ========
+ *  Purpose:
+ *      Idle and close every stream of the engine, free their buffers and
+ *      the engine.
+ *  Parameters:
+ *      hEngine:            The engine handle.
+ *  Returns:
+ *      DSP_SOK:            Success.
+ *      DSP_EHANDLE:        Invalid engine handle.
+ *      The first failure met while closing the streams; the engine is
+ *      freed regardless.
+ *  Details:
+ *      Buffers still in flight are flushed and reclaimed without going
+ *      through the callbacks.
+ */
+	extern DBAPI DSPStreamEngine_Delete(DSP_HSTRMENGINE hEngine);
+
+/*
+ *  ======== DSPStreamEngine_Pump ========
+ *  Purpose:
+ *      Issue the buffers not issued yet, then wait for the streams once
+ *      and complete one buffer of every stream that is ready.
+ *  Parameters:
+ *      hEngine:            The engine handle.
+ *      uTimeout:           Longest wait in ms, or DSP_FOREVER.
+ *      puCompleted:        Location to store the number of buffers handed
+ *                          to the callbacks (optional).
+ *  Returns:
+ *      DSP_SOK:            Buffers are in flight.
+ *      DSP_SFALSE:         Every stream has ended; nothing is in flight.
+ *      DSP_EHANDLE:        Invalid engine handle.
+ *      DSP_ETIMEOUT:       No stream became ready within uTimeout.
+ *      Failures of a callback or of the stream calls.
+ */
+	extern DBAPI DSPStreamEngine_Pump(DSP_HSTRMENGINE hEngine,
+					  UINT uTimeout,
+					  OUT OPTIONAL UINT *puCompleted);
+
+/*
+ *  ======== DSPStreamEngine_Run ========
+ *  Purpose:
+ *      DSPStreamEngine_Pump until every stream has ended.
+ *  Parameters:
+ *      hEngine:            The engine handle.
+ *      uTimeout:           Longest wait for any one buffer, in ms, or
+ *                          DSP_FOREVER.
+ *  Returns:
+ *      DSP_SOK:            Every stream has ended.
+ *      As DSPStreamEngine_Pump otherwise.
+ */
+	extern DBAPI DSPStreamEngine_Run(DSP_HSTRMENGINE hEngine,
+					 UINT uTimeout);
+
+#ifdef __cplusplus
+}
+#endif
+#endif				/* DSPSTREAMENGINE_ */
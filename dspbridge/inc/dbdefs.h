@@ -596,6 +596,18 @@ bit 6 - MMU element size = 64bit (valid only for non mixed page entries)
 
 #define DSP_MAPVMALLOCADDR         0x00000080
 
+/* Operations of a DSP_CACHEOP entry */
+#define DSP_CACHEOP_FLUSH           0x00000000
+#define DSP_CACHEOP_INVALIDATE      0x00000001
+
+/* One range of a DSPProcessor_CacheOperations() request */
+	struct DSP_CACHEOP {
+		PVOID pMpuAddr;
+		ULONG ulSize;
+		ULONG ulFlags;	/* as for DSPProcessor_FlushMemory */
+		UINT uOp;	/* DSP_CACHEOP_FLUSH or _INVALIDATE */
+	} ;
+
 #if defined (OMAP_2430) || defined (OMAP_3430)
 #define GEM_CACHE_LINE_SIZE     128
 #define GEM_L1P_PREFETCH_SIZE   128
@@ -0,0 +1,139 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ * 
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+/*
+ *  ======== dspemu.h ========
+ *  Description:
+ *      Host-side emulation of the DSP/BIOS Bridge driver, and the interface
+ *      for the node plug-ins that stand in for DSP nodes under emulation.
+ *
+ *      When the emulator is selected every DSPTRAP_Trap() is served in user
+ *      space instead of by the driver. Each node runs in a host thread that
+ *      hands the messages of the GPP to a plug-in. The plug-in for a node
+ *      is found from the library registered for its UUID with
+ *      DSPManager_RegisterObject: "<dir>/mp3dec_sn.dll64P" is served by
+ *      "$DSP_EMU_PLUGIN_PATH/mp3dec_sn.so", which must export
+ *      DSPEMU_NODEPLUGIN_SYMBOL. Nodes without a plug-in get the built-in
+ *      loopback node, which returns every message unchanged; for USN
+ *      socket nodes that acknowledges each command and hands every buffer
+ *      straight back. GPP stream data always loops back: input stream n of
+ *      a node is copied to its output stream n.
+ *
+ *  Environment:
+ *      DSP_BRIDGE_EMULATOR      0 selects the driver instead of the
+ *                               emulator. The emulator is only built in,
+ *                               and read at all, with DSPTRAP_EMULATOR.
+ *      DSP_EMU_PLUGIN_PATH      directory searched for node plug-ins.
+ *      DSP_EMU_MSG_LATENCY_US   one-way mailbox latency, each direction.
+ *      DSP_EMU_NODE_PROCESS_US  time the loopback node spends per message
+ *                               or stream buffer.
+ *      DSP_EMU_FLUSH_NS_PER_KB  cost of a cache flush or invalidate.
+ *
+ *  Public Functions:
+ *      DSPEMU_SendMessage
+ *      DSPEMU_ToMpu
+ *      DSPEMU_GetContext
+ *      DSPEMU_SetContext
+ *      DSPEMU_RaiseProcessorEvent
+ *
+ *! Revision History:
+ *! ================
+ */
+
+#ifndef DSPEMU_
+#define DSPEMU_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <dbdefs.h>
+
+#define DSPEMU_ENABLE_ENV           "DSP_BRIDGE_EMULATOR"
+#define DSPEMU_PLUGIN_PATH_ENV      "DSP_EMU_PLUGIN_PATH"
+#define DSPEMU_MSG_LATENCY_ENV      "DSP_EMU_MSG_LATENCY_US"
+#define DSPEMU_NODE_PROCESS_ENV     "DSP_EMU_NODE_PROCESS_US"
+#define DSPEMU_FLUSH_COST_ENV       "DSP_EMU_FLUSH_NS_PER_KB"
+
+#define DSPEMU_DEFAULT_PLUGIN_PATH  "/system/lib/dspemu"
+#define DSPEMU_DEFAULT_MSG_LATENCY  50	/* us, GPP <-> DSP mailbox */
+
+#define DSPEMU_NODEPLUGIN_SYMBOL    "DSPEMU_NodePlugin"
+
+/* Opaque emulated node, passed to every plug-in callback */
+	struct DSPEMU_NODE;
+
+/*
+ *  ======== DSPEMU_NODEPLUGIN ========
+ *  Callbacks of a host node. pfnCreate and pfnDelete run on the thread
+ *  calling DSPNode_Create / DSPNode_Delete, pfnMessage on the node thread,
+ *  one message at a time, while the node is running. Any callback may be
+ *  NULL.
+ */
+	struct DSPEMU_NODEPLUGIN {
+		CONST CHAR *pszName;
+		DSP_STATUS(*pfnCreate) (struct DSPEMU_NODE *hNode,
+					CONST struct DSP_CBDATA *pArgs);
+		VOID(*pfnMessage) (struct DSPEMU_NODE *hNode,
+				   CONST struct DSP_MSG *pMsg);
+		VOID(*pfnDelete) (struct DSPEMU_NODE *hNode);
+	};
+
+/*
+ *  ======== DSPEMU_SendMessage ========
+ *  Purpose:
+ *      Queue a message from the node to the GPP, as the DSP side of
+ *      DSPNode_GetMessage. Blocks while the GPP queue of the node is full.
+ *  Returns:
+ *      DSP_SOK         : Success.
+ *      DSP_EWRONGSTATE : The node is being terminated.
+ */
+	extern DSP_STATUS DSPEMU_SendMessage(struct DSPEMU_NODE *hNode,
+					     CONST struct DSP_MSG *pMsg);
+
+/*
+ *  ======== DSPEMU_ToMpu ========
+ *  Purpose:
+ *      Translate a DSP address returned by DSPProcessor_Map to the MPU
+ *      address it maps.
+ *  Returns:
+ *      The MPU address, or NULL when [dwDspAddr, dwDspAddr + ulSize) is
+ *      not inside a single mapping.
+ */
+	extern PVOID DSPEMU_ToMpu(DWORD dwDspAddr, ULONG ulSize);
+
+/*
+ *  ======== DSPEMU_GetContext / DSPEMU_SetContext ========
+ *  Purpose:
+ *      Per-node pointer owned by the plug-in.
+ */
+	extern PVOID DSPEMU_GetContext(struct DSPEMU_NODE *hNode);
+	extern VOID DSPEMU_SetContext(struct DSPEMU_NODE *hNode, PVOID pContext);
+
+/*
+ *  ======== DSPEMU_RaiseProcessorEvent ========
+ *  Purpose:
+ *      Signal DSP_MMUFAULT or DSP_SYSERROR to every client registered for
+ *      it, leaving the processor in PROC_ERROR, so that error recovery can
+ *      be exercised without a DSP.
+ */
+	extern VOID DSPEMU_RaiseProcessorEvent(UINT uEvent);
+
+#ifdef __cplusplus
+}
+#endif
+#endif				/* DSPEMU_ */
@@ -11,6 +11,7 @@ LOCAL_SRC_FILES:= \
 	DSPProcessor_OEM.c \
 	DSPNode.c \
 	DSPStrm.c \
+	DSPStrmEngine.c \
 	perfutils.c \
 	dsptrap.c
 
@@ -19,9 +20,49 @@ LOCAL_C_INCLUDES += \
 
 LOCAL_CFLAGS += -pipe -fomit-frame-pointer -Wall  -Wno-trigraphs -Werror-implicit-function-declaration  -fno-strict-aliasing -mapcs -mno-sched-prolog -mabi=aapcs-linux -mno-thumb-interwork -msoft-float -Uarm -DMODULE -D__LINUX_ARM_ARCH__=7  -fno-common -DLINUX -DOMAP_3430 -fpic
 
+# BRIDGE_EMULATOR=1 builds the emulator (dspemu.c) in and serves the Bridge
+# commands from it by default; DSP_BRIDGE_EMULATOR=0 in the environment then
+# selects the driver. Other builds only ever use the driver.
+ifeq ($(BRIDGE_EMULATOR),1)
+LOCAL_SRC_FILES += dspemu.c
+LOCAL_CFLAGS += -DDSPTRAP_EMULATOR
+LOCAL_SHARED_LIBRARIES := libdl
+endif
+
 LOCAL_MODULE:= libbridge
 
 LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_SHARED_LIBRARY)
 
+
+# Host build, always on the emulator: runs LCML and the OMX components on
+# a Linux workstation against host node plug-ins.
+ifeq ($(BUILD_BRIDGE_HOST),1)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	DSPManager.c \
+	DSPProcessor.c \
+	DSPProcessor_OEM.c \
+	DSPNode.c \
+	DSPStrm.c \
+	DSPStrmEngine.c \
+	dsptrap.c \
+	dspemu.c
+
+LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH)/inc
+
+LOCAL_CFLAGS += -Wall -fno-strict-aliasing -DLINUX -DOMAP_3430 -DDSPTRAP_EMULATOR
+
+LOCAL_LDLIBS += -lpthread -ldl
+
+LOCAL_MODULE:= libbridge
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_SHARED_LIBRARY)
+
+endif
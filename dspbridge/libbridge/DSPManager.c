@@ -68,10 +68,6 @@
 
 #include <DSPManager.h>
 
-#ifdef DEBUG_BRIDGE_PERF
-#include <perfutils.h>
-#endif
-
 /*  ----------------------------------- Globals */
 int hMediaFile = -1;		/* class driver handle */
 static ULONG usage_count;
@@ -103,7 +99,12 @@ DBAPI DspManager_Open(UINT argc, PVOID argp)
 
 	sem_wait(&semOpenClose);
 	if (usage_count == 0) {	/* try opening handle to Bridge driver */
-		status = open(BRIDGE_DRIVER_NAME, O_RDWR);
+#ifdef DSPTRAP_EMULATOR
+		if (DSPEMU_Enabled())
+			status = DSPEMU_Open();
+		else
+#endif
+			status = open(BRIDGE_DRIVER_NAME, O_RDWR);
 		if (status >= 0)
 			hMediaFile = status;
 	}
@@ -135,7 +136,12 @@ DBAPI DspManager_Close(UINT argc, PVOID argp)
 	sem_wait(&semOpenClose);
 
 	if (usage_count == 1) {
-		status = close(hMediaFile);
+#ifdef DSPTRAP_EMULATOR
+		if (hMediaFile == DSPEMU_HANDLE)
+			status = DSPEMU_Close();
+		else
+#endif
+			status = close(hMediaFile);
 		if (status >= 0)
 			hMediaFile = -1;
 	}
@@ -294,14 +300,6 @@ DBAPI DSPManager_RegisterObject(IN struct DSP_UUID *pUuid,
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
 		 (TEXT("MGR: DSPManager_RegisterObject\r\n")));
@@ -319,10 +317,6 @@ DBAPI DSPManager_RegisterObject(IN struct DSP_UUID *pUuid,
 		status = DSPTRAP_Trap(&tempStruct,
 					CMD_MGR_REGISTEROBJECT_OFFSET);
 	}
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPManager_RegisterObject", 0);
-#endif
 
 	return status;
 }
@@ -337,14 +331,6 @@ DBAPI DSPManager_UnregisterObject(IN struct DSP_UUID *pUuid,
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
 		 (TEXT("MGR: DSPManager_RegisterObject\r\n")));
@@ -360,11 +346,6 @@ DBAPI DSPManager_UnregisterObject(IN struct DSP_UUID *pUuid,
 		status = DSPTRAP_Trap(&tempStruct,
 				CMD_MGR_UNREGISTEROBJECT_OFFSET);
 	}
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPManager_UnregisterObject", 0);
-
-#endif
 
 	return status;
 }
@@ -94,10 +94,6 @@
 
 #include <DSPNode.h>
 
-#ifdef DEBUG_BRIDGE_PERF
-#include <perfutils.h>
-#endif
-
 /*  ----------------------------------- Globals */
 extern int hMediaFile;		/* class driver handle */
 
@@ -412,14 +408,6 @@ DBAPI DSPNode_Create(DSP_HNODE hNode)
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION, (TEXT("NODE: DSPNode_Create:\r\n")));
@@ -436,12 +424,6 @@ DBAPI DSPNode_Create(DSP_HNODE hNode)
 		(TEXT("NODE: DSPNode_Create: hNode is Invalid Handle\r\n")));
 	}
 
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPNode_Create", 0);
-
-#endif
-
 	return status;
 }
 
@@ -460,14 +442,6 @@ DBAPI DSPNode_Delete(DSP_HNODE hNode)
 	struct CMM_INFO pInfo;		/* Used for virtual space allocation */
 	DSP_NODETYPE nodeType;
 	struct DSP_NODEATTR    nodeAttr;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION, (TEXT("NODE: DSPNode_Delete:\r\n")));
 	if (!hNode) {
@@ -537,10 +511,6 @@ loop_end:
 			free(nodeAttr.inNodeAttrIn.pGPPVirtAddr);
 		}
 	}
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPNode_Delete", 0);
-#endif
 
 	return status;
 }
@@ -646,15 +616,6 @@ DBAPI DSPNode_GetMessage(DSP_HNODE hNode, OUT struct DSP_MSG *pMessage,
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION, (TEXT("NODE: DSPNode_GetMessage:\r\n")));
 
@@ -679,10 +640,6 @@ DBAPI DSPNode_GetMessage(DSP_HNODE hNode, OUT struct DSP_MSG *pMessage,
 			(TEXT("NODE: DSPNode_GetMessage: "
 			"hNode is Invalid \r\n")));
 	}
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPNode_GetMessage", 0);
-#endif
 
 
 	return status;
@@ -754,14 +711,6 @@ DBAPI DSPNode_PutMessage(DSP_HNODE hNode, IN CONST struct DSP_MSG *pMessage,
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timeval tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION, (TEXT("NODE: DSPNode_PutMessage:\r\n")));
 
@@ -788,10 +737,6 @@ DBAPI DSPNode_PutMessage(DSP_HNODE hNode, IN CONST struct DSP_MSG *pMessage,
 			(TEXT("NODE: DSPNode_PutMessage: "
 					"hNode is Invalid \r\n")));
 	}
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPNode_PutMessage", 0);
-#endif
 
 
 	return status;
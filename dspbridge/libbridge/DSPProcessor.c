@@ -25,6 +25,7 @@
  *
  *  Public Functions:
  *      DSPProcessor_Attach
+ *      DSPProcessor_CacheOperations
  *      DSPProcessor_Detach
  *      DSPProcessor_EnumNodes
  *      DSPProcessor_FlushMemory
@@ -78,14 +79,19 @@
 /*  ----------------------------------- Others */
 #include <dsptrap.h>
 
-#ifdef DEBUG_BRIDGE_PERF
-#include <perfutils.h>
-#endif
 /*  ----------------------------------- This */
 #include "_dbdebug.h"
 #include "_dbpriv.h"
 #include <DSPProcessor.h>
 
+/*  ----------------------------------- Globals */
+/* Set once the driver turned out not to know CMD_PROC_CACHEOPS_OFFSET */
+static bool bNoCacheOpsTrap = false;
+
+/*  ----------------------------------- Function Prototypes */
+static DSP_STATUS CacheOperationsLoop(DSP_HPROCESSOR hProcessor,
+				      struct DSP_CACHEOP *aOps, UINT uCount);
+
 /*
  *  ======== DSPProcessor_Attach ========
  *  Purpose:
@@ -213,15 +219,6 @@ DBAPI DSPProcessor_FlushMemory(DSP_HPROCESSOR hProcessor, PVOID pMpuAddr,
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-timeRetVal = getTimeStamp(&tv_beg);
-
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
 			(TEXT("PROC: DSPProcessor_FlushMemory\r\n")));
@@ -238,10 +235,6 @@ timeRetVal = getTimeStamp(&tv_beg);
 		status = DSP_EHANDLE;
 		DEBUGMSG(DSPAPI_ZONE_ERROR, (TEXT("PROC: Invalid Handle\r\n")));
 	}
-#ifdef DEBUG_BRIDGE_PERF
-timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPProcessor_FlushMemory", ulSize);
-#endif
 
 	return status;
 
@@ -257,14 +250,6 @@ DBAPI DSPProcessor_InvalidateMemory(DSP_HPROCESSOR hProcessor,
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
 			(TEXT("PROC: DSPProcessor_InvalidateMemory\r\n")));
@@ -281,16 +266,99 @@ DBAPI DSPProcessor_InvalidateMemory(DSP_HPROCESSOR hProcessor,
 		status = DSP_EHANDLE;
 		DEBUGMSG(DSPAPI_ZONE_ERROR, (TEXT("PROC: Invalid Handle\r\n")));
 	}
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end,
-			"DSPProcessor_InvalidateMemory", ulSize);
-#endif
 
 	return status;
 
 }
 
+/*
+ *  ======== DSPProcessor_CacheOperations ========
+ *  Purpose:
+ *      Flushes and invalidates several buffers with a single trap.
+ */
+DBAPI DSPProcessor_CacheOperations(DSP_HPROCESSOR hProcessor,
+				   IN struct DSP_CACHEOP *aOps, UINT uCount)
+{
+	DSP_STATUS status = DSP_SOK;
+	Trapped_Args tempStruct;
+	UINT i;
+
+	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
+			(TEXT("PROC: DSPProcessor_CacheOperations\r\n")));
+
+	/* Check the handle */
+	if (!hProcessor) {
+		/* Invalid handle */
+		DEBUGMSG(DSPAPI_ZONE_ERROR, (TEXT("PROC: Invalid Handle\r\n")));
+		return DSP_EHANDLE;
+	}
+	if (uCount == 0)
+		return DSP_SOK;
+	if (!aOps) {
+		DEBUGMSG(DSPAPI_ZONE_ERROR, (TEXT("PROC: Invalid pointer\r\n")));
+		return DSP_EPOINTER;
+	}
+	for (i = 0; i < uCount; i++) {
+		if (aOps[i].uOp != DSP_CACHEOP_FLUSH &&
+				aOps[i].uOp != DSP_CACHEOP_INVALIDATE) {
+			DEBUGMSG(DSPAPI_ZONE_ERROR,
+				(TEXT("PROC: Invalid cache operation\r\n")));
+			return DSP_EVALUE;
+		}
+	}
+
+	/* A single range costs one trap either way */
+	if (uCount == 1 || bNoCacheOpsTrap)
+		return CacheOperationsLoop(hProcessor, aOps, uCount);
+
+	tempStruct.ARGS_PROC_CACHEOPS.hProcessor = hProcessor;
+	tempStruct.ARGS_PROC_CACHEOPS.aOps = aOps;
+	tempStruct.ARGS_PROC_CACHEOPS.uCount = uCount;
+	status = DSPTRAP_Trap(&tempStruct, CMD_PROC_CACHEOPS_OFFSET);
+
+	/*
+	 * An older driver rejects the command itself: the ioctl fails, or the
+	 * command is refused as unknown. Redo the request one range at a time,
+	 * and stop asking the driver once that works where the trap did not.
+	 */
+	if (status == (DSP_STATUS)-1 || status == DSP_ENOTIMPL ||
+			status == DSP_EINVALIDARG) {
+		status = CacheOperationsLoop(hProcessor, aOps, uCount);
+		if (DSP_SUCCEEDED(status)) {
+			DEBUGMSG(DSPAPI_ZONE_WARNING,
+				(TEXT("PROC: no vectored cache operations, "
+				"using single ranges\r\n")));
+			bNoCacheOpsTrap = true;
+		}
+	}
+
+	return status;
+}
+
+/*
+ *  ======== CacheOperationsLoop ========
+ *  Purpose:
+ *      Applies aOps one range at a time, stopping at the first failure.
+ */
+static DSP_STATUS CacheOperationsLoop(DSP_HPROCESSOR hProcessor,
+				      struct DSP_CACHEOP *aOps, UINT uCount)
+{
+	DSP_STATUS status = DSP_SOK;
+	UINT i;
+
+	for (i = 0; i < uCount && DSP_SUCCEEDED(status); i++) {
+		if (aOps[i].uOp == DSP_CACHEOP_FLUSH)
+			status = DSPProcessor_FlushMemory(hProcessor,
+					aOps[i].pMpuAddr, aOps[i].ulSize,
+					aOps[i].ulFlags);
+		else
+			status = DSPProcessor_InvalidateMemory(hProcessor,
+					aOps[i].pMpuAddr, aOps[i].ulSize);
+	}
+
+	return status;
+}
+
 /*
  *  ======== DSPProcessor_GetResourceInfo ========
  *  Purpose:
@@ -399,14 +467,6 @@ DBAPI DSPProcessor_Map(DSP_HPROCESSOR hProcessor, PVOID pMpuAddr,
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION, (TEXT("PROC: DSPProcessor_Map\r\n")));
 
@@ -461,11 +521,6 @@ DBAPI DSPProcessor_Map(DSP_HPROCESSOR hProcessor, PVOID pMpuAddr,
 		DEBUGMSG(DSPAPI_ZONE_ERROR, (TEXT("PROC: Invalid Handle\r\n")));
 	}
 
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPProcessor_Map", ulSize);
-#endif
-
 
 	return status;
 }
@@ -529,14 +584,6 @@ DBAPI DSPProcessor_ReserveMemory(DSP_HPROCESSOR hProcessor, ULONG ulSize,
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
@@ -577,11 +624,6 @@ DBAPI DSPProcessor_ReserveMemory(DSP_HPROCESSOR hProcessor, ULONG ulSize,
 		DEBUGMSG(DSPAPI_ZONE_ERROR, (TEXT("PROC: Invalid Handle\r\n")));
 	}
 
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPProcessor_ReserveMemory", ulSize);
-#endif
-
 	return status;
 }
 
@@ -593,14 +635,6 @@ DBAPI DSPProcessor_UnMap(DSP_HPROCESSOR hProcessor, PVOID pMapAddr)
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION, (TEXT("PROC: DSPProcessor_UnMap\r\n")));
 
@@ -622,11 +656,6 @@ DBAPI DSPProcessor_UnMap(DSP_HPROCESSOR hProcessor, PVOID pMapAddr)
 		DEBUGMSG(DSPAPI_ZONE_ERROR, (TEXT("PROC: Invalid Handle\r\n")));
 	}
 
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPProcessor_UnMap", 0);
-#endif
-
 	return status;
 }
 
@@ -639,14 +668,6 @@ DBAPI DSPProcessor_UnReserveMemory(DSP_HPROCESSOR hProcessor, PVOID pRsvAddr)
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
 			(TEXT("PROC: DSPProcessor_UnReserveMemory\r\n")));
@@ -668,10 +689,6 @@ DBAPI DSPProcessor_UnReserveMemory(DSP_HPROCESSOR hProcessor, PVOID pRsvAddr)
 		status = DSP_EHANDLE;
 		DEBUGMSG(DSPAPI_ZONE_ERROR, (TEXT("PROC: Invalid Handle\r\n")));
 	}
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPProcessor_UnReserveMemory", 0);
-#endif
 
 	return status;
 }
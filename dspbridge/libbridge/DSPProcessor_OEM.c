@@ -46,9 +46,6 @@
 #include "_dbdebug.h"
 #include "_dbpriv.h"
 #include <DSPProcessor_OEM.h>
-#ifdef DEBUG_BRIDGE_PERF
-#include <perfutils.h>
-#endif
 
 
 
@@ -96,14 +93,6 @@ DBAPI DSPProcessor_Load(DSP_HPROCESSOR hProcessor, IN CONST INT iArgc,
 {
 	DSP_STATUS status = DSP_SOK;
 	Trapped_Args tempStruct;
-#ifdef DEBUG_BRIDGE_PERF
-	struct timeval tv_beg;
-	struct timeval tv_end;
-	struct timezone tz;
-	int timeRetVal = 0;
-
-	timeRetVal = getTimeStamp(&tv_beg);
-#endif
 
 
 	DEBUGMSG(DSPAPI_ZONE_FUNCTION, (TEXT("PROC: DSPProcessor_Load\r\n")));
@@ -138,12 +127,6 @@ DBAPI DSPProcessor_Load(DSP_HPROCESSOR hProcessor, IN CONST INT iArgc,
 				(TEXT("PROC: Invalid Handle \r\n")));
 	}
 
-#ifdef DEBUG_BRIDGE_PERF
-	timeRetVal = getTimeStamp(&tv_end);
-	PrintStatistics(&tv_beg, &tv_end, "DSPProcessor_Load", 0);
-
-#endif
-
 	return status;
 }
 
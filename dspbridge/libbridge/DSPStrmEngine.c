@@ -0,0 +1,394 @@
+/*
+ * dspbridge/src/api/linux/DSPStrmEngine.c
+ *
+ * DSP-BIOS Bridge driver support functions for TI OMAP processors.
+ *
+ * Copyright (C) 2007 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation version 2.1 of the License.
+ *
+ * This program is distributed .as is. WITHOUT ANY WARRANTY of any kind,
+ * whether express or implied; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/*
+ *  ======== DSPStrmEngine.c ========
+ *  Description:
+ *      Streaming engine built on the DSPStream API. Each stream owns a
+ *      fixed pool of prepared buffers; DSPStreamEngine_Pump keeps all of
+ *      them issued, multiplexes the wait over every stream with a single
+ *      DSPStream_Select and recycles each reclaimed buffer through the
+ *      callback of its stream. No buffer is allocated, prepared or freed
+ *      between DSPStreamEngine_AddStream and DSPStreamEngine_Delete.
+ *
+ *  Public Functions:
+ *      DSPStreamEngine_AddStream
+ *      DSPStreamEngine_Create
+ *      DSPStreamEngine_Delete
+ *      DSPStreamEngine_Pump
+ *      DSPStreamEngine_Run
+ *
+ *! Revision History
+ *! ================
+ */
+
+/*  ----------------------------------- Host OS */
+#include <host_os.h>
+
+/*  ----------------------------------- DSP/BIOS Bridge */
+#include <std.h>
+#include <dbdefs.h>
+#include <errbase.h>
+
+/*  ----------------------------------- This */
+#include "_dbdebug.h"
+
+#include <DSPStream.h>
+#include <DSPStreamEngine.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*  ----------------------------------- Defines, Data Structures, Typedefs */
+#define STRMENG_TIMEOUT         10000	/* ms, when pAttrIn gives none */
+
+/* One stream of an engine */
+struct STRMENG_STREAM {
+	DSP_HSTREAM hStream;
+	UINT uDirection;
+	UINT uBufSize;
+	DSPSTRMENG_FXN pfnComplete;
+	PVOID pArg;
+	UINT uNumBufs;
+	UINT uPrepared;		/* apBuffer[0..uPrepared) are prepared     */
+	UINT uPrimed;		/* apBuffer[0..uPrimed) have been issued   */
+	UINT uOutstanding;	/* issued and not reclaimed yet            */
+	BYTE **apBuffer;
+};
+
+struct DSPSTRMENG_OBJECT {
+	UINT uNumStreams;
+	struct STRMENG_STREAM aStream[DSPSTRMENG_MAXSTREAMS];
+};
+
+/*  ----------------------------------- Function Prototypes */
+static DSP_STATUS CloseStream(struct STRMENG_STREAM *pStrm);
+static DSP_STATUS Complete(struct STRMENG_STREAM *pStrm, BYTE *pBuffer,
+			   ULONG ulBytes, ULONG ulBufSize);
+static DSP_STATUS Prime(struct STRMENG_STREAM *pStrm);
+
+/*
+ *  ======== DSPStreamEngine_AddStream ========
+ *  Purpose:
+ *      Open a stream and set up its buffer pool.
+ */
+DBAPI DSPStreamEngine_AddStream(DSP_HSTRMENGINE hEngine, DSP_HNODE hNode,
+			UINT uDirection, UINT uIndex,
+			IN OPTIONAL struct DSP_STREAMATTRIN *pAttrIn,
+			UINT uNumBufs, UINT uBufSize,
+			DSPSTRMENG_FXN pfnComplete, PVOID pArg,
+			OUT OPTIONAL DSP_HSTREAM *phStream)
+{
+	DSP_STATUS status = DSP_SOK;
+	struct DSP_STREAMATTRIN attrs;
+	struct STRMENG_STREAM *pStrm;
+
+	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
+		 (TEXT("NODE: DSPStreamEngine_AddStream:\r\n")));
+
+	if (!hEngine)
+		return DSP_EHANDLE;
+	if (!pfnComplete)
+		return DSP_EPOINTER;
+	if (uNumBufs == 0 || uBufSize == 0)
+		return DSP_EVALUE;
+	if (hEngine->uNumStreams == DSPSTRMENG_MAXSTREAMS) {
+		DEBUGMSG(DSPAPI_ZONE_ERROR,
+			 (TEXT("NODE: DSPStreamEngine_AddStream: "
+			       "Too many streams\r\n")));
+		return DSP_ERANGE;
+	}
+
+	/* The driver queues as many buffers as the stream was opened with */
+	if (pAttrIn) {
+		attrs = *pAttrIn;
+	} else {
+		memset(&attrs, 0, sizeof(attrs));
+		attrs.cbStruct = sizeof(attrs);
+		attrs.uTimeout = STRMENG_TIMEOUT;
+		attrs.lMode = STRMMODE_PROCCOPY;
+	}
+	attrs.uNumBufs = uNumBufs;
+
+	pStrm = &hEngine->aStream[hEngine->uNumStreams];
+	memset(pStrm, 0, sizeof(*pStrm));
+	pStrm->uDirection = uDirection;
+	pStrm->uBufSize = uBufSize;
+	pStrm->pfnComplete = pfnComplete;
+	pStrm->pArg = pArg;
+
+	status = DSPStream_Open(hNode, uDirection, uIndex, &attrs,
+				&pStrm->hStream);
+	if (DSP_FAILED(status))
+		return status;
+
+	pStrm->apBuffer = calloc(uNumBufs, sizeof(BYTE *));
+	if (pStrm->apBuffer == NULL) {
+		status = DSP_EMEMORY;
+	} else {
+		status = DSPStream_AllocateBuffers(pStrm->hStream, uBufSize,
+						   pStrm->apBuffer, uNumBufs);
+		if (DSP_SUCCEEDED(status))
+			pStrm->uNumBufs = uNumBufs;
+	}
+	while (DSP_SUCCEEDED(status) && pStrm->uPrepared < uNumBufs) {
+		status = DSPStream_PrepareBuffer(pStrm->hStream, uBufSize,
+					pStrm->apBuffer[pStrm->uPrepared]);
+		if (DSP_SUCCEEDED(status))
+			pStrm->uPrepared++;
+	}
+
+	if (DSP_FAILED(status)) {
+		DEBUGMSG(DSPAPI_ZONE_ERROR,
+			 (TEXT("NODE: DSPStreamEngine_AddStream: "
+			       "Failed to set up the buffers\r\n")));
+		CloseStream(pStrm);
+		return status;
+	}
+
+	hEngine->uNumStreams++;
+	if (phStream)
+		*phStream = pStrm->hStream;
+
+	return DSP_SOK;
+}
+
+/*
+ *  ======== DSPStreamEngine_Create ========
+ *  Purpose:
+ *      Create an empty engine.
+ */
+DBAPI DSPStreamEngine_Create(OUT DSP_HSTRMENGINE *phEngine)
+{
+	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
+		 (TEXT("NODE: DSPStreamEngine_Create:\r\n")));
+
+	if (!phEngine)
+		return DSP_EPOINTER;
+
+	*phEngine = calloc(1, sizeof(struct DSPSTRMENG_OBJECT));
+
+	return *phEngine ? DSP_SOK : DSP_EMEMORY;
+}
+
+/*
+ *  ======== DSPStreamEngine_Delete ========
+ *  Purpose:
+ *      Close every stream and free the engine.
+ */
+DBAPI DSPStreamEngine_Delete(DSP_HSTRMENGINE hEngine)
+{
+	DSP_STATUS status = DSP_SOK;
+	DSP_STATUS closeStatus;
+	UINT i;
+
+	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
+		 (TEXT("NODE: DSPStreamEngine_Delete:\r\n")));
+
+	if (!hEngine)
+		return DSP_EHANDLE;
+
+	for (i = 0; i < hEngine->uNumStreams; i++) {
+		closeStatus = CloseStream(&hEngine->aStream[i]);
+		if (DSP_SUCCEEDED(status))
+			status = closeStatus;
+	}
+	free(hEngine);
+
+	return status;
+}
+
+/*
+ *  ======== DSPStreamEngine_Pump ========
+ *  Purpose:
+ *      One round of issue, select and reclaim over all streams.
+ */
+DBAPI DSPStreamEngine_Pump(DSP_HSTRMENGINE hEngine, UINT uTimeout,
+			   OUT OPTIONAL UINT *puCompleted)
+{
+	DSP_STATUS status = DSP_SOK;
+	DSP_HSTREAM aStreamTab[DSPSTRMENG_MAXSTREAMS];
+	struct STRMENG_STREAM *apReady[DSPSTRMENG_MAXSTREAMS];
+	struct STRMENG_STREAM *pStrm;
+	BYTE *pBuffer;
+	ULONG ulBytes;
+	ULONG ulBufSize;
+	DWORD dwArg;
+	UINT uCompleted = 0;
+	UINT nStreams = 0;
+	UINT uMask = 0;
+	UINT i;
+
+	if (puCompleted)
+		*puCompleted = 0;
+	if (!hEngine)
+		return DSP_EHANDLE;
+
+	for (i = 0; i < hEngine->uNumStreams; i++) {
+		pStrm = &hEngine->aStream[i];
+		if (pStrm->uPrimed < pStrm->uNumBufs) {
+			status = Prime(pStrm);
+			if (DSP_FAILED(status))
+				return status;
+		}
+		if (pStrm->uOutstanding) {
+			aStreamTab[nStreams] = pStrm->hStream;
+			apReady[nStreams] = pStrm;
+			nStreams++;
+		}
+	}
+	if (nStreams == 0)
+		return DSP_SFALSE;
+
+	status = DSPStream_Select(aStreamTab, nStreams, &uMask, uTimeout);
+	if (DSP_SUCCEEDED(status) && uMask == 0)
+		status = DSP_ETIMEOUT;
+
+	for (i = 0; DSP_SUCCEEDED(status) && i < nStreams; i++) {
+		if (!(uMask & (1 << i)))
+			continue;
+
+		pStrm = apReady[i];
+		ulBufSize = pStrm->uBufSize;
+		status = DSPStream_Reclaim(pStrm->hStream, &pBuffer, &ulBytes,
+					   &ulBufSize, &dwArg);
+		if (DSP_FAILED(status))
+			break;
+
+		pStrm->uOutstanding--;
+		uCompleted++;
+		status = Complete(pStrm, pBuffer, ulBytes, ulBufSize);
+	}
+
+	if (puCompleted)
+		*puCompleted = uCompleted;
+
+	return status;
+}
+
+/*
+ *  ======== DSPStreamEngine_Run ========
+ *  Purpose:
+ *      Pump until every stream has ended.
+ */
+DBAPI DSPStreamEngine_Run(DSP_HSTRMENGINE hEngine, UINT uTimeout)
+{
+	DSP_STATUS status;
+
+	DEBUGMSG(DSPAPI_ZONE_FUNCTION,
+		 (TEXT("NODE: DSPStreamEngine_Run:\r\n")));
+
+	do {
+		status = DSPStreamEngine_Pump(hEngine, uTimeout, NULL);
+	} while (status == DSP_SOK);
+
+	return status == DSP_SFALSE ? DSP_SOK : status;
+}
+
+/*
+ *  ======== CloseStream ========
+ *  Purpose:
+ *      Take back the buffers of a stream, free them and close the stream.
+ */
+static DSP_STATUS CloseStream(struct STRMENG_STREAM *pStrm)
+{
+	DSP_STATUS status = DSP_SOK;
+	DSP_STATUS tmpStatus;
+	BYTE *pBuffer;
+	ULONG ulBytes;
+	ULONG ulBufSize;
+	DWORD dwArg;
+
+	if (pStrm->uOutstanding) {
+		status = DSPStream_Idle(pStrm->hStream, true);
+		while (DSP_SUCCEEDED(status) && pStrm->uOutstanding) {
+			status = DSPStream_Reclaim(pStrm->hStream, &pBuffer,
+						   &ulBytes, &ulBufSize, &dwArg);
+			if (DSP_SUCCEEDED(status))
+				pStrm->uOutstanding--;
+		}
+	}
+
+	while (pStrm->uPrepared) {
+		pStrm->uPrepared--;
+		DSPStream_UnprepareBuffer(pStrm->hStream, pStrm->uBufSize,
+					  pStrm->apBuffer[pStrm->uPrepared]);
+	}
+	/* Buffers the driver still holds must not be freed */
+	if (pStrm->apBuffer && pStrm->uOutstanding == 0) {
+		DSPStream_FreeBuffers(pStrm->hStream, pStrm->apBuffer,
+				      pStrm->uNumBufs);
+	}
+	free(pStrm->apBuffer);
+	pStrm->apBuffer = NULL;
+
+	tmpStatus = DSPStream_Close(pStrm->hStream);
+	if (DSP_SUCCEEDED(status))
+		status = tmpStatus;
+
+	return status;
+}
+
+/*
+ *  ======== Complete ========
+ *  Purpose:
+ *      Hand a reclaimed buffer to the callback and reissue or retire it.
+ */
+static DSP_STATUS Complete(struct STRMENG_STREAM *pStrm, BYTE *pBuffer,
+			   ULONG ulBytes, ULONG ulBufSize)
+{
+	DSP_STATUS status;
+	ULONG ulIssue = ulBufSize;
+
+	status = (*pStrm->pfnComplete)(pStrm->pArg, pStrm->hStream, pBuffer,
+				       ulBytes, ulBufSize, &ulIssue);
+	if (status != DSP_SOK)
+		return status == DSP_SFALSE ? DSP_SOK : status;
+
+	status = DSPStream_Issue(pStrm->hStream, pBuffer, ulIssue, ulBufSize,
+				 0);
+	if (DSP_SUCCEEDED(status))
+		pStrm->uOutstanding++;
+
+	return status;
+}
+
+/*
+ *  ======== Prime ========
+ *  Purpose:
+ *      Issue the buffers of a stream that have not been issued yet; input
+ *      buffers are filled by the callback first.
+ */
+static DSP_STATUS Prime(struct STRMENG_STREAM *pStrm)
+{
+	DSP_STATUS status = DSP_SOK;
+	BYTE *pBuffer;
+
+	while (DSP_SUCCEEDED(status) && pStrm->uPrimed < pStrm->uNumBufs) {
+		pBuffer = pStrm->apBuffer[pStrm->uPrimed++];
+		if (pStrm->uDirection == DSP_TONODE) {
+			status = Complete(pStrm, pBuffer, 0, pStrm->uBufSize);
+		} else {
+			status = DSPStream_Issue(pStrm->hStream, pBuffer, 0,
+						 pStrm->uBufSize, 0);
+			if (DSP_SUCCEEDED(status))
+				pStrm->uOutstanding++;
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,1898 @@
+/*
+ * dspbridge/src/api/linux/dspemu.c
+ *
+ * DSP-BIOS Bridge driver support functions for TI OMAP processors.
+ *
+ * Copyright (C) 2007 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation version 2.1 of the License.
+ *
+ * This program is distributed .as is. WITHOUT ANY WARRANTY of any kind,
+ * whether express or implied; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+
+/*
+ *  ======== dspemu.c ========
+ *  Description:
+ *      User-space emulation of the DSP/BIOS Bridge driver. DSPTRAP_Trap()
+ *      hands every command here instead of to the driver when the emulator
+ *      is selected, so the API and everything above it (LCML, the OMX
+ *      components) runs unmodified on a host without a DSP.
+ *
+ *      Emulated: processor attach/state, DMM reserve/map/flush, node
+ *      allocate/create/run/pause/terminate/delete, node messaging and
+ *      notifications, DSPManager_WaitForEvents, node-to-node connects and
+ *      processor-copy GPP streams. Node code runs in a host thread per
+ *      node, supplied by a plug-in (see dspemu.h) or by the built-in
+ *      loopback node. Stream data always takes the loopback path: what is
+ *      issued to input stream n of a running node comes back on its output
+ *      stream n, or is consumed when there is none.
+ *
+ *      Not emulated: zero-copy and DMA streams, node message buffers,
+ *      shared memory segments (CMM reports none), MEM and UTIL commands.
+ *      These fail with DSP_ENOTIMPL.
+ *
+ *  Public Functions:
+ *      DSPEMU_Enabled
+ *      DSPEMU_Open
+ *      DSPEMU_Close
+ *      DSPEMU_Trap
+ *      DSPEMU_SendMessage
+ *      DSPEMU_ToMpu
+ *      DSPEMU_GetContext
+ *      DSPEMU_SetContext
+ *      DSPEMU_RaiseProcessorEvent
+ *
+ *! Revision History
+ *! =================
+ */
+
+/*  ----------------------------------- Host OS */
+#include <host_os.h>
+
+/*  ----------------------------------- DSP/BIOS Bridge */
+#include <dbdefs.h>
+#include <errbase.h>
+
+/*  ----------------------------------- Others */
+#include <dsptrap.h>
+
+/*  ----------------------------------- This */
+#include "_dbdebug.h"
+#include <dspemu.h>
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+/*  ----------------------------------- Definitions */
+/* DSP virtual space handed out by DSPProcessor_ReserveMemory */
+#define EMU_DSPVA_BASE      0x20000000UL
+#define EMU_DSPVA_SIZE      0x10000000UL
+#define EMU_PAGE_SIZE       0x1000UL
+
+#define EMU_MSG_DEPTH       64	/* per direction, per node */
+#define EMU_STRM_MAXBUFS    64	/* buffers in flight, per stream */
+#define EMU_STRM_NUMBUFS    2	/* default uNumBufs, as in the driver */
+#define EMU_STRM_TIMEOUT    10000	/* default uTimeout, ms */
+#define EMU_PATH_MAX        256
+#define EMU_NODE_PRIORITY   5
+
+#define EMU_PAGE_ALIGN(x)   (((x) + EMU_PAGE_SIZE - 1) & ~(EMU_PAGE_SIZE - 1))
+
+/* DSPManager_RegisterObject entry */
+struct EMU_OBJECT {
+	struct EMU_OBJECT *next;
+	struct DSP_UUID uuid;
+	DSP_DCDOBJTYPE objType;
+	CHAR szPath[EMU_PATH_MAX];
+};
+
+/* One per DSPProcessor_Attach */
+struct EMU_PROC {
+	struct EMU_PROC *next;
+};
+
+/* DSPProcessor_ReserveMemory range, kept sorted by address */
+struct EMU_RSV {
+	struct EMU_RSV *next;
+	ULONG ulBase;
+	ULONG ulSize;
+};
+
+/* DSPProcessor_Map mapping */
+struct EMU_MAP {
+	struct EMU_MAP *next;
+	ULONG ulDspAddr;
+	ULONG ulMpuAddr;
+	ULONG ulSize;
+};
+
+/*
+ *  A registered notification. DSP_NOTIFICATION.handle carries ulId rather
+ *  than a pointer, so a stale notification left in a wait array after its
+ *  object was deleted can never match a newer registration.
+ */
+struct EMU_EVENT {
+	struct EMU_EVENT *next;
+	ULONG ulId;
+	HANDLE hObject;		/* processor or node */
+	UINT uEventMask;
+	bool bSignalled;
+};
+
+/*
+ *  A thread blocked in MGR_WAIT. It polls the read end of its own pipe,
+ *  which is written to whenever an event is raised; a signal ends the
+ *  wait with DSP_EFAIL.
+ */
+struct EMU_WAITER {
+	struct EMU_WAITER *next;
+	int fd[2];
+};
+
+struct EMU_MSGQ {
+	struct DSP_MSG aMsg[EMU_MSG_DEPTH];
+	UINT uHead;
+	UINT uCount;
+};
+
+struct DSPEMU_NODE {
+	struct DSPEMU_NODE *next;
+	struct DSP_NDBPROPS props;
+	DSP_NODESTATE state;
+	INT iPriority;
+	UINT uNumStreams;
+	CONST struct DSPEMU_NODEPLUGIN *pPlugin;
+	PVOID hLib;		/* plug-in library, NULL when built in */
+	PVOID pContext;
+	struct DSP_CBDATA *pArgs;	/* copy of the DSPNode_Allocate args */
+	struct EMU_MSGQ toDsp;
+	struct EMU_MSGQ toGpp;
+	pthread_cond_t cond;	/* queue or state change */
+	pthread_t thread;
+	bool bThread;
+	bool bTerminate;
+	unsigned long long ullBusy;	/* stream work queued until, ns */
+};
+
+/* A buffer issued to a stream */
+struct EMU_STRMBUF {
+	BYTE *pBuffer;
+	ULONG ulBytes;
+	ULONG ulBufSize;
+	DWORD dwArg;
+	unsigned long long ullTime;	/* reaches the DSP, then the GPP; ns */
+};
+
+/*
+ *  A GPP stream. Buffers complete in the order they were issued:
+ *  aBuf[uHead] is the oldest outstanding, the first uDone of the uCount
+ *  outstanding ones are complete.
+ */
+struct EMU_STREAM {
+	struct EMU_STREAM *next;
+	struct DSPEMU_NODE *pNode;
+	UINT uDirection;
+	UINT uIndex;
+	UINT uNumBufs;
+	UINT uTimeout;
+	struct EMU_STRMBUF aBuf[EMU_STRM_MAXBUFS];
+	UINT uHead;
+	UINT uCount;
+	UINT uDone;
+	ULONG ulBytes;		/* moved so far */
+};
+
+/*  ----------------------------------- Globals */
+static pthread_mutex_t emuLock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct EMU_OBJECT *emuObjects;
+static struct EMU_PROC *emuProcs;
+static struct DSPEMU_NODE *emuNodes;
+static struct EMU_RSV *emuRsvs;
+static struct EMU_MAP *emuMaps;
+static struct EMU_EVENT *emuEvents;
+static struct EMU_WAITER *emuWaiters;
+static struct EMU_STREAM *emuStreams;
+static ULONG emuNextEventId = 1;
+
+static DSP_PROCSTATE emuProcState = PROC_RUNNING;
+static struct DSP_ERRORINFO emuErrInfo;
+static int emuCmm;		/* address is the CMM manager handle */
+
+static pthread_key_t emuWaiterKey;
+static pthread_once_t emuWaiterOnce = PTHREAD_ONCE_INIT;
+
+/* Stream completions, on CLOCK_MONOTONIC */
+static pthread_cond_t emuStrmCond;
+static pthread_once_t emuStrmOnce = PTHREAD_ONCE_INIT;
+
+static UINT emuMsgLatencyUs = DSPEMU_DEFAULT_MSG_LATENCY;
+static UINT emuNodeProcessUs;
+static UINT emuFlushNsPerKb;
+static CHAR emuPluginPath[EMU_PATH_MAX] = DSPEMU_DEFAULT_PLUGIN_PATH;
+
+static VOID LoopbackMessage(struct DSPEMU_NODE *hNode,
+			    CONST struct DSP_MSG *pMsg);
+
+static CONST struct DSPEMU_NODEPLUGIN emuLoopback = {
+	"loopback",
+	NULL,
+	LoopbackMessage,
+	NULL
+};
+
+/*
+ *  ======== EnvUInt ========
+ */
+static UINT EnvUInt(CONST CHAR *pszName, UINT uDefault)
+{
+	CONST CHAR *pszValue = getenv(pszName);
+
+	return (pszValue && *pszValue) ?
+		(UINT)strtoul(pszValue, NULL, 0) : uDefault;
+}
+
+/*
+ *  ======== SleepUs ========
+ */
+static VOID SleepUs(ULONG ulUs)
+{
+	struct timespec ts;
+
+	ts.tv_sec = ulUs / 1000000;
+	ts.tv_nsec = (ulUs % 1000000) * 1000;
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+		;
+}
+
+/*
+ *  ======== Deadline ========
+ *  Absolute time for a Bridge timeout in ms; NULL for DSP_FOREVER.
+ */
+static struct timespec *Deadline(UINT uTimeout, struct timespec *pTs)
+{
+	if (uTimeout == (UINT)DSP_FOREVER)
+		return NULL;
+
+	clock_gettime(CLOCK_REALTIME, pTs);
+	pTs->tv_sec += uTimeout / 1000;
+	pTs->tv_nsec += (uTimeout % 1000) * 1000000L;
+	if (pTs->tv_nsec >= 1000000000L) {
+		pTs->tv_sec++;
+		pTs->tv_nsec -= 1000000000L;
+	}
+	return pTs;
+}
+
+/*
+ *  ======== CondWait ========
+ *  Wait on pCond (emuLock held). Returns FALSE once pDeadline has passed.
+ */
+static bool CondWait(pthread_cond_t *pCond, CONST struct timespec *pDeadline)
+{
+	if (pDeadline == NULL)
+		return pthread_cond_wait(pCond, &emuLock) == 0;
+
+	return pthread_cond_timedwait(pCond, &emuLock, pDeadline) != ETIMEDOUT;
+}
+
+/*
+ *  ======== NowNs ========
+ *  Monotonic time in ns, the clock of stream buffer times.
+ */
+static unsigned long long NowNs(VOID)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ *  ======== StrmDeadline ========
+ *  NowNs() time for a Bridge timeout in ms; 0 for DSP_FOREVER.
+ */
+static unsigned long long StrmDeadline(UINT uTimeout)
+{
+	if (uTimeout == (UINT)DSP_FOREVER)
+		return 0;
+
+	return NowNs() + (unsigned long long)uTimeout * 1000000ULL;
+}
+
+static void StrmCondInit(void)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&emuStrmCond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+/*
+ *  ======== StrmWait ========
+ *  Wait for a stream completion (emuLock held), at most until ullUntil
+ *  (NowNs time, 0 for no limit).
+ */
+static VOID StrmWait(unsigned long long ullUntil)
+{
+	struct timespec ts;
+
+	if (ullUntil == 0) {
+		pthread_cond_wait(&emuStrmCond, &emuLock);
+		return;
+	}
+	ts.tv_sec = ullUntil / 1000000000ULL;
+	ts.tv_nsec = ullUntil % 1000000000ULL;
+	pthread_cond_timedwait(&emuStrmCond, &emuLock, &ts);
+}
+
+/*
+ *  ======== UuidEqual ========
+ */
+static bool UuidEqual(CONST struct DSP_UUID *pA, CONST struct DSP_UUID *pB)
+{
+	return pA->ulData1 == pB->ulData1 && pA->usData2 == pB->usData2 &&
+		pA->usData3 == pB->usData3 && pA->ucData4 == pB->ucData4 &&
+		pA->ucData5 == pB->ucData5 &&
+		memcmp(pA->ucData6, pB->ucData6, sizeof(pA->ucData6)) == 0;
+}
+
+/*
+ *  ======== BaseName ========
+ *  "/system/lib/dsp/mp3dec_sn.dll64P" -> "mp3dec_sn"
+ */
+static VOID BaseName(CONST CHAR *pszPath, CHAR *pszBase, UINT uSize)
+{
+	CONST CHAR *pszStart = strrchr(pszPath, '/');
+	UINT i;
+
+	pszStart = pszStart ? pszStart + 1 : pszPath;
+	for (i = 0; i + 1 < uSize && pszStart[i] && pszStart[i] != '.'; i++)
+		pszBase[i] = pszStart[i];
+	pszBase[i] = '\0';
+}
+
+/*
+ *  ======== MsgQ_Put / MsgQ_Get ========
+ */
+static VOID MsgQ_Put(struct EMU_MSGQ *pQ, CONST struct DSP_MSG *pMsg)
+{
+	pQ->aMsg[(pQ->uHead + pQ->uCount) % EMU_MSG_DEPTH] = *pMsg;
+	pQ->uCount++;
+}
+
+static VOID MsgQ_Get(struct EMU_MSGQ *pQ, struct DSP_MSG *pMsg)
+{
+	*pMsg = pQ->aMsg[pQ->uHead];
+	pQ->uHead = (pQ->uHead + 1) % EMU_MSG_DEPTH;
+	pQ->uCount--;
+}
+
+/*
+ *  ======== FindObject ========
+ *  emuLock held.
+ */
+static struct EMU_OBJECT *FindObject(CONST struct DSP_UUID *pUuid,
+				     DSP_DCDOBJTYPE objType)
+{
+	struct EMU_OBJECT *pObj;
+
+	for (pObj = emuObjects; pObj; pObj = pObj->next) {
+		if (pObj->objType == objType && UuidEqual(&pObj->uuid, pUuid))
+			break;
+	}
+	return pObj;
+}
+
+/*
+ *  ======== FindProc / FindNode ========
+ *  Validate a handle from the caller. emuLock held.
+ */
+static struct EMU_PROC *FindProc(DSP_HPROCESSOR hProcessor)
+{
+	struct EMU_PROC *pProc;
+
+	for (pProc = emuProcs; pProc; pProc = pProc->next) {
+		if (pProc == (struct EMU_PROC *)hProcessor)
+			break;
+	}
+	return pProc;
+}
+
+static struct DSPEMU_NODE *FindNode(DSP_HNODE hNode)
+{
+	struct DSPEMU_NODE *pNode;
+
+	for (pNode = emuNodes; pNode; pNode = pNode->next) {
+		if (pNode == (struct DSPEMU_NODE *)hNode)
+			break;
+	}
+	return pNode;
+}
+
+/*
+ *  ======== FindStream ========
+ *  Validate a stream handle (emuLock held), or look up the stream of pNode
+ *  with the given direction and index when hStream is NULL.
+ */
+static struct EMU_STREAM *FindStream(DSP_HSTREAM hStream,
+				     struct DSPEMU_NODE *pNode,
+				     UINT uDirection, UINT uIndex)
+{
+	struct EMU_STREAM *pStrm;
+
+	for (pStrm = emuStreams; pStrm; pStrm = pStrm->next) {
+		if (hStream ? pStrm == (struct EMU_STREAM *)hStream :
+		    (pStrm->pNode == pNode && pStrm->uDirection == uDirection &&
+		     pStrm->uIndex == uIndex))
+			break;
+	}
+	return pStrm;
+}
+
+/*
+ *  ======== FillProps ========
+ *  Node database properties of a registered node. Task nodes with no
+ *  heap profiles, so DSPNode_Allocate allocates nothing on their behalf.
+ */
+static VOID FillProps(CONST struct EMU_OBJECT *pObj,
+		      struct DSP_NDBPROPS *pProps)
+{
+	memset(pProps, 0, sizeof(*pProps));
+	pProps->cbStruct = sizeof(*pProps);
+	pProps->uiNodeID = pObj->uuid;
+	BaseName(pObj->szPath, pProps->acName, DSP_MAXNAMELEN);
+	pProps->uNodeType = NODE_TASK;
+	pProps->iPriority = EMU_NODE_PRIORITY;
+	pProps->uMessageDepth = EMU_MSG_DEPTH;
+	pProps->uTimeout = 1000;
+}
+
+/*
+ *  ======== WakeWaiters ========
+ *  emuLock held.
+ */
+static VOID WakeWaiters(VOID)
+{
+	struct EMU_WAITER *pWaiter;
+	CHAR c = 0;
+
+	for (pWaiter = emuWaiters; pWaiter; pWaiter = pWaiter->next) {
+		if (write(pWaiter->fd[1], &c, 1) < 0 && errno != EAGAIN)
+			DEBUGMSG(DSPAPI_ZONE_ERROR,
+				 (TEXT("EMU: Failed to wake waiter\n")));
+	}
+}
+
+/*
+ *  ======== SignalEvents ========
+ *  Signal every notification registered on hObject for uEvent. emuLock
+ *  held.
+ */
+static VOID SignalEvents(HANDLE hObject, UINT uEvent)
+{
+	struct EMU_EVENT *pEvent;
+	bool bSignalled = false;
+
+	for (pEvent = emuEvents; pEvent; pEvent = pEvent->next) {
+		if (pEvent->hObject == hObject &&
+		    (pEvent->uEventMask & uEvent)) {
+			pEvent->bSignalled = true;
+			bSignalled = true;
+		}
+	}
+	if (bSignalled)
+		WakeWaiters();
+}
+
+/*
+ *  ======== StreamComplete ========
+ *  Complete the oldest pending buffer of pStrm, returning it to the GPP
+ *  one mailbox latency after the node is done with it. emuLock held.
+ */
+static VOID StreamComplete(struct EMU_STREAM *pStrm,
+			   unsigned long long ullDone)
+{
+	struct EMU_STRMBUF *pBuf;
+
+	pBuf = &pStrm->aBuf[(pStrm->uHead + pStrm->uDone) % EMU_STRM_MAXBUFS];
+	pBuf->ullTime = ullDone + emuMsgLatencyUs * 1000ULL;
+	pStrm->ulBytes += pBuf->ulBytes;
+	pStrm->uDone++;
+	pthread_cond_broadcast(&emuStrmCond);
+	SignalEvents(pStrm, DSP_STREAMIOCOMPLETION);
+}
+
+/*
+ *  ======== StreamMatch ========
+ *  The loopback data path of a running node: input stream n is copied
+ *  into the buffers of output stream n, or consumed when the node has no
+ *  such output. The node works through buffers one at a time, each
+ *  starting once it has reached the DSP and the node is free, and taking
+ *  DSP_EMU_NODE_PROCESS_US; rather than sleeping, the resulting times are
+ *  stamped on the buffers. emuLock held.
+ */
+static VOID StreamMatch(struct DSPEMU_NODE *pNode, UINT uIndex)
+{
+	struct EMU_STREAM *pIn;
+	struct EMU_STREAM *pOut;
+	struct EMU_STRMBUF *pSrc;
+	struct EMU_STRMBUF *pDst;
+	unsigned long long ullStart;
+
+	if (pNode->state != NODE_RUNNING)
+		return;
+
+	pIn = FindStream(NULL, pNode, DSP_TONODE, uIndex);
+	pOut = FindStream(NULL, pNode, DSP_FROMNODE, uIndex);
+	while (pIn && pIn->uDone < pIn->uCount) {
+		if (pOut && pOut->uDone == pOut->uCount)
+			break;
+
+		pSrc = &pIn->aBuf[(pIn->uHead + pIn->uDone) % EMU_STRM_MAXBUFS];
+		ullStart = pSrc->ullTime;
+		if (pOut) {
+			pDst = &pOut->aBuf[(pOut->uHead + pOut->uDone) %
+							EMU_STRM_MAXBUFS];
+			if (pDst->ullTime > ullStart)
+				ullStart = pDst->ullTime;
+			pDst->ulBytes = pSrc->ulBytes < pDst->ulBufSize ?
+				pSrc->ulBytes : pDst->ulBufSize;
+			memcpy(pDst->pBuffer, pSrc->pBuffer, pDst->ulBytes);
+			pDst->dwArg = pSrc->dwArg;
+		}
+		if (pNode->ullBusy > ullStart)
+			ullStart = pNode->ullBusy;
+		pNode->ullBusy = ullStart + emuNodeProcessUs * 1000ULL;
+
+		StreamComplete(pIn, pNode->ullBusy);
+		if (pOut)
+			StreamComplete(pOut, pNode->ullBusy);
+	}
+}
+
+/*
+ *  ======== StreamFlush ========
+ *  Complete every pending buffer of pStrm at once; output buffers come
+ *  back empty. emuLock held.
+ */
+static VOID StreamFlush(struct EMU_STREAM *pStrm)
+{
+	unsigned long long ullNow = NowNs();
+
+	while (pStrm->uDone < pStrm->uCount) {
+		if (pStrm->uDirection == DSP_FROMNODE)
+			pStrm->aBuf[(pStrm->uHead + pStrm->uDone) %
+					EMU_STRM_MAXBUFS].ulBytes = 0;
+		StreamComplete(pStrm, ullNow);
+	}
+}
+
+/*
+ *  ======== FreeEvents ========
+ *  Drop the notifications registered on hObject. emuLock held.
+ */
+static VOID FreeEvents(HANDLE hObject)
+{
+	struct EMU_EVENT **ppEvent = &emuEvents;
+	struct EMU_EVENT *pEvent;
+
+	while ((pEvent = *ppEvent) != NULL) {
+		if (pEvent->hObject == hObject) {
+			*ppEvent = pEvent->next;
+			free(pEvent);
+		} else
+			ppEvent = &pEvent->next;
+	}
+}
+
+/*
+ *  ======== FindEvent ========
+ *  emuLock held.
+ */
+static struct EMU_EVENT *FindEvent(CONST struct DSP_NOTIFICATION *pNotify)
+{
+	struct EMU_EVENT *pEvent;
+
+	if (pNotify == NULL || pNotify->handle == NULL)
+		return NULL;
+
+	for (pEvent = emuEvents; pEvent; pEvent = pEvent->next) {
+		if (pEvent->ulId == (ULONG)pNotify->handle)
+			break;
+	}
+	return pEvent;
+}
+
+/*
+ *  ======== RegisterNotify ========
+ *  Shared by processors and nodes. A zero mask unregisters.
+ */
+static DSP_STATUS RegisterNotify(HANDLE hObject, UINT uEventMask,
+				 struct DSP_NOTIFICATION *hNotification)
+{
+	struct EMU_EVENT **ppEvent;
+	struct EMU_EVENT *pEvent = FindEvent(hNotification);
+
+	if (uEventMask == 0) {
+		for (ppEvent = &emuEvents; *ppEvent; ppEvent = &(*ppEvent)->next) {
+			if (*ppEvent == pEvent && pEvent->hObject == hObject) {
+				*ppEvent = pEvent->next;
+				free(pEvent);
+				hNotification->handle = NULL;
+				break;
+			}
+		}
+		return DSP_SOK;
+	}
+
+	/* Re-registering a notification moves it, as in the driver */
+	if (pEvent == NULL) {
+		pEvent = calloc(1, sizeof(*pEvent));
+		if (pEvent == NULL)
+			return DSP_EMEMORY;
+
+		pEvent->ulId = emuNextEventId++;
+		pEvent->next = emuEvents;
+		emuEvents = pEvent;
+		hNotification->handle = (HANDLE)pEvent->ulId;
+	}
+	pEvent->hObject = hObject;
+	pEvent->uEventMask = uEventMask;
+	pEvent->bSignalled = false;
+
+	return DSP_SOK;
+}
+
+/*
+ *  ======== WaiterDestroy ========
+ */
+static void WaiterDestroy(void *pArg)
+{
+	struct EMU_WAITER *pWaiter = pArg;
+
+	close(pWaiter->fd[0]);
+	close(pWaiter->fd[1]);
+	free(pWaiter);
+}
+
+static void WaiterKeyCreate(void)
+{
+	pthread_key_create(&emuWaiterKey, WaiterDestroy);
+}
+
+/*
+ *  ======== GetWaiter ========
+ *  The calling thread's waiter, created on first use.
+ */
+static struct EMU_WAITER *GetWaiter(VOID)
+{
+	struct EMU_WAITER *pWaiter;
+
+	pthread_once(&emuWaiterOnce, WaiterKeyCreate);
+	pWaiter = pthread_getspecific(emuWaiterKey);
+	if (pWaiter)
+		return pWaiter;
+
+	pWaiter = calloc(1, sizeof(*pWaiter));
+	if (pWaiter == NULL)
+		return NULL;
+
+	if (pipe(pWaiter->fd) < 0) {
+		free(pWaiter);
+		return NULL;
+	}
+	fcntl(pWaiter->fd[0], F_SETFL, O_NONBLOCK);
+	fcntl(pWaiter->fd[1], F_SETFL, O_NONBLOCK);
+	pthread_setspecific(emuWaiterKey, pWaiter);
+
+	return pWaiter;
+}
+
+/*
+ *  ======== MgrWait ========
+ */
+static DSP_STATUS MgrWait(struct DSP_NOTIFICATION **aNotifications,
+			  UINT uCount, UINT *puIndex, UINT uTimeout)
+{
+	DSP_STATUS status = DSP_ETIMEOUT;
+	struct EMU_WAITER *pWaiter = GetWaiter();
+	struct EMU_WAITER **ppWaiter;
+	struct EMU_EVENT *pEvent;
+	struct timespec now;
+	struct timespec end;
+	long long llTimeout;
+	CHAR buf[16];
+	int nTimeout = -1;
+	int nPoll;
+	int nErrno;
+	UINT i;
+
+	if (pWaiter == NULL)
+		return DSP_EMEMORY;
+
+	if (uTimeout != (UINT)DSP_FOREVER) {
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		end.tv_sec += uTimeout / 1000;
+		end.tv_nsec += (uTimeout % 1000) * 1000000L;
+	}
+
+	pthread_mutex_lock(&emuLock);
+	for (;;) {
+		for (i = 0; i < uCount; i++) {
+			pEvent = FindEvent(aNotifications[i]);
+			if (pEvent && pEvent->bSignalled) {
+				pEvent->bSignalled = false;
+				*puIndex = i;
+				status = DSP_SOK;
+				break;
+			}
+		}
+		if (DSP_SUCCEEDED(status))
+			break;
+
+		if (uTimeout != (UINT)DSP_FOREVER) {
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			llTimeout = (long long)(end.tv_sec - now.tv_sec) * 1000 +
+				(end.tv_nsec - now.tv_nsec) / 1000000;
+			if (llTimeout <= 0)
+				break;
+			nTimeout = llTimeout > INT_MAX ? INT_MAX : (int)llTimeout;
+		}
+
+		pWaiter->next = emuWaiters;
+		emuWaiters = pWaiter;
+		pthread_mutex_unlock(&emuLock);
+
+		{
+			struct pollfd pfd;
+
+			pfd.fd = pWaiter->fd[0];
+			pfd.events = POLLIN;
+			nPoll = poll(&pfd, 1, nTimeout);
+			nErrno = errno;
+		}
+
+		pthread_mutex_lock(&emuLock);
+		for (ppWaiter = &emuWaiters; *ppWaiter;
+					ppWaiter = &(*ppWaiter)->next) {
+			if (*ppWaiter == pWaiter) {
+				*ppWaiter = pWaiter->next;
+				break;
+			}
+		}
+		while (read(pWaiter->fd[0], buf, sizeof(buf)) > 0)
+			;
+		if (nPoll < 0 && nErrno == EINTR) {
+			status = DSP_EFAIL;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&emuLock);
+
+	return status;
+}
+
+/*
+ *  ======== NodeThread ========
+ *  The "DSP task": hands each message from the GPP to the plug-in while
+ *  the node is running.
+ */
+static void *NodeThread(void *pArg)
+{
+	struct DSPEMU_NODE *pNode = pArg;
+	struct DSP_MSG msg;
+
+	pthread_mutex_lock(&emuLock);
+	while (!pNode->bTerminate) {
+		if (pNode->state != NODE_RUNNING || pNode->toDsp.uCount == 0) {
+			pthread_cond_wait(&pNode->cond, &emuLock);
+			continue;
+		}
+		MsgQ_Get(&pNode->toDsp, &msg);
+		pthread_cond_broadcast(&pNode->cond);
+		pthread_mutex_unlock(&emuLock);
+
+		SleepUs(emuMsgLatencyUs);
+		if (pNode->pPlugin->pfnMessage)
+			pNode->pPlugin->pfnMessage(pNode, &msg);
+
+		pthread_mutex_lock(&emuLock);
+	}
+	pthread_mutex_unlock(&emuLock);
+
+	return NULL;
+}
+
+/*
+ *  ======== LoopbackMessage ========
+ *  Built-in node: every message goes straight back.
+ */
+static VOID LoopbackMessage(struct DSPEMU_NODE *hNode,
+			    CONST struct DSP_MSG *pMsg)
+{
+	if (emuNodeProcessUs)
+		SleepUs(emuNodeProcessUs);
+	DSPEMU_SendMessage(hNode, pMsg);
+}
+
+/*
+ *  ======== LoadPlugin ========
+ *  "$DSP_EMU_PLUGIN_PATH/<base name of the node library>.so", or the
+ *  loopback node.
+ */
+static CONST struct DSPEMU_NODEPLUGIN *LoadPlugin(CONST CHAR *pszPath,
+						  PVOID *phLib)
+{
+	CONST struct DSPEMU_NODEPLUGIN *pPlugin;
+	CHAR szBase[DSP_MAXNAMELEN];
+	/* "<plug-in path>/<base>.so" always fits */
+	CHAR szLib[EMU_PATH_MAX + DSP_MAXNAMELEN + sizeof("/.so")];
+	PVOID hLib;
+
+	*phLib = NULL;
+	BaseName(pszPath, szBase, sizeof(szBase));
+	snprintf(szLib, sizeof(szLib), "%s/%s.so", emuPluginPath, szBase);
+
+	hLib = dlopen(szLib, RTLD_NOW);
+	if (hLib == NULL)
+		return &emuLoopback;
+
+	pPlugin = dlsym(hLib, DSPEMU_NODEPLUGIN_SYMBOL);
+	if (pPlugin == NULL) {
+		DEBUGMSG(DSPAPI_ZONE_ERROR,
+			 (TEXT("EMU: node plug-in has no "
+			       DSPEMU_NODEPLUGIN_SYMBOL ", using loopback\n")));
+		dlclose(hLib);
+		return &emuLoopback;
+	}
+	*phLib = hLib;
+
+	return pPlugin;
+}
+
+/*
+ *  ======== StopNode ========
+ *  Called with emuLock held; drops it while joining the node thread.
+ */
+static VOID StopNode(struct DSPEMU_NODE *pNode)
+{
+	pNode->bTerminate = true;
+	pthread_cond_broadcast(&pNode->cond);
+	if (pNode->bThread) {
+		pNode->bThread = false;
+		pthread_mutex_unlock(&emuLock);
+		pthread_join(pNode->thread, NULL);
+		pthread_mutex_lock(&emuLock);
+	}
+}
+
+/*
+ *  ======== DeleteNode ========
+ *  Called with emuLock held on a node already unlinked from emuNodes.
+ */
+static VOID DeleteNode(struct DSPEMU_NODE *pNode)
+{
+	struct EMU_STREAM **ppStrm = &emuStreams;
+	struct EMU_STREAM *pStrm;
+
+	StopNode(pNode);
+	FreeEvents(pNode);
+	/* The streams of a node go with it, as in the driver */
+	while ((pStrm = *ppStrm) != NULL) {
+		if (pStrm->pNode == pNode) {
+			*ppStrm = pStrm->next;
+			FreeEvents(pStrm);
+			free(pStrm);
+		} else
+			ppStrm = &pStrm->next;
+	}
+	pthread_cond_broadcast(&emuStrmCond);
+	pthread_mutex_unlock(&emuLock);
+
+	if (pNode->state != NODE_ALLOCATED && pNode->pPlugin->pfnDelete)
+		pNode->pPlugin->pfnDelete(pNode);
+	if (pNode->hLib)
+		dlclose(pNode->hLib);
+	pthread_cond_destroy(&pNode->cond);
+	free(pNode->pArgs);
+	free(pNode);
+
+	pthread_mutex_lock(&emuLock);
+}
+
+/*
+ *  ======== ProcTrap ========
+ */
+static DSP_STATUS ProcTrap(Trapped_Args *args, int cmd)
+{
+	DSP_STATUS status = DSP_SOK;
+	struct EMU_PROC **ppProc;
+	struct EMU_PROC *pProc;
+	struct EMU_RSV **ppRsv;
+	struct EMU_RSV *pRsv;
+	struct EMU_MAP **ppMap;
+	struct EMU_MAP *pMap;
+	struct DSPEMU_NODE *pNode;
+	ULONG ulBase;
+	ULONG ulSize;
+	UINT uNodes;
+	UINT i;
+
+	if (cmd == CMD_PROC_ATTACH_OFFSET) {
+		if (args->ARGS_PROC_ATTACH.uProcessor != DSP_UNIT)
+			return DSP_EINVALIDARG;
+
+		pProc = calloc(1, sizeof(*pProc));
+		if (pProc == NULL)
+			return DSP_EMEMORY;
+
+		pProc->next = emuProcs;
+		emuProcs = pProc;
+		*args->ARGS_PROC_ATTACH.phProcessor = pProc;
+		return DSP_SOK;
+	}
+
+	/* hProcessor is the first member of every other PROC command */
+	pProc = FindProc(args->ARGS_PROC_DETACH.hProcessor);
+	if (pProc == NULL)
+		return DSP_EHANDLE;
+
+	switch (cmd) {
+	case CMD_PROC_DETACH_OFFSET:
+		for (ppProc = &emuProcs; *ppProc != pProc;
+						ppProc = &(*ppProc)->next)
+			;
+		*ppProc = pProc->next;
+		FreeEvents(pProc);
+		free(pProc);
+		break;
+
+	case CMD_PROC_CTRL_OFFSET:
+		/* Nothing to power-manage */
+		break;
+
+	case CMD_PROC_ENUMNODE_OFFSET:
+		uNodes = 0;
+		for (pNode = emuNodes; pNode; pNode = pNode->next) {
+			if (uNodes < args->ARGS_PROC_ENUMNODE_INFO.uNodeTabSize)
+				args->ARGS_PROC_ENUMNODE_INFO.aNodeTab[uNodes] =
+									pNode;
+			uNodes++;
+		}
+		*args->ARGS_PROC_ENUMNODE_INFO.puNumNodes = uNodes;
+		*args->ARGS_PROC_ENUMNODE_INFO.puAllocated = uNodes;
+		if (uNodes > args->ARGS_PROC_ENUMNODE_INFO.uNodeTabSize)
+			status = DSP_ESIZE;
+		break;
+
+	case CMD_PROC_GETSTATE_OFFSET:
+		if (args->ARGS_PROC_GETSTATE.uStateInfoSize <
+					sizeof(struct DSP_PROCESSORSTATE)) {
+			status = DSP_ESIZE;
+			break;
+		}
+		args->ARGS_PROC_GETSTATE.pProcStatus->iState = emuProcState;
+		args->ARGS_PROC_GETSTATE.pProcStatus->errInfo = emuErrInfo;
+		break;
+
+	case CMD_PROC_GETTRACE_OFFSET:
+		if (args->ARGS_PROC_GETTRACE.uMaxSize)
+			args->ARGS_PROC_GETTRACE.pBuf[0] = '\0';
+		break;
+
+	case CMD_PROC_LOAD_OFFSET:
+	case CMD_PROC_START_OFFSET:
+	case CMD_PROC_STOP_OFFSET:
+		/* No base image: only the state machine is kept */
+		if (cmd == CMD_PROC_START_OFFSET && emuProcState != PROC_LOADED) {
+			status = DSP_EWRONGSTATE;
+			break;
+		}
+		emuProcState = (cmd == CMD_PROC_LOAD_OFFSET) ? PROC_LOADED :
+			(cmd == CMD_PROC_START_OFFSET) ? PROC_RUNNING :
+			PROC_STOPPED;
+		if (cmd == CMD_PROC_LOAD_OFFSET)
+			memset(&emuErrInfo, 0, sizeof(emuErrInfo));
+		for (pProc = emuProcs; pProc; pProc = pProc->next)
+			SignalEvents(pProc, DSP_PROCESSORSTATECHANGE);
+		break;
+
+	case CMD_PROC_REGISTERNOTIFY_OFFSET:
+		status = RegisterNotify(pProc,
+			args->ARGS_PROC_REGISTER_NOTIFY.uEventMask,
+			args->ARGS_PROC_REGISTER_NOTIFY.hNotification);
+		break;
+
+	case CMD_PROC_RSVMEM_OFFSET:
+		/* First fit in the sorted reservation list */
+		ulSize = EMU_PAGE_ALIGN(args->ARGS_PROC_RSVMEM.ulSize);
+		ulBase = EMU_DSPVA_BASE;
+		for (ppRsv = &emuRsvs; *ppRsv; ppRsv = &(*ppRsv)->next) {
+			if ((*ppRsv)->ulBase - ulBase >= ulSize)
+				break;
+			ulBase = (*ppRsv)->ulBase + (*ppRsv)->ulSize;
+		}
+		if (ulSize == 0 ||
+		    ulSize > EMU_DSPVA_BASE + EMU_DSPVA_SIZE - ulBase) {
+			status = DSP_EMEMORY;
+			break;
+		}
+		pRsv = malloc(sizeof(*pRsv));
+		if (pRsv == NULL) {
+			status = DSP_EMEMORY;
+			break;
+		}
+		pRsv->ulBase = ulBase;
+		pRsv->ulSize = ulSize;
+		pRsv->next = *ppRsv;
+		*ppRsv = pRsv;
+		*args->ARGS_PROC_RSVMEM.ppRsvAddr = (PVOID)ulBase;
+		break;
+
+	case CMD_PROC_UNRSVMEM_OFFSET:
+		ulBase = (ULONG)args->ARGS_PROC_UNRSVMEM.pRsvAddr;
+		for (ppRsv = &emuRsvs; *ppRsv; ppRsv = &(*ppRsv)->next) {
+			if ((*ppRsv)->ulBase == ulBase)
+				break;
+		}
+		pRsv = *ppRsv;
+		if (pRsv == NULL) {
+			status = DSP_EINVALIDARG;
+			break;
+		}
+		/* Mappings left inside the range go with it */
+		ppMap = &emuMaps;
+		while ((pMap = *ppMap) != NULL) {
+			if (pMap->ulDspAddr - pRsv->ulBase < pRsv->ulSize) {
+				*ppMap = pMap->next;
+				free(pMap);
+			} else
+				ppMap = &pMap->next;
+		}
+		*ppRsv = pRsv->next;
+		free(pRsv);
+		break;
+
+	case CMD_PROC_MAPMEM_OFFSET:
+		ulBase = (ULONG)args->ARGS_PROC_MAPMEM.pReqAddr;
+		ulSize = (ULONG)args->ARGS_PROC_MAPMEM.pMpuAddr &
+			(EMU_PAGE_SIZE - 1);
+		for (pRsv = emuRsvs; pRsv; pRsv = pRsv->next) {
+			if (ulBase - pRsv->ulBase < pRsv->ulSize)
+				break;
+		}
+		if (pRsv == NULL || ulSize + args->ARGS_PROC_MAPMEM.ulSize >
+				pRsv->ulBase + pRsv->ulSize - ulBase) {
+			status = DSP_EINVALIDARG;
+			break;
+		}
+		pMap = malloc(sizeof(*pMap));
+		if (pMap == NULL) {
+			status = DSP_EMEMORY;
+			break;
+		}
+		/* The driver keeps the page offset of the MPU buffer */
+		pMap->ulDspAddr = ulBase + ulSize;
+		pMap->ulMpuAddr = (ULONG)args->ARGS_PROC_MAPMEM.pMpuAddr;
+		pMap->ulSize = args->ARGS_PROC_MAPMEM.ulSize;
+		pMap->next = emuMaps;
+		emuMaps = pMap;
+		*args->ARGS_PROC_MAPMEM.ppMapAddr = (PVOID)pMap->ulDspAddr;
+		break;
+
+	case CMD_PROC_UNMAPMEM_OFFSET:
+		ulBase = (ULONG)args->ARGS_PROC_UNMAPMEM.pMapAddr &
+			~(EMU_PAGE_SIZE - 1);
+		for (ppMap = &emuMaps; *ppMap; ppMap = &(*ppMap)->next) {
+			if (((*ppMap)->ulDspAddr & ~(EMU_PAGE_SIZE - 1)) ==
+								ulBase)
+				break;
+		}
+		pMap = *ppMap;
+		if (pMap == NULL) {
+			status = DSP_EINVALIDARG;
+			break;
+		}
+		*ppMap = pMap->next;
+		free(pMap);
+		break;
+
+	case CMD_PROC_FLUSHMEMORY_OFFSET:
+	case CMD_PROC_INVALIDATEMEMORY_OFFSET:
+		/* Same size member for both commands */
+		ulSize = (cmd == CMD_PROC_FLUSHMEMORY_OFFSET) ?
+			args->ARGS_PROC_FLUSHMEMORY.ulSize :
+			args->ARGS_PROC_INVALIDATEMEMORY.ulSize;
+		if (emuFlushNsPerKb) {
+			pthread_mutex_unlock(&emuLock);
+			SleepUs((ULONG)((unsigned long long)ulSize / 1024 *
+				emuFlushNsPerKb / 1000));
+			pthread_mutex_lock(&emuLock);
+		}
+		break;
+
+	case CMD_PROC_CACHEOPS_OFFSET:
+		/* One trap for all the ranges */
+		ulSize = 0;
+		for (i = 0; i < args->ARGS_PROC_CACHEOPS.uCount; i++)
+			ulSize += args->ARGS_PROC_CACHEOPS.aOps[i].ulSize;
+		if (emuFlushNsPerKb) {
+			pthread_mutex_unlock(&emuLock);
+			SleepUs((ULONG)((unsigned long long)ulSize / 1024 *
+				emuFlushNsPerKb / 1000));
+			pthread_mutex_lock(&emuLock);
+		}
+		break;
+
+	default:
+		status = DSP_ENOTIMPL;
+		break;
+	}
+
+	return status;
+}
+
+/*
+ *  ======== NodeAllocate ========
+ *  Called without emuLock: loads the plug-in.
+ */
+static DSP_STATUS NodeAllocate(Trapped_Args *args)
+{
+	struct DSPEMU_NODE *pNode;
+	struct EMU_OBJECT *pObj;
+	CONST struct DSP_CBDATA *pArgs = args->ARGS_NODE_ALLOCATE.pArgs;
+	CHAR szPath[EMU_PATH_MAX];
+	ULONG cbArgs = pArgs ? sizeof(ULONG) + pArgs->cbData : 0;
+
+	pNode = calloc(1, sizeof(*pNode));
+	if (pNode == NULL)
+		return DSP_EMEMORY;
+
+	if (cbArgs) {
+		pNode->pArgs = malloc(cbArgs);
+		if (pNode->pArgs == NULL) {
+			free(pNode);
+			return DSP_EMEMORY;
+		}
+		memcpy(pNode->pArgs, pArgs, cbArgs);
+	}
+
+	pthread_mutex_lock(&emuLock);
+	pObj = FindObject(args->ARGS_NODE_ALLOCATE.pNodeID, DSP_DCDNODETYPE);
+	if (pObj) {
+		FillProps(pObj, &pNode->props);
+		strcpy(szPath, pObj->szPath);
+	}
+	pthread_mutex_unlock(&emuLock);
+
+	if (pObj == NULL) {
+		free(pNode->pArgs);
+		free(pNode);
+		return DSP_EUUID;
+	}
+
+	pNode->pPlugin = LoadPlugin(szPath, &pNode->hLib);
+	pNode->state = NODE_ALLOCATED;
+	pNode->iPriority = args->ARGS_NODE_ALLOCATE.pAttrIn ?
+		args->ARGS_NODE_ALLOCATE.pAttrIn->iPriority :
+		pNode->props.iPriority;
+	pthread_cond_init(&pNode->cond, NULL);
+
+	pthread_mutex_lock(&emuLock);
+	pNode->next = emuNodes;
+	emuNodes = pNode;
+	pthread_mutex_unlock(&emuLock);
+
+	*args->ARGS_NODE_ALLOCATE.phNode = pNode;
+
+	return DSP_SOK;
+}
+
+/*
+ *  ======== NodeTrap ========
+ */
+static DSP_STATUS NodeTrap(Trapped_Args *args, int cmd)
+{
+	DSP_STATUS status = DSP_SOK;
+	struct DSPEMU_NODE **ppNode;
+	struct DSPEMU_NODE *pNode;
+	struct DSPEMU_NODE *pOther;
+	struct DSP_NODEATTR *pAttr;
+	struct EMU_STREAM *pStrm;
+	struct timespec ts;
+	struct timespec *pDeadline;
+	UINT uTimeout;
+
+	/* hNode is the first member of every NODE command used here */
+	pNode = FindNode(args->ARGS_NODE_CREATE.hNode);
+	if (pNode == NULL)
+		return DSP_EHANDLE;
+
+	switch (cmd) {
+	case CMD_NODE_CREATE_OFFSET:
+		if (pNode->state != NODE_ALLOCATED) {
+			status = DSP_EWRONGSTATE;
+			break;
+		}
+		if (pNode->pPlugin->pfnCreate) {
+			pthread_mutex_unlock(&emuLock);
+			status = pNode->pPlugin->pfnCreate(pNode, pNode->pArgs);
+			pthread_mutex_lock(&emuLock);
+		}
+		if (DSP_SUCCEEDED(status))
+			pNode->state = NODE_CREATED;
+		break;
+
+	case CMD_NODE_RUN_OFFSET:
+		if (pNode->state != NODE_CREATED &&
+		    pNode->state != NODE_PAUSED) {
+			status = DSP_EWRONGSTATE;
+			break;
+		}
+		if (!pNode->bThread) {
+			if (pthread_create(&pNode->thread, NULL, NodeThread,
+							pNode) != 0) {
+				status = DSP_EFAIL;
+				break;
+			}
+			pNode->bThread = true;
+		}
+		pNode->state = NODE_RUNNING;
+		pthread_cond_broadcast(&pNode->cond);
+		SignalEvents(pNode, DSP_NODESTATECHANGE);
+		/* Start on what was issued before the node ran */
+		for (pStrm = emuStreams; pStrm; pStrm = pStrm->next) {
+			if (pStrm->pNode == pNode &&
+			    pStrm->uDirection == DSP_TONODE)
+				StreamMatch(pNode, pStrm->uIndex);
+		}
+		break;
+
+	case CMD_NODE_PAUSE_OFFSET:
+		if (pNode->state != NODE_RUNNING) {
+			status = DSP_EWRONGSTATE;
+			break;
+		}
+		pNode->state = NODE_PAUSED;
+		SignalEvents(pNode, DSP_NODESTATECHANGE);
+		break;
+
+	case CMD_NODE_TERMINATE_OFFSET:
+		if (pNode->state != NODE_RUNNING &&
+		    pNode->state != NODE_PAUSED) {
+			status = DSP_EWRONGSTATE;
+			break;
+		}
+		StopNode(pNode);
+		pNode->state = NODE_DONE;
+		*args->ARGS_NODE_TERMINATE.pStatus = DSP_SOK;
+		SignalEvents(pNode, DSP_NODESTATECHANGE);
+		break;
+
+	case CMD_NODE_DELETE_OFFSET:
+		for (ppNode = &emuNodes; *ppNode != pNode;
+						ppNode = &(*ppNode)->next)
+			;
+		*ppNode = pNode->next;
+		DeleteNode(pNode);
+		break;
+
+	case CMD_NODE_CHANGEPRIORITY_OFFSET:
+		pNode->iPriority = args->ARGS_NODE_CHANGEPRIORITY.iPriority;
+		break;
+
+	case CMD_NODE_CONNECT_OFFSET:
+		/* Node-to-node data never reaches the GPP; just account */
+		pOther = FindNode(args->ARGS_NODE_CONNECT.hOtherNode);
+		if (pOther == NULL) {
+			status = DSP_ENOTIMPL;
+			break;
+		}
+		pNode->uNumStreams++;
+		pOther->uNumStreams++;
+		break;
+
+	case CMD_NODE_GETATTR_OFFSET:
+		if (args->ARGS_NODE_GETATTR.uAttrSize <
+					sizeof(struct DSP_NODEATTR)) {
+			status = DSP_ESIZE;
+			break;
+		}
+		pAttr = args->ARGS_NODE_GETATTR.pAttr;
+		memset(pAttr, 0, sizeof(*pAttr));
+		pAttr->cbStruct = sizeof(*pAttr);
+		pAttr->inNodeAttrIn.cbStruct = sizeof(pAttr->inNodeAttrIn);
+		pAttr->inNodeAttrIn.iPriority = pNode->iPriority;
+		pAttr->iNodeInfo.cbStruct = sizeof(pAttr->iNodeInfo);
+		pAttr->iNodeInfo.nbNodeDatabaseProps = pNode->props;
+		pAttr->iNodeInfo.uExecutionPriority = pNode->iPriority;
+		pAttr->iNodeInfo.nsExecutionState = pNode->state;
+		pAttr->iNodeInfo.uNumberStreams = pNode->uNumStreams;
+		break;
+
+	case CMD_NODE_PUTMESSAGE_OFFSET:
+		if (pNode->state == NODE_ALLOCATED ||
+		    pNode->state == NODE_DONE) {
+			status = DSP_EWRONGSTATE;
+			break;
+		}
+		uTimeout = args->ARGS_NODE_PUTMESSAGE.uTimeout;
+		pDeadline = Deadline(uTimeout, &ts);
+		while (pNode->toDsp.uCount == EMU_MSG_DEPTH) {
+			if (uTimeout == 0 || !CondWait(&pNode->cond, pDeadline)) {
+				status = DSP_ETIMEOUT;
+				break;
+			}
+		}
+		if (DSP_SUCCEEDED(status)) {
+			MsgQ_Put(&pNode->toDsp,
+				 args->ARGS_NODE_PUTMESSAGE.pMessage);
+			pthread_cond_broadcast(&pNode->cond);
+		}
+		break;
+
+	case CMD_NODE_GETMESSAGE_OFFSET:
+		uTimeout = args->ARGS_NODE_GETMESSAGE.uTimeout;
+		pDeadline = Deadline(uTimeout, &ts);
+		while (pNode->toGpp.uCount == 0) {
+			if (uTimeout == 0 || !pNode->bThread ||
+			    !CondWait(&pNode->cond, pDeadline)) {
+				status = DSP_ETIMEOUT;
+				break;
+			}
+		}
+		if (DSP_SUCCEEDED(status)) {
+			MsgQ_Get(&pNode->toGpp,
+				 args->ARGS_NODE_GETMESSAGE.pMessage);
+			pthread_cond_broadcast(&pNode->cond);
+		}
+		break;
+
+	case CMD_NODE_REGISTERNOTIFY_OFFSET:
+		status = RegisterNotify(pNode,
+			args->ARGS_NODE_REGISTERNOTIFY.uEventMask,
+			args->ARGS_NODE_REGISTERNOTIFY.hNotification);
+		break;
+
+	default:
+		/* Message buffers need shared memory, not emulated */
+		status = DSP_ENOTIMPL;
+		break;
+	}
+
+	return status;
+}
+
+/*
+ *  ======== StrmOpen ========
+ *  Only processor-copy streams: there is no shared memory to swap
+ *  buffers through.
+ */
+static DSP_STATUS StrmOpen(Trapped_Args *args)
+{
+	struct DSPEMU_NODE *pNode = FindNode(args->ARGS_STRM_OPEN.hNode);
+	struct DSP_STREAMATTRIN *pAttrIn = NULL;
+	struct EMU_STREAM *pStrm;
+
+	if (pNode == NULL)
+		return DSP_EHANDLE;
+	if (pNode->state == NODE_DONE)
+		return DSP_EWRONGSTATE;
+	if (args->ARGS_STRM_OPEN.pAttrIn)
+		pAttrIn = args->ARGS_STRM_OPEN.pAttrIn->pStreamAttrIn;
+	if (pAttrIn && pAttrIn->lMode != STRMMODE_PROCCOPY)
+		return DSP_ENOTIMPL;
+	if ((pAttrIn && pAttrIn->uNumBufs > EMU_STRM_MAXBUFS) ||
+	    FindStream(NULL, pNode, args->ARGS_STRM_OPEN.uDirection,
+		       args->ARGS_STRM_OPEN.uIndex))
+		return DSP_EVALUE;
+
+	pStrm = calloc(1, sizeof(*pStrm));
+	if (pStrm == NULL)
+		return DSP_EMEMORY;
+
+	pStrm->pNode = pNode;
+	pStrm->uDirection = args->ARGS_STRM_OPEN.uDirection;
+	pStrm->uIndex = args->ARGS_STRM_OPEN.uIndex;
+	pStrm->uNumBufs = (pAttrIn && pAttrIn->uNumBufs) ?
+		pAttrIn->uNumBufs : EMU_STRM_NUMBUFS;
+	pStrm->uTimeout = (pAttrIn && pAttrIn->uTimeout) ?
+		pAttrIn->uTimeout : EMU_STRM_TIMEOUT;
+	pStrm->next = emuStreams;
+	emuStreams = pStrm;
+	*args->ARGS_STRM_OPEN.phStream = pStrm;
+
+	return DSP_SOK;
+}
+
+/*
+ *  ======== StrmSelect ========
+ */
+static DSP_STATUS StrmSelect(Trapped_Args *args)
+{
+	DSP_HSTREAM *aStreamTab = args->ARGS_STRM_SELECT.aStreamTab;
+	struct EMU_STREAM *pStrm;
+	unsigned long long ullEnd;
+	unsigned long long ullNow;
+	unsigned long long ullWake;
+	UINT uMask;
+	UINT i;
+
+	if (args->ARGS_STRM_SELECT.nStreams > sizeof(UINT) * 8)
+		return DSP_ERANGE;
+
+	ullEnd = StrmDeadline(args->ARGS_STRM_SELECT.uTimeout);
+	for (;;) {
+		ullNow = NowNs();
+		ullWake = ullEnd;
+		uMask = 0;
+		for (i = 0; i < args->ARGS_STRM_SELECT.nStreams; i++) {
+			pStrm = FindStream(aStreamTab[i], NULL, 0, 0);
+			if (pStrm == NULL)
+				return DSP_EHANDLE;
+			if (pStrm->uDone == 0)
+				continue;
+			if (pStrm->aBuf[pStrm->uHead].ullTime <= ullNow)
+				uMask |= 1 << i;
+			else if (ullWake == 0 ||
+				 pStrm->aBuf[pStrm->uHead].ullTime < ullWake)
+				ullWake = pStrm->aBuf[pStrm->uHead].ullTime;
+		}
+		if (uMask || (ullEnd && ullNow >= ullEnd))
+			break;
+		StrmWait(ullWake);
+	}
+	*args->ARGS_STRM_SELECT.pMask = uMask;
+
+	return uMask ? DSP_SOK : DSP_ETIMEOUT;
+}
+
+/*
+ *  ======== StrmTrap ========
+ */
+static DSP_STATUS StrmTrap(Trapped_Args *args, int cmd)
+{
+	DSP_STATUS status = DSP_SOK;
+	struct EMU_STREAM **ppStrm;
+	struct EMU_STREAM *pStrm;
+	struct EMU_STRMBUF *pBuf;
+	struct STRM_INFO *pInfo;
+	unsigned long long ullEnd;
+
+	if (cmd == CMD_STRM_OPEN_OFFSET)
+		return StrmOpen(args);
+	if (cmd == CMD_STRM_SELECT_OFFSET)
+		return StrmSelect(args);
+
+	/* hStream is the first member of every other STRM command */
+	pStrm = FindStream(args->ARGS_STRM_CLOSE.hStream, NULL, 0, 0);
+	if (pStrm == NULL)
+		return DSP_EHANDLE;
+
+	switch (cmd) {
+	case CMD_STRM_CLOSE_OFFSET:
+		if (pStrm->uCount) {
+			status = DSP_EPENDING;
+			break;
+		}
+		for (ppStrm = &emuStreams; *ppStrm != pStrm;
+						ppStrm = &(*ppStrm)->next)
+			;
+		*ppStrm = pStrm->next;
+		FreeEvents(pStrm);
+		free(pStrm);
+		pthread_cond_broadcast(&emuStrmCond);
+		break;
+
+	case CMD_STRM_GETINFO_OFFSET:
+		pInfo = args->ARGS_STRM_GETINFO.pStreamInfo;
+		pInfo->lMode = STRMMODE_PROCCOPY;
+		pInfo->uSegment = 0;
+		pInfo->pVirtBase = NULL;
+		pInfo->pUser->cbStruct = sizeof(struct DSP_STREAMINFO);
+		pInfo->pUser->uNumberBufsAllowed = pStrm->uNumBufs;
+		pInfo->pUser->uNumberBufsInStream = pStrm->uCount;
+		pInfo->pUser->ulNumberBytes = pStrm->ulBytes;
+		pInfo->pUser->hSyncObjectHandle = NULL;
+		pInfo->pUser->ssStreamState = pStrm->uCount == 0 ? STREAM_IDLE :
+			pStrm->uDone < pStrm->uCount ? STREAM_PENDING :
+			STREAM_DONE;
+		break;
+
+	case CMD_STRM_ISSUE_OFFSET:
+		if (pStrm->uCount == pStrm->uNumBufs) {
+			status = DSP_ESTREAMFULL;
+			break;
+		}
+		pBuf = &pStrm->aBuf[(pStrm->uHead + pStrm->uCount) %
+							EMU_STRM_MAXBUFS];
+		pBuf->pBuffer = args->ARGS_STRM_ISSUE.pBuffer;
+		pBuf->ulBytes = args->ARGS_STRM_ISSUE.dwBytes;
+		pBuf->ulBufSize = args->ARGS_STRM_ISSUE.dwBufSize;
+		pBuf->dwArg = args->ARGS_STRM_ISSUE.dwArg;
+		pBuf->ullTime = NowNs() + emuMsgLatencyUs * 1000ULL;
+		pStrm->uCount++;
+		StreamMatch(pStrm->pNode, pStrm->uIndex);
+		break;
+
+	case CMD_STRM_RECLAIM_OFFSET:
+		if (pStrm->uCount == 0) {
+			status = DSP_ETIMEOUT;
+			break;
+		}
+		ullEnd = StrmDeadline(pStrm->uTimeout);
+		for (;;) {
+			if (pStrm->uDone &&
+			    pStrm->aBuf[pStrm->uHead].ullTime <= NowNs())
+				break;
+			if (ullEnd && NowNs() >= ullEnd) {
+				status = DSP_ETIMEOUT;
+				break;
+			}
+			StrmWait(pStrm->uDone &&
+				 (ullEnd == 0 ||
+				  pStrm->aBuf[pStrm->uHead].ullTime < ullEnd) ?
+				 pStrm->aBuf[pStrm->uHead].ullTime : ullEnd);
+			/* The node may have been deleted meanwhile */
+			if (FindStream(args->ARGS_STRM_RECLAIM.hStream,
+				       NULL, 0, 0) == NULL)
+				return DSP_EHANDLE;
+		}
+		if (DSP_FAILED(status))
+			break;
+
+		pBuf = &pStrm->aBuf[pStrm->uHead];
+		*args->ARGS_STRM_RECLAIM.pBufPtr = pBuf->pBuffer;
+		*args->ARGS_STRM_RECLAIM.pBytes = pBuf->ulBytes;
+		if (args->ARGS_STRM_RECLAIM.pBufSize)
+			*args->ARGS_STRM_RECLAIM.pBufSize = pBuf->ulBufSize;
+		*args->ARGS_STRM_RECLAIM.pdwArg = pBuf->dwArg;
+		pStrm->uHead = (pStrm->uHead + 1) % EMU_STRM_MAXBUFS;
+		pStrm->uCount--;
+		pStrm->uDone--;
+		break;
+
+	case CMD_STRM_IDLE_OFFSET:
+		/* Output drains first unless flushed; input is cancelled */
+		if (pStrm->uDirection == DSP_TONODE &&
+		    !args->ARGS_STRM_IDLE.bFlush) {
+			ullEnd = StrmDeadline(pStrm->uTimeout);
+			while (pStrm->uDone < pStrm->uCount) {
+				if (ullEnd && NowNs() >= ullEnd) {
+					status = DSP_ETIMEOUT;
+					break;
+				}
+				StrmWait(ullEnd);
+				if (FindStream(args->ARGS_STRM_IDLE.hStream,
+					       NULL, 0, 0) == NULL)
+					return DSP_EHANDLE;
+			}
+		}
+		if (DSP_SUCCEEDED(status))
+			StreamFlush(pStrm);
+		break;
+
+	case CMD_STRM_REGISTERNOTIFY_OFFSET:
+		status = RegisterNotify(pStrm,
+			args->ARGS_STRM_REGISTERNOTIFY.uEventMask,
+			args->ARGS_STRM_REGISTERNOTIFY.hNotification);
+		break;
+
+	default:
+		/* Buffer allocation needs shared memory, not emulated */
+		status = DSP_ENOTIMPL;
+		break;
+	}
+
+	return status;
+}
+
+/*
+ *  ======== MgrTrap ========
+ */
+static DSP_STATUS MgrTrap(Trapped_Args *args, int cmd)
+{
+	DSP_STATUS status = DSP_SOK;
+	struct EMU_OBJECT **ppObj;
+	struct EMU_OBJECT *pObj;
+	struct DSP_PROCESSORINFO *pInfo;
+	UINT uNodes;
+
+	switch (cmd) {
+	case CMD_MGR_ENUMNODE_INFO_OFFSET:
+		uNodes = 0;
+		for (pObj = emuObjects; pObj; pObj = pObj->next) {
+			if (pObj->objType != DSP_DCDNODETYPE)
+				continue;
+			if (uNodes == args->ARGS_MGR_ENUMNODE_INFO.uNode)
+				FillProps(pObj,
+					args->ARGS_MGR_ENUMNODE_INFO.pNDBProps);
+			uNodes++;
+		}
+		*args->ARGS_MGR_ENUMNODE_INFO.puNumNodes = uNodes;
+		if (args->ARGS_MGR_ENUMNODE_INFO.uNode >= uNodes)
+			status = DSP_EINVALIDARG;
+		break;
+
+	case CMD_MGR_ENUMPROC_INFO_OFFSET:
+		*args->ARGS_MGR_ENUMPROC_INFO.puNumProcs = 1;
+		if (args->ARGS_MGR_ENUMPROC_INFO.uProcessor != DSP_UNIT) {
+			status = DSP_EINVALIDARG;
+			break;
+		}
+		pInfo = args->ARGS_MGR_ENUMPROC_INFO.pProcessorInfo;
+		memset(pInfo, 0, sizeof(*pInfo));
+		pInfo->cbStruct = sizeof(*pInfo);
+		pInfo->uProcessorFamily = 6000;
+		pInfo->uProcessorType = DSPTYPE_64;
+		pInfo->uProcessorID = DSP_UNIT;
+		pInfo->nNodeMinPriority = DSP_NODE_MIN_PRIORITY;
+		pInfo->nNodeMaxPriority = DSP_NODE_MAX_PRIORITY;
+		break;
+
+	case CMD_MGR_REGISTEROBJECT_OFFSET:
+		pObj = FindObject(args->ARGS_MGR_REGISTEROBJECT.pUuid,
+				  args->ARGS_MGR_REGISTEROBJECT.objType);
+		if (pObj == NULL) {
+			pObj = calloc(1, sizeof(*pObj));
+			if (pObj == NULL) {
+				status = DSP_EMEMORY;
+				break;
+			}
+			pObj->uuid = *args->ARGS_MGR_REGISTEROBJECT.pUuid;
+			pObj->objType = args->ARGS_MGR_REGISTEROBJECT.objType;
+			pObj->next = emuObjects;
+			emuObjects = pObj;
+		}
+		strncpy(pObj->szPath, args->ARGS_MGR_REGISTEROBJECT.pszPathName,
+			sizeof(pObj->szPath) - 1);
+		break;
+
+	case CMD_MGR_UNREGISTEROBJECT_OFFSET:
+		for (ppObj = &emuObjects; *ppObj; ppObj = &(*ppObj)->next) {
+			pObj = *ppObj;
+			if (pObj->objType ==
+				args->ARGS_MGR_UNREGISTEROBJECT.objType &&
+			    UuidEqual(&pObj->uuid,
+				args->ARGS_MGR_UNREGISTEROBJECT.pUuid)) {
+				*ppObj = pObj->next;
+				free(pObj);
+				break;
+			}
+		}
+		break;
+
+#ifndef RES_CLEANUP_DISABLE
+	case CMD_MGR_RESOUCES_OFFSET:
+		break;
+#endif
+
+	default:
+		status = DSP_ENOTIMPL;
+		break;
+	}
+
+	return status;
+}
+
+/*
+ *  ======== DSPEMU_Enabled ========
+ */
+bool DSPEMU_Enabled(VOID)
+{
+	CONST CHAR *pszValue = getenv(DSPEMU_ENABLE_ENV);
+
+	if (pszValue && *pszValue)
+		return strcmp(pszValue, "0") != 0;
+	return true;
+}
+
+/*
+ *  ======== DSPEMU_Open ========
+ *  Returns the pseudo driver handle; the environment is read here.
+ */
+int DSPEMU_Open(VOID)
+{
+	CONST CHAR *pszPath = getenv(DSPEMU_PLUGIN_PATH_ENV);
+
+	pthread_once(&emuStrmOnce, StrmCondInit);
+
+	pthread_mutex_lock(&emuLock);
+	emuMsgLatencyUs = EnvUInt(DSPEMU_MSG_LATENCY_ENV,
+				  DSPEMU_DEFAULT_MSG_LATENCY);
+	emuNodeProcessUs = EnvUInt(DSPEMU_NODE_PROCESS_ENV, 0);
+	emuFlushNsPerKb = EnvUInt(DSPEMU_FLUSH_COST_ENV, 0);
+	if (pszPath && *pszPath) {
+		strncpy(emuPluginPath, pszPath, sizeof(emuPluginPath) - 1);
+		emuPluginPath[sizeof(emuPluginPath) - 1] = '\0';
+	}
+	pthread_mutex_unlock(&emuLock);
+
+	DEBUGMSG(DSPAPI_ZONE_INIT, (TEXT("EMU: DSP Bridge emulator selected\n")));
+
+	return DSPEMU_HANDLE;
+}
+
+/*
+ *  ======== DSPEMU_Close ========
+ *  Last close: release what the process left behind, as the driver does.
+ *  Registered objects persist, like the DCD registry.
+ */
+int DSPEMU_Close(VOID)
+{
+	struct DSPEMU_NODE *pNode;
+	struct EMU_PROC *pProc;
+	struct EMU_RSV *pRsv;
+	struct EMU_MAP *pMap;
+
+	pthread_mutex_lock(&emuLock);
+	while ((pNode = emuNodes) != NULL) {
+		emuNodes = pNode->next;
+		DeleteNode(pNode);
+	}
+	while ((pProc = emuProcs) != NULL) {
+		emuProcs = pProc->next;
+		FreeEvents(pProc);
+		free(pProc);
+	}
+	while ((pMap = emuMaps) != NULL) {
+		emuMaps = pMap->next;
+		free(pMap);
+	}
+	while ((pRsv = emuRsvs) != NULL) {
+		emuRsvs = pRsv->next;
+		free(pRsv);
+	}
+	pthread_mutex_unlock(&emuLock);
+
+	return 0;
+}
+
+/*
+ *  ======== DSPEMU_Trap ========
+ */
+DWORD DSPEMU_Trap(Trapped_Args *args, int cmd)
+{
+	DSP_STATUS status;
+
+	if (cmd == CMD_MGR_WAIT_OFFSET)
+		return MgrWait(args->ARGS_MGR_WAIT.aNotifications,
+			       args->ARGS_MGR_WAIT.uCount,
+			       args->ARGS_MGR_WAIT.puIndex,
+			       args->ARGS_MGR_WAIT.uTimeout);
+	if (cmd == CMD_NODE_ALLOCATE_OFFSET) {
+		pthread_mutex_lock(&emuLock);
+		status = FindProc(args->ARGS_NODE_ALLOCATE.hProcessor) ?
+			DSP_SOK : DSP_EHANDLE;
+		pthread_mutex_unlock(&emuLock);
+		return DSP_SUCCEEDED(status) ? NodeAllocate(args) : status;
+	}
+
+	pthread_mutex_lock(&emuLock);
+	if (cmd <= CMD_MGR_END_OFFSET)
+		status = MgrTrap(args, cmd);
+	else if (cmd <= CMD_PROC_END_OFFSET || cmd == CMD_PROC_CACHEOPS_OFFSET)
+		status = ProcTrap(args, cmd);
+	else if (cmd == CMD_NODE_GETUUIDPROPS_OFFSET) {
+		struct EMU_OBJECT *pObj = FindObject(
+				args->ARGS_NODE_GETUUIDPROPS.pNodeID,
+				DSP_DCDNODETYPE);
+
+		if (FindProc(args->ARGS_NODE_GETUUIDPROPS.hProcessor) == NULL)
+			status = DSP_EHANDLE;
+		else if (pObj == NULL)
+			status = DSP_EUUID;
+		else {
+			FillProps(pObj, args->ARGS_NODE_GETUUIDPROPS.pNodeProps);
+			status = DSP_SOK;
+		}
+	} else if (cmd <= CMD_NODE_END_OFFSET)
+		status = NodeTrap(args, cmd);
+	else if (cmd <= CMD_STRM_END_OFFSET)
+		status = StrmTrap(args, cmd);
+	else if (cmd == CMD_CMM_GETHANDLE_OFFSET) {
+		*args->ARGS_CMM_GETHANDLE.phCmmMgr = (struct CMM_OBJECT *)&emuCmm;
+		status = DSP_SOK;
+	} else if (cmd == CMD_CMM_GETINFO_OFFSET) {
+		/* No shared memory segments, so nothing gets mmap()ed */
+		memset(args->ARGS_CMM_GETINFO.pCmmInfo, 0,
+		       sizeof(struct CMM_INFO));
+		status = DSP_SOK;
+	} else
+		status = DSP_ENOTIMPL;
+	pthread_mutex_unlock(&emuLock);
+
+	if (status == DSP_ENOTIMPL)
+		DEBUGMSG(DSPAPI_ZONE_WARNING,
+			 (TEXT("EMU: Bridge command not emulated\n")));
+	return status;
+}
+
+/*
+ *  ======== DSPEMU_SendMessage ========
+ */
+DSP_STATUS DSPEMU_SendMessage(struct DSPEMU_NODE *hNode,
+			      CONST struct DSP_MSG *pMsg)
+{
+	DSP_STATUS status = DSP_SOK;
+
+	SleepUs(emuMsgLatencyUs);
+
+	pthread_mutex_lock(&emuLock);
+	while (!hNode->bTerminate && hNode->toGpp.uCount == EMU_MSG_DEPTH)
+		pthread_cond_wait(&hNode->cond, &emuLock);
+	if (hNode->bTerminate)
+		status = DSP_EWRONGSTATE;
+	else {
+		MsgQ_Put(&hNode->toGpp, pMsg);
+		pthread_cond_broadcast(&hNode->cond);
+		SignalEvents(hNode, DSP_NODEMESSAGEREADY);
+	}
+	pthread_mutex_unlock(&emuLock);
+
+	return status;
+}
+
+/*
+ *  ======== DSPEMU_ToMpu ========
+ */
+PVOID DSPEMU_ToMpu(DWORD dwDspAddr, ULONG ulSize)
+{
+	struct EMU_MAP *pMap;
+	PVOID pMpu = NULL;
+
+	pthread_mutex_lock(&emuLock);
+	for (pMap = emuMaps; pMap; pMap = pMap->next) {
+		if (dwDspAddr - pMap->ulDspAddr < pMap->ulSize &&
+		    ulSize <= pMap->ulSize - (dwDspAddr - pMap->ulDspAddr)) {
+			pMpu = (PVOID)(pMap->ulMpuAddr +
+				       (dwDspAddr - pMap->ulDspAddr));
+			break;
+		}
+	}
+	pthread_mutex_unlock(&emuLock);
+
+	return pMpu;
+}
+
+/*
+ *  ======== DSPEMU_GetContext / DSPEMU_SetContext ========
+ */
+PVOID DSPEMU_GetContext(struct DSPEMU_NODE *hNode)
+{
+	return hNode->pContext;
+}
+
+VOID DSPEMU_SetContext(struct DSPEMU_NODE *hNode, PVOID pContext)
+{
+	hNode->pContext = pContext;
+}
+
+/*
+ *  ======== DSPEMU_RaiseProcessorEvent ========
+ */
+VOID DSPEMU_RaiseProcessorEvent(UINT uEvent)
+{
+	struct EMU_PROC *pProc;
+
+	pthread_mutex_lock(&emuLock);
+	emuProcState = PROC_ERROR;
+	emuErrInfo.dwErrMask = uEvent;
+	for (pProc = emuProcs; pProc; pProc = pProc->next)
+		SignalEvents(pProc, uEvent | DSP_PROCESSORSTATECHANGE);
+	pthread_mutex_unlock(&emuLock);
+}
@@ -44,6 +44,10 @@
 #include <dsptrap.h>
 #include <_dbdebug.h>
 
+#ifdef DEBUG_BRIDGE_PERF
+#include <perfutils.h>
+#endif
+
 /*  ----------------------------------- Globals */
 extern int hMediaFile;		/* class driver handle */
 
@@ -53,11 +57,22 @@ extern int hMediaFile;		/* class driver handle */
 DWORD DSPTRAP_Trap(Trapped_Args *args, int cmd)
 {
 	DWORD dwResult = DSP_EHANDLE;/* returned from call into class driver */
+#ifdef DEBUG_BRIDGE_PERF
+	unsigned long long ullBegin = PERF_Now();
+#endif
 
+#ifdef DSPTRAP_EMULATOR
+	if (hMediaFile == DSPEMU_HANDLE)
+		dwResult = DSPEMU_Trap(args, cmd);
+	else
+#endif
 	if (hMediaFile >= 0)
 		dwResult = ioctl(hMediaFile, cmd, args);
 	else
 		DEBUGMSG(DSPAPI_ZONE_FUNCTION, "Invalid handle to driver\n");
 
+#ifdef DEBUG_BRIDGE_PERF
+	PERF_TrapRecord(args, cmd, dwResult, ullBegin);
+#endif
 	return dwResult;
 }
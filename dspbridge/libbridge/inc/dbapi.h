@@ -50,6 +50,7 @@ extern "C" {
 #include <DSPProcessor.h>	/* DSP/BIOS Bridge Processor APIs                   */
 #include <DSPNode.h>		/* DSP/BIOS Bridge Node APIs                        */
 #include <DSPStream.h>		/* DSP/BIOS Bridge Stream APIs                      */
+#include <DSPStreamEngine.h>	/* DSP/BIOS Bridge Stream engine                    */
 
 #ifdef __cplusplus
 }
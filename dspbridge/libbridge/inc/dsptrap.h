@@ -46,4 +46,15 @@
 /* Function Prototypes */
 extern DWORD DSPTRAP_Trap(Trapped_Args * args, int cmd);
 
+#ifdef DSPTRAP_EMULATOR
+/* Pseudo driver handle while the host emulator (dspemu.c) is selected */
+#define DSPEMU_HANDLE       0x7fffffff
+
+/* Host emulator backend, see dspemu.h */
+extern bool DSPEMU_Enabled(void);
+extern int DSPEMU_Open(void);
+extern int DSPEMU_Close(void);
+extern DWORD DSPEMU_Trap(Trapped_Args * args, int cmd);
+#endif
+
 #endif				/* DSPTRAP_ */
@@ -15,10 +15,43 @@
  * Lesser General Public License for more details.
  */
 
-#include <sys/time.h>
+/*
+ *  ======== perfutils.h ========
+ *  Description:
+ *      Bridge call profiler, built with DEBUG_BRIDGE_PERF. DSPTRAP_Trap()
+ *      times every command on a monotonic clock and accounts it, per
+ *      thread and without locks, under its CMD_*_OFFSET and the log2
+ *      bucket of its buffer size. The totals of all threads are printed
+ *      by PERF_TrapDump(), and at exit to the file named by
+ *      $DSP_TRAP_PROFILE (stdout when unset).
+ *
+ *  Public Functions:
+ *      PERF_Now
+ *      PERF_TrapRecord
+ *      PERF_TrapDump
+ *      PERF_TrapReset
+ */
+
+#ifndef PERFUTILS_
+#define PERFUTILS_
+
 #include <stdio.h>
 #include <dbdefs.h>
+#include <wcdioctl.h>
+
+#define PERF_PROFILE_ENV    "DSP_TRAP_PROFILE"
+
+/* Monotonic time in ns */
+unsigned long long PERF_Now(VOID);
+
+/* Account one trap that started at ullBegin (PERF_Now) */
+VOID PERF_TrapRecord(Trapped_Args *args, int cmd, DWORD dwResult,
+		     unsigned long long ullBegin);
+
+/* Print the totals of all threads */
+VOID PERF_TrapDump(FILE *fp);
 
-INT getTimeStamp(struct timeval *tv);
+/* Start over; each thread drops its counts on its next trap */
+VOID PERF_TrapReset(VOID);
 
-VOID PrintStatistics(struct timeval *tv_beg,struct timeval* tv_end, char * ModuleName,INT BufferSize);
+#endif				/* PERFUTILS_ */
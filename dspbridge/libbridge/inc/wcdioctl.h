@@ -216,6 +216,12 @@ typedef union {
                 ULONG ulSize;
         } ARGS_PROC_INVALIDATEMEMORY;
 
+	struct {
+		DSP_HPROCESSOR hProcessor;
+		struct DSP_CACHEOP *aOps;
+		UINT uCount;
+	} ARGS_PROC_CACHEOPS;
+
 
 	/* NODE Module */
 	struct {
@@ -530,7 +536,15 @@ typedef union {
 #define CMD_UTIL_TESTDLL_OFFSET         (CMD_UTIL_BASE_OFFSET + 0)
 #define CMD_UTIL_END_OFFSET             CMD_UTIL_TESTDLL_OFFSET
 
+/*
+ * PROC commands added later. They follow UTIL so that the offsets known to
+ * older drivers do not move; those drivers fail them as unknown commands.
+ */
+#define CMD_PROCEXT_BASE_OFFSET         (CMD_UTIL_END_OFFSET + 1)
+#define CMD_PROC_CACHEOPS_OFFSET        (CMD_PROCEXT_BASE_OFFSET + 0)
+#define CMD_PROCEXT_END_OFFSET          CMD_PROC_CACHEOPS_OFFSET
+
 /* !!! place all command modules before CMD_BASE_END_OFFSET */
-#define CMD_BASE_END_OFFSET             CMD_UTIL_END_OFFSET
+#define CMD_BASE_END_OFFSET             CMD_PROCEXT_END_OFFSET
 
 #endif				/* WCDIOCTL_ */
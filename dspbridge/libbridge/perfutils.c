@@ -1,5 +1,5 @@
 /*
- * dspbridge/src/api/linux/Timer.c
+ * dspbridge/src/api/linux/perfutils.c
  *
  * DSP-BIOS Bridge driver support functions for TI OMAP processors.
  *
@@ -17,10 +17,15 @@
 
 
 /*
- *  ======== Timer.c ========
+ *  ======== perfutils.c ========
  *  Description:
- *      Source for API time measurements. For Debugging only
+ *      Bridge call profiler. For Debugging only (DEBUG_BRIDGE_PERF).
  *
+ *      Every thread that traps gets its own table, claimed once and never
+ *      freed; only the owner writes it, so recording takes no lock. The
+ *      dump reads all tables racily, which at worst misses the calls
+ *      being recorded at that moment. Reset bumps a generation number
+ *      that each owner notices on its next trap.
  *
  *! Revision History
  *! =================
@@ -29,45 +34,450 @@
  */
 
 /*  ----------------------------------- Host OS */
+#include <host_os.h>
+
+/*  ----------------------------------- DSP/BIOS Bridge */
+#include <dbdefs.h>
+
+/*  ----------------------------------- This */
 #include <perfutils.h>
 
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+/*  ----------------------------------- Definitions */
+#define PERF_SLOTS          128	/* (command, size) keys per thread */
+#define PERF_LAT_BUCKETS    40	/* log2 ns, up to ~18 minutes */
+#define PERF_SIZE_BUCKETS   33	/* 0: no size, b: [2^(b-1), 2^b) bytes */
+#define PERF_NUM_CMDS       (CMD_BASE_END_OFFSET - CMD_BASE + 1)
+
+#define PERF_KEY(cmd, bucket)   ((((cmd) - CMD_BASE + 1) << 8) | (bucket))
+#define PERF_KEY_CMD(key)       (((key) >> 8) + CMD_BASE - 1)
+#define PERF_KEY_BUCKET(key)    ((key) & 0xff)
+
+struct PERF_SLOT {
+	UINT uKey;		/* 0 when unused */
+	ULONG ulCount;
+	ULONG ulFailed;
+	unsigned long long ullTotalNs;
+	unsigned long long ullMinNs;
+	unsigned long long ullMaxNs;
+	ULONG aulHist[PERF_LAT_BUCKETS];
+};
+
+struct PERF_THREAD {
+	struct PERF_THREAD *next;
+	volatile int inUse;
+	volatile UINT uGeneration;
+	ULONG ulDropped;	/* calls that found the table full */
+	struct PERF_SLOT aSlots[PERF_SLOTS];
+};
+
+#define PERF_CMD(x)     [CMD_##x##_OFFSET - CMD_BASE] = #x
+
+static const char *const perfCmdNames[PERF_NUM_CMDS] = {
+	PERF_CMD(MGR_ENUMNODE_INFO),
+	PERF_CMD(MGR_ENUMPROC_INFO),
+	PERF_CMD(MGR_REGISTEROBJECT),
+	PERF_CMD(MGR_UNREGISTEROBJECT),
+	PERF_CMD(MGR_WAIT),
+#ifndef RES_CLEANUP_DISABLE
+	PERF_CMD(MGR_RESOUCES),
+#endif
+	PERF_CMD(PROC_ATTACH),
+	PERF_CMD(PROC_CTRL),
+	PERF_CMD(PROC_DETACH),
+	PERF_CMD(PROC_ENUMNODE),
+	PERF_CMD(PROC_ENUMRESOURCES),
+	PERF_CMD(PROC_GETSTATE),
+	PERF_CMD(PROC_GETTRACE),
+	PERF_CMD(PROC_LOAD),
+	PERF_CMD(PROC_REGISTERNOTIFY),
+	PERF_CMD(PROC_START),
+	PERF_CMD(PROC_RSVMEM),
+	PERF_CMD(PROC_UNRSVMEM),
+	PERF_CMD(PROC_MAPMEM),
+	PERF_CMD(PROC_UNMAPMEM),
+	PERF_CMD(PROC_FLUSHMEMORY),
+	PERF_CMD(PROC_STOP),
+	PERF_CMD(PROC_INVALIDATEMEMORY),
+	PERF_CMD(NODE_ALLOCATE),
+	PERF_CMD(NODE_ALLOCMSGBUF),
+	PERF_CMD(NODE_CHANGEPRIORITY),
+	PERF_CMD(NODE_CONNECT),
+	PERF_CMD(NODE_CREATE),
+	PERF_CMD(NODE_DELETE),
+	PERF_CMD(NODE_FREEMSGBUF),
+	PERF_CMD(NODE_GETATTR),
+	PERF_CMD(NODE_GETMESSAGE),
+	PERF_CMD(NODE_PAUSE),
+	PERF_CMD(NODE_PUTMESSAGE),
+	PERF_CMD(NODE_REGISTERNOTIFY),
+	PERF_CMD(NODE_RUN),
+	PERF_CMD(NODE_TERMINATE),
+	PERF_CMD(NODE_GETUUIDPROPS),
+	PERF_CMD(STRM_ALLOCATEBUFFER),
+	PERF_CMD(STRM_CLOSE),
+	PERF_CMD(STRM_FREEBUFFER),
+	PERF_CMD(STRM_GETEVENTHANDLE),
+	PERF_CMD(STRM_GETINFO),
+	PERF_CMD(STRM_IDLE),
+	PERF_CMD(STRM_ISSUE),
+	PERF_CMD(STRM_OPEN),
+	PERF_CMD(STRM_RECLAIM),
+	PERF_CMD(STRM_REGISTERNOTIFY),
+	PERF_CMD(STRM_SELECT),
+	PERF_CMD(CMM_ALLOCBUF),
+	PERF_CMD(CMM_FREEBUF),
+	PERF_CMD(CMM_GETHANDLE),
+	PERF_CMD(CMM_GETINFO),
+	PERF_CMD(MEM_ALLOC),
+	PERF_CMD(MEM_CALLOC),
+	PERF_CMD(MEM_FREE),
+	PERF_CMD(MEM_PAGELOCK),
+	PERF_CMD(MEM_PAGEUNLOCK),
+	PERF_CMD(UTIL_TESTDLL),
+	PERF_CMD(PROC_CACHEOPS),
+};
+
+/*  ----------------------------------- Globals */
+static struct PERF_THREAD *volatile perfThreads;	/* push-only */
+static volatile UINT perfGeneration;
+static pthread_key_t perfKey;
+static pthread_once_t perfOnce = PTHREAD_ONCE_INIT;
+
+/*
+ *  ======== Log2 ========
+ *  Index of the highest set bit, -1 for 0.
+ */
+static INT Log2(unsigned long long ullValue)
+{
+	INT i = -1;
+
+	while (ullValue) {
+		ullValue >>= 1;
+		i++;
+	}
+	return i;
+}
+
+/*
+ *  ======== TrapSize ========
+ *  Buffer size carried by the command, 0 if none; the sum of all the
+ *  ranges for a vectored cache operation. UnMap and
+ *  UnReserveMemory leave their ulSize unset, so it is not read.
+ */
+static ULONG TrapSize(Trapped_Args *args, int cmd)
+{
+	ULONG ulSize = 0;
+	UINT i;
+
+	switch (cmd) {
+	case CMD_PROC_FLUSHMEMORY_OFFSET:
+		return args->ARGS_PROC_FLUSHMEMORY.ulSize;
+	case CMD_PROC_INVALIDATEMEMORY_OFFSET:
+		return args->ARGS_PROC_INVALIDATEMEMORY.ulSize;
+	case CMD_PROC_MAPMEM_OFFSET:
+		return args->ARGS_PROC_MAPMEM.ulSize;
+	case CMD_PROC_RSVMEM_OFFSET:
+		return args->ARGS_PROC_RSVMEM.ulSize;
+	case CMD_NODE_ALLOCMSGBUF_OFFSET:
+		return args->ARGS_NODE_ALLOCMSGBUF.uSize;
+	case CMD_STRM_ALLOCATEBUFFER_OFFSET:
+		return args->ARGS_STRM_ALLOCATEBUFFER.uSize;
+	case CMD_STRM_ISSUE_OFFSET:
+		return args->ARGS_STRM_ISSUE.dwBytes;
+	case CMD_CMM_ALLOCBUF_OFFSET:
+		return args->ARGS_CMM_ALLOCBUF.uSize;
+	case CMD_MEM_ALLOC_OFFSET:
+		return args->ARGS_MEM_ALLOC.cBytes;
+	case CMD_MEM_CALLOC_OFFSET:
+		return args->ARGS_MEM_CALLOC.cBytes;
+	case CMD_MEM_PAGELOCK_OFFSET:
+		return args->ARGS_MEM_PAGELOCK.cSize;
+	case CMD_MEM_PAGEUNLOCK_OFFSET:
+		return args->ARGS_MEM_PAGEUNLOCK.cSize;
+	case CMD_PROC_CACHEOPS_OFFSET:
+		for (i = 0; i < args->ARGS_PROC_CACHEOPS.uCount; i++)
+			ulSize += args->ARGS_PROC_CACHEOPS.aOps[i].ulSize;
+		return ulSize;
+	default:
+		return 0;
+	}
+}
+
+/*
+ *  ======== FindSlot ========
+ *  Open addressing on uKey; NULL when the table is full.
+ */
+static struct PERF_SLOT *FindSlot(struct PERF_SLOT *aSlots, UINT uKey)
+{
+	UINT uHash = (uKey * 2654435761U) % PERF_SLOTS;
+	UINT i;
+
+	for (i = 0; i < PERF_SLOTS; i++) {
+		struct PERF_SLOT *pSlot = &aSlots[(uHash + i) % PERF_SLOTS];
+
+		if (pSlot->uKey == uKey)
+			return pSlot;
+		if (pSlot->uKey == 0) {
+			pSlot->ullMinNs = ~0ULL;
+			pSlot->uKey = uKey;
+			return pSlot;
+		}
+	}
+	return NULL;
+}
 
 /*
- * ======== StartTimer ========
+ *  ======== AtExitDump ========
  */
-INT getTimeStamp(struct timeval *tv)
+static void AtExitDump(void)
 {
-	INT Result = 0;
-	struct timezone tz;
-	Result = gettimeofday(tv, &tz);
-	if (Result != 0)
-		fprintf(stdout, "FAIL: gettimeofday is failed\n");
+	const char *pszPath = getenv(PERF_PROFILE_ENV);
+	FILE *fp = stdout;
 
-	return Result;
+	if (pszPath && *pszPath) {
+		fp = fopen(pszPath, "a");
+		if (fp == NULL)
+			return;
+	}
+	PERF_TrapDump(fp);
+	if (fp != stdout)
+		fclose(fp);
 }
+
 /*
- * ======== PrintStatisticsStartTimer ========
+ *  ======== ThreadExit ========
+ *  The table keeps its counts and goes to the next new thread.
  */
-void PrintStatistics(struct timeval *tv_beg, struct timeval *tv_end,
-			char *ModuleName, INT BufferSize)
+static void ThreadExit(void *pArg)
 {
-	ULONG   totalTimeuSec = 0;
+	struct PERF_THREAD *pThread = pArg;
+
+	__sync_synchronize();
+	pThread->inUse = 0;
+}
 
-	if (tv_end->tv_usec < tv_beg->tv_usec) {
-		tv_end->tv_usec += 1000000;
-		tv_end->tv_sec  -= 1;
+static void PerfInit(void)
+{
+	pthread_key_create(&perfKey, ThreadExit);
+	atexit(AtExitDump);
+}
+
+/*
+ *  ======== ClaimThread ========
+ *  The calling thread's table: a released one if any, else a new one.
+ */
+static struct PERF_THREAD *ClaimThread(VOID)
+{
+	struct PERF_THREAD *pThread;
+
+	pthread_once(&perfOnce, PerfInit);
+
+	for (pThread = perfThreads; pThread; pThread = pThread->next) {
+		if (!pThread->inUse &&
+		    __sync_bool_compare_and_swap(&pThread->inUse, 0, 1))
+			break;
 	}
+	if (pThread == NULL) {
+		pThread = calloc(1, sizeof(*pThread));
+		if (pThread == NULL)
+			return NULL;
 
-	totalTimeuSec = (tv_end->tv_sec - tv_beg->tv_sec) * 1000000 +
-			(tv_end->tv_usec - tv_beg->tv_usec);
-	fprintf(stdout, "LOG: *********BEGIN STATISTICS************"
-				"********************\n");
-	fprintf(stdout, "LOG: MODULE: %s \n", ModuleName);
-	if (BufferSize != 0)
-		fprintf(stdout, "LOG: BufferSize: 0x%x \n", BufferSize);
+		pThread->inUse = 1;
+		pThread->uGeneration = perfGeneration;
+		do {
+			pThread->next = perfThreads;
+		} while (!__sync_bool_compare_and_swap(&perfThreads,
+						       pThread->next, pThread));
+	}
+	pthread_setspecific(perfKey, pThread);
 
-	fprintf(stdout, "LOG: RESULT: %lu\n", totalTimeuSec);
-	fprintf(stdout, "LOG: **********END STATISTICS*************"
-				"******************\n");
+	return pThread;
+}
 
+/*
+ *  ======== PERF_Now ========
+ */
+unsigned long long PERF_Now(VOID)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ *  ======== PERF_TrapRecord ========
+ */
+VOID PERF_TrapRecord(Trapped_Args *args, int cmd, DWORD dwResult,
+		     unsigned long long ullBegin)
+{
+	unsigned long long ullNs = PERF_Now() - ullBegin;
+	struct PERF_THREAD *pThread;
+	struct PERF_SLOT *pSlot;
+	INT iBucket;
+	UINT uGeneration;
+
+	if (cmd < CMD_BASE || cmd > CMD_BASE_END_OFFSET)
+		return;
+
+	pthread_once(&perfOnce, PerfInit);
+	pThread = pthread_getspecific(perfKey);
+	if (pThread == NULL) {
+		pThread = ClaimThread();
+		if (pThread == NULL)
+			return;
+	}
+
+	uGeneration = perfGeneration;
+	if (pThread->uGeneration != uGeneration) {
+		memset(pThread->aSlots, 0, sizeof(pThread->aSlots));
+		pThread->ulDropped = 0;
+		pThread->uGeneration = uGeneration;
+	}
+
+	iBucket = Log2(TrapSize(args, cmd)) + 1;
+	if (iBucket >= PERF_SIZE_BUCKETS)
+		iBucket = PERF_SIZE_BUCKETS - 1;
+	pSlot = FindSlot(pThread->aSlots, PERF_KEY(cmd, iBucket));
+	if (pSlot == NULL) {
+		pThread->ulDropped++;
+		return;
+	}
+
+	pSlot->ulCount++;
+	if (DSP_FAILED(dwResult))
+		pSlot->ulFailed++;
+	pSlot->ullTotalNs += ullNs;
+	if (ullNs < pSlot->ullMinNs)
+		pSlot->ullMinNs = ullNs;
+	if (ullNs > pSlot->ullMaxNs)
+		pSlot->ullMaxNs = ullNs;
+	iBucket = Log2(ullNs);
+	if (iBucket < 0)
+		iBucket = 0;
+	if (iBucket >= PERF_LAT_BUCKETS)
+		iBucket = PERF_LAT_BUCKETS - 1;
+	pSlot->aulHist[iBucket]++;
+}
+
+/*
+ *  ======== Percentile ========
+ *  Upper bound, in ns, of the histogram bucket holding the uPct'th
+ *  percentile.
+ */
+static unsigned long long Percentile(CONST struct PERF_SLOT *pSlot, UINT uPct)
+{
+	unsigned long long ullRank = ((unsigned long long)pSlot->ulCount *
+				      uPct + 99) / 100;
+	unsigned long long ullSeen = 0;
+	INT i;
+
+	for (i = 0; i < PERF_LAT_BUCKETS; i++) {
+		ullSeen += pSlot->aulHist[i];
+		if (ullSeen >= ullRank)
+			break;
+	}
+	return 2ULL << i;
+}
+
+/*
+ *  ======== SizeLabel ========
+ */
+static VOID SizeLabel(UINT uBucket, CHAR *pszLabel, UINT uSize)
+{
+	unsigned long long ullLow = 1ULL << (uBucket - 1);
+
+	if (uBucket == 0)
+		snprintf(pszLabel, uSize, "-");
+	else if (ullLow < 1024)
+		snprintf(pszLabel, uSize, ">=%lluB", ullLow);
+	else if (ullLow < 1024 * 1024)
+		snprintf(pszLabel, uSize, ">=%lluK", ullLow >> 10);
+	else
+		snprintf(pszLabel, uSize, ">=%lluM", ullLow >> 20);
+}
+
+/*
+ *  ======== PERF_TrapDump ========
+ */
+VOID PERF_TrapDump(FILE *fp)
+{
+	struct PERF_THREAD *pThread;
+	struct PERF_SLOT *aTotal;
+	struct PERF_SLOT *pSlot;
+	struct PERF_SLOT *pSum;
+	ULONG ulDropped = 0;
+	UINT uGeneration = perfGeneration;
+	CHAR szSize[16];
+	UINT uCmd;
+	UINT uBucket;
+	UINT i;
+	INT j;
+
+	/* Merged (command, size) table, wide enough for every key */
+	aTotal = calloc(PERF_NUM_CMDS * PERF_SIZE_BUCKETS, sizeof(*aTotal));
+	if (aTotal == NULL)
+		return;
+
+	for (pThread = perfThreads; pThread; pThread = pThread->next) {
+		if (pThread->uGeneration != uGeneration)
+			continue;
+		ulDropped += pThread->ulDropped;
+		for (i = 0; i < PERF_SLOTS; i++) {
+			pSlot = &pThread->aSlots[i];
+			if (pSlot->uKey == 0 || pSlot->ulCount == 0)
+				continue;
+			uCmd = PERF_KEY_CMD(pSlot->uKey) - CMD_BASE;
+			uBucket = PERF_KEY_BUCKET(pSlot->uKey);
+			pSum = &aTotal[uCmd * PERF_SIZE_BUCKETS + uBucket];
+			if (pSum->ulCount == 0)
+				pSum->ullMinNs = ~0ULL;
+			pSum->ulCount += pSlot->ulCount;
+			pSum->ulFailed += pSlot->ulFailed;
+			pSum->ullTotalNs += pSlot->ullTotalNs;
+			if (pSlot->ullMinNs < pSum->ullMinNs)
+				pSum->ullMinNs = pSlot->ullMinNs;
+			if (pSlot->ullMaxNs > pSum->ullMaxNs)
+				pSum->ullMaxNs = pSlot->ullMaxNs;
+			for (j = 0; j < PERF_LAT_BUCKETS; j++)
+				pSum->aulHist[j] += pSlot->aulHist[j];
+		}
+	}
+
+	fprintf(fp, "LOG: Bridge trap profile (ns)\n");
+	fprintf(fp, "LOG: %-22s %-8s %9s %6s %12s %10s %10s %10s "
+		"%10s %10s\n", "command", "size", "count", "failed", "total",
+		"avg", "min", "max", "p50<", "p99<");
+	for (i = 0; i < PERF_NUM_CMDS * PERF_SIZE_BUCKETS; i++) {
+		pSum = &aTotal[i];
+		if (pSum->ulCount == 0)
+			continue;
+		uCmd = i / PERF_SIZE_BUCKETS;
+		SizeLabel(i % PERF_SIZE_BUCKETS, szSize, sizeof(szSize));
+		fprintf(fp, "LOG: %-22s %-8s %9lu %6lu %12llu %10llu %10llu "
+			"%10llu %10llu %10llu\n",
+			perfCmdNames[uCmd] ? perfCmdNames[uCmd] : "?", szSize,
+			pSum->ulCount, pSum->ulFailed, pSum->ullTotalNs,
+			pSum->ullTotalNs / pSum->ulCount, pSum->ullMinNs,
+			pSum->ullMaxNs, Percentile(pSum, 50),
+			Percentile(pSum, 99));
+	}
+	if (ulDropped)
+		fprintf(fp, "LOG: %lu calls not recorded, table full\n",
+			ulDropped);
+	fflush(fp);
+
+	free(aTotal);
+}
+
+/*
+ *  ======== PERF_TrapReset ========
+ */
+VOID PERF_TrapReset(VOID)
+{
+	__sync_fetch_and_add(&perfGeneration, 1);
 }
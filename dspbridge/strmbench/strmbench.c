@@ -0,0 +1,334 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ *  ======== strmbench.c ========
+ *  "strmbench" measures GPP <-> DSP stream throughput through the
+ *  DSPStreamEngine. It runs a loopback node with one input and one output
+ *  stream, pushes a fixed number of buffers through them for every
+ *  combination of buffers in flight and buffer size, and prints bytes/s
+ *  and buffers/s for each. Every buffer carries its sequence number, which
+ *  is checked when it comes back.
+ *
+ *  Usage:
+ *      strmbench [optional args]
+ *
+ *  Options:
+ *      -?: displays "strmbench" usage.
+ *      -p [processor]: DSP processor to attach to, 0 by default.
+ *      -c [count]: buffers sent per measurement, 2000 by default.
+ *      -u [uuid]: UUID of the loopback node, in DCD form
+ *          (XXXXXXXX_XXXX_XXXX_XXXX_XXXXXXXXXXXX).
+ *      -l [library]: node library registered for the UUID. Without -l the
+ *          node is expected to be registered already. Under the Bridge
+ *          emulator (libbridge built with BRIDGE_EMULATOR=1) any library
+ *          name will do: stream data always loops back.
+ *
+ *  Example:
+ *      1.  Under the emulator, with 50us mailbox latency and 200us of
+ *          node work per buffer:
+ *
+ *          DSP_EMU_NODE_PROCESS_US=200 strmbench
+ *
+ *      2.  Against a copy node installed on the DSP:
+ *
+ *          strmbench -u <uuid> -l /system/lib/dsp/strmcopy.dll64P
+ *
+ *! Revision History:
+ *! ================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dbdefs.h>
+
+#include <dbapi.h>
+#include <DSPManager.h>
+#include <DSPProcessor.h>
+#include <DSPNode.h>
+#include <DSPStream.h>
+#include <DSPStreamEngine.h>
+
+/* global constants. */
+#define STRMBENCH_COUNT     2000	/* buffers per measurement */
+#define STRMBENCH_TIMEOUT   5000	/* ms, per buffer */
+#define STRMBENCH_LIBRARY   "/system/lib/dsp/strmloop.dll64P"
+
+static const UINT aNumBufs[] = { 1, 2, 4, 8 };
+static const UINT aBufSize[] = { 512, 4096, 16384, 65536 };
+
+/* Loopback node used when no -u is given */
+static struct DSP_UUID benchUuid = {
+	0x5f4b0c1e, 0x7a2d, 0x4e61, 0x9b, 0x3c, { 0x11, 0x52, 0xa0, 0x6e,
+						  0xd4, 0x27 }
+};
+
+/* State of one measurement, shared by the two stream callbacks */
+struct BENCH {
+	UINT uCount;		/* buffers to send                        */
+	UINT uSent;		/* input buffers issued                   */
+	UINT uReceived;		/* output buffers reclaimed               */
+	UINT uOutInFlight;	/* output buffers issued, not reclaimed   */
+	UINT uErrors;		/* output buffers out of sequence         */
+	unsigned long long ullBytes;
+};
+
+/* function prototype. */
+static VOID DisplayUsage(VOID);
+static DSP_STATUS FromNode(PVOID pArg, DSP_HSTREAM hStream, BYTE *pBuffer,
+			   ULONG ulBytes, ULONG ulBufSize, ULONG *pulIssue);
+static DSP_STATUS Measure(DSP_HNODE hNode, UINT uCount, UINT uNumBufs,
+			  UINT uBufSize);
+static unsigned long long Now(VOID);
+static DSP_STATUS ToNode(PVOID pArg, DSP_HSTREAM hStream, BYTE *pBuffer,
+			 ULONG ulBytes, ULONG ulBufSize, ULONG *pulIssue);
+
+/*
+ *  ======== main ========
+ */
+INT main(INT argc, CHAR *argv[])
+{
+	INT opt;
+	UINT uProcId = 0;
+	UINT uCount = STRMBENCH_COUNT;
+	CHAR *pszLibrary = NULL;
+	bool fError = false;
+	bool fUuid = false;
+	DSP_HPROCESSOR hProc = NULL;
+	DSP_HNODE hNode = NULL;
+	DSP_STATUS status;
+	DSP_STATUS exitStatus;
+	UINT d[11];
+	UINT i;
+	UINT j;
+
+	while ((opt = getopt(argc, argv, "?p:c:u:l:")) != EOF) {
+		switch (opt) {
+		case 'p':
+			uProcId = atoi(optarg);
+			break;
+		case 'c':
+			uCount = atoi(optarg);
+			break;
+		case 'u':
+			if (sscanf(optarg, "%8x_%4x_%4x_%2x%2x_%2x%2x%2x%2x%2x%2x",
+				   &d[0], &d[1], &d[2], &d[3], &d[4], &d[5],
+				   &d[6], &d[7], &d[8], &d[9], &d[10]) != 11) {
+				fError = true;
+				break;
+			}
+			benchUuid.ulData1 = d[0];
+			benchUuid.usData2 = d[1];
+			benchUuid.usData3 = d[2];
+			benchUuid.ucData4 = d[3];
+			benchUuid.ucData5 = d[4];
+			for (i = 0; i < 6; i++)
+				benchUuid.ucData6[i] = d[5 + i];
+			fUuid = true;
+			break;
+		case 'l':
+			pszLibrary = optarg;
+			break;
+		case '?':
+		default:
+			fError = true;
+			break;
+		}
+	}
+	/* Every output buffer must have an input buffer to come back with */
+	if (uCount < aNumBufs[sizeof(aNumBufs) / sizeof(aNumBufs[0]) - 1])
+		fError = true;
+	if (fError) {
+		DisplayUsage();
+		return -1;
+	}
+	if (!fUuid && pszLibrary == NULL)
+		pszLibrary = STRMBENCH_LIBRARY;
+
+	status = DspManager_Open(0, NULL);
+	if (DSP_FAILED(status)) {
+		fprintf(stderr, "DSPManager_Open failed: 0x%lx\n", status);
+		return -1;
+	}
+	if (pszLibrary) {
+		status = DSPManager_RegisterObject(&benchUuid, DSP_DCDNODETYPE,
+						   pszLibrary);
+	}
+	if (DSP_SUCCEEDED(status))
+		status = DSPProcessor_Attach(uProcId, NULL, &hProc);
+	if (DSP_SUCCEEDED(status))
+		status = DSPNode_Allocate(hProc, &benchUuid, NULL, NULL, &hNode);
+	if (DSP_SUCCEEDED(status))
+		status = DSPNode_Create(hNode);
+	if (DSP_SUCCEEDED(status))
+		status = DSPNode_Run(hNode);
+	if (DSP_FAILED(status))
+		fprintf(stderr, "Loopback node setup failed: 0x%lx\n", status);
+
+	if (DSP_SUCCEEDED(status)) {
+		fprintf(stdout, "%8s %8s %8s %12s %12s %8s\n", "inflight",
+			"bufsize", "buffers", "MB/s", "buffers/s", "errors");
+	}
+	for (i = 0; DSP_SUCCEEDED(status) &&
+	     i < sizeof(aNumBufs) / sizeof(aNumBufs[0]); i++) {
+		for (j = 0; DSP_SUCCEEDED(status) &&
+		     j < sizeof(aBufSize) / sizeof(aBufSize[0]); j++)
+			status = Measure(hNode, uCount, aNumBufs[i], aBufSize[j]);
+	}
+
+	if (hNode) {
+		DSPNode_Terminate(hNode, &exitStatus);
+		DSPNode_Delete(hNode);
+	}
+	if (hProc)
+		DSPProcessor_Detach(hProc);
+	if (pszLibrary)
+		DSPManager_UnregisterObject(&benchUuid, DSP_DCDNODETYPE);
+	DspManager_Close(0, NULL);
+
+	return DSP_SUCCEEDED(status) ? 0 : -1;
+}
+
+/*
+ *  ======== DisplayUsage ========
+ */
+static VOID DisplayUsage(VOID)
+{
+	fprintf(stdout, "Usage: strmbench [options]\n");
+	fprintf(stdout, "\t[optional arguments]:\n");
+	fprintf(stdout, "\t-?: Display strmbench usage\n");
+	fprintf(stdout, "\t-p [processor]: User-specified processor #\n");
+	fprintf(stdout, "\t-c [count]: Buffers per measurement, at least 8\n");
+	fprintf(stdout, "\t-u [uuid]: Loopback node UUID\n");
+	fprintf(stdout, "\t-l [library]: Register the node from this library\n");
+	fprintf(stdout, "\n\tExample: strmbench -c 10000\n\n");
+}
+
+/*
+ *  ======== FromNode ========
+ *  Check the sequence number of a buffer that came back, and keep the
+ *  output stream supplied with just enough buffers for what is still due.
+ */
+static DSP_STATUS FromNode(PVOID pArg, DSP_HSTREAM hStream, BYTE *pBuffer,
+			   ULONG ulBytes, ULONG ulBufSize, ULONG *pulIssue)
+{
+	struct BENCH *pBench = pArg;
+	UINT uSeq;
+
+	if (ulBytes < sizeof(uSeq)) {
+		pBench->uErrors++;
+	} else {
+		memcpy(&uSeq, pBuffer, sizeof(uSeq));
+		if (uSeq != pBench->uReceived)
+			pBench->uErrors++;
+	}
+	pBench->ullBytes += ulBytes;
+	pBench->uReceived++;
+	pBench->uOutInFlight--;
+
+	if (pBench->uCount - pBench->uReceived <= pBench->uOutInFlight)
+		return DSP_SFALSE;
+	pBench->uOutInFlight++;
+
+	return DSP_SOK;
+}
+
+/*
+ *  ======== Measure ========
+ *  Send uCount buffers of uBufSize bytes through the node with uNumBufs
+ *  buffers in flight each way, and print the rates.
+ */
+static DSP_STATUS Measure(DSP_HNODE hNode, UINT uCount, UINT uNumBufs,
+			  UINT uBufSize)
+{
+	DSP_HSTRMENGINE hEngine;
+	struct BENCH bench;
+	unsigned long long ullStart;
+	double dSeconds;
+	DSP_STATUS status;
+	DSP_STATUS tmpStatus;
+
+	memset(&bench, 0, sizeof(bench));
+	bench.uCount = uCount;
+	bench.uOutInFlight = uNumBufs;
+
+	status = DSPStreamEngine_Create(&hEngine);
+	if (DSP_FAILED(status))
+		return status;
+
+	status = DSPStreamEngine_AddStream(hEngine, hNode, DSP_FROMNODE, 0,
+					   NULL, uNumBufs, uBufSize, FromNode,
+					   &bench, NULL);
+	if (DSP_SUCCEEDED(status)) {
+		status = DSPStreamEngine_AddStream(hEngine, hNode, DSP_TONODE,
+						   0, NULL, uNumBufs, uBufSize,
+						   ToNode, &bench, NULL);
+	}
+	if (DSP_SUCCEEDED(status)) {
+		ullStart = Now();
+		status = DSPStreamEngine_Run(hEngine, STRMBENCH_TIMEOUT);
+		dSeconds = (Now() - ullStart) / 1e9;
+	}
+	tmpStatus = DSPStreamEngine_Delete(hEngine);
+	if (DSP_SUCCEEDED(status))
+		status = tmpStatus;
+
+	if (DSP_FAILED(status)) {
+		fprintf(stderr, "%u x %u bytes failed: 0x%lx\n", uNumBufs,
+			uBufSize, status);
+		return status;
+	}
+	fprintf(stdout, "%8u %8u %8u %12.2f %12.0f %8u\n", uNumBufs, uBufSize,
+		bench.uReceived, bench.ullBytes / dSeconds / 1e6,
+		bench.uReceived / dSeconds, bench.uErrors);
+
+	return DSP_SOK;
+}
+
+/*
+ *  ======== Now ========
+ */
+static unsigned long long Now(VOID)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ *  ======== ToNode ========
+ *  Stamp the next sequence number on a full input buffer until uCount
+ *  have been sent.
+ */
+static DSP_STATUS ToNode(PVOID pArg, DSP_HSTREAM hStream, BYTE *pBuffer,
+			 ULONG ulBytes, ULONG ulBufSize, ULONG *pulIssue)
+{
+	struct BENCH *pBench = pArg;
+
+	if (pBench->uSent == pBench->uCount)
+		return DSP_SFALSE;
+
+	memcpy(pBuffer, &pBench->uSent, sizeof(pBench->uSent));
+	pBench->uSent++;
+	*pulIssue = ulBufSize;
+
+	return DSP_SOK;
+}
@@ -17,6 +17,7 @@
 #include "TIOMXPlugin.h"
 
 #include <dlfcn.h>
+#include <string.h>
 
 #include <media/stagefright/HardwareAPI.h>
 #include <media/stagefright/MediaDebug.h>
@@ -50,6 +51,51 @@ TIOMXPlugin::TIOMXPlugin()
                     mLibHandle, "TIOMX_GetRolesOfComponent");
 
         (*mInit)();
+
+        buildComponentCache();
+    }
+}
+
+void TIOMXPlugin::buildComponentCache() {
+    char name[OMX_MAX_STRINGNAME_SIZE];
+
+    for (OMX_U32 index = 0;
+         (*mComponentNameEnum)(name, sizeof(name), index) == OMX_ErrorNone;
+         ++index) {
+        ComponentInfo info;
+        info.mName = name;
+
+        OMX_U32 numRoles;
+        OMX_ERRORTYPE err = (*mGetRolesOfComponentHandle)(name, &numRoles, NULL);
+
+        if (err == OMX_ErrorNone && numRoles > 0) {
+            // one block for all the role names of the component
+            OMX_U8 *names = new OMX_U8[numRoles * OMX_MAX_STRINGNAME_SIZE];
+            OMX_U8 **array = new OMX_U8 *[numRoles];
+            for (OMX_U32 i = 0; i < numRoles; ++i) {
+                array[i] = names + i * OMX_MAX_STRINGNAME_SIZE;
+            }
+
+            err = (*mGetRolesOfComponentHandle)(name, &numRoles, array);
+
+            if (err == OMX_ErrorNone) {
+                for (OMX_U32 i = 0; i < numRoles; ++i) {
+                    info.mRoles.push(String8((const char *)array[i]));
+                }
+            }
+
+            delete[] array;
+            array = NULL;
+            delete[] names;
+            names = NULL;
+        }
+
+        if (err != OMX_ErrorNone) {
+            LOGW("cannot get the roles of %s (0x%08x)", name, err);
+        }
+
+        mComponentIndex.add(info.mName, mComponents.size());
+        mComponents.push(info);
     }
 }
 
@@ -94,7 +140,17 @@ OMX_ERRORTYPE TIOMXPlugin::enumerateComponents(
         return OMX_ErrorUndefined;
     }
 
-    return (*mComponentNameEnum)(name, size, index);
+    if (index >= mComponents.size()) {
+        return OMX_ErrorNoMore;
+    }
+
+    const String8 &componentName = mComponents[index].mName;
+    if (componentName.length() >= size) {
+        return OMX_ErrorBadParameter;
+    }
+    strcpy(name, componentName.string());
+
+    return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE TIOMXPlugin::getRolesOfComponent(
@@ -106,38 +162,12 @@ OMX_ERRORTYPE TIOMXPlugin::getRolesOfComponent(
         return OMX_ErrorUndefined;
     }
 
-    OMX_U32 numRoles;
-    OMX_ERRORTYPE err = (*mGetRolesOfComponentHandle)(
-            const_cast<OMX_STRING>(name), &numRoles, NULL);
-
-    if (err != OMX_ErrorNone) {
-        return err;
+    ssize_t index = mComponentIndex.indexOfKey(String8(name));
+    if (index < 0) {
+        return OMX_ErrorComponentNotFound;
     }
 
-    if (numRoles > 0) {
-        OMX_U8 **array = new OMX_U8 *[numRoles];
-        for (OMX_U32 i = 0; i < numRoles; ++i) {
-            array[i] = new OMX_U8[OMX_MAX_STRINGNAME_SIZE];
-        }
-
-        OMX_U32 numRoles2;
-        err = (*mGetRolesOfComponentHandle)(
-                const_cast<OMX_STRING>(name), &numRoles2, array);
-
-        CHECK_EQ(err, OMX_ErrorNone);
-        CHECK_EQ(numRoles, numRoles2);
-
-        for (OMX_U32 i = 0; i < numRoles; ++i) {
-            String8 s((const char *)array[i]);
-            roles->push(s);
-
-            delete[] array[i];
-            array[i] = NULL;
-        }
-
-        delete[] array;
-        array = NULL;
-    }
+    *roles = mComponents[mComponentIndex.valueAt(index)].mRoles;
 
     return OMX_ErrorNone;
 }
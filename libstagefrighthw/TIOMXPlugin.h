@@ -19,6 +19,9 @@
 #define TI_OMX_PLUGIN_H_
 
 #include <media/stagefright/OMXPluginBase.h>
+#include <utils/KeyedVector.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -45,8 +48,19 @@ struct TIOMXPlugin : public OMXPluginBase {
             Vector<String8> *roles);
 
 private:
+    struct ComponentInfo {
+        String8 mName;
+        Vector<String8> mRoles;
+    };
+
     void *mLibHandle;
 
+    // Names and roles of the core's components, read once at construction;
+    // the core's table is fixed, so enumeration and role queries are
+    // answered from here without calling into it.
+    Vector<ComponentInfo> mComponents;
+    KeyedVector<String8, size_t> mComponentIndex;
+
     typedef OMX_ERRORTYPE (*InitFunc)();
     typedef OMX_ERRORTYPE (*DeinitFunc)();
     typedef OMX_ERRORTYPE (*ComponentNameEnumFunc)(
@@ -67,6 +81,8 @@ private:
     FreeHandleFunc mFreeHandle;
     GetRolesOfComponentFunc mGetRolesOfComponentHandle;
 
+    void buildComponentCache();
+
     TIOMXPlugin(const TIOMXPlugin &);
     TIOMXPlugin &operator=(const TIOMXPlugin &);
 };
@@ -79,7 +79,10 @@ endif
 
 #call to common omx & system components
 include $(TI_OMX_SYSTEM)/omx_core/src/Android.mk
+include $(TI_OMX_SYSTEM)/omx_core/tests/Android.mk
 include $(TI_OMX_SYSTEM)/lcml/src/Android.mk
+include $(TI_OMX_SYSTEM)/lcml/tests/Android.mk
+include $(TI_OMX_SYSTEM)/common/tests/Android.mk
 
 #call to audio
 include $(TI_OMX_AUDIO)/aac_dec/src/Android.mk
@@ -353,6 +353,7 @@ typedef struct JPEGDEC_BUFFER_PRIVATE {
 typedef struct JPEGDEC_PORT_TYPE
 {
     OMX_HANDLETYPE hTunnelComponent;
+    OMX_BOOL bDspTunnelPeer;    /* peer is in LCML_DSP_TUNNEL_PEERS */
     OMX_U32 nTunnelPort;
     JPEGDEC_BUFFER_PRIVATE* pBufferPrivate[NUM_OF_BUFFERS];
     JPEGDEC_BUFFERFLAG_TRACK sBufferFlagTrack[NUM_OF_BUFFERS];
@@ -1697,8 +1697,11 @@ OMX_ERRORTYPE HandleFreeOutputBufferFromAppJpegDec(JPEGDEC_COMPONENT_PRIVATE *pC
                       PERF_ModuleCommonLayer);
 #endif
 
+    /* a tunneled frame is only read by the peer's DSP node, see LCML_BUFFER_TUNNEL */
     eError = LCML_QueueBuffer(((LCML_DSP_INTERFACE*)pLcmlHandle)->pCodecinterfacehandle,
-                              EMMCodecOuputBuffer,
+                              EMMCodecOuputBuffer |
+                              ((pComponentPrivate->pCompPort[JPEGDEC_OUTPUT_PORT]->hTunnelComponent != NULL &&
+                                pComponentPrivate->pCompPort[JPEGDEC_OUTPUT_PORT]->bDspTunnelPeer) ? LCML_BUFFER_TUNNEL : 0),
                               pBuffHead->pBuffer,
                               pBuffHead->nAllocLen,
                               pBuffHead->nFilledLen,
@@ -319,6 +319,7 @@ static OMX_ERRORTYPE FreeBuffer_JPEGDec(OMX_IN OMX_HANDLETYPE hComponent,
     JPEGDEC_BUFFER_PRIVATE* pBuffPrivate = NULL;
     OMX_U8* pTemp;
     OMX_U8 nBufferCount = -1;
+    OMX_ERRORTYPE eRelease = OMX_ErrorNone;
 
     OMX_CHECK_PARAM(hComponent);
     OMX_CHECK_PARAM(pBuffHead);
@@ -370,7 +371,25 @@ static OMX_ERRORTYPE FreeBuffer_JPEGDec(OMX_IN OMX_HANDLETYPE hComponent,
 	goto PRINT_EXIT;
     }
 
-    if (pBuffPrivate->bAllocbyComponent == OMX_TRUE) {
+    /* tunneled buffers stay mapped in LCML until they are freed */
+    if (pComponentPrivate->pCompPort[nPortIndex]->hTunnelComponent != NULL &&
+        pComponentPrivate->pLCML != NULL &&
+        pComponentPrivate->nIsLCMLActive == 1) {
+        void *aRelease[3];
+        aRelease[0] = pBuffHead->pBuffer;
+        aRelease[1] = (void *)pBuffHead->nAllocLen;
+        aRelease[2] = (void *)(LCML_RELEASE_WAIT |
+                               (pBuffPrivate->bAllocbyComponent == OMX_TRUE ? LCML_RELEASE_OWNER : 0));
+        eRelease = LCML_ControlCodec(((LCML_DSP_INTERFACE*)pComponentPrivate->pLCML)->pCodecinterfacehandle,
+                                     EMMCodecControlReleaseBuffer, aRelease);
+        if (eRelease != OMX_ErrorNone) {
+            /* the DSP still maps it: keep the memory rather than free it under the DSP */
+            OMX_PRBUFFER4(pComponentPrivate->dbg, "buffer %p still mapped in the DSP (0x%x), not freed\n",
+                          pBuffHead->pBuffer, eRelease);
+        }
+    }
+
+    if (pBuffPrivate->bAllocbyComponent == OMX_TRUE && eRelease == OMX_ErrorNone) {
         if (pBuffHead->pBuffer) {
 
 #ifdef __PERF_INSTRUMENTATION__
@@ -2155,6 +2174,7 @@ static OMX_ERRORTYPE ComponentTunnelRequest_JPEGDec(OMX_IN OMX_HANDLETYPE hCompo
     if (pTunnelSetup == NULL || hTunneledComp == 0) {
         /* cancel previous tunnel */
         pPort->hTunnelComponent = 0;
+        pPort->bDspTunnelPeer = OMX_FALSE;
         pPort->nTunnelPort = 0;
         OMX_PRBUFFER2(pComponentPrivate->dbg, "OMX_BufferSupplyUnspecified\n");
         pPort->pParamBufSupplier->eBufferSupplier = OMX_BufferSupplyUnspecified;
@@ -2175,6 +2195,7 @@ static OMX_ERRORTYPE ComponentTunnelRequest_JPEGDec(OMX_IN OMX_HANDLETYPE hCompo
         }
 
         pPort->hTunnelComponent = hTunneledComp;
+        pPort->bDspTunnelPeer = LCML_IsDspTunnelPeer(hTunneledComp);
         pPort->nTunnelPort = nTunneledPort;
 
         if (pComponentPrivate->pCompPort[JPEGDEC_OUTPUT_PORT]->pPortDef && pComponentPrivate->pCompPort[JPEGDEC_OUTPUT_PORT]->pPortDef->nPortIndex == nPort) {
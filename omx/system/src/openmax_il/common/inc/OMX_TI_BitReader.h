@@ -0,0 +1,282 @@
+
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/* =============================================================================
+*             Texas Instruments OMAP(TM) Platform Software
+*  (c) Copyright Texas Instruments, Incorporated.  All Rights Reserved.
+*
+*  Use of this software is controlled by the terms and conditions found
+*  in the license agreement under which this software has been supplied.
+* =========================================================================== */
+/** OMX_TI_BitReader.h
+  *  MSB-first bit reader for the sequence and picture headers of MPEG-4,
+  *  H.263, MPEG-2, VC-1 and H.264 streams, shared by the video decoder and
+  *  the OpenCORE config parser.
+  *
+  *  The next bits are kept in a 64-bit cache that is refilled eight bytes
+  *  at a time, byte by byte only near the end of the data, so a read is a
+  *  shift in the common case. ue(v) and se(v) are decoded with one count
+  *  leading zeros on the cache. Reads never go past nSize: bits past the
+  *  end read as zero and set bError, as do invalid Exp-Golomb codes.
+ */
+
+#ifndef __OMX_TI_BITREADER_H__
+#define __OMX_TI_BITREADER_H__
+
+#include "OMX_Types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define OMX_TI_BR_CLZ64(x) ((OMX_U32)__builtin_clzll(x))
+#else
+static __inline OMX_U32 OMX_TI_BR_CLZ64(OMX_U64 x)
+{
+    OMX_U32 n = 0;
+
+    while (!(x & ((OMX_U64)1 << 63))) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+}
+#endif
+
+typedef struct OMX_TI_BITREADERTYPE {
+    const OMX_U8* pData;
+    OMX_U32 nSize;              /* bytes of pData */
+    OMX_U32 nNext;              /* next byte of pData to load */
+    OMX_U64 nCache;             /* next bits of the stream, MSB first */
+    OMX_U32 nCacheBits;         /* valid bits in nCache, at most 63 */
+    OMX_BOOL bError;            /* read past the end or invalid code */
+} OMX_TI_BITREADERTYPE;
+
+/* ======================================================================= */
+/**
+ * OMX_TI_BitReaderFill() tops the cache up to at least 56 bits, or to the
+ * end of the data. Bits of the last partial byte loaded are also copied
+ * into the cache; they are the same bits the next fill ORs in again.
+ */
+/* ======================================================================= */
+static __inline void OMX_TI_BitReaderFill(OMX_TI_BITREADERTYPE* pBits)
+{
+    const OMX_U8* p = pBits->pData + pBits->nNext;
+
+    if (pBits->nSize - pBits->nNext >= 8) {
+        pBits->nCache |= (((OMX_U64)p[0] << 56) | ((OMX_U64)p[1] << 48) |
+                          ((OMX_U64)p[2] << 40) | ((OMX_U64)p[3] << 32) |
+                          ((OMX_U64)p[4] << 24) | ((OMX_U64)p[5] << 16) |
+                          ((OMX_U64)p[6] << 8)  |  (OMX_U64)p[7]) >> pBits->nCacheBits;
+        pBits->nNext += (63 - pBits->nCacheBits) >> 3;
+        pBits->nCacheBits |= 56;
+    }
+    else {
+        while (pBits->nCacheBits < 56 && pBits->nNext < pBits->nSize) {
+            pBits->nCache |= (OMX_U64)pBits->pData[pBits->nNext++] << (56 - pBits->nCacheBits);
+            pBits->nCacheBits += 8;
+        }
+    }
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_BitReaderInit() starts reading nSize bytes at pData.
+ */
+/* ======================================================================= */
+static __inline void OMX_TI_BitReaderInit(OMX_TI_BITREADERTYPE* pBits,
+                                          const OMX_U8* pData, OMX_U32 nSize)
+{
+    pBits->pData = pData;
+    pBits->nSize = pData != NULL ? nSize : 0;
+    pBits->nNext = 0;
+    pBits->nCache = 0;
+    pBits->nCacheBits = 0;
+    pBits->bError = OMX_FALSE;
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_BitReaderTell() bit position of the next bit to read.
+ */
+/* ======================================================================= */
+static __inline OMX_U32 OMX_TI_BitReaderTell(const OMX_TI_BITREADERTYPE* pBits)
+{
+    return pBits->nNext * 8 - pBits->nCacheBits;
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_BitsLeft() number of bits left to read.
+ */
+/* ======================================================================= */
+static __inline OMX_U32 OMX_TI_BitsLeft(const OMX_TI_BITREADERTYPE* pBits)
+{
+    return (pBits->nSize - pBits->nNext) * 8 + pBits->nCacheBits;
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_BitReaderSeek() moves to bit nBitPos, or to the end of the data
+ * (setting bError) if that is past it.
+ */
+/* ======================================================================= */
+static __inline void OMX_TI_BitReaderSeek(OMX_TI_BITREADERTYPE* pBits, OMX_U32 nBitPos)
+{
+    if (nBitPos > pBits->nSize * 8) {
+        nBitPos = pBits->nSize * 8;
+        pBits->bError = OMX_TRUE;
+    }
+    pBits->nNext = nBitPos >> 3;
+    pBits->nCache = 0;
+    pBits->nCacheBits = 0;
+    if (nBitPos & 7) {
+        OMX_TI_BitReaderFill(pBits);
+        pBits->nCache <<= nBitPos & 7;
+        pBits->nCacheBits -= nBitPos & 7;
+    }
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_ShowBits() next nBits (0 to 32) bits, without consuming them.
+ */
+/* ======================================================================= */
+static __inline OMX_U32 OMX_TI_ShowBits(OMX_TI_BITREADERTYPE* pBits, OMX_U32 nBits)
+{
+    if (nBits > pBits->nCacheBits) {
+        OMX_TI_BitReaderFill(pBits);
+    }
+    /* two shifts, so that nBits == 0 gives 0 */
+    return (OMX_U32)((pBits->nCache >> 1) >> (63 - nBits));
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_SkipBits() consumes nBits bits, any number of them.
+ */
+/* ======================================================================= */
+static __inline void OMX_TI_SkipBits(OMX_TI_BITREADERTYPE* pBits, OMX_U32 nBits)
+{
+    if (nBits > pBits->nCacheBits) {
+        if (nBits > 32) {
+            OMX_TI_BitReaderSeek(pBits, OMX_TI_BitReaderTell(pBits) + nBits);
+            return;
+        }
+        OMX_TI_BitReaderFill(pBits);
+        if (nBits > pBits->nCacheBits) {
+            OMX_TI_BitReaderSeek(pBits, pBits->nSize * 8);
+            pBits->bError = OMX_TRUE;
+            return;
+        }
+    }
+    pBits->nCache <<= nBits;
+    pBits->nCacheBits -= nBits;
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_ReadBits() reads nBits (0 to 32) bits.
+ */
+/* ======================================================================= */
+static __inline OMX_U32 OMX_TI_ReadBits(OMX_TI_BITREADERTYPE* pBits, OMX_U32 nBits)
+{
+    OMX_U32 nValue;
+
+    if (nBits > pBits->nCacheBits) {
+        OMX_TI_BitReaderFill(pBits);
+        if (nBits > pBits->nCacheBits) {
+            /* at the end of the data */
+            nValue = OMX_TI_ShowBits(pBits, nBits);
+            OMX_TI_SkipBits(pBits, nBits);
+            return nValue;
+        }
+    }
+    nValue = (OMX_U32)((pBits->nCache >> 1) >> (63 - nBits));
+    pBits->nCache <<= nBits;
+    pBits->nCacheBits -= nBits;
+    return nValue;
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_ByteAlign() skips to the next byte boundary, if not on one.
+ */
+/* ======================================================================= */
+static __inline void OMX_TI_ByteAlign(OMX_TI_BITREADERTYPE* pBits)
+{
+    OMX_TI_SkipBits(pBits, pBits->nCacheBits & 7);
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_ReadUE() reads an unsigned Exp-Golomb code, ue(v). Codes of up to
+ * 31 leading zeros are valid; others give 0 and set bError.
+ */
+/* ======================================================================= */
+static __inline OMX_U32 OMX_TI_ReadUE(OMX_TI_BITREADERTYPE* pBits)
+{
+    OMX_U32 nZeros;
+    OMX_U32 nLen;
+
+    if (pBits->nCacheBits < 32) {
+        OMX_TI_BitReaderFill(pBits);
+    }
+    if (pBits->nCache != 0) {
+        nZeros = OMX_TI_BR_CLZ64(pBits->nCache);
+        nLen = 2 * nZeros + 1;
+        if (nZeros < 32 && nLen <= pBits->nCacheBits) {
+            OMX_U32 nValue = (OMX_U32)(pBits->nCache >> (64 - nLen)) - 1;
+
+            pBits->nCache <<= nLen;
+            pBits->nCacheBits -= nLen;
+            return nValue;
+        }
+    }
+
+    /* code longer than the cache, near the end of the data or invalid */
+    nZeros = 0;
+    while (OMX_TI_ReadBits(pBits, 1) == 0) {
+        if (++nZeros == 32 || OMX_TI_BitsLeft(pBits) == 0) {
+            pBits->bError = OMX_TRUE;
+            return 0;
+        }
+    }
+    return ((1U << nZeros) | OMX_TI_ReadBits(pBits, nZeros)) - 1;
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_ReadSE() reads a signed Exp-Golomb code, se(v).
+ */
+/* ======================================================================= */
+static __inline OMX_S32 OMX_TI_ReadSE(OMX_TI_BITREADERTYPE* pBits)
+{
+    OMX_U32 nCode = OMX_TI_ReadUE(pBits);
+
+    return (nCode & 1) ? (OMX_S32)((nCode >> 1) + 1) : -(OMX_S32)(nCode >> 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OMX_TI_BITREADER_H__ */
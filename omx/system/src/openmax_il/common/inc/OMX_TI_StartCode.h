@@ -0,0 +1,141 @@
+
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/* =============================================================================
+*             Texas Instruments OMAP(TM) Platform Software
+*  (c) Copyright Texas Instruments, Incorporated.  All Rights Reserved.
+*
+*  Use of this software is controlled by the terms and conditions found
+*  in the license agreement under which this software has been supplied.
+* =========================================================================== */
+/** OMX_TI_StartCode.h
+  *  Start code (00 00 01) search for MPEG-4, MPEG-2 and H.264 elementary
+  *  streams, shared by the video decoder and the OpenCORE config parser.
+  *
+  *  The buffer is read 64 bits at a time, two words per step, and only
+  *  words that hold two adjacent zero bytes are looked at byte by byte:
+  *  w | (w >> 8) has a zero byte for every such pair, whatever the byte
+  *  order, so words without one can be skipped whole. Offsets are those of
+  *  the first 00 of the prefix; with more leading zeros (00 00 00 01) it is
+  *  the last two that count.
+ */
+
+#ifndef __OMX_TI_STARTCODE_H__
+#define __OMX_TI_STARTCODE_H__
+
+#include <string.h>
+#include "OMX_Types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 64-bit even on 32-bit ARM: the zero pair test costs two registers per
+   word there, but skips 14 bytes per step instead of 6 */
+typedef unsigned long long OMX_TI_SC_WORD;
+
+#define OMX_TI_SC_ONES  ((OMX_TI_SC_WORD)-1 / 0xFF)
+#define OMX_TI_SC_HIGHS (OMX_TI_SC_ONES * 0x80)
+
+/* non-zero if any byte of x is zero */
+#define OMX_TI_SC_HASZERO(x) (((x) - OMX_TI_SC_ONES) & ~(x) & OMX_TI_SC_HIGHS)
+
+/* non-zero if x may hold two adjacent zero bytes; never misses a pair */
+#define OMX_TI_SC_HASZEROPAIR(x) OMX_TI_SC_HASZERO((x) | ((x) >> 8))
+
+/* ======================================================================= */
+/**
+ * OMX_TI_FindStartCode() offset of the first start code that begins at or
+ * after nPos, or nSize if there is none.
+ */
+/* ======================================================================= */
+static __inline OMX_U32 OMX_TI_FindStartCode(const OMX_U8* pData, OMX_U32 nSize,
+                                             OMX_U32 nPos)
+{
+    const OMX_U32 nWord = sizeof(OMX_TI_SC_WORD);
+    const OMX_U32 nStep = 2 * nWord - 2;
+    OMX_TI_SC_WORD w0;
+    OMX_TI_SC_WORD w1;
+    OMX_U32 nEnd;
+    OMX_U32 i;
+
+    if (nSize < 3 || nPos > nSize - 3) {
+        return nSize;
+    }
+
+    /* a start code at i has its zero pair at i, i + 1; each step reads the
+       2 * nWord - 1 bytes from nPos as two words sharing their middle byte,
+       so that every pair that starts in the first nStep of them lies within
+       one word */
+    for (; nPos + 2 * nWord - 1 <= nSize; nPos += nStep) {
+        memcpy(&w0, pData + nPos, nWord);
+        memcpy(&w1, pData + nPos + nWord - 1, nWord);
+        if (!OMX_TI_SC_HASZEROPAIR(w0) && !OMX_TI_SC_HASZEROPAIR(w1)) {
+            continue;
+        }
+        nEnd = nPos + nStep;
+        if (nEnd > nSize - 2) {
+            nEnd = nSize - 2;
+        }
+        for (i = nPos; i < nEnd; i++) {
+            if (pData[i + 1] == 0 && pData[i] == 0 && pData[i + 2] == 1) {
+                return i;
+            }
+        }
+    }
+
+    /* the tail that does not fill a step */
+    for (i = nPos; i + 2 < nSize; i++) {
+        if (pData[i + 1] == 0 && pData[i] == 0 && pData[i + 2] == 1) {
+            return i;
+        }
+    }
+    return nSize;
+}
+
+/* ======================================================================= */
+/**
+ * OMX_TI_ScanStartCodes() offsets of all the start codes of a buffer, i.e.
+ * its NAL unit or VOP boundaries, in one pass. Up to nMaxOffsets of them
+ * are stored in pOffsets, which may be NULL; the return value is the number
+ * of start codes found, which can be larger.
+ */
+/* ======================================================================= */
+static __inline OMX_U32 OMX_TI_ScanStartCodes(const OMX_U8* pData, OMX_U32 nSize,
+                                              OMX_U32* pOffsets, OMX_U32 nMaxOffsets)
+{
+    OMX_U32 nCount = 0;
+    OMX_U32 nPos = OMX_TI_FindStartCode(pData, nSize, 0);
+
+    while (nPos < nSize) {
+        if (pOffsets != NULL && nCount < nMaxOffsets) {
+            pOffsets[nCount] = nPos;
+        }
+        nCount++;
+        nPos = OMX_TI_FindStartCode(pData, nSize, nPos + 3);
+    }
+    return nCount;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __OMX_TI_STARTCODE_H__ */
@@ -0,0 +1,31 @@
+ifeq ($(BUILD_OMX_COMMON_TEST),1)
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	StartCodeBench.c
+
+LOCAL_C_INCLUDES := \
+	$(TI_OMX_COMP_C_INCLUDES)
+
+LOCAL_CFLAGS := $(TI_OMX_CFLAGS)
+
+LOCAL_MODULE:= StartCodeBench
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	BitReaderBench.c
+
+LOCAL_C_INCLUDES := \
+	$(TI_OMX_COMP_C_INCLUDES)
+
+LOCAL_CFLAGS := $(TI_OMX_CFLAGS)
+
+LOCAL_MODULE:= BitReaderBench
+
+include $(BUILD_EXECUTABLE)
+endif
@@ -0,0 +1,664 @@
+
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  BitReaderBench.c
+*
+*  Times OMX_TI_BitReader against the bit reading the video decoder used
+*  before (VIDDEC_GetBits and the bit at a time VIDDEC_UVLC_dec, copied
+*  here) on H.264 SPS and PPS and MPEG-4 VOL headers.
+*
+*  The headers are written with random but plausible field values, High
+*  profile scaling lists and VBV parameters included, and each one keeps
+*  the list of its fields. Both readers go through that list and must give
+*  back the values written. Truncated copies of every header are read too:
+*  the new reader must stop at the end of the data, return the fields that
+*  fit, and set bError exactly when some did not. Seeking to each field,
+*  aligning from each bit and invalid ue(v) codes are checked as well.
+*
+*  Reports ns per header for each reader. Fails only on a wrong value; the
+*  speed depends on the target and is not checked.
+*
+*  usage: BitReaderBench [-d seconds] [-n headers]
+* =========================================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "OMX_TI_BitReader.h"
+
+#define BENCH_DEFAULT_SECONDS   1
+#define BENCH_DEFAULT_HEADERS   1000
+#define BENCH_MAX_BYTES         1024
+#define BENCH_MAX_FIELDS        1024
+
+typedef enum BENCH_FIELDTYPE {
+    BENCH_U,                    /* u(n) */
+    BENCH_UE,                   /* ue(v) */
+    BENCH_SE                    /* se(v) */
+} BENCH_FIELDTYPE;
+
+typedef struct BENCH_FIELD {
+    BENCH_FIELDTYPE eType;
+    OMX_U32 nBits;              /* u(n) width; end bit of the field for all */
+    OMX_U32 nEnd;
+    OMX_U32 nValue;
+} BENCH_FIELD;
+
+typedef struct BENCH_HEADER {
+    OMX_U8 *pData;
+    OMX_U32 nSize;
+    BENCH_FIELD *pFields;
+    OMX_U32 nFields;
+} BENCH_HEADER;
+
+typedef struct BENCH_WRITER {
+    OMX_U8 aData[BENCH_MAX_BYTES];
+    OMX_U32 nPos;
+    BENCH_FIELD aFields[BENCH_MAX_FIELDS];
+    OMX_U32 nFields;
+    unsigned int nSeed;
+} BENCH_WRITER;
+
+static const char *sKinds[] = { "SPS", "PPS", "VOL" };
+
+static double NowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* ---- the decoder's reader before OMX_TI_BitReader ---- */
+
+/* nOutput is unsigned int rather than OMX_U32, which is 64 bits on LP64
+   hosts: the shifts rely on dropping what is left of bit 31 */
+static OMX_U32 OldGetBits(OMX_U32* nPosition, OMX_U8 nBits, OMX_U8* pBuffer)
+{
+    unsigned int nOutput;
+    OMX_U32 nNumBitsRead = 0;
+    OMX_U32 nBytePosition = *nPosition / 8;
+    OMX_U8  nBitPosition = *nPosition % 8;
+
+    *nPosition += nBits;
+    nOutput = ((unsigned int)pBuffer[nBytePosition] << (24+nBitPosition));
+    nNumBitsRead = nNumBitsRead + (8 - nBitPosition);
+    if (nNumBitsRead < nBits) {
+        nOutput = nOutput | (pBuffer[nBytePosition + 1] << (16+nBitPosition));
+        nNumBitsRead = nNumBitsRead + 8;
+    }
+    if (nNumBitsRead < nBits) {
+        nOutput = nOutput | (pBuffer[nBytePosition + 2] << (8+nBitPosition));
+        nNumBitsRead = nNumBitsRead + 8;
+    }
+    if (nNumBitsRead < nBits) {
+        nOutput = nOutput | (pBuffer[nBytePosition + 3] << (nBitPosition));
+        nNumBitsRead = nNumBitsRead + 8;
+    }
+    return nOutput >> (32 - nBits);
+}
+
+static OMX_U32 OldUVLC(OMX_U32 *nPosition, OMX_U8* pBuffer)
+{
+    OMX_U32 nBytePosition = (*nPosition) / 8;
+    OMX_U8 cBitPosition = (*nPosition) % 8;
+    OMX_U32 nLen = 1;
+    OMX_U32 nCtrBit;
+    OMX_U32 nVal = 1;
+    OMX_U32 nInfoBit;
+
+    nCtrBit = pBuffer[nBytePosition] & (0x1 << (7-cBitPosition));
+    while (nCtrBit == 0) {
+        nLen++;
+        cBitPosition++;
+        (*nPosition)++;
+        if (!(cBitPosition%8)) {
+            cBitPosition = 0;
+            nBytePosition++;
+        }
+        nCtrBit = pBuffer[nBytePosition] & (0x1<<(7-cBitPosition));
+    }
+    for (nInfoBit = 0; nInfoBit < nLen - 1; nInfoBit++) {
+        cBitPosition++;
+        (*nPosition)++;
+        if (!(cBitPosition%8)) {
+            cBitPosition = 0;
+            nBytePosition++;
+        }
+        nVal = (nVal << 1);
+        if (pBuffer[nBytePosition] & (0x01 << (7 - cBitPosition)))
+            nVal |= 1;
+    }
+    (*nPosition)++;
+    return nVal - 1;
+}
+
+/* ---- writing headers ---- */
+
+static void PutBits(BENCH_WRITER *w, OMX_U32 nBits, OMX_U32 nValue)
+{
+    while (nBits-- > 0) {
+        if ((nValue >> nBits) & 1) {
+            w->aData[w->nPos >> 3] |= 0x80 >> (w->nPos & 7);
+        }
+        w->nPos++;
+    }
+}
+
+static void AddField(BENCH_WRITER *w, BENCH_FIELDTYPE eType, OMX_U32 nBits, OMX_U32 nValue)
+{
+    BENCH_FIELD *f = &w->aFields[w->nFields++];
+
+    f->eType = eType;
+    f->nBits = nBits;
+    f->nEnd = w->nPos;
+    f->nValue = nValue;
+}
+
+static OMX_U32 U(BENCH_WRITER *w, OMX_U32 nBits, OMX_U32 nValue)
+{
+    nValue &= nBits < 32 ? (1U << nBits) - 1 : 0xFFFFFFFF;
+    PutBits(w, nBits, nValue);
+    AddField(w, BENCH_U, nBits, nValue);
+    return nValue;
+}
+
+static void PutCode(BENCH_WRITER *w, OMX_U32 nCode)
+{
+    OMX_U32 nLen = 0;
+
+    while ((nCode + 1) >> (nLen + 1)) {
+        nLen++;
+    }
+    PutBits(w, nLen, 0);
+    PutBits(w, nLen + 1, nCode + 1);
+}
+
+static OMX_U32 UE(BENCH_WRITER *w, OMX_U32 nValue)
+{
+    PutCode(w, nValue);
+    AddField(w, BENCH_UE, 0, nValue);
+    return nValue;
+}
+
+static void SE(BENCH_WRITER *w, OMX_S32 nValue)
+{
+    PutCode(w, nValue > 0 ? 2 * (OMX_U32)nValue - 1 : 2 * (OMX_U32)-nValue);
+    AddField(w, BENCH_SE, 0, (OMX_U32)nValue);
+}
+
+static OMX_U32 Rand(BENCH_WRITER *w, OMX_U32 nMin, OMX_U32 nMax)
+{
+    return nMin + rand_r(&w->nSeed) % (nMax - nMin + 1);
+}
+
+static OMX_S32 RandS(BENCH_WRITER *w, OMX_S32 nMin, OMX_S32 nMax)
+{
+    return nMin + (OMX_S32)(rand_r(&w->nSeed) % (OMX_U32)(nMax - nMin + 1));
+}
+
+static void WriteSPS(BENCH_WRITER *w)
+{
+    static const OMX_U32 aProfiles[] = { 66, 77, 100 };
+    OMX_U32 nProfile = aProfiles[Rand(w, 0, 2)];
+    OMX_S32 nLast, nNext, nDelta;
+    OMX_U32 i, j, n;
+
+    U(w, 8, 0x67);
+    U(w, 8, nProfile);
+    U(w, 8, Rand(w, 0, 3) << 6);
+    U(w, 8, Rand(w, 10, 51));
+    UE(w, Rand(w, 0, 31));
+    if (nProfile == 100) {
+        UE(w, 1);
+        UE(w, 0);
+        UE(w, 0);
+        U(w, 1, 0);
+        if (U(w, 1, Rand(w, 0, 1))) {
+            for (i = 0; i < 8; i++) {
+                if (U(w, 1, Rand(w, 0, 1))) {
+                    /* scaling_list(): no more deltas once nextScale is 0 */
+                    nLast = nNext = 8;
+                    n = i < 6 ? 16 : 64;
+                    for (j = 0; j < n && nNext != 0; j++) {
+                        nDelta = RandS(w, -8, 8);
+                        SE(w, nDelta);
+                        nNext = (nLast + nDelta + 256) % 256;
+                        nLast = nNext ? nNext : nLast;
+                    }
+                }
+            }
+        }
+    }
+    UE(w, Rand(w, 0, 12));
+    n = UE(w, Rand(w, 0, 2));
+    if (n == 0) {
+        UE(w, Rand(w, 0, 12));
+    }
+    else if (n == 1) {
+        U(w, 1, Rand(w, 0, 1));
+        SE(w, RandS(w, -300, 300));
+        SE(w, RandS(w, -300, 300));
+        n = UE(w, Rand(w, 0, 4));
+        for (i = 0; i < n; i++) {
+            SE(w, RandS(w, -300, 300));
+        }
+    }
+    UE(w, Rand(w, 1, 16));
+    U(w, 1, Rand(w, 0, 1));
+    UE(w, Rand(w, 10, 119));
+    UE(w, Rand(w, 8, 67));
+    if (!U(w, 1, Rand(w, 0, 3) != 0)) {
+        U(w, 1, Rand(w, 0, 1));
+    }
+    U(w, 1, 1);
+    if (U(w, 1, Rand(w, 0, 1))) {
+        UE(w, Rand(w, 0, 8));
+        UE(w, Rand(w, 0, 8));
+        UE(w, Rand(w, 0, 8));
+        UE(w, Rand(w, 0, 8));
+    }
+    U(w, 1, 0);
+}
+
+static void WritePPS(BENCH_WRITER *w)
+{
+    U(w, 8, 0x68);
+    UE(w, Rand(w, 0, 255));
+    UE(w, Rand(w, 0, 31));
+    U(w, 1, Rand(w, 0, 1));
+    U(w, 1, 0);
+    UE(w, 0);
+    UE(w, Rand(w, 0, 15));
+    UE(w, Rand(w, 0, 15));
+    U(w, 1, Rand(w, 0, 1));
+    U(w, 2, Rand(w, 0, 2));
+    SE(w, RandS(w, -26, 25));
+    SE(w, RandS(w, -26, 25));
+    SE(w, RandS(w, -12, 12));
+    U(w, 1, 1);
+    U(w, 1, Rand(w, 0, 1));
+    U(w, 1, 0);
+}
+
+static void WriteVOL(BENCH_WRITER *w)
+{
+    OMX_U32 nVerId = 1;
+    OMX_U32 nResolution;
+    OMX_U32 nBits;
+
+    U(w, 32, 0x120 + Rand(w, 0, 15));
+    U(w, 1, 0);
+    U(w, 8, Rand(w, 1, 17));
+    if (U(w, 1, Rand(w, 0, 1))) {
+        nVerId = U(w, 4, Rand(w, 1, 2));
+        U(w, 3, Rand(w, 0, 7));
+    }
+    if (U(w, 4, Rand(w, 0, 1) ? 15 : 1) == 15) {
+        U(w, 8, Rand(w, 1, 255));
+        U(w, 8, Rand(w, 1, 255));
+    }
+    if (U(w, 1, Rand(w, 0, 1))) {
+        U(w, 2, 1);
+        U(w, 1, Rand(w, 0, 1));
+        if (U(w, 1, Rand(w, 0, 1))) {
+            U(w, 15, Rand(w, 0, 32767));
+            U(w, 1, 1);
+            U(w, 15, Rand(w, 0, 32767));
+            U(w, 1, 1);
+            U(w, 15, Rand(w, 0, 32767));
+            U(w, 1, 1);
+            U(w, 3, Rand(w, 0, 7));
+            U(w, 11, Rand(w, 0, 2047));
+            U(w, 1, 1);
+            U(w, 15, Rand(w, 0, 32767));
+            U(w, 1, 1);
+        }
+    }
+    U(w, 2, 0);
+    U(w, 1, 1);
+    nResolution = U(w, 16, Rand(w, 1, 30000));
+    U(w, 1, 1);
+    if (U(w, 1, Rand(w, 0, 1))) {
+        for (nBits = 1; (nResolution - 1) >> nBits; nBits++) {
+        }
+        U(w, nBits, Rand(w, 0, nResolution - 1));
+    }
+    U(w, 1, 1);
+    U(w, 13, Rand(w, 16, 1280));
+    U(w, 1, 1);
+    U(w, 13, Rand(w, 16, 720));
+    U(w, 1, 1);
+    U(w, 1, Rand(w, 0, 1));
+    U(w, 1, 1);
+    U(w, nVerId == 1 ? 1 : 2, 0);
+    if (U(w, 1, 0)) {
+        U(w, 4, 5);
+        U(w, 4, 8);
+    }
+    U(w, 1, Rand(w, 0, 1));
+    if (nVerId != 1) {
+        U(w, 1, 0);
+    }
+    U(w, 1, 1);
+    U(w, 1, Rand(w, 0, 1));
+    if (U(w, 1, Rand(w, 0, 1)) && nVerId != 1) {
+        U(w, 1, Rand(w, 0, 1));
+    }
+    U(w, 1, 0);
+}
+
+static int MakeHeader(BENCH_HEADER *h, int nKind, unsigned int nSeed)
+{
+    BENCH_WRITER *w = calloc(1, sizeof(BENCH_WRITER));
+
+    if (w == NULL) {
+        return 1;
+    }
+    w->nSeed = nSeed;
+    if (nKind == 0) {
+        WriteSPS(w);
+    }
+    else if (nKind == 1) {
+        WritePPS(w);
+    }
+    else {
+        WriteVOL(w);
+    }
+    /* rbsp_trailing_bits / next_start_code */
+    PutBits(w, 1, 1);
+    w->nPos = (w->nPos + 7) & ~7;
+
+    h->nSize = w->nPos / 8;
+    h->nFields = w->nFields;
+    /* the old reader loads up to four bytes ahead without checking */
+    h->pData = calloc(h->nSize + 4, 1);
+    h->pFields = malloc(w->nFields * sizeof(BENCH_FIELD));
+    if (h->pData == NULL || h->pFields == NULL) {
+        free(w);
+        return 1;
+    }
+    memcpy(h->pData, w->aData, h->nSize);
+    memcpy(h->pFields, w->aFields, w->nFields * sizeof(BENCH_FIELD));
+    free(w);
+    return 0;
+}
+
+/* ---- reading them back ---- */
+
+static OMX_U32 ReadOld(const BENCH_HEADER *h, OMX_U32 *pValues)
+{
+    OMX_U32 nPos = 0;
+    OMX_U32 nCode;
+    OMX_U32 i;
+
+    for (i = 0; i < h->nFields; i++) {
+        switch (h->pFields[i].eType) {
+            case BENCH_U:
+                pValues[i] = OldGetBits(&nPos, (OMX_U8)h->pFields[i].nBits, h->pData);
+                break;
+            case BENCH_UE:
+                pValues[i] = OldUVLC(&nPos, h->pData);
+                break;
+            default:
+                nCode = OldUVLC(&nPos, h->pData);
+                pValues[i] = (nCode & 1) ? (nCode >> 1) + 1 : -(nCode >> 1);
+                break;
+        }
+    }
+    return nPos;
+}
+
+static OMX_U32 ReadNew(const BENCH_HEADER *h, OMX_U32 nSize, OMX_U32 *pValues,
+                       OMX_BOOL *pError)
+{
+    OMX_TI_BITREADERTYPE sBits;
+    OMX_U32 i;
+
+    OMX_TI_BitReaderInit(&sBits, h->pData, nSize);
+    for (i = 0; i < h->nFields; i++) {
+        switch (h->pFields[i].eType) {
+            case BENCH_U:
+                pValues[i] = OMX_TI_ReadBits(&sBits, h->pFields[i].nBits);
+                break;
+            case BENCH_UE:
+                pValues[i] = OMX_TI_ReadUE(&sBits);
+                break;
+            default:
+                pValues[i] = (OMX_U32)OMX_TI_ReadSE(&sBits);
+                break;
+        }
+    }
+    *pError = sBits.bError;
+    return OMX_TI_BitReaderTell(&sBits);
+}
+
+static int Check(const char *sReader, const BENCH_HEADER *h, OMX_U32 nSize,
+                 const OMX_U32 *pValues, int nHeader)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < h->nFields && h->pFields[i].nEnd <= nSize * 8; i++) {
+        if (pValues[i] != h->pFields[i].nValue) {
+            printf("FAIL: %s reader, header %d of %lu bytes, field %lu: %lu, expected %lu\n",
+                   sReader, nHeader, (unsigned long)nSize, (unsigned long)i,
+                   (unsigned long)pValues[i], (unsigned long)h->pFields[i].nValue);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* every field read again after seeking to it; alignment from each bit */
+static int VerifySeek(const BENCH_HEADER *h, int nHeader)
+{
+    OMX_TI_BITREADERTYPE sBits;
+    const BENCH_FIELD *f;
+    OMX_U32 nValue, nPos, i;
+
+    OMX_TI_BitReaderInit(&sBits, h->pData, h->nSize);
+    for (i = 0; i < h->nFields; i++) {
+        f = &h->pFields[i];
+        OMX_TI_BitReaderSeek(&sBits, i ? h->pFields[i - 1].nEnd : 0);
+        nValue = f->eType == BENCH_U ? OMX_TI_ReadBits(&sBits, f->nBits) :
+                 f->eType == BENCH_UE ? OMX_TI_ReadUE(&sBits) :
+                 (OMX_U32)OMX_TI_ReadSE(&sBits);
+        if (nValue != f->nValue || OMX_TI_BitReaderTell(&sBits) != f->nEnd) {
+            printf("FAIL: header %d, field %lu after a seek\n", nHeader, (unsigned long)i);
+            return 1;
+        }
+    }
+    for (nPos = 0; nPos <= h->nSize * 8; nPos++) {
+        OMX_TI_BitReaderSeek(&sBits, nPos);
+        OMX_TI_ByteAlign(&sBits);
+        if (OMX_TI_BitReaderTell(&sBits) != ((nPos + 7) & ~7) || sBits.bError) {
+            printf("FAIL: header %d, aligning from bit %lu\n", nHeader, (unsigned long)nPos);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* every header read whole by both readers, then cut short by the new one */
+static int Verify(BENCH_HEADER *pHeaders, int nHeaders)
+{
+    OMX_U32 aValues[BENCH_MAX_FIELDS];
+    OMX_BOOL bError;
+    OMX_U32 nCut, nEnd;
+    OMX_U8 *pCut;
+    int i;
+
+    for (i = 0; i < nHeaders; i++) {
+        BENCH_HEADER *h = &pHeaders[i];
+        BENCH_HEADER sCut = *h;
+
+        ReadOld(h, aValues);
+        if (Check("old", h, h->nSize, aValues, i)) {
+            return 1;
+        }
+        ReadNew(h, h->nSize, aValues, &bError);
+        if (bError || Check("new", h, h->nSize, aValues, i)) {
+            printf("FAIL: new reader, header %d\n", i);
+            return 1;
+        }
+        if (VerifySeek(h, i)) {
+            return 1;
+        }
+        for (nCut = 0; nCut < h->nSize; nCut++) {
+            /* an exact copy, so that reading past it shows up under
+               valgrind or AddressSanitizer */
+            pCut = malloc(nCut ? nCut : 1);
+            if (pCut == NULL) {
+                return 1;
+            }
+            memcpy(pCut, h->pData, nCut);
+            sCut.pData = pCut;
+            nEnd = ReadNew(&sCut, nCut, aValues, &bError);
+            free(pCut);
+            if (Check("new", h, nCut, aValues, i)) {
+                return 1;
+            }
+            if (nEnd > nCut * 8 ||
+                bError != (h->pFields[h->nFields - 1].nEnd > nCut * 8)) {
+                printf("FAIL: header %d cut to %lu bytes: ended at bit %lu, bError %d\n",
+                       i, (unsigned long)nCut, (unsigned long)nEnd, bError);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* ue(v) with 32 leading zeros or more is not a valid code */
+static int VerifyInvalid(void)
+{
+    static const OMX_U8 aZeros[9] = { 0, 0, 0, 0, 0x80, 0, 0, 0, 0 };
+    static const OMX_U8 aLongest[9] = { 0, 0, 0, 1, 0xFF, 0xFF, 0xFF, 0xFE, 0 };
+    OMX_TI_BITREADERTYPE sBits;
+    OMX_U32 nValue;
+
+    OMX_TI_BitReaderInit(&sBits, aZeros, sizeof(aZeros));
+    nValue = OMX_TI_ReadUE(&sBits);
+    if (nValue != 0 || !sBits.bError) {
+        printf("FAIL: 32 leading zeros read as %lu\n", (unsigned long)nValue);
+        return 1;
+    }
+    /* 31 zeros, then 32 bits: the largest value there is */
+    OMX_TI_BitReaderInit(&sBits, aLongest, sizeof(aLongest));
+    nValue = OMX_TI_ReadUE(&sBits);
+    if (nValue != 0xFFFFFFFE || sBits.bError || OMX_TI_BitReaderTell(&sBits) != 63) {
+        printf("FAIL: longest ue(v) read as %lu\n", (unsigned long)nValue);
+        return 1;
+    }
+    return 0;
+}
+
+static double TimeReader(BENCH_HEADER *pHeaders, int nHeaders, double fSeconds, int bNew)
+{
+    OMX_U32 aValues[BENCH_MAX_FIELDS];
+    volatile OMX_U32 nSink = 0;
+    OMX_BOOL bError;
+    double fStart = NowMs();
+    double fElapsed;
+    long nRead = 0;
+    int i;
+
+    do {
+        for (i = 0; i < nHeaders; i++) {
+            if (bNew) {
+                nSink += ReadNew(&pHeaders[i], pHeaders[i].nSize, aValues, &bError);
+            }
+            else {
+                nSink += ReadOld(&pHeaders[i], aValues);
+            }
+        }
+        nRead += nHeaders;
+        fElapsed = NowMs() - fStart;
+    } while (fElapsed < fSeconds * 1000);
+    return fElapsed * 1000000.0 / nRead;
+}
+
+int main(int argc, char *argv[])
+{
+    double fSeconds = BENCH_DEFAULT_SECONDS;
+    int nHeaders = BENCH_DEFAULT_HEADERS;
+    BENCH_HEADER *pHeaders[3];
+    double fOld, fNew, fOldAll = 0, fNewAll = 0;
+    int opt, k, i, ret = 0;
+
+    while ((opt = getopt(argc, argv, "d:n:")) != -1) {
+        switch (opt) {
+            case 'd':
+                fSeconds = atof(optarg);
+                break;
+            case 'n':
+                nHeaders = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-d seconds] [-n headers]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (nHeaders < 1) {
+        nHeaders = 1;
+    }
+
+    if (VerifyInvalid()) {
+        return 1;
+    }
+
+    for (k = 0; k < 3; k++) {
+        pHeaders[k] = calloc(nHeaders, sizeof(BENCH_HEADER));
+        if (pHeaders[k] == NULL) {
+            fprintf(stderr, "cannot allocate headers\n");
+            return 1;
+        }
+        for (i = 0; i < nHeaders; i++) {
+            if (MakeHeader(&pHeaders[k][i], k, k * nHeaders + i + 1)) {
+                fprintf(stderr, "cannot allocate headers\n");
+                return 1;
+            }
+        }
+        if (Verify(pHeaders[k], nHeaders)) {
+            ret = 1;
+            continue;
+        }
+        fOld = TimeReader(pHeaders[k], nHeaders, fSeconds / 3, 0);
+        fNew = TimeReader(pHeaders[k], nHeaders, fSeconds / 3, 1);
+        fOldAll += fOld;
+        fNewAll += fNew;
+        printf("%s: old %.0f ns, new %.0f ns per header (x%.1f)\n",
+               sKinds[k], fOld, fNew, fOld / fNew);
+    }
+    if (!ret) {
+        printf("all: old %.0f ns, new %.0f ns per SPS+PPS+VOL (x%.1f)\n",
+               fOldAll, fNewAll, fOldAll / fNewAll);
+    }
+
+    for (k = 0; k < 3; k++) {
+        for (i = 0; pHeaders[k] != NULL && i < nHeaders; i++) {
+            free(pHeaders[k][i].pData);
+            free(pHeaders[k][i].pFields);
+        }
+        free(pHeaders[k]);
+    }
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
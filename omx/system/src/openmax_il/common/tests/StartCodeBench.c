@@ -0,0 +1,305 @@
+
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  StartCodeBench.c
+*
+*  Compares OMX_TI_ScanStartCodes with the byte at a time search the config
+*  parsers and the video decoder used before (zeros counted one by one, as
+*  in LocateFrameHeader), over elementary streams given on the command
+*  line: H.264 byte streams, MPEG-4 or MPEG-2 video. Without files a
+*  synthetic H.264 byte stream is used, NAL units of random payload with
+*  emulation prevention bytes.
+*
+*  Both must find the same boundaries; random buffers rich in 00 and 01
+*  bytes are checked as well. Reports MB/s and start codes found for each
+*  stream and the speed-up of the word at a time scan. Fails only on a
+*  difference; the speed depends on the target and is not checked.
+*
+*  usage: StartCodeBench [-d seconds] [stream ...]
+* =========================================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "OMX_TI_StartCode.h"
+
+#define BENCH_DEFAULT_SECONDS   1
+#define BENCH_SYNTH_BYTES       (4 * 1024 * 1024)
+#define BENCH_FUZZ_ROUNDS       20000
+
+static double NowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* the scan being replaced: next start code at or after nPos, or nSize */
+static OMX_U32 ByteFindStartCode(const OMX_U8 *pData, OMX_U32 nSize, OMX_U32 nPos)
+{
+    OMX_U32 nZeros = 0;
+    OMX_U32 i;
+
+    for (i = nPos; i < nSize; i++)
+    {
+        if (nZeros > 1 && pData[i] == 0x01)
+        {
+            return i - 2;
+        }
+        if (pData[i])
+        {
+            nZeros = 0;
+        }
+        else
+        {
+            nZeros++;
+        }
+    }
+    return nSize;
+}
+
+static OMX_U32 ByteScanStartCodes(const OMX_U8 *pData, OMX_U32 nSize,
+                                  OMX_U32 *pOffsets, OMX_U32 nMaxOffsets)
+{
+    OMX_U32 nCount = 0;
+    OMX_U32 nPos = ByteFindStartCode(pData, nSize, 0);
+
+    while (nPos < nSize)
+    {
+        if (pOffsets != NULL && nCount < nMaxOffsets)
+        {
+            pOffsets[nCount] = nPos;
+        }
+        nCount++;
+        nPos = ByteFindStartCode(pData, nSize, nPos + 3);
+    }
+    return nCount;
+}
+
+/* H.264 byte stream of random NAL units, mostly a few KB, some larger */
+static OMX_U8 *MakeStream(OMX_U32 nSize)
+{
+    OMX_U8 *pData = malloc(nSize);
+    unsigned int nSeed = 1;
+    OMX_U32 nPos = 0;
+    OMX_U32 nNal = 0;
+    OMX_U32 nZeros = 0;
+    OMX_U8 b;
+
+    if (pData == NULL)
+    {
+        return NULL;
+    }
+    while (nPos < nSize)
+    {
+        if (nNal == 0 && nPos + 5 <= nSize)
+        {
+            pData[nPos++] = 0;
+            pData[nPos++] = 0;
+            pData[nPos++] = 1;
+            pData[nPos++] = 0x65;
+            nNal = (rand_r(&nSeed) % 8 == 0) ? 20000 + rand_r(&nSeed) % 40000
+                                            : 200 + rand_r(&nSeed) % 4000;
+            nZeros = 0;
+            continue;
+        }
+        /* coded data is mostly random, with short runs of zeros now and
+           then (zero residuals, cabac_zero_words) */
+        b = (rand_r(&nSeed) % 1024 == 0 || (nZeros > 0 && nZeros < 3)) ?
+            0 : (OMX_U8)rand_r(&nSeed);
+        if (nZeros >= 2 && b <= 3)
+        {
+            b = 3;
+        }
+        nZeros = b ? 0 : nZeros + 1;
+        pData[nPos++] = b;
+        if (nNal > 0)
+        {
+            nNal--;
+        }
+    }
+    return pData;
+}
+
+static OMX_U8 *ReadStream(const char *sPath, OMX_U32 *pSize)
+{
+    FILE *pFile = fopen(sPath, "rb");
+    OMX_U8 *pData = NULL;
+    long nSize;
+
+    if (pFile == NULL)
+    {
+        return NULL;
+    }
+    if (fseek(pFile, 0, SEEK_END) == 0 && (nSize = ftell(pFile)) > 0)
+    {
+        rewind(pFile);
+        pData = malloc(nSize);
+        if (pData != NULL && fread(pData, 1, nSize, pFile) != (size_t)nSize)
+        {
+            free(pData);
+            pData = NULL;
+        }
+        *pSize = (OMX_U32)nSize;
+    }
+    fclose(pFile);
+    return pData;
+}
+
+/* both scans over short random buffers of 00, 01 and other bytes */
+static int Fuzz(void)
+{
+    static const OMX_U8 sBytes[] = { 0, 0, 0, 1, 1, 3, 0x65, 0xff };
+    OMX_U8 buf[96];
+    unsigned int nSeed = 7;
+    OMX_U32 nSize, nPos, nWord, nByte, i;
+    int r;
+
+    for (r = 0; r < BENCH_FUZZ_ROUNDS; r++)
+    {
+        nSize = rand_r(&nSeed) % sizeof(buf);
+        for (i = 0; i < nSize; i++)
+        {
+            buf[i] = sBytes[rand_r(&nSeed) % sizeof(sBytes)];
+        }
+        nPos = nSize ? rand_r(&nSeed) % (nSize + 1) : 0;
+        nWord = OMX_TI_FindStartCode(buf, nSize, nPos);
+        nByte = ByteFindStartCode(buf, nSize, nPos);
+        if (nWord != nByte)
+        {
+            printf("FAIL: %lu byte buffer from %lu: start code at %lu, expected %lu\n",
+                   (unsigned long)nSize, (unsigned long)nPos,
+                   (unsigned long)nWord, (unsigned long)nByte);
+            return 1;
+        }
+    }
+    printf("fuzz: %d buffers agree\n", BENCH_FUZZ_ROUNDS);
+    return 0;
+}
+
+/* times both scans over one stream; returns 1 on a mismatch */
+static int Bench(const char *sName, const OMX_U8 *pData, OMX_U32 nSize,
+                 double fSeconds)
+{
+    OMX_U32 nByteCount = ByteScanStartCodes(pData, nSize, NULL, 0);
+    OMX_U32 nWordCount = OMX_TI_ScanStartCodes(pData, nSize, NULL, 0);
+    OMX_U32 *pByteOffsets;
+    OMX_U32 *pWordOffsets;
+    double fStart, fByteMBs, fWordMBs, fMB;
+    volatile OMX_U32 nSink = 0;
+    int nPasses, ret = 0;
+
+    if (nByteCount != nWordCount)
+    {
+        printf("FAIL: %s: %lu start codes, expected %lu\n", sName,
+               (unsigned long)nWordCount, (unsigned long)nByteCount);
+        return 1;
+    }
+    pByteOffsets = malloc((nByteCount + 1) * sizeof(OMX_U32));
+    pWordOffsets = malloc((nByteCount + 1) * sizeof(OMX_U32));
+    if (pByteOffsets == NULL || pWordOffsets == NULL)
+    {
+        fprintf(stderr, "cannot allocate offsets\n");
+        free(pByteOffsets);
+        free(pWordOffsets);
+        return 1;
+    }
+    ByteScanStartCodes(pData, nSize, pByteOffsets, nByteCount);
+    OMX_TI_ScanStartCodes(pData, nSize, pWordOffsets, nByteCount);
+    if (memcmp(pByteOffsets, pWordOffsets, nByteCount * sizeof(OMX_U32)) != 0)
+    {
+        printf("FAIL: %s: start codes at other offsets\n", sName);
+        ret = 1;
+    }
+    free(pByteOffsets);
+    free(pWordOffsets);
+
+    fMB = nSize / (1024.0 * 1024.0);
+    fStart = NowMs();
+    for (nPasses = 0; NowMs() - fStart < fSeconds * 1000; nPasses++)
+    {
+        nSink += ByteScanStartCodes(pData, nSize, NULL, 0);
+    }
+    fByteMBs = nPasses * fMB * 1000 / (NowMs() - fStart);
+
+    fStart = NowMs();
+    for (nPasses = 0; NowMs() - fStart < fSeconds * 1000; nPasses++)
+    {
+        nSink += OMX_TI_ScanStartCodes(pData, nSize, NULL, 0);
+    }
+    fWordMBs = nPasses * fMB * 1000 / (NowMs() - fStart);
+
+    printf("%s: %.1f MB, %lu start codes: byte %.0f MB/s, word %.0f MB/s (x%.1f)\n",
+           sName, fMB, (unsigned long)nByteCount, fByteMBs, fWordMBs,
+           fWordMBs / fByteMBs);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    double fSeconds = BENCH_DEFAULT_SECONDS;
+    OMX_U8 *pData;
+    OMX_U32 nSize;
+    int opt, i, ret = 0;
+
+    while ((opt = getopt(argc, argv, "d:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                fSeconds = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-d seconds] [stream ...]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    ret |= Fuzz();
+
+    if (optind == argc)
+    {
+        nSize = BENCH_SYNTH_BYTES;
+        pData = MakeStream(nSize);
+        if (pData == NULL)
+        {
+            fprintf(stderr, "cannot allocate the stream\n");
+            return 1;
+        }
+        ret |= Bench("synthetic H.264", pData, nSize, fSeconds);
+        free(pData);
+    }
+    for (i = optind; i < argc; i++)
+    {
+        pData = ReadStream(argv[i], &nSize);
+        if (pData == NULL)
+        {
+            fprintf(stderr, "cannot read %s\n", argv[i]);
+            ret = 1;
+            continue;
+        }
+        ret |= Bench(argv[i], pData, nSize, fSeconds);
+        free(pData);
+    }
+
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
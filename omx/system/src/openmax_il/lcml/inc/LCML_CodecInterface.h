@@ -34,7 +34,9 @@
 #ifndef __LCML_CODECINTERFACE_H__
 #define __LCML_CODECINTERFACE_H__
 
+#include <string.h>
 #include <OMX_Core.h>
+#include <OMX_Component.h>
 #include <OMX_TI_Debug.h>
 /** 
  * Commands to send messages to codec 
@@ -48,9 +50,112 @@ typedef enum
     EMMCodecControlDestroy,
     EMMCodecControlAlgCtrl,
     EMMCodecControlStrmCtrl,
-    EMMCodecControlUsnEos
+    EMMCodecControlUsnEos,
+    EMMCodecControlCachePolicy,   /* args[0]: TLcmlCachePolicy */
+    EMMCodecControlBufferAccess,  /* args[0]: buffer, args[1]: length, args[2]: LCML_CPU_ACCESS_* */
+    EMMCodecControlLatencyStats,  /* args[0]: stream id, args[1]: LCML_LATENCY_STATS *, args[2]: reset if non-zero */
+    EMMCodecControlReleaseBuffer  /* args[0]: buffer, args[1]: length, args[2]: LCML_RELEASE_*; drops its cached mapping */
 }TControlCmd;
 
+/**
+ * Cache maintenance done by QueueBuffer on buffers mapped with ReUseMap.
+ * The default can be set with the LCML_CACHE_POLICY environment variable
+ * ("always", "tracked" or "none").
+ */
+typedef enum
+{
+    ELcmlCachePolicyAlways,     /* flush inputs and invalidate outputs on every queue */
+    ELcmlCachePolicyTracked,    /* skip when the CPU has not touched the buffer */
+    ELcmlCachePolicyNone        /* never, for buffers that are not cached */
+}TLcmlCachePolicy;
+
+/**
+ * CPU access to a buffer since the DSP returned it, reported with
+ * EMMCodecControlBufferAccess before the buffer is queued again. Without a
+ * report the CPU is assumed to have read and written the buffer.
+ */
+#define LCML_CPU_ACCESS_NONE    0x0
+#define LCML_CPU_ACCESS_READ    0x1
+#define LCML_CPU_ACCESS_WRITE   0x2
+
+/**
+ * OR'd into the buffer type of QueueBuffer for a buffer that is tunneled
+ * between two TI components and whose data the CPU does not touch. Its DSP
+ * mapping is made once and shared by every LCML instance of the process
+ * that queues the same buffer. Once queued it is assumed untouched by the
+ * CPU until it is queued again, so under ELcmlCachePolicyTracked it goes
+ * without cache maintenance unless EMMCodecControlBufferAccess reports an
+ * access in between. The mapping is kept until
+ * EMMCodecControlReleaseBuffer or the codec is destroyed.
+ */
+#define LCML_BUFFER_TUNNEL      0x10000
+
+/**
+ * Flags of EMMCodecControlReleaseBuffer. The release fails with
+ * OMX_ErrorNotReady while the DSP still holds the buffer; LCML_RELEASE_WAIT
+ * first waits up to LCML_RELEASE_WAIT_MS for it to come back, and must not
+ * be used from the LCML callback. LCML_RELEASE_OWNER tells that the caller
+ * frees the memory once the release succeeded, so no other instance may
+ * take the shared mapping of it any more.
+ */
+#define LCML_RELEASE_WAIT       0x1
+#define LCML_RELEASE_OWNER      0x2
+#define LCML_RELEASE_WAIT_MS    200
+
+/**
+ * Names of the TI components whose frames only their DSP node reads and
+ * writes. A component uses LCML_BUFFER_TUNNEL only on a port tunneled to one
+ * of them; any other peer may touch the buffer on the CPU.
+ */
+#define LCML_DSP_TUNNEL_PEERS   "OMX.TI.Video.Decoder", "OMX.TI.Video.encoder", \
+                                "OMX.TI.VPP", "OMX.TI.JPEG.decoder"
+
+/**
+ * Checks whether a tunneled component is one of LCML_DSP_TUNNEL_PEERS, so
+ * that the buffers of the tunnel can be queued with LCML_BUFFER_TUNNEL.
+ */
+static __inline OMX_BOOL LCML_IsDspTunnelPeer(OMX_HANDLETYPE hComp)
+{
+    static const char *aPeers[] = { LCML_DSP_TUNNEL_PEERS };
+    char cName[OMX_MAX_STRINGNAME_SIZE];
+    OMX_VERSIONTYPE sComponentVersion;
+    OMX_VERSIONTYPE sSpecVersion;
+    OMX_UUIDTYPE sComponentUUID;
+    OMX_U32 i;
+
+    memset(cName, 0, sizeof(cName));
+    if (OMX_GetComponentVersion(hComp, cName, &sComponentVersion, &sSpecVersion, &sComponentUUID) != OMX_ErrorNone)
+    {
+        return OMX_FALSE;
+    }
+    for (i = 0; i < sizeof(aPeers) / sizeof(aPeers[0]); i++)
+    {
+        if (strcmp(cName, aPeers[i]) == 0)
+        {
+            return OMX_TRUE;
+        }
+    }
+    return OMX_FALSE;
+}
+
+/**
+ * DSP round-trip latency of the buffers of one stream, from the
+ * USN_GPPMSG_SET_BUFF sent by QueueBuffer to the matching
+ * USN_DSPMSG_BUFF_FREE. Even streams carry input buffers, odd streams
+ * output buffers. Times are in microseconds; percentiles are bucket upper
+ * bounds, within 25% of the true value.
+ */
+typedef struct LCML_LATENCY_STATS
+{
+    OMX_U32 nCount;         /* buffers returned */
+    OMX_U32 nP50;
+    OMX_U32 nP90;
+    OMX_U32 nP99;
+    OMX_U32 nMax;
+    OMX_U32 nInFlight;      /* buffers currently held by the DSP */
+    OMX_U32 nPeakInFlight;
+}LCML_LATENCY_STATS;
+
 
 /**
  * Type fo buffer ENUM
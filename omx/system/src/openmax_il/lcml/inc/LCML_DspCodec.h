@@ -38,9 +38,6 @@
 #define MAX_OBJS                10
 #define MAX_STREAMS             10
 
-/* 720p implementation */
-#define MAX_DMM_BUFFERS 20
-
 /*DSP specific*/
 #define DSP_DOF_IMAGE           "baseimage.dof"
 #define TI_PROCESSOR_DSP        0
@@ -124,7 +121,176 @@ typedef struct
     OMX_U32 iStreamID;
 } TArmDspCommunicationStruct;
 
+/* Comm struct pool: one cache line aligned slot per queue entry, input slots
+ * first then output slots, all covered by a single DMM mapping */
+#define LCML_COMM_SLOT_SIZE     (((sizeof(TArmDspCommunicationStruct) + GEM_CACHE_LINE_SIZE - 1) / \
+                                  GEM_CACHE_LINE_SIZE) * GEM_CACHE_LINE_SIZE)
+#define LCML_COMM_POOL_SIZE     ROUND_TO_PAGESIZE(2 * QUEUE_SIZE * LCML_COMM_SLOT_SIZE)
+
 
+/* DMM mapping cache used when buffers are queued with ReUseMap. It holds
+ * at least as many mappings as there are queue slots so a free entry can
+ * always be evicted; buckets must be a power of two */
+#define LCML_MAP_CACHE_SIZE     (2 * QUEUE_SIZE)
+#define LCML_MAP_CACHE_BUCKETS  64
+
+typedef struct LCML_MAP_CACHE_ENTRY
+{
+    DMM_BUFFER_OBJ dmmBuf;  /* mapping, pAllocated is the ARM address key */
+    OMX_U32 nLength;        /* mapped length, second half of the key */
+    OMX_U32 nLastUse;       /* LRU stamp, 0 when the entry is unused */
+    OMX_U32 nCpuAccess;     /* LCML_CPU_ACCESS_* since the last DSP handoff */
+    OMX_S32 nNext;          /* next entry in the same bucket, -1 ends */
+} LCML_MAP_CACHE_ENTRY;
+
+typedef struct LCML_MAP_CACHE
+{
+    LCML_MAP_CACHE_ENTRY entries[LCML_MAP_CACHE_SIZE];
+    OMX_S32 buckets[LCML_MAP_CACHE_BUCKETS];
+    OMX_U32 nCount;
+    OMX_U32 nClock;
+    /* statistics, logged through PERF when the codec is destroyed */
+    OMX_U32 nHits;
+    OMX_U32 nMisses;
+    OMX_U32 nEvictions;
+    OMX_U32 nMappedBytes;
+    OMX_U32 nPeakMappedBytes;
+    OMX_U32 nCacheOpsDone;
+    OMX_U32 nCacheOpsSkipped;
+    OMX_U32 nShared;        /* misses served by another instance's mapping */
+} LCML_MAP_CACHE;
+
+/* Mappings held by the map caches of all LCML instances, so that a buffer
+ * passed from one component to another is mapped into the DSP only once.
+ * A mapping is unmapped when the last cache holding it drops it; when the
+ * table is full new mappings stay private to their cache. */
+#define LCML_SHARED_MAPS        (8 * QUEUE_SIZE)
+
+typedef struct LCML_SHARED_MAP
+{
+    DSP_HPROCESSOR hProc;
+    DMM_BUFFER_OBJ dmmBuf;  /* pAllocated and nLength are the key */
+    OMX_U32 nLength;
+    OMX_U32 nUsers;         /* caches holding the mapping, 0 when unused */
+    OMX_BOOL bStale;        /* memory freed by its owner: only released, never taken again */
+} LCML_SHARED_MAP;
+
+/* DSP round-trip latency histograms, one per stream for the first
+ * LCML_LATENCY_STREAMS streams. Buckets 0-3 are exact microseconds, then
+ * four buckets per power of two up to about two seconds. */
+#define LCML_LATENCY_STREAMS    4
+#define LCML_LATENCY_BUCKETS    80
+
+typedef struct LCML_LATENCY_HIST
+{
+    OMX_U32 buckets[LCML_LATENCY_BUCKETS];
+    OMX_U32 nCount;
+    OMX_U32 nMax;
+    OMX_U32 nPeakInFlight;
+} LCML_LATENCY_HIST;
+
+/* Process-wide cache of the bridge setup shared by all instances: one
+ * processor attach and the node libraries registered with the DCD. Entries
+ * stay registered after their last user so that a codec restart skips the
+ * bridge calls; a DSP error or unloading LCML drops the cache. */
+#define LCML_MAX_REGISTERED_OBJECTS 64
+
+typedef struct LCML_REGISTERED_OBJECT
+{
+    struct DSP_UUID uuid;
+    LCML_DllType eDllType;
+    OMX_U8 DllName[50];
+    OMX_U32 nRefs;          /* instances using it, 0 once only cached */
+} LCML_REGISTERED_OBJECT;
+
+/* Warm pool of created, idle nodes handed out by InitMMCodec. A pool is kept
+ * per codec configuration (node UUID, create phase arguments and node
+ * attributes) that has been started before; LCML_NODE_POOL gives the number
+ * of idle nodes kept for each, 0 or unset disables the pool. */
+#define LCML_NODE_POOL_MAX_CONFIGS  8
+#define LCML_NODE_POOL_MAX_DEPTH    4
+
+typedef struct LCML_NODE_POOL_CONFIG
+{
+    struct DSP_UUID uuid;
+    LCML_CREATEPHASEARGS crData;
+    struct DSP_NODEATTRIN attrIn;
+    DSP_HNODE hNodes[LCML_NODE_POOL_MAX_DEPTH];
+    OMX_U32 nNodes;
+    OMX_U32 nLastUsed;      /* start counter at the last start, for replacement */
+    OMX_BOOL bFailed;       /* background create failed, no refill until used */
+} LCML_NODE_POOL_CONFIG;
+
+/* DSP virtual address arena reserved once per processor attach. DmmMap
+ * carves its reservations out of it with a buddy allocator instead of
+ * calling DSPProcessor_ReserveMemory per buffer; LCML_DMM_ARENA_MB sizes it
+ * (rounded down to a power of two, 0 disables it). */
+#define LCML_DMM_ARENA_DEFAULT_MB   32
+#define LCML_DMM_ARENA_MAX_ORDER    16      /* 256 MB of 4 KB pages */
+#define LCML_DMM_ARENA_FREE         0x80    /* in pOrder: block is free */
+
+typedef struct LCML_DMM_ARENA
+{
+    DSP_HPROCESSOR hProc;   /* processor the reservation belongs to */
+    OMX_U8 *pBase;          /* DSP address of the reservation, NULL if none */
+    OMX_U32 nPages;         /* a power of two */
+    OMX_U32 nMaxOrder;
+    OMX_S32 freeHead[LCML_DMM_ARENA_MAX_ORDER + 1];
+    OMX_S32 *pNext;         /* free list links, indexed by first page */
+    OMX_S32 *pPrev;
+    OMX_U8 *pOrder;         /* order of the block starting at a page */
+    OMX_U32 nUsedPages;
+    OMX_U32 nPeakPages;
+    OMX_U32 nAllocs;
+    OMX_U32 nFallbacks;     /* reservations that did not fit in the arena */
+} LCML_DMM_ARENA;
+
+/* bridge notifications registered per node: message ready, plus MMU fault
+ * and DSP system error when errors are propagated, and last the node state
+ * change that Destroy raises by terminating the node to end the wait */
+#ifdef __ERROR_PROPAGATION__
+#define LCML_NUM_NOTIFICATIONS  4
+#else
+#define LCML_NUM_NOTIFICATIONS  2
+#endif
+#define LCML_NOTIFY_STATECHANGE (LCML_NUM_NOTIFICATIONS - 1)
+
+/* longest bridge wait of a thread serving nodes. The state change ends it
+ * at once on a normal teardown; the timeout only matters when the node
+ * could not be terminated (the DSP crashed), and then bounds Destroy */
+#define LCML_EVENT_TIMEOUT_MS   1000
+
+/* Optional process-wide dispatcher. When LCML_DISPATCH_THREADS is set in
+ * the environment, instances share that many threads (at most
+ * LCML_DISPATCH_MAX_THREADS) instead of starting a MessagingThread each.
+ * Every node registers a second set of notifications that only its
+ * dispatcher thread waits on, directly in the bridge. One bridge wait
+ * takes at most LCML_DISPATCH_MAX_EVENTS objects, so a thread serves at
+ * most LCML_DISPATCH_MAX_NODES nodes; instances that do not fit get a
+ * private thread. */
+#define LCML_DISPATCH_MAX_THREADS   4
+#define LCML_DISPATCH_MAX_EVENTS    32
+#define LCML_DISPATCH_MAX_NODES     (LCML_DISPATCH_MAX_EVENTS / LCML_NUM_NOTIFICATIONS)
+
+/* nDispatchState of a node: not yet in the wait of its thread, in it, or
+ * left out for good because the node stopped or the DSP failed */
+#define LCML_DISPATCH_PENDING   0
+#define LCML_DISPATCH_WATCHED   1
+#define LCML_DISPATCH_DROPPED   2
+
+typedef struct LCML_DISPATCH_THREAD
+{
+    pthread_t tid;
+    struct LCML_DSP_INTERFACE *nodes[LCML_DISPATCH_MAX_NODES];
+    OMX_U32 nNodes;
+    OMX_U32 nGeneration;      /* bumped on every change to nodes[] */
+    OMX_U32 nSeenGeneration;  /* generation the thread is waiting on */
+    OMX_BOOL bBlocked;        /* in the bridge wait, only node events end it */
+    OMX_BOOL bExit;
+#ifdef __PERF_INSTRUMENTATION__
+    PERF_OBJHANDLE pPERF;
+#endif
+} LCML_DISPATCH_THREAD;
 
 /*API needs to be exposed to application*/
 
@@ -275,27 +441,54 @@ typedef struct LCML_DSP_INTERFACE
     OMX_U32 iBufinputcount;
     OMX_U32 iBufoutputcount;
     OMX_U32 pshutdownFlag;
-#ifdef __ERROR_PROPAGATION__
-    struct DSP_NOTIFICATION * g_aNotificationObjects[3];
-#else
-    struct DSP_NOTIFICATION * g_aNotificationObjects[1];
-#endif
+    struct DSP_NOTIFICATION * g_aNotificationObjects[LCML_NUM_NOTIFICATIONS];
     pthread_t g_tidMessageThread;
+    /* shared dispatcher thread serving this node, NULL with a private
+     * MessagingThread */
+    LCML_DISPATCH_THREAD *pDispatcher;
+    /* the dispatcher's own notifications, laid out like
+     * g_aNotificationObjects, and where the node is in its wait */
+    struct DSP_NOTIFICATION *aDispatchNotifications[LCML_NUM_NOTIFICATIONS];
+    OMX_U32 nDispatchState;
+    /* serialises ProcessNodeEvents while a node changes threads */
+    pthread_mutex_t eventMutex;
     OMX_U32 algcntlmapped[QUEUE_SIZE];
     DMM_BUFFER_OBJ *pAlgcntlDmmBuf[QUEUE_SIZE];
     OMX_U32 strmcntlmapped[QUEUE_SIZE];
     DMM_BUFFER_OBJ *pStrmcntlDmmBuf[QUEUE_SIZE];
+    /* guards the slots, the map cache and the latency records; never held
+     * across a bridge call in QueueBuffer */
     pthread_mutex_t mutex;
+    /* EMMCodecControlReleaseBuffer callers waiting for the DSP to return
+     * a buffer, woken after each batch of messages; guarded by mutex */
+    pthread_cond_t releaseCond;
+    OMX_U32 nReleaseWaiters;
+    /* keeps QueueBuffer calls of one direction (input, output) in order */
+    pthread_mutex_t queueMutex[2];
+    /* slot QueueBuffer holds per direction until SET_BUFF is sent; STOP and
+     * FLUSH must not return it */
+    TArmDspCommunicationStruct *pQueuePending[2];
     OMX_U32 flush_pending[4];
     OMX_BOOL bUsnEos;
 
 #ifdef __PERF_INSTRUMENTATION__
     PERF_OBJHANDLE pPERF, pPERFcomp;
 #endif
-    DMM_BUFFER_OBJ mapped_dmm_buffers[MAX_DMM_BUFFERS];
-    OMX_U32 mapped_buffer_count;
+    LCML_MAP_CACHE mapCache;
+    TLcmlCachePolicy eCachePolicy;
+    /* round-trip latency, queue times indexed like Arm*storage */
+    LCML_LATENCY_HIST latency[LCML_LATENCY_STREAMS];
+    OMX_U32 nInputQueuedAt[QUEUE_SIZE];
+    OMX_U32 nOutputQueuedAt[QUEUE_SIZE];
+    OMX_U32 nLatencyReportedAt;
     OMX_BOOL ReUseMap;
     pthread_mutex_t m_isStopped_mutex;
+    /* comm structs preallocated per queue slot, DMM-mapped once at init */
+    char *pCommPool;
+    DMM_BUFFER_OBJ commPoolDmmBuf;
+    /* references held on the shared processor attach and node libraries */
+    OMX_BOOL bBridgeAttached;
+    OMX_BOOL bNodeObjectsRegistered;
 
 }LCML_DSP_INTERFACE;
 
@@ -241,6 +241,7 @@ typedef struct DMM_BUFFER_OBJ {
     void* paramReserved;
 /*  void* structReserved;*/
     int nSize;
+    int bCached;        /* mapping owned by the map cache, kept on return */
 } DMM_BUFFER_OBJ;
 
 /* ======================================================================= */
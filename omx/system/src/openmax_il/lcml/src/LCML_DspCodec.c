@@ -59,12 +59,78 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <malloc.h>
 #include "usn.h"
 #include <sys/time.h>
+#include <time.h>
 
 #define CEXEC_DONE 1
 /*DSP_HNODE hDasfNode;*/
 #define ABS_DLL_NAME_LENGTH 128
+
+/* tags for the PERF_Log records of the DMM map cache (28 bits max) */
+#define LCML_PERF_LOG_MAP_HITS      0x4D41501   /* hits, misses */
+#define LCML_PERF_LOG_MAP_BYTES     0x4D41502   /* evictions, peak mapped bytes */
+#define LCML_PERF_LOG_MAP_EVICT     0x4D41503   /* evicted address, length */
+#define LCML_PERF_LOG_CACHE_OPS     0x4D41504   /* cache maintenance done, skipped */
+/* tags for the DSP round-trip latency records, stream id in the low nibble */
+#define LCML_PERF_LOG_LAT_PCT       0x4C41500   /* p50, p90 in us */
+#define LCML_PERF_LOG_LAT_MAX       0x4C41510   /* p99, max in us */
+#define LCML_PERF_LOG_LAT_DEPTH     0x4C41520   /* buffers in flight, peak */
+#define LCML_LATENCY_REPORT_US      1000000
+/* tag for the node setup phase timings, phase in the low nibble */
+#define LCML_PERF_LOG_SETUP         0x5345500   /* phase, total so far in us */
+#define LCML_PERF_LOG_POOL          0x5345510   /* pool hits, misses */
+#define LCML_PERF_LOG_POOL_START    0x5345520   /* start time in us, low bit set on a hit */
+#define LCML_PERF_LOG_TEARDOWN      0x5345530   /* messaging stopped, destroy done in us */
+
+/* node setup phases timed by SetupPhaseDone */
+enum
+{
+    LCML_SETUP_ATTACH,
+    LCML_SETUP_REGISTER,
+    LCML_SETUP_ALLOCATE,
+    LCML_SETUP_CREATE,
+    LCML_SETUP_RUN,
+    LCML_SETUP_MESSAGING
+};
+
+/* process-wide dispatcher state, all fields guarded by g_dispatchMutex */
+static pthread_mutex_t g_dispatchMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_dispatchCond = PTHREAD_COND_INITIALIZER;
+static LCML_DISPATCH_THREAD g_dispatchThreads[LCML_DISPATCH_MAX_THREADS];
+static OMX_S32 g_nDispatchThreads = -1;     /* configured count, -1 until read */
+static OMX_U32 g_nDispatchActive = 0;       /* threads currently running */
+static OMX_U32 g_nDispatchUsers = 0;        /* instances registered */
+static OMX_BOOL g_bDispatchStopping = OMX_FALSE;
+
+/* process-wide bridge setup cache, all fields guarded by g_bridgeMutex */
+static pthread_mutex_t g_bridgeMutex = PTHREAD_MUTEX_INITIALIZER;
+static DSP_HPROCESSOR g_hProc = NULL;
+static OMX_U32 g_nProcUsers = 0;            /* instances using g_hProc */
+static OMX_BOOL g_bBridgeStale = OMX_FALSE; /* DSP faulted, redo the setup */
+static LCML_REGISTERED_OBJECT g_registeredObjects[LCML_MAX_REGISTERED_OBJECTS];
+static OMX_U32 g_nRegisteredObjects = 0;
+
+/* warm node pool, also guarded by g_bridgeMutex */
+static LCML_NODE_POOL_CONFIG g_poolConfigs[LCML_NODE_POOL_MAX_CONFIGS];
+static OMX_U32 g_nPoolConfigs = 0;
+static OMX_S32 g_nPoolDepth = -1;           /* configured depth, -1 until read */
+static OMX_U32 g_nPoolStarts = 0;
+static OMX_U32 g_nPoolHits = 0;
+static pthread_t g_poolThread;
+static OMX_BOOL g_bPoolThreadRunning = OMX_FALSE;
+static OMX_BOOL g_bPoolThreadJoinable = OMX_FALSE;  /* g_poolThread not joined yet */
+static OMX_BOOL g_bPoolStopping = OMX_FALSE;
+
+/* DSP address arena of g_hProc, guarded by g_arenaMutex */
+static pthread_mutex_t g_arenaMutex = PTHREAD_MUTEX_INITIALIZER;
+static LCML_DMM_ARENA g_arena;
+
+/* DSP mappings shared between the map caches, guarded by g_shareMutex; it
+ * may be taken with an instance mutex held, never the other way round */
+static pthread_mutex_t g_shareMutex = PTHREAD_MUTEX_INITIALIZER;
+static LCML_SHARED_MAP g_sharedMaps[LCML_SHARED_MAPS];
 #undef LOG_TAG
 #define LOG_TAG "TI_LCML"
 
@@ -118,8 +184,57 @@ static OMX_ERRORTYPE DmmUnMap(DSP_HPROCESSOR ProcHandle,
                               struct OMX_TI_Debug dbg);
 static OMX_ERRORTYPE DeleteDspResource(LCML_DSP_INTERFACE *hInterface);
 static OMX_ERRORTYPE FreeResources(LCML_DSP_INTERFACE *hInterface);
+static OMX_ERRORTYPE CreateCommPool(LCML_DSP_INTERFACE *hInterface);
+static void DestroyCommPool(LCML_DSP_INTERFACE *hInterface);
+static void InitUndo(LCML_DSP_INTERFACE *hInterface);
+static OMX_ERRORTYPE RegisterStateNotify(LCML_DSP_INTERFACE *hInterface);
+static OMX_BOOL NodeRunning(LCML_DSP_INTERFACE *hInterface);
+static DSP_STATUS TerminateNode(LCML_DSP_INTERFACE *hInterface);
+static OMX_S32 FindFreeSlot(TArmDspCommunicationStruct *storage[], OMX_U32 start);
+static OMX_BOOL SlotPending(LCML_DSP_INTERFACE *hInterface, TArmDspCommunicationStruct *pComm);
+static void MapCacheInit(LCML_MAP_CACHE *pCache);
+static void MapCacheUnlink(LCML_MAP_CACHE *pCache, OMX_S32 index);
+static OMX_BOOL MapCacheInFlight(LCML_DSP_INTERFACE *hInterface, LCML_MAP_CACHE_ENTRY *pEntry);
+static LCML_MAP_CACHE_ENTRY *MapCacheFind(LCML_MAP_CACHE *pCache, void *pArmPtr, OMX_U32 nLength);
+static LCML_MAP_CACHE_ENTRY *MapCacheLookup(LCML_MAP_CACHE *pCache, void *pArmPtr, OMX_U32 nLength);
+static OMX_ERRORTYPE MapCacheInsert(LCML_DSP_INTERFACE *hInterface, OMX_U32 nLength, DMM_BUFFER_OBJ *pDmmBuf,
+                                    DMM_BUFFER_OBJ *pEvicted);
+static void MapCacheFlush(LCML_DSP_INTERFACE *hInterface);
+static OMX_ERRORTYPE SharedMapAcquire(LCML_DSP_INTERFACE *hInterface, OMX_U32 nLength, void *pArmPtr,
+                                      DMM_BUFFER_OBJ *pDmmBuf, OMX_BOOL *pbReused);
+static void SharedMapRelease(LCML_DSP_INTERFACE *hInterface, DMM_BUFFER_OBJ *pDmmBuf);
+static void SharedMapPurge(LCML_DSP_INTERFACE *hInterface, void *pArmPtr, OMX_U32 nLength);
+static OMX_BOOL CacheMaintenanceNeeded(LCML_DSP_INTERFACE *hInterface, LCML_MAP_CACHE_ENTRY *pEntry, OMX_U32 nAccessMask);
+static TLcmlCachePolicy DefaultCachePolicy(void);
+static OMX_U32 LatencyNow(void);
+static void LatencyQueued(LCML_DSP_INTERFACE *hInterface, OMX_U32 streamId, OMX_U32 slot);
+static void LatencyReturned(LCML_DSP_INTERFACE *hInterface, OMX_U32 streamId, OMX_U32 slot);
+static void LatencyGetStats(LCML_DSP_INTERFACE *hInterface, OMX_U32 streamId, LCML_LATENCY_STATS *pStats);
+static void LatencyReport(LCML_DSP_INTERFACE *hInterface, OMX_BOOL bMessagingThread);
 
 void* MessagingThread(void *arg);
+static void ProcessNodeEvents(void *arg, unsigned int index);
+static OMX_ERRORTYPE DispatchRegister(LCML_DSP_INTERFACE *hInterface, OMX_BOOL *pbBootstrap);
+static OMX_ERRORTYPE DispatchNotifyRegister(LCML_DSP_INTERFACE *hInterface);
+static void DispatchNotifyRelease(LCML_DSP_INTERFACE *hInterface);
+static void DispatchDrop(LCML_DSP_INTERFACE *hInterface);
+static OMX_BOOL DispatchAdopted(LCML_DSP_INTERFACE *hInterface);
+static void DispatchUnregister(LCML_DSP_INTERFACE *hInterface);
+static void* DispatchThread(void *arg);
+static DSP_STATUS BridgeAttach(LCML_DSP_INTERFACE *hInterface);
+static void BridgeDetach(LCML_DSP_INTERFACE *hInterface);
+static void BridgeMarkStale(void);
+static DSP_STATUS RegisterNodeObjects(LCML_DSP_INTERFACE *hInterface);
+static void UnregisterNodeObjects(LCML_DSP_INTERFACE *hInterface);
+static void SetupPhaseDone(LCML_DSP_INTERFACE *hInterface, OMX_U32 nPhase, OMX_U32 tStart, OMX_U32 *ptPhase);
+static OMX_BOOL NodePoolTake(LCML_DSP_INTERFACE *hInterface, LCML_CREATEPHASEARGS *pCrData, struct DSP_NODEATTRIN *pAttrIn);
+static void NodePoolStarted(LCML_DSP_INTERFACE *hInterface, LCML_CREATEPHASEARGS *pCrData, struct DSP_NODEATTRIN *pAttrIn,
+                            OMX_BOOL bHit, OMX_U32 tStart);
+static void NodePoolFlush(void);
+static void ArenaCreate(DSP_HPROCESSOR hProc);
+static void ArenaDestroy(void);
+static void *ArenaAlloc(DSP_HPROCESSOR hProc, OMX_U32 nSize);
+static OMX_BOOL ArenaFree(DSP_HPROCESSOR hProc, void *pAddr);
 
 static int append_dsp_path(char * dll64p_name, char *absDLLname);
 
@@ -174,6 +289,10 @@ OMX_ERRORTYPE GetHandle(OMX_HANDLETYPE *hInterface )
     memset(pHandle->dspCodec, 0, sizeof(LCML_DSP));
 
     pthread_mutex_init (&pHandle->mutex, NULL);
+    pthread_mutex_init (&pHandle->queueMutex[0], NULL);
+    pthread_mutex_init (&pHandle->queueMutex[1], NULL);
+    pthread_mutex_init (&pHandle->eventMutex, NULL);
+    pthread_cond_init (&pHandle->releaseCond, NULL);
     dspcodecinterface->pCodec = *hInterface;
     OMX_PRINT2 (dspcodecinterface->dbg, "GetHandle application handle %p dspCodec %p",pHandle, pHandle->dspCodec);
 
@@ -208,7 +327,7 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
 {
 
     OMX_ERRORTYPE eError = OMX_ErrorNone;
-    OMX_U32 dllinfo;
+    LCML_DSP_INTERFACE * phandle = NULL;
 
     OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: InitMMCodecEx application\n", __LINE__);
 
@@ -223,18 +342,19 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
     }
     else
     {
-        LCML_DSP_INTERFACE * phandle;
         LCML_CREATEPHASEARGS crData;
         DSP_STATUS status;
-        int i = 0, k = 0;
+        int i = 0;
         struct DSP_NODEATTRIN NodeAttrIn;
         struct DSP_CBDATA     *pArgs;
         BYTE  argsBuf[32 + sizeof(ULONG)];
-        char abs_dsp_path[ABS_DLL_NAME_LENGTH];
+        OMX_U32 tSetup, tPhase;
+        OMX_BOOL bPoolHit;
+        OMX_BOOL bBootstrap;
 #ifndef CEXEC_DONE
         UINT argc = 1;
         char argv[ABS_DLL_NAME_LENGTH];
-        k = append_dsp_path(DSP_DOF_IMAGE, argv);
+        int k = append_dsp_path(DSP_DOF_IMAGE, argv);
         if (k < 0)
         {
             OMX_PRDSP4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: append_dsp_path returned an error!\n", __LINE__);
@@ -258,7 +378,8 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
         /* 720p implementation */
         {
             pthread_mutex_init(&phandle->m_isStopped_mutex, NULL);
-            phandle->mapped_buffer_count = 0;
+            MapCacheInit(&phandle->mapCache);
+            phandle->eCachePolicy = DefaultCachePolicy();
         }
         /* INIT DSP RESOURCE */
         if(pCallbacks)
@@ -271,33 +392,18 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
 
         /* INITIALIZATION OF DSP */
         OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: Entering Init_DSPSubSystem\n", __LINE__);
-        status = DspManager_Open(0, NULL);
-        DSP_ERROR_EXIT(status, "DSP Manager Open", ERROR);
-        OMX_PRDSP1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "DspManager_Open Successful\n");
+        tSetup = tPhase = LatencyNow();
 
         /* Attach and get handle to processor */
-        status = DSPProcessor_Attach(TI_PROCESSOR_DSP, NULL, &(phandle->dspCodec->hProc));
+        status = BridgeAttach(phandle);
         DSP_ERROR_EXIT(status, "Attach processor", ERROR);
         OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "DSPProcessor_Attach Successful\n");
         OMX_PRDSP1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Base Image is Already Loaded\n");
+        SetupPhaseDone(phandle, LCML_SETUP_ATTACH, tSetup, &tPhase);
 
-        for (dllinfo=0; dllinfo < phandle->dspCodec->NodeInfo.nNumOfDLLs; dllinfo++)
-        {
-            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: Register Component Node\n",phandle->dspCodec->NodeInfo.AllUUIDs[dllinfo].eDllType);
-
-            k = append_dsp_path((char*)phandle->dspCodec->NodeInfo.AllUUIDs[dllinfo].DllName, abs_dsp_path);
-            if (k < 0)
-            {
-                OMX_PRDSP4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: append_dsp_path returned an error!\n", __LINE__);
-                eError = OMX_ErrorBadParameter;
-                goto ERROR;
-            }
-
-            status = DSPManager_RegisterObject((struct DSP_UUID *)phandle->dspCodec->NodeInfo.AllUUIDs[dllinfo].uuid,
-                                                phandle->dspCodec->NodeInfo.AllUUIDs[dllinfo].eDllType, abs_dsp_path);
-
-            DSP_ERROR_EXIT (status, "Register Component Library", ERROR);
-        }
+        status = RegisterNodeObjects(phandle);
+        DSP_ERROR_EXIT (status, "Register Component Library", ERROR);
+        SetupPhaseDone(phandle, LCML_SETUP_REGISTER, tSetup, &tPhase);
 
         /* NODE specific data */
         NodeAttrIn.cbStruct = sizeof(struct DSP_NODEATTRIN);
@@ -339,12 +445,16 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
         crData.cbData = i*2;
         OMX_PRINT2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Create Phase args  strlen = %ld\n", crData.cbData);
 
-        status = DSPNode_Allocate(phandle->dspCodec->hProc,
-                                  (struct DSP_UUID *)phandle->dspCodec->NodeInfo.AllUUIDs[0].uuid,
-                                  (struct DSP_CBDATA*)&crData,
-                                  &NodeAttrIn,&(phandle->dspCodec->hNode));
-        DSP_ERROR_EXIT(status, "Allocate Component", ERROR);
-        OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: DSPNode_Allocate Successfully\n", __LINE__);
+        bPoolHit = NodePoolTake(phandle, &crData, &NodeAttrIn);
+        if (!bPoolHit)
+        {
+            status = DSPNode_Allocate(phandle->dspCodec->hProc,
+                                      (struct DSP_UUID *)phandle->dspCodec->NodeInfo.AllUUIDs[0].uuid,
+                                      (struct DSP_CBDATA*)&crData,
+                                      &NodeAttrIn,&(phandle->dspCodec->hNode));
+            DSP_ERROR_EXIT(status, "Allocate Component", ERROR);
+            OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: DSPNode_Allocate Successfully\n", __LINE__);
+        }
 
         pArgs = (struct DSP_CBDATA *)argsBuf;
         strcpy((char*)pArgs->cData, Args);
@@ -400,13 +510,19 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
             }
         }
 
-        status = DSPNode_Create(phandle->dspCodec->hNode);
-        DSP_ERROR_EXIT(status, "Create the Node", ERROR);
-        OMX_PRDSP1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: After DSPNode_Create !!! \n", __LINE__);
+        SetupPhaseDone(phandle, LCML_SETUP_ALLOCATE, tSetup, &tPhase);
+        if (!bPoolHit)
+        {
+            status = DSPNode_Create(phandle->dspCodec->hNode);
+            DSP_ERROR_EXIT(status, "Create the Node", ERROR);
+            OMX_PRDSP1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: After DSPNode_Create !!! \n", __LINE__);
+        }
+        SetupPhaseDone(phandle, LCML_SETUP_CREATE, tSetup, &tPhase);
 
         status = DSPNode_Run(phandle->dspCodec->hNode);
         DSP_ERROR_EXIT (status, "Goto RUN mode", ERROR);
         OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: DSPNode_Run Successfully\n", __LINE__);
+        SetupPhaseDone(phandle, LCML_SETUP_RUN, tSetup, &tPhase);
 
         if ((phandle->dspCodec->In_BufInfo.DataTrMethod == DMM_METHOD) || (phandle->dspCodec->Out_BufInfo.DataTrMethod == DMM_METHOD))
         {
@@ -417,6 +533,7 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
             if(notification == NULL)
             {
                 OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: malloc failed....\n",__LINE__);
+                eError = OMX_ErrorInsufficientResources;
                 goto ERROR;
             }
             memset(notification, 0, sizeof(struct DSP_NOTIFICATION));
@@ -433,6 +550,7 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
             if(notification_mmufault == NULL)
             {
                 OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: malloc failed....\n",__LINE__);
+                eError = OMX_ErrorInsufficientResources;
                 goto ERROR;
             }
             memset(notification_mmufault,0,sizeof(struct DSP_NOTIFICATION));
@@ -449,6 +567,7 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
             if(notification_syserror == NULL)
             {
                 OMX_ERROR4  (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: malloc failed....\n",__LINE__);
+                eError = OMX_ErrorInsufficientResources;
                 goto ERROR;
             }
             memset(notification_syserror,0,sizeof(struct DSP_NOTIFICATION));
@@ -459,27 +578,48 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
 #endif
         }
 
+        eError = CreateCommPool(phandle);
+        if (eError != OMX_ErrorNone)
+        {
+            goto ERROR;
+        }
+
+        eError = RegisterStateNotify(phandle);
+        if (eError != OMX_ErrorNone)
+        {
+            goto ERROR;
+        }
+
         /* Listener thread */
         phandle->pshutdownFlag = 0;
         phandle->g_tidMessageThread = 0;
         phandle->bUsnEos = OMX_FALSE;
-        tmperr = pthread_create(&phandle->g_tidMessageThread,
-                                NULL,
-                                MessagingThread,
-                                (void*)phandle);
-
-        if (tmperr || !phandle->g_tidMessageThread)
+        if (DispatchRegister(phandle, &bBootstrap) == OMX_ErrorNone && !bBootstrap)
         {
-            OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Thread creation failed: 0x%x",tmperr);
-            eError = OMX_ErrorInsufficientResources;
-            goto ERROR;
+            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Node served by the shared dispatcher\n");
         }
+        else
+        {
+            /* a private thread, or one that serves the node until its
+             * dispatcher thread next wakes and takes it over */
+            tmperr = pthread_create(&phandle->g_tidMessageThread,
+                                    NULL,
+                                    MessagingThread,
+                                    (void*)phandle);
+
+            if (tmperr || !phandle->g_tidMessageThread)
+            {
+                OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Thread creation failed: 0x%x",tmperr);
+                eError = OMX_ErrorInsufficientResources;
+                goto ERROR;
+            }
 
 #ifdef __PERF_INSTRUMENTATION__
-        PERF_ThreadCreated(phandle->pPERF,
-                           phandle->g_tidMessageThread,
-                           PERF_FOURCC('C','M','L','T'));
+            PERF_ThreadCreated(phandle->pPERF,
+                               phandle->g_tidMessageThread,
+                               PERF_FOURCC('C','M','L','T'));
 #endif
+        }
         /* init buffers buffer counter */
         phandle->iBufinputcount = 0;
         phandle->iBufoutputcount = 0;
@@ -493,6 +633,8 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
             phandle->algcntlmapped[i] = 0;
             phandle->strmcntlmapped[i] = 0;
         }
+        SetupPhaseDone(phandle, LCML_SETUP_MESSAGING, tSetup, &tPhase);
+        NodePoolStarted(phandle, &crData, &NodeAttrIn, bPoolHit, tSetup);
 #ifdef __PERF_INSTRUMENTATION__
         PERF_Boundary(phandle->pPERF,
                       PERF_BoundaryComplete | PERF_BoundarySetup);
@@ -500,6 +642,10 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
     }
 
 ERROR:
+    if (eError != OMX_ErrorNone && phandle != NULL)
+    {
+        InitUndo(phandle);
+    }
 #ifndef CEXEC_DONE
     LCML_FREE(argv);
 #endif
@@ -528,12 +674,11 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
                                  LCML_CALLBACKTYPE *pCallbacks)
 {
     OMX_ERRORTYPE eError = OMX_ErrorNone;
-    OMX_U32 dllinfo;
-    LCML_DSP_INTERFACE * phandle;
+    LCML_DSP_INTERFACE * phandle = NULL;
 #ifndef CEXEC_DONE
     UINT argc = 1;
     char argv[ABS_DLL_NAME_LENGTH];
-    k = append_dsp_path(DSP_DOF_IMAGE, argv);
+    int k = append_dsp_path(DSP_DOF_IMAGE, argv);
     if (k < 0)
     {
         OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: append_dsp_path returned an error!\n", __LINE__);
@@ -543,10 +688,12 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
 #endif
     LCML_CREATEPHASEARGS crData;
     DSP_STATUS status;
-    int i = 0, k =0;
+    int i = 0;
     struct DSP_NODEATTRIN NodeAttrIn;
     int tmperr;
-    char abs_dsp_path[ABS_DLL_NAME_LENGTH];
+    OMX_U32 tSetup, tPhase;
+    OMX_BOOL bPoolHit;
+    OMX_BOOL bBootstrap;
 
     OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: InitMMCodec application\n",__LINE__);
 
@@ -570,7 +717,8 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
     /* 720p implementation */
     {
         pthread_mutex_init(&phandle->m_isStopped_mutex, NULL);
-        phandle->mapped_buffer_count = 0;
+        MapCacheInit(&phandle->mapCache);
+        phandle->eCachePolicy = DefaultCachePolicy();
     }
 
     /* INIT DSP RESOURCE */
@@ -586,34 +734,18 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
 
     /* INITIALIZATION OF DSP */
     OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: Entering Init_DSPSubSystem\n", __LINE__);
-    status = DspManager_Open(0, NULL);
-    DSP_ERROR_EXIT(status, "DSP Manager Open", ERROR);
-    OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "DspManager_Open Successful\n");
+    tSetup = tPhase = LatencyNow();
 
     /* Attach and get handle to processor */
-    status = DSPProcessor_Attach(TI_PROCESSOR_DSP, NULL, &(phandle->dspCodec->hProc));
+    status = BridgeAttach(phandle);
     DSP_ERROR_EXIT(status, "Attach processor", ERROR);
     OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "DSPProcessor_Attach Successful\n");
     OMX_PRDSP1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Base Image is Already Loaded\n");
+    SetupPhaseDone(phandle, LCML_SETUP_ATTACH, tSetup, &tPhase);
 
-    for(dllinfo=0; dllinfo < phandle->dspCodec->NodeInfo.nNumOfDLLs; dllinfo++)
-    {
-        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: Register Component Node\n",phandle->dspCodec->NodeInfo.AllUUIDs[dllinfo].eDllType);
-
-        k = append_dsp_path((char*)phandle->dspCodec->NodeInfo.AllUUIDs[dllinfo].DllName, abs_dsp_path);
-        if (k < 0)
-        {
-            OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: append_dsp_path returned an error!\n", __LINE__);
-            eError = OMX_ErrorBadParameter;
-            goto ERROR;
-        }
-
-        status = DSPManager_RegisterObject((struct DSP_UUID *)phandle->dspCodec->NodeInfo.AllUUIDs[dllinfo].uuid,
-                                               phandle->dspCodec->NodeInfo.AllUUIDs[dllinfo].eDllType,
-                                               abs_dsp_path);
-
-        DSP_ERROR_EXIT (status, "Register Component Library", ERROR)
-    }
+    status = RegisterNodeObjects(phandle);
+    DSP_ERROR_EXIT (status, "Register Component Library", ERROR);
+    SetupPhaseDone(phandle, LCML_SETUP_REGISTER, tSetup, &tPhase);
 
     /* NODE specific data */
 
@@ -657,12 +789,16 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
     crData.cbData = i * 2;
     OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Create Phase args  strlen = %ld\n", crData.cbData);
 
-    status = DSPNode_Allocate(phandle->dspCodec->hProc,
-                             (struct DSP_UUID *)phandle->dspCodec->NodeInfo.AllUUIDs[0].uuid,
-                             (struct DSP_CBDATA*)&crData, &NodeAttrIn,
-                             &(phandle->dspCodec->hNode));
-    DSP_ERROR_EXIT(status, "Allocate Component", ERROR);
-    OMX_PRDSP1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: DSPNode_Allocate Successfully\n", __LINE__);
+    bPoolHit = NodePoolTake(phandle, &crData, &NodeAttrIn);
+    if (!bPoolHit)
+    {
+        status = DSPNode_Allocate(phandle->dspCodec->hProc,
+                                 (struct DSP_UUID *)phandle->dspCodec->NodeInfo.AllUUIDs[0].uuid,
+                                 (struct DSP_CBDATA*)&crData, &NodeAttrIn,
+                                 &(phandle->dspCodec->hNode));
+        DSP_ERROR_EXIT(status, "Allocate Component", ERROR);
+        OMX_PRDSP1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: DSPNode_Allocate Successfully\n", __LINE__);
+    }
 
     if(phandle->dspCodec->DeviceInfo.TypeofDevice == 1)
     {
@@ -708,13 +844,19 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
         }
     }
 
-    status = DSPNode_Create(phandle->dspCodec->hNode);
-    DSP_ERROR_EXIT(status, "Create the Node", ERROR);
-    OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: After DSPNode_Create !!! \n", __LINE__);
+    SetupPhaseDone(phandle, LCML_SETUP_ALLOCATE, tSetup, &tPhase);
+    if (!bPoolHit)
+    {
+        status = DSPNode_Create(phandle->dspCodec->hNode);
+        DSP_ERROR_EXIT(status, "Create the Node", ERROR);
+        OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: After DSPNode_Create !!! \n", __LINE__);
+    }
+    SetupPhaseDone(phandle, LCML_SETUP_CREATE, tSetup, &tPhase);
 
     status = DSPNode_Run (phandle->dspCodec->hNode);
     DSP_ERROR_EXIT (status, "Goto RUN mode", ERROR);
     OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: DSPNode_Run Successfully\n", __LINE__);
+    SetupPhaseDone(phandle, LCML_SETUP_RUN, tSetup, &tPhase);
 
     if ((phandle->dspCodec->In_BufInfo.DataTrMethod == DMM_METHOD) ||
         (phandle->dspCodec->Out_BufInfo.DataTrMethod == DMM_METHOD))
@@ -726,6 +868,7 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
         if(notification == NULL)
         {
             OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: malloc failed....\n",__LINE__);
+            eError = OMX_ErrorInsufficientResources;
             goto ERROR;
         }
         memset(notification,0,sizeof(struct DSP_NOTIFICATION));
@@ -742,6 +885,7 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
         if(notification_mmufault == NULL)
         {
             OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: malloc failed....\n",__LINE__);
+            eError = OMX_ErrorInsufficientResources;
             goto ERROR;
         }
         memset(notification_mmufault,0,sizeof(struct DSP_NOTIFICATION));
@@ -758,6 +902,7 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
         if(notification_syserror == NULL)
         {
             OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "%d :: malloc failed....\n",__LINE__);
+            eError = OMX_ErrorInsufficientResources;
             goto ERROR;
         }
         memset(notification_syserror,0,sizeof(struct DSP_NOTIFICATION));
@@ -768,27 +913,48 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
 #endif
     }
 
+    eError = CreateCommPool(phandle);
+    if (eError != OMX_ErrorNone)
+    {
+        goto ERROR;
+    }
+
+    eError = RegisterStateNotify(phandle);
+    if (eError != OMX_ErrorNone)
+    {
+        goto ERROR;
+    }
+
     /* Listener thread */
     phandle->pshutdownFlag = 0;
     phandle->g_tidMessageThread = 0;
 
-    tmperr = pthread_create(&phandle->g_tidMessageThread,
-                            NULL,
-                            MessagingThread,
-                            (void*)phandle);
-
-    if(tmperr || !phandle->g_tidMessageThread)
+    if (DispatchRegister(phandle, &bBootstrap) == OMX_ErrorNone && !bBootstrap)
     {
-        OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Thread creation failed: 0x%x",tmperr);
-        eError = OMX_ErrorInsufficientResources;
-        goto ERROR;
+        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Node served by the shared dispatcher\n");
     }
+    else
+    {
+        /* a private thread, or one that serves the node until its
+         * dispatcher thread next wakes and takes it over */
+        tmperr = pthread_create(&phandle->g_tidMessageThread,
+                                NULL,
+                                MessagingThread,
+                                (void*)phandle);
+
+        if(tmperr || !phandle->g_tidMessageThread)
+        {
+            OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInt)->dbg, "Thread creation failed: 0x%x",tmperr);
+            eError = OMX_ErrorInsufficientResources;
+            goto ERROR;
+        }
 
 #ifdef __PERF_INSTRUMENTATION__
-    PERF_ThreadCreated(phandle->pPERF,
-                       phandle->g_tidMessageThread,
-                       PERF_FOURCC('C','M','L','T'));
+        PERF_ThreadCreated(phandle->pPERF,
+                           phandle->g_tidMessageThread,
+                           PERF_FOURCC('C','M','L','T'));
 #endif
+    }
     /* init buffers buffer counter */
     phandle->iBufinputcount =0;
     phandle->iBufoutputcount =0;
@@ -802,6 +968,8 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
         phandle->algcntlmapped[i] = 0;
         phandle->strmcntlmapped[i] = 0;
     }
+    SetupPhaseDone(phandle, LCML_SETUP_MESSAGING, tSetup, &tPhase);
+    NodePoolStarted(phandle, &crData, &NodeAttrIn, bPoolHit, tSetup);
 
 #ifdef __PERF_INSTRUMENTATION__
     PERF_Boundary(phandle->pPERF,
@@ -809,6 +977,10 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
 #endif
 
 ERROR:
+    if (eError != OMX_ErrorNone && phandle != NULL)
+    {
+        InitUndo(phandle);
+    }
 #ifndef CEXEC_DONE
     LCML_FREE(argv);
 #endif
@@ -865,12 +1037,24 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
     OMX_U32 streamId = 0;
     DSP_STATUS status;
     OMX_ERRORTYPE eError = OMX_ErrorNone;
-    char * tmp2=NULL;
+    OMX_S32 slot = -1;
+    OMX_U32 commOffset = 0;
     DMM_BUFFER_OBJ* pDmmBuf=NULL;
+    TArmDspCommunicationStruct *pComm;
+    LCML_MAP_CACHE_ENTRY *pEntry = NULL;
+    DMM_BUFFER_OBJ evictedBuf;
+    OMX_BOOL bInput;
+    OMX_BOOL bReUseMap = OMX_FALSE;
+    OMX_BOOL bTunnel = OMX_FALSE;
+    OMX_BOOL bReused = OMX_FALSE;
+    OMX_BOOL bMaintenance = OMX_FALSE;
+    pthread_mutex_t *pQueueMutex;
     int commandId;
     struct DSP_MSG msg;
     OMX_U32 MapBufLen=0;
-    OMX_BOOL mappedBufferFound = false;
+    /* buffer and comm struct maintenance, submitted in one bridge call */
+    struct DSP_CACHEOP cacheOps[2];
+    UINT nCacheOps = 0;
 
     OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "%d :: QueueBuffer application\n",__LINE__);
 
@@ -891,36 +1075,12 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
                        PERF_ModuleComponent,
                        PERF_ModuleSocketNode);
 #endif
-    pthread_mutex_lock(&phandle->mutex);
-    LCML_MALLOC(tmp2,sizeof(TArmDspCommunicationStruct) + 256,char);
-    if (tmp2 == NULL)
+    /* tunneled buffers go through the map cache in every mode */
+    if (bufType & LCML_BUFFER_TUNNEL)
     {
-            eError = OMX_ErrorInsufficientResources;
-            goto MUTEX_UNLOCK;
-    }
-    memset(tmp2,0,sizeof(TArmDspCommunicationStruct)+256);
-    phandle->commStruct = (TArmDspCommunicationStruct *)(tmp2 + 128);
-    phandle->commStruct->iBufferPtr = (OMX_U32) buffer;
-    phandle->commStruct->iBufferSize = bufferLen;
-    phandle->commStruct->iParamPtr = (OMX_U32) auxInfo;
-    phandle->commStruct->iParamSize = auxInfoLen;
-    /*USN updation */
-    phandle->commStruct->iBufSizeUsed =  bufferSizeUsed ;
-    phandle->commStruct->iArmArg = (OMX_U32) buffer;
-    phandle->commStruct->iArmParamArg = (OMX_U32) auxInfo;
-
-    /* if the bUsnEos flag is set interpret the usrArg as a buffer header */
-    if (phandle->bUsnEos == OMX_TRUE) {
-        phandle->commStruct->iEOSFlag = (((OMX_BUFFERHEADERTYPE*)usrArg)->nFlags & 0x00000001);
+        bufType = (TMMCodecBufferType)(bufType & ~LCML_BUFFER_TUNNEL);
+        bTunnel = OMX_TRUE;
     }
-    else {
-        phandle->commStruct->iEOSFlag = 0;
-    }
-    phandle->commStruct->iUsrArg = (OMX_U32) usrArg;
-    phandle->iBufoutputcount = phandle->iBufoutputcount % QUEUE_SIZE;
-    phandle->iBufinputcount = phandle->iBufinputcount % QUEUE_SIZE;
-    phandle->commStruct->Bufoutindex = phandle->iBufoutputcount;
-    phandle->commStruct->BufInindex = phandle->iBufinputcount;
     switch (bufType)
     {
         case EMMCodecInputBufferMapBufLen:
@@ -933,11 +1093,11 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
             break;
         case EMMCodecInputBufferMapReuse:
             bufType = EMMCodecInputBuffer;
-            phandle->ReUseMap = 1;
+            bReUseMap = OMX_TRUE;
             break;
         case EMMCodecOutputBufferMapReuse:
             bufType = EMMCodecOuputBuffer;
-            phandle->ReUseMap = 1;
+            bReUseMap = OMX_TRUE;
             break;
         default:
             break;
@@ -947,12 +1107,80 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
     {
         streamId = bufType - EMMCodecStream0;
     }
+    bInput = (bufType == EMMCodecInputBuffer || !(streamId % 2)) ? OMX_TRUE : OMX_FALSE;
+
+    /* Buffers of one direction are queued in order under the direction lock.
+     * phandle->mutex, which the messaging thread needs to return buffers, is
+     * only held while the slots and the map cache are updated and never
+     * across a mapping, cache operation or message to the node. */
+    pQueueMutex = &phandle->queueMutex[bInput ? 0 : 1];
+    pthread_mutex_lock(pQueueMutex);
+    pthread_mutex_lock(&phandle->mutex);
+    if (bReUseMap)
+    {
+        phandle->ReUseMap = 1;
+    }
+
+    /* take the comm struct of the next free queue slot from the pool; a slot
+     * still held by the DSP is skipped rather than overwritten */
+    phandle->iBufoutputcount = phandle->iBufoutputcount % QUEUE_SIZE;
+    phandle->iBufinputcount = phandle->iBufinputcount % QUEUE_SIZE;
+    if (bInput)
+    {
+        slot = FindFreeSlot(phandle->Arminputstorage, phandle->iBufinputcount);
+    }
+    else
+    {
+        slot = FindFreeSlot(phandle->Armoutputstorage, phandle->iBufoutputcount);
+    }
+    if (slot < 0 || phandle->pCommPool == NULL)
+    {
+        pthread_mutex_unlock(&phandle->mutex);
+        OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "No free comm struct for stream %lu\n", streamId);
+        eError = OMX_ErrorInsufficientResources;
+        goto QUEUE_UNLOCK;
+    }
+    if (bInput)
+    {
+        phandle->iBufinputcount = slot;
+        commOffset = slot * LCML_COMM_SLOT_SIZE;
+    }
+    else
+    {
+        phandle->iBufoutputcount = slot;
+        commOffset = (QUEUE_SIZE + slot) * LCML_COMM_SLOT_SIZE;
+    }
+
+    pComm = (TArmDspCommunicationStruct *)(phandle->pCommPool + commOffset);
+    memset(pComm, 0, sizeof(TArmDspCommunicationStruct));
+    pComm->iBufferPtr = (OMX_U32) buffer;
+    pComm->iBufferSize = bufferLen;
+    pComm->iParamPtr = (OMX_U32) auxInfo;
+    pComm->iParamSize = auxInfoLen;
+    /*USN updation */
+    pComm->iBufSizeUsed =  bufferSizeUsed ;
+    pComm->iArmArg = (OMX_U32) buffer;
+    pComm->iArmParamArg = (OMX_U32) auxInfo;
+    /* set before the slot is published so the map cache never evicts the
+     * mapping of a buffer being queued */
+    pComm->iArmbufferArg = (OMX_U32)buffer;
 
-	phandle->commStruct->iStreamID = streamId;
+    /* if the bUsnEos flag is set interpret the usrArg as a buffer header */
+    if (phandle->bUsnEos == OMX_TRUE) {
+        pComm->iEOSFlag = (((OMX_BUFFERHEADERTYPE*)usrArg)->nFlags & 0x00000001);
+    }
+    else {
+        pComm->iEOSFlag = 0;
+    }
+    pComm->iUsrArg = (OMX_U32) usrArg;
+    pComm->Bufoutindex = phandle->iBufoutputcount;
+    pComm->BufInindex = phandle->iBufinputcount;
+	pComm->iStreamID = streamId;
 
-    if (bufType == EMMCodecInputBuffer || !(streamId % 2))
+    if (bInput)
     {
-        phandle->Arminputstorage[phandle->iBufinputcount] = phandle->commStruct;
+        phandle->Arminputstorage[phandle->iBufinputcount] = pComm;
+        phandle->pQueuePending[0] = pComm;
         pDmmBuf = phandle->dspCodec->InDmmBuffer;
         pDmmBuf = pDmmBuf + phandle->iBufinputcount;
         phandle->iBufinputcount++;
@@ -960,118 +1188,148 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
         OMX_PRBUFFER1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "VPP port %lu use InDmmBuffer (%lu) %p\n", streamId, phandle->iBufinputcount, pDmmBuf);
 
     }
-    else if (bufType == EMMCodecOuputBuffer || streamId % 2)
+    else
     {
-        phandle->Armoutputstorage[phandle->iBufoutputcount] = phandle->commStruct;
+        phandle->Armoutputstorage[phandle->iBufoutputcount] = pComm;
+        phandle->pQueuePending[1] = pComm;
         pDmmBuf = phandle->dspCodec->OutDmmBuffer;
         pDmmBuf = pDmmBuf + phandle->iBufoutputcount;
         phandle->iBufoutputcount++;
         phandle->iBufoutputcount = phandle->iBufoutputcount % QUEUE_SIZE;
     }
-    else
+    bReUseMap = (phandle->ReUseMap || bTunnel) ? OMX_TRUE : OMX_FALSE;
+    if (pDmmBuf != NULL)
     {
-        OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Unrecognized buffer type..");
-        eError = OMX_ErrorBadParameter;
-        if(tmp2)
+        pDmmBuf->bCached = bReUseMap;
+    }
+    if (bReUseMap && buffer != NULL && bufferLen != 0 && pDmmBuf != NULL)
+    {
+        pEntry = MapCacheLookup(&phandle->mapCache, buffer, bufferLen);
+        if (pEntry != NULL)
         {
-            free(tmp2);
-            phandle->commStruct = NULL;
+            *pDmmBuf = pEntry->dmmBuf;
+            /* nCpuAccess is what the component reported with
+             * EMMCodecControlBufferAccess, or the assumption made when the
+             * buffer was last queued: none for a tunneled buffer */
+            if (bufType == EMMCodecInputBuffer)
+            {
+                bMaintenance = CacheMaintenanceNeeded(phandle, pEntry, LCML_CPU_ACCESS_WRITE);
+            }
+            else if (bufType == EMMCodecOuputBuffer)
+            {
+                bMaintenance = CacheMaintenanceNeeded(phandle, pEntry, LCML_CPU_ACCESS_READ | LCML_CPU_ACCESS_WRITE);
+            }
+            /* until told otherwise assume the CPU touches it once it is back */
+            pEntry->nCpuAccess = bTunnel ? LCML_CPU_ACCESS_NONE : (LCML_CPU_ACCESS_READ | LCML_CPU_ACCESS_WRITE);
         }
-        goto MUTEX_UNLOCK;
     }
+    pthread_mutex_unlock(&phandle->mutex);
+
     commandId = USN_GPPMSG_SET_BUFF|streamId;
     OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Sending command ID 0x%x",commandId);
     if( pDmmBuf == NULL)
     {
         eError = OMX_ErrorInsufficientResources;
-        goto MUTEX_UNLOCK;
+        goto RELEASE_SLOT;
     }
     OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "buffer = 0x%p bufferlen = %ld auxInfo = 0x%p auxInfoLen %ld\n",
         buffer, bufferLen, auxInfo, auxInfoLen );
 
-    phandle->commStruct->iArmbufferArg = (OMX_U32)buffer;
     if ((buffer != NULL) && (bufferLen != 0))
     {
-        OMX_U32 i;
-        DSP_STATUS status;
-
-        if (phandle->ReUseMap)
+        if (bReUseMap)
         {
-            mappedBufferFound = false;
-            for(i = 0; i <= phandle->mapped_buffer_count; i++)
+            if (pEntry != NULL)
+            {
+                OMX_PRBUFFER1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Re-using pDmmBuf %p mapped %p\n", pDmmBuf, pDmmBuf->pMapped);
+            }
+            else
             {
-                if(phandle->mapped_dmm_buffers[i].pAllocated == buffer)
+                if (bInput)
+                {
+                    pComm->iBufferSize = bufferSizeUsed ? bufferSizeUsed : bufferLen;
+                }
+                /* mapped here, or by another instance that queued it before */
+                eError = SharedMapAcquire(phandle, bufferLen, buffer, pDmmBuf, &bReused);
+                if (eError != OMX_ErrorNone)
                 {
-                    mappedBufferFound = true;
-                    *pDmmBuf = phandle->mapped_dmm_buffers[i];
-                     OMX_PRBUFFER1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Re-using pDmmBuf %p mapped %p\n", pDmmBuf, pDmmBuf->pMapped);
+                    goto RELEASE_SLOT;
+                }
+                pDmmBuf->bCached = 1;
 
-                    if(bufType == EMMCodecInputBuffer)
+                pthread_mutex_lock(&phandle->mutex);
+                eError = MapCacheInsert(phandle, bufferLen, pDmmBuf, &evictedBuf);
+                if (eError == OMX_ErrorNone)
+                {
+                    pEntry = MapCacheFind(&phandle->mapCache, buffer, bufferLen);
+                    if (bReused)
                     {
-                        /* Issue a memory flush for input buffer to ensure cache coherency */
-                        status = DSPProcessor_FlushMemory(phandle->dspCodec->hProc, pDmmBuf->pAllocated, bufferSizeUsed, (bufferSizeUsed > 512*1024) ? 3: 0);
-                        if(DSP_FAILED(status))
-                        {
-                            goto MUTEX_UNLOCK;
-                        }
+                        phandle->mapCache.nShared++;
                     }
-
-                    else if(bufType == EMMCodecOuputBuffer)
+                    if (bTunnel)
+                    {
+                        pEntry->nCpuAccess = LCML_CPU_ACCESS_NONE;
+                    }
+                    else if (bReused)
                     {
-                        /* Issue an memory invalidate for output buffer */
-                        if (bufferLen > 512*1024)
+                        /* no fresh mapping, so the bridge did no maintenance */
+                        if (bufType == EMMCodecInputBuffer)
                         {
-                            status = DSPProcessor_FlushMemory(phandle->dspCodec->hProc, pDmmBuf->pAllocated, bufferLen, 3);
-                            if(DSP_FAILED(status))
-                            {
-                                goto MUTEX_UNLOCK;
-                            }
+                            bMaintenance = CacheMaintenanceNeeded(phandle, pEntry, LCML_CPU_ACCESS_WRITE);
                         }
-                        else
+                        else if (bufType == EMMCodecOuputBuffer)
                         {
-                            status = DSPProcessor_InvalidateMemory(phandle->dspCodec->hProc, pDmmBuf->pAllocated, bufferLen);
-                            if(DSP_FAILED(status))
-                            {
-                                goto MUTEX_UNLOCK;
-                            }
+                            bMaintenance = CacheMaintenanceNeeded(phandle, pEntry, LCML_CPU_ACCESS_READ | LCML_CPU_ACCESS_WRITE);
                         }
                     }
-
-                    break;
                 }
-            }
-
-            if(false == mappedBufferFound)
-            {
-                if (bufType == EMMCodecInputBuffer || !(streamId % 2))
+                pthread_mutex_unlock(&phandle->mutex);
+                if (evictedBuf.pMapped != NULL)
                 {
-                        phandle->commStruct->iBufferSize = bufferSizeUsed ? bufferSizeUsed : bufferLen;
-                        eError = DmmMap(phandle->dspCodec->hProc, bufferLen,buffer, (pDmmBuf), ((LCML_CODEC_INTERFACE *)hComponent)->dbg);
-                }
-                else if (bufType == EMMCodecOuputBuffer || streamId % 2) {
-                    eError = DmmMap(phandle->dspCodec->hProc, bufferLen, buffer, (pDmmBuf), ((LCML_CODEC_INTERFACE *)hComponent)->dbg);
+                    SharedMapRelease(phandle, &evictedBuf);
                 }
                 if (eError != OMX_ErrorNone)
                 {
-                    goto MUTEX_UNLOCK;
+                    SharedMapRelease(phandle, pDmmBuf);
+                    goto RELEASE_SLOT;
                 }
+            }
 
-                /*720p implementation */
-                phandle->commStruct->iBufferPtr = (OMX_U32) pDmmBuf->pMapped;
-                /* storing reserve address for buffer */
-                pDmmBuf->bufReserved = pDmmBuf->pReserved;
-                if(phandle->mapped_buffer_count <= MAX_DMM_BUFFERS)
+            /* queued here, issued together with the comm struct flush */
+            if(bufType == EMMCodecInputBuffer && bMaintenance)
+            {
+                /* Issue a memory flush for input buffer to ensure cache coherency */
+                cacheOps[nCacheOps].pMpuAddr = pDmmBuf->pAllocated;
+                cacheOps[nCacheOps].ulSize = bufferSizeUsed;
+                cacheOps[nCacheOps].ulFlags = (bufferSizeUsed > 512*1024) ? 3: 0;
+                cacheOps[nCacheOps].uOp = DSP_CACHEOP_FLUSH;
+                nCacheOps++;
+            }
+
+            else if(bufType == EMMCodecOuputBuffer && bMaintenance)
+            {
+                /* Issue an memory invalidate for output buffer */
+                cacheOps[nCacheOps].pMpuAddr = pDmmBuf->pAllocated;
+                cacheOps[nCacheOps].ulSize = bufferLen;
+                if (bufferLen > 512*1024)
                 {
-                    phandle->mapped_dmm_buffers[phandle->mapped_buffer_count++] = *pDmmBuf;
+                    cacheOps[nCacheOps].ulFlags = 3;
+                    cacheOps[nCacheOps].uOp = DSP_CACHEOP_FLUSH;
                 }
+                else
+                {
+                    cacheOps[nCacheOps].ulFlags = 0;
+                    cacheOps[nCacheOps].uOp = DSP_CACHEOP_INVALIDATE;
+                }
+                nCacheOps++;
             }
-        phandle->commStruct->iBufferPtr = (OMX_U32) pDmmBuf->pMapped;
+        pComm->iBufferPtr = (OMX_U32) pDmmBuf->pMapped;
         }
         else
         {
 
             OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Mapping buffer continously\n");
-            if (bufType == EMMCodecInputBuffer || !(streamId % 2))
+            if (bInput)
             {
                 if (MapBufLen)
                 {
@@ -1081,19 +1339,19 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
                 }
                 else
                 {
-                    phandle->commStruct->iBufferSize = bufferSizeUsed ? bufferSizeUsed : bufferLen;
+                    pComm->iBufferSize = bufferSizeUsed ? bufferSizeUsed : bufferLen;
                     OMX_PRINT2 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Mapping Size %ld out of %ld", bufferSizeUsed, bufferLen);
                     eError = DmmMap(phandle->dspCodec->hProc, bufferSizeUsed ? bufferSizeUsed : bufferLen,buffer, (pDmmBuf), ((LCML_CODEC_INTERFACE *)hComponent)->dbg);
                 }
             }
-            else if (bufType == EMMCodecOuputBuffer || streamId % 2) {
+            else {
                 eError = DmmMap(phandle->dspCodec->hProc, bufferLen, buffer, (pDmmBuf), ((LCML_CODEC_INTERFACE *)hComponent)->dbg);
             }
             if (eError != OMX_ErrorNone)
             {
-                goto MUTEX_UNLOCK;
+                goto RELEASE_SLOT;
             }
-            phandle->commStruct->iBufferPtr = (OMX_U32) pDmmBuf->pMapped;
+            pComm->iBufferPtr = (OMX_U32) pDmmBuf->pMapped;
             pDmmBuf->bufReserved = pDmmBuf->pReserved;
         }
 
@@ -1102,36 +1360,60 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
     if (auxInfoLen != 0 && auxInfo != NULL )
     {
         OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "mapping parameter \n");
-        eError = DmmMap(phandle->dspCodec->hProc, phandle->commStruct->iParamSize, (void*)phandle->commStruct->iParamPtr, (pDmmBuf), ((LCML_CODEC_INTERFACE *)hComponent)->dbg);
+        eError = DmmMap(phandle->dspCodec->hProc, pComm->iParamSize, (void*)pComm->iParamPtr, (pDmmBuf), ((LCML_CODEC_INTERFACE *)hComponent)->dbg);
         if (eError != OMX_ErrorNone)
         {
-            goto MUTEX_UNLOCK;
+            goto RELEASE_SLOT;
         }
 
-        phandle->commStruct->iParamPtr = (OMX_U32 )pDmmBuf->pMapped ;
+        pComm->iParamPtr = (OMX_U32 )pDmmBuf->pMapped ;
         /* storing reserve address for param */
         pDmmBuf->paramReserved = pDmmBuf->pReserved;
     }
 
-    eError = DmmMap(phandle->dspCodec->hProc, sizeof(TArmDspCommunicationStruct),(void *)phandle->commStruct, (pDmmBuf), ((LCML_CODEC_INTERFACE *)hComponent)->dbg);
-    if (eError != OMX_ErrorNone)
-    {
-        goto MUTEX_UNLOCK;
-    }
-
-    /* storing mapped address of struct */
-    phandle->commStruct->iArmArg = (OMX_U32)pDmmBuf->pMapped;
+    /* storing mapped address of struct; the pool is mapped already so the
+     * struct only has to be written back for the DSP to see it */
+    pComm->iArmArg = (OMX_U32)phandle->commPoolDmmBuf.pMapped + commOffset;
+    cacheOps[nCacheOps].pMpuAddr = pComm;
+    cacheOps[nCacheOps].ulSize = sizeof(TArmDspCommunicationStruct);
+    cacheOps[nCacheOps].ulFlags = 0;
+    cacheOps[nCacheOps].uOp = DSP_CACHEOP_FLUSH;
+    nCacheOps++;
+    status = DSPProcessor_CacheOperations(phandle->dspCodec->hProc, cacheOps, nCacheOps);
+    DSP_ERROR_EXIT (status, "Flush buffer and communication structure", RELEASE_SLOT);
 
     OMX_PRINT2 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "sending SETBUFF \n");
+    pthread_mutex_lock(&phandle->mutex);
+    LatencyQueued(phandle, streamId, slot);
+    pthread_mutex_unlock(&phandle->mutex);
     msg.dwCmd = commandId;
-    msg.dwArg1 = (int)pDmmBuf->pMapped;
+    msg.dwArg1 = (int)pComm->iArmArg;
     msg.dwArg2 = 0;
 
     status = DSPNode_PutMessage (phandle->dspCodec->hNode, &msg, DSP_FOREVER);
     OMX_PRINT2 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "after SETBUFF \n");
-    DSP_ERROR_EXIT (status, "Send message to node", MUTEX_UNLOCK);
-MUTEX_UNLOCK:
+    DSP_ERROR_EXIT (status, "Send message to node", RELEASE_SLOT);
+    /* the DSP owns the buffer now, STOP and FLUSH may return it */
+    pthread_mutex_lock(&phandle->mutex);
+    phandle->pQueuePending[bInput ? 0 : 1] = NULL;
+    pthread_mutex_unlock(&phandle->mutex);
+    goto QUEUE_UNLOCK;
+
+RELEASE_SLOT:
+    /* the DSP never got the buffer, give the slot back */
+    pthread_mutex_lock(&phandle->mutex);
+    phandle->pQueuePending[bInput ? 0 : 1] = NULL;
+    if (bInput)
+    {
+        phandle->Arminputstorage[slot] = NULL;
+    }
+    else
+    {
+        phandle->Armoutputstorage[slot] = NULL;
+    }
     pthread_mutex_unlock(&phandle->mutex);
+QUEUE_UNLOCK:
+    pthread_mutex_unlock(pQueueMutex);
 EXIT:
     return eError;
 }
@@ -1219,6 +1501,7 @@ static OMX_ERRORTYPE ControlCodec(OMX_HANDLETYPE hComponent,
         case EMMCodecControlDestroy:
         {
             int pthreadError = 0;
+            OMX_U32 tStart, tStopped, tEnd;
             OMX_PRINT2 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Destroy the codec");
 #ifdef __PERF_INSTRUMENTATION__
             PERF_Boundary(phandle->pPERF,
@@ -1226,13 +1509,30 @@ static OMX_ERRORTYPE ControlCodec(OMX_HANDLETYPE hComponent,
             PERF_SendingCommand(phandle->pPERF,
                                 -1, 0, PERF_ModuleComponent);
 #endif
-            phandle->pshutdownFlag = 1;
-            pthreadError = pthread_join(phandle->g_tidMessageThread, NULL);
-            if (0 != pthreadError)
+            tStart = LatencyNow();
+            if (phandle->pDispatcher != NULL)
+            {
+                DispatchUnregister(phandle);
+            }
+            else
             {
-                eError = OMX_ErrorHardware;
-                OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "%d :: Error while closing Component Thread\n", pthreadError);
+                /* terminating the node raises the state change the
+                 * messaging thread waits on next to the DSP events; if the
+                 * DSP cannot raise it the thread's wait times out */
+                phandle->pshutdownFlag = 1;
+                status = TerminateNode(phandle);
+                if (DSP_FAILED(status))
+                {
+                    OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "%d :: Node terminate failed: 0x%lx\n", __LINE__, status);
+                }
+                pthreadError = pthread_join(phandle->g_tidMessageThread, NULL);
+                if (0 != pthreadError)
+                {
+                    eError = OMX_ErrorHardware;
+                    OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "%d :: Error while closing Component Thread\n", pthreadError);
+                }
             }
+            tStopped = LatencyNow();
             OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Destroy the codec %d",eError);
             /* 720p implementation */
             /*DeleteDspResource (phandle);*/
@@ -1243,33 +1543,24 @@ static OMX_ERRORTYPE ControlCodec(OMX_HANDLETYPE hComponent,
                 pthread_mutex_unlock(&phandle->m_isStopped_mutex);
             }
 
-            if (phandle->ReUseMap)
-            {
-                OMX_U32 i;
+            pthread_mutex_lock(&phandle->mutex);
+            LatencyReport(phandle, OMX_FALSE);
+            pthread_mutex_unlock(&phandle->mutex);
 
+            if (phandle->ReUseMap || phandle->mapCache.nCount != 0)
+            {
                 /* Unmap buffers */
-                for(i=0; i< phandle->mapped_buffer_count; i++)
-                {
-                    DmmUnMap(phandle->dspCodec->hProc,(void*)phandle->mapped_dmm_buffers[i].pMapped,
-                            phandle->mapped_dmm_buffers[i].bufReserved, ((LCML_CODEC_INTERFACE *)hComponent)->dbg);
-                }
-
-                for(i = 0; i <= phandle->mapped_buffer_count; i++)
-                {
-                    phandle->mapped_dmm_buffers[i].pAllocated = 0;
-                    phandle->mapped_dmm_buffers[i].pReserved = 0;
-                    phandle->mapped_dmm_buffers[i].pMapped = 0;
-                    phandle->mapped_dmm_buffers[i].bufReserved = 0;
-                    phandle->mapped_dmm_buffers[i].paramReserved = 0;
-                    phandle->mapped_dmm_buffers[i].nSize = 0;
-                }
-
-                phandle->mapped_buffer_count = 0;
+                MapCacheFlush(phandle);
             }
 
+            DestroyCommPool(phandle);
             DeleteDspResource (phandle);
 
+            tEnd = LatencyNow();
+            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "teardown: messaging stopped in %lu us, destroyed in %lu us\n",
+                        tStopped - tStart, tEnd - tStart);
 #ifdef __PERF_INSTRUMENTATION__
+            PERF_Log(phandle->pPERF, LCML_PERF_LOG_TEARDOWN, tStopped - tStart, tEnd - tStart);
             PERF_OBJHANDLE pPERF = phandle->pPERF;
 #endif
 
@@ -1433,21 +1724,127 @@ static OMX_ERRORTYPE ControlCodec(OMX_HANDLETYPE hComponent,
             phandle->bUsnEos = OMX_TRUE;
             break;
         }
+        case EMMCodecControlCachePolicy:
+        {
+            if ((TLcmlCachePolicy)args[0] > ELcmlCachePolicyNone)
+            {
+                eError = OMX_ErrorBadParameter;
+                goto EXIT;
+            }
+            pthread_mutex_lock(&phandle->mutex);
+            phandle->eCachePolicy = (TLcmlCachePolicy)args[0];
+            pthread_mutex_unlock(&phandle->mutex);
+            break;
+        }
+        case EMMCodecControlBufferAccess:
+        {
+            LCML_MAP_CACHE_ENTRY *pEntry;
 
-    }
+            pthread_mutex_lock(&phandle->mutex);
+            pEntry = MapCacheFind(&phandle->mapCache, args[0], (OMX_U32)args[1]);
+            if (pEntry != NULL)
+            {
+                pEntry->nCpuAccess = (OMX_U32)args[2];
+            }
+            pthread_mutex_unlock(&phandle->mutex);
+            break;
+        }
 
-EXIT:
-    return eError;
-}
+        case EMMCodecControlLatencyStats:
+        {
+            OMX_U32 streamId = (OMX_U32)args[0];
 
+            if (streamId >= LCML_LATENCY_STREAMS || args[1] == NULL)
+            {
+                eError = OMX_ErrorBadParameter;
+                break;
+            }
+            pthread_mutex_lock(&phandle->mutex);
+            LatencyGetStats(phandle, streamId, (LCML_LATENCY_STATS *)args[1]);
+            if (args[2] != NULL)
+            {
+                memset(&phandle->latency[streamId], 0, sizeof(LCML_LATENCY_HIST));
+            }
+            pthread_mutex_unlock(&phandle->mutex);
+            break;
+        }
 
-/** ========================================================================
-*  DmmMap () method is used to allocate the memory using DMM.
-*
-*  @param ProcHandle -  Component identification number
-*  @param size  - Buffer header address, that needs to be sent to codec
-*  @param pArmPtr - Message used to send the buffer to codec
-*  @param pDmmBuf - buffer id
+        case EMMCodecControlReleaseBuffer:
+        {
+            LCML_MAP_CACHE_ENTRY *pEntry;
+            DMM_BUFFER_OBJ dmmBuf;
+            OMX_U32 nFlags = (OMX_U32)args[2];
+            struct timespec deadline;
+            int ret = 0;
+
+            if (nFlags & LCML_RELEASE_WAIT)
+            {
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_sec += LCML_RELEASE_WAIT_MS / 1000;
+                deadline.tv_nsec += (LCML_RELEASE_WAIT_MS % 1000) * 1000000;
+                if (deadline.tv_nsec >= 1000000000)
+                {
+                    deadline.tv_sec++;
+                    deadline.tv_nsec -= 1000000000;
+                }
+            }
+
+            dmmBuf.pMapped = NULL;
+            pthread_mutex_lock(&phandle->mutex);
+            pEntry = MapCacheFind(&phandle->mapCache, args[0], (OMX_U32)args[1]);
+            /* the messaging thread wakes us after each batch of returned
+             * buffers; the entry is looked up again as the cache may change */
+            while (pEntry != NULL && MapCacheInFlight(phandle, pEntry) &&
+                   (nFlags & LCML_RELEASE_WAIT) && ret == 0)
+            {
+                phandle->nReleaseWaiters++;
+                ret = pthread_cond_timedwait(&phandle->releaseCond, &phandle->mutex, &deadline);
+                phandle->nReleaseWaiters--;
+                pEntry = MapCacheFind(&phandle->mapCache, args[0], (OMX_U32)args[1]);
+            }
+            if (pEntry != NULL)
+            {
+                if (MapCacheInFlight(phandle, pEntry))
+                {
+                    OMX_PRDSP4(((LCML_CODEC_INTERFACE *)hComponent)->dbg,
+                               "buffer %p still with the DSP, not released", args[0]);
+                    eError = OMX_ErrorNotReady;
+                }
+                else
+                {
+                    dmmBuf = pEntry->dmmBuf;
+                    MapCacheUnlink(&phandle->mapCache, pEntry - phandle->mapCache.entries);
+                }
+            }
+            pthread_mutex_unlock(&phandle->mutex);
+            if (eError == OMX_ErrorNone && (nFlags & LCML_RELEASE_OWNER))
+            {
+                /* the memory goes away: peers still holding the mapping
+                 * keep it until they drop it, nobody takes it anew */
+                SharedMapPurge(phandle, args[0], (OMX_U32)args[1]);
+            }
+            /* unmapped without the mutex, the messaging thread needs it */
+            if (dmmBuf.pMapped != NULL)
+            {
+                SharedMapRelease(phandle, &dmmBuf);
+            }
+            break;
+        }
+
+    }
+
+EXIT:
+    return eError;
+}
+
+
+/** ========================================================================
+*  DmmMap () method is used to allocate the memory using DMM.
+*
+*  @param ProcHandle -  Component identification number
+*  @param size  - Buffer header address, that needs to be sent to codec
+*  @param pArmPtr - Message used to send the buffer to codec
+*  @param pDmmBuf - buffer id
 *
 *  @retval OMX_ErrorNone  - Success
 *          OMX_ErrorHardware  -  Hardware Error
@@ -1479,14 +1876,18 @@ OMX_ERRORTYPE DmmMap(DSP_HPROCESSOR ProcHandle,
     /* Allocate */
     pDmmBuf->pAllocated = pArmPtr;
 
-    /* Reserve */
+    /* Reserve, from the arena when it has room */
     nSizeReserved = ROUND_TO_PAGESIZE(size) + 2*DMM_PAGE_SIZE ;
-    status = DSPProcessor_ReserveMemory(ProcHandle, nSizeReserved, &(pDmmBuf->pReserved));
-    if(DSP_FAILED(status))
+    pDmmBuf->pReserved = ArenaAlloc(ProcHandle, nSizeReserved);
+    if (pDmmBuf->pReserved == NULL)
     {
-        OMX_ERROR4 (dbg, "DSPProcessor_ReserveMemory() failed - error 0x%x", (int)status);
-        eError = OMX_ErrorInsufficientResources;
-        goto EXIT;
+        status = DSPProcessor_ReserveMemory(ProcHandle, nSizeReserved, &(pDmmBuf->pReserved));
+        if(DSP_FAILED(status))
+        {
+            OMX_ERROR4 (dbg, "DSPProcessor_ReserveMemory() failed - error 0x%x", (int)status);
+            eError = OMX_ErrorInsufficientResources;
+            goto EXIT;
+        }
     }
     pDmmBuf->nSize = size;
 
@@ -1503,6 +1904,11 @@ OMX_ERRORTYPE DmmMap(DSP_HPROCESSOR ProcHandle,
     if(DSP_FAILED(status))
     {
         OMX_ERROR4 (dbg, "DSPProcessor_Map() failed - error 0x%x", (int)status);
+        if (!ArenaFree(ProcHandle, pDmmBuf->pReserved))
+        {
+            DSPProcessor_UnReserveMemory(ProcHandle, pDmmBuf->pReserved);
+        }
+        pDmmBuf->pReserved = NULL;
         eError = OMX_ErrorInsufficientResources;
         goto EXIT;
     }
@@ -1551,10 +1957,13 @@ OMX_ERRORTYPE DmmUnMap(DSP_HPROCESSOR ProcHandle, void* pMapPtr, void* pResPtr,
    }
 
     OMX_PRINT2 (dbg, "unreserving  structure =0x%p\n",pResPtr );
-    status = DSPProcessor_UnReserveMemory(ProcHandle,pResPtr);
-    if(DSP_FAILED(status))
+    if (!ArenaFree(ProcHandle, pResPtr))
     {
-        OMX_PRDSP4 (dbg, "DSPProcessor_UnReserveMemory() failed - error 0x%x", (int)status);
+        status = DSPProcessor_UnReserveMemory(ProcHandle,pResPtr);
+        if(DSP_FAILED(status))
+        {
+            OMX_PRDSP4 (dbg, "DSPProcessor_UnReserveMemory() failed - error 0x%x", (int)status);
+        }
     }
 
 EXIT:
@@ -1562,315 +1971,2075 @@ EXIT:
 }
 
 /** ========================================================================
-* FreeResources () method is used to allocate the memory using DMM.
-*
-* @param hInterface  - Component identification number
+*  ArenaCreate () reserves the DSP address arena of a freshly attached
+*  processor. Failing to reserve it only means that DmmMap keeps reserving
+*  per buffer.
 *
-* @retval OMX_ErrorNone           Success
-*         OMX_ErrorHardware       Hardware Error
+*  @param hProc  - processor handle the arena is reserved from
 ** ==========================================================================*/
-OMX_ERRORTYPE FreeResources (LCML_DSP_INTERFACE *hInterface)
+static void ArenaCreate(DSP_HPROCESSOR hProc)
 {
-    OMX_ERRORTYPE eError = OMX_ErrorNone;
-    LCML_DSP_INTERFACE *codec;
+    LCML_DMM_ARENA *pArena = &g_arena;
+    DSP_STATUS status;
+    char *value;
+    int nMB = LCML_DMM_ARENA_DEFAULT_MB;
+    OMX_U32 nOrder = 0, i;
 
-    OMX_PRINT1 ((struct OMX_TI_Debug)(((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg), "%d :: LCML:: FreeResources\n",__LINE__);
-    if(hInterface->dspCodec != NULL)
+    value = getenv("LCML_DMM_ARENA_MB");
+    if (value != NULL)
     {
-        LCML_FREE(hInterface->dspCodec);
-        hInterface->dspCodec = NULL;
+        nMB = atoi(value);
     }
-    codec = (LCML_DSP_INTERFACE *)(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle)->pCodec);
-    if(codec != NULL)
+    if (nMB <= 0)
     {
-        pthread_mutex_destroy(&codec->m_isStopped_mutex);
-        pthread_mutex_lock(&codec->mutex);
+        return;
+    }
+    while (nOrder < LCML_DMM_ARENA_MAX_ORDER &&
+           ((OMX_U32)DMM_PAGE_SIZE << (nOrder + 1)) <= (OMX_U32)nMB * 1024 * 1024)
+    {
+        nOrder++;
+    }
 
-        OMX_PRINT1 ((struct OMX_TI_Debug)(((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg), "%d :: LCML:: FreeResources\n",__LINE__);
-        if(codec->g_aNotificationObjects[0]!= NULL)
+    pthread_mutex_lock(&g_arenaMutex);
+    memset(pArena, 0, sizeof(LCML_DMM_ARENA));
+    pArena->nPages = 1 << nOrder;
+    pArena->nMaxOrder = nOrder;
+    pArena->pNext = (OMX_S32 *)malloc(pArena->nPages * sizeof(OMX_S32));
+    pArena->pPrev = (OMX_S32 *)malloc(pArena->nPages * sizeof(OMX_S32));
+    pArena->pOrder = (OMX_U8 *)malloc(pArena->nPages);
+    status = DSP_EMEMORY;
+    if (pArena->pNext != NULL && pArena->pPrev != NULL && pArena->pOrder != NULL)
+    {
+        status = DSPProcessor_ReserveMemory(hProc, pArena->nPages * DMM_PAGE_SIZE, (void **)&pArena->pBase);
+    }
+    if (DSP_FAILED(status))
+    {
+        free(pArena->pNext);
+        free(pArena->pPrev);
+        free(pArena->pOrder);
+        memset(pArena, 0, sizeof(LCML_DMM_ARENA));
+    }
+    else
+    {
+        pArena->hProc = hProc;
+        for (i = 0; i <= LCML_DMM_ARENA_MAX_ORDER; i++)
         {
-            LCML_FREE(codec->g_aNotificationObjects[0]);
-            codec->g_aNotificationObjects[0] = NULL;
-#ifdef __ERROR_PROPAGATION__
-            if(codec->g_aNotificationObjects[1]!= NULL)
-            {
-                LCML_FREE(codec->g_aNotificationObjects[1]);
-                codec->g_aNotificationObjects[1] = NULL;
-            }
-            if(codec->g_aNotificationObjects[2]!= NULL)
-            {
-                LCML_FREE(codec->g_aNotificationObjects[2]);
-                codec->g_aNotificationObjects[2] = NULL;
-            }
- #endif
-            OMX_DBG_CLOSE((struct OMX_TI_Debug )(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle)->dbg));
-            LCML_FREE(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle));
-            hInterface->pCodecinterfacehandle = NULL;
+            pArena->freeHead[i] = -1;
         }
-        pthread_mutex_unlock(&codec->mutex);
-        pthread_mutex_destroy (&codec->mutex);
-        LCML_FREE(codec);
-        codec = NULL;
+        pArena->freeHead[nOrder] = 0;
+        pArena->pNext[0] = pArena->pPrev[0] = -1;
+        pArena->pOrder[0] = nOrder | LCML_DMM_ARENA_FREE;
     }
-    return eError;
+    pthread_mutex_unlock(&g_arenaMutex);
+}
+
+/* releases the arena before the processor is detached */
+static void ArenaDestroy(void)
+{
+    LCML_DMM_ARENA *pArena = &g_arena;
+
+    pthread_mutex_lock(&g_arenaMutex);
+    if (pArena->pBase != NULL)
+    {
+        DSPProcessor_UnReserveMemory(pArena->hProc, pArena->pBase);
+        free(pArena->pNext);
+        free(pArena->pPrev);
+        free(pArena->pOrder);
+    }
+    memset(pArena, 0, sizeof(LCML_DMM_ARENA));
+    pthread_mutex_unlock(&g_arenaMutex);
+}
+
+static void ArenaUnlink(LCML_DMM_ARENA *pArena, OMX_S32 nPage, OMX_U32 nOrder)
+{
+    if (pArena->pPrev[nPage] >= 0)
+    {
+        pArena->pNext[pArena->pPrev[nPage]] = pArena->pNext[nPage];
+    }
+    else
+    {
+        pArena->freeHead[nOrder] = pArena->pNext[nPage];
+    }
+    if (pArena->pNext[nPage] >= 0)
+    {
+        pArena->pPrev[pArena->pNext[nPage]] = pArena->pPrev[nPage];
+    }
+}
+
+static void ArenaPush(LCML_DMM_ARENA *pArena, OMX_S32 nPage, OMX_U32 nOrder)
+{
+    pArena->pOrder[nPage] = nOrder | LCML_DMM_ARENA_FREE;
+    pArena->pPrev[nPage] = -1;
+    pArena->pNext[nPage] = pArena->freeHead[nOrder];
+    if (pArena->freeHead[nOrder] >= 0)
+    {
+        pArena->pPrev[pArena->freeHead[nOrder]] = nPage;
+    }
+    pArena->freeHead[nOrder] = nPage;
 }
 
 /** ========================================================================
-* DeleteDspResource () method is used to allocate the memory using DMM.
+*  ArenaAlloc () takes a DSP address range from the arena of the processor,
+*  rounded up to a power of two pages.
 *
-* @param hInterface                   Component identification number
+*  @param hProc  - processor the range is for
+*  @param nSize  - bytes to reserve, a multiple of DMM_PAGE_SIZE
 *
-* @retval OMX_ErrorNone           Success
-*         OMX_ErrorHardware       Hardware Error
+*  @retval DSP address, NULL if the processor has no arena or it is full
 ** ==========================================================================*/
-OMX_ERRORTYPE DeleteDspResource(LCML_DSP_INTERFACE *hInterface)
+static void *ArenaAlloc(DSP_HPROCESSOR hProc, OMX_U32 nSize)
 {
-    OMX_ERRORTYPE eError = OMX_ErrorNone;
-    DSP_STATUS status;
-    DSP_STATUS nExit;
-    struct DSP_NODEATTR nodeAttr;
-    OMX_U32 dllinfo;
-    LCML_DSP_INTERFACE *codec;
+    LCML_DMM_ARENA *pArena = &g_arena;
+    OMX_U32 nPages = nSize / DMM_PAGE_SIZE;
+    OMX_U32 nOrder = 0, nFound;
+    OMX_S32 nPage;
+    void *pAddr = NULL;
+
+    pthread_mutex_lock(&g_arenaMutex);
+    if (pArena->pBase == NULL || pArena->hProc != hProc)
+    {
+        goto EXIT;
+    }
+    while ((1U << nOrder) < nPages)
+    {
+        nOrder++;
+    }
+    for (nFound = nOrder; nFound <= pArena->nMaxOrder && pArena->freeHead[nFound] < 0; nFound++)
+    {
+    }
+    if (nFound > pArena->nMaxOrder)
+    {
+        pArena->nFallbacks++;
+        goto EXIT;
+    }
+    nPage = pArena->freeHead[nFound];
+    ArenaUnlink(pArena, nPage, nFound);
+    /* split, keeping the lower half and freeing the upper one */
+    while (nFound > nOrder)
+    {
+        nFound--;
+        ArenaPush(pArena, nPage + (1 << nFound), nFound);
+    }
+    pArena->pOrder[nPage] = nOrder;
+    pArena->nUsedPages += 1 << nOrder;
+    if (pArena->nUsedPages > pArena->nPeakPages)
+    {
+        pArena->nPeakPages = pArena->nUsedPages;
+    }
+    pArena->nAllocs++;
+    pAddr = pArena->pBase + nPage * DMM_PAGE_SIZE;
 
-    /* Get current state of node, if it is running, then only terminate it */
+EXIT:
+    pthread_mutex_unlock(&g_arenaMutex);
+    return pAddr;
+}
 
-    status = DSPNode_GetAttr(hInterface->dspCodec->hNode, &nodeAttr, sizeof(nodeAttr));
-    DSP_ERROR_EXIT (status, "DeInit: Error in Node GetAtt ", EXIT);
-        status = DSPNode_Terminate(hInterface->dspCodec->hNode, &nExit);
-    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: LCML:: Node Has Been Terminated --1\n",__LINE__);
-    codec = (LCML_DSP_INTERFACE *)(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle)->pCodec);
-    if(codec->g_aNotificationObjects[0]!= NULL)
+/** ========================================================================
+*  ArenaFree () gives a range taken by ArenaAlloc back, merging it with its
+*  free buddies.
+*
+*  @param hProc  - processor the range was reserved for
+*  @param pAddr  - DSP address returned by ArenaAlloc
+*
+*  @retval OMX_FALSE if the address is not in the arena, so it was
+*          reserved with DSPProcessor_ReserveMemory
+** ==========================================================================*/
+static OMX_BOOL ArenaFree(DSP_HPROCESSOR hProc, void *pAddr)
+{
+    LCML_DMM_ARENA *pArena = &g_arena;
+    OMX_U8 *pByte = (OMX_U8 *)pAddr;
+    OMX_S32 nPage, nBuddy;
+    OMX_U32 nOrder;
+    OMX_BOOL bOwned = OMX_FALSE;
+
+    pthread_mutex_lock(&g_arenaMutex);
+    if (pArena->pBase == NULL || pArena->hProc != hProc || pByte < pArena->pBase ||
+        pByte >= pArena->pBase + pArena->nPages * DMM_PAGE_SIZE)
     {
+        goto EXIT;
     }
-#ifdef __ERROR_PROPAGATION__
-    if(codec->g_aNotificationObjects[1]!= NULL)
+    bOwned = OMX_TRUE;
+    nPage = (pByte - pArena->pBase) / DMM_PAGE_SIZE;
+    nOrder = pArena->pOrder[nPage];
+    if (nOrder & LCML_DMM_ARENA_FREE)
     {
-       /* status = DSPNode_RegisterNotify(hInterface->dspCodec->hProc, 0, DSP_SIGNALEVENT, codec->g_aNotificationObjects[1]);
-        DSP_ERROR_EXIT(status, "DSP node de-register notify", EXIT);*/
+        goto EXIT;                  /* double free, keep the lists intact */
     }
-#endif
-    if (hInterface->dspCodec->DeviceInfo.TypeofDevice == 1) {
-        /* delete DASF node */
-        status = DSPNode_Delete(hInterface->dspCodec->hDasfNode);
-        DSP_ERROR_EXIT (status, "DeInit: DASF Node Delete ", EXIT);
-        OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: Deleted the DASF node Successfully\n",__LINE__);
+    pArena->nUsedPages -= 1 << nOrder;
+    while (nOrder < pArena->nMaxOrder)
+    {
+        nBuddy = nPage ^ (1 << nOrder);
+        if (pArena->pOrder[nBuddy] != (nOrder | LCML_DMM_ARENA_FREE))
+        {
+            break;
+        }
+        ArenaUnlink(pArena, nBuddy, nOrder);
+        pArena->pOrder[nBuddy] = 0;
+        nPage &= ~(1 << nOrder);
+        nOrder++;
     }
-	/* delete SN */
-    status = DSPNode_Delete(hInterface->dspCodec->hNode);
-    DSP_ERROR_EXIT (status, "DeInit: Codec Node Delete ", EXIT);
-    OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: Deleted the node Successfully\n",__LINE__);
+    ArenaPush(pArena, nPage, nOrder);
 
-    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: Entering UnLoadDLLs \n", __LINE__);
-    for(dllinfo=0;dllinfo < hInterface->dspCodec->NodeInfo.nNumOfDLLs ;dllinfo++)
+EXIT:
+    pthread_mutex_unlock(&g_arenaMutex);
+    return bOwned;
+}
+
+/** ========================================================================
+*  MapCacheInit () empties the DMM mapping cache and clears its statistics.
+*
+*  @param pCache  - cache embedded in the LCML handle
+** ==========================================================================*/
+static void MapCacheInit(LCML_MAP_CACHE *pCache)
+{
+    OMX_U32 i;
+
+    memset(pCache, 0, sizeof(LCML_MAP_CACHE));
+    for (i = 0; i < LCML_MAP_CACHE_BUCKETS; i++)
     {
-        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: Register Component Node\n",hInterface->dspCodec->NodeInfo.AllUUIDs[dllinfo].eDllType);
-        status = DSPManager_UnregisterObject ((struct DSP_UUID *) hInterface->dspCodec->NodeInfo.AllUUIDs[dllinfo].uuid,
-                                                                                        hInterface->dspCodec->NodeInfo.AllUUIDs[dllinfo].eDllType);
-        /*DSP_ERROR_EXIT (status, "Unregister DSP Object, Socket UUID ", EXIT);*/
+        pCache->buckets[i] = -1;
     }
+}
 
-    /* detach processor from gpp */
-    status = DSPProcessor_Detach(hInterface->dspCodec->hProc);
-    DSP_ERROR_EXIT (status, "DeInit: DSP Processor Detach ", EXIT);
+static OMX_U32 MapCacheHash(void *pArmPtr, OMX_U32 nLength)
+{
+    OMX_U32 key = (OMX_U32)pArmPtr;
 
-    status = DspManager_Close(0, NULL);
-    DSP_ERROR_EXIT (status, "DeInit: DSPManager Close ", EXIT);
+    /* buffers are at least cache line aligned, fold the page and line bits */
+    key = (key >> 12) ^ (key >> 5) ^ nLength;
+    return (key ^ (key >> 16)) & (LCML_MAP_CACHE_BUCKETS - 1);
+}
 
-EXIT:
-    return eError;
+static void MapCacheUnlink(LCML_MAP_CACHE *pCache, OMX_S32 index)
+{
+    LCML_MAP_CACHE_ENTRY *pEntry = &pCache->entries[index];
+    OMX_S32 *pLink = &pCache->buckets[MapCacheHash(pEntry->dmmBuf.pAllocated, pEntry->nLength)];
+
+    while (*pLink != index)
+    {
+        pLink = &pCache->entries[*pLink].nNext;
+    }
+    *pLink = pEntry->nNext;
+    pCache->nCount--;
+    pCache->nMappedBytes -= pEntry->nLength;
+    memset(pEntry, 0, sizeof(LCML_MAP_CACHE_ENTRY));
+}
+
+/* a mapping may only be dropped once no queued comm struct refers to it */
+static OMX_BOOL MapCacheInFlight(LCML_DSP_INTERFACE *hInterface, LCML_MAP_CACHE_ENTRY *pEntry)
+{
+    OMX_U32 i;
 
+    for (i = 0; i < QUEUE_SIZE; i++)
+    {
+        if ((hInterface->Arminputstorage[i] != NULL &&
+             hInterface->Arminputstorage[i]->iArmbufferArg == (OMX_U32)pEntry->dmmBuf.pAllocated) ||
+            (hInterface->Armoutputstorage[i] != NULL &&
+             hInterface->Armoutputstorage[i]->iArmbufferArg == (OMX_U32)pEntry->dmmBuf.pAllocated))
+        {
+            return OMX_TRUE;
+        }
+    }
+    return OMX_FALSE;
 }
 
+/* hash lookup only, leaves the LRU order and statistics alone */
+static LCML_MAP_CACHE_ENTRY *MapCacheFind(LCML_MAP_CACHE *pCache, void *pArmPtr, OMX_U32 nLength)
+{
+    OMX_S32 index = pCache->buckets[MapCacheHash(pArmPtr, nLength)];
+
+    while (index >= 0)
+    {
+        LCML_MAP_CACHE_ENTRY *pEntry = &pCache->entries[index];
+
+        if (pEntry->dmmBuf.pAllocated == pArmPtr && pEntry->nLength == nLength)
+        {
+            return pEntry;
+        }
+        index = pEntry->nNext;
+    }
+    return NULL;
+}
 
 /** ========================================================================
-* This is the function run in the message thread.  It waits for an event
-* signal from Bridge and then reads all available messages.
+*  MapCacheLookup () finds the DSP mapping of a buffer queued before with
+*  ReUseMap. Call with the codec mutex held.
 *
-* @param[in] arg  Unused - Required by pthreads API
+*  @param pCache   - cache embedded in the LCML handle
+*  @param pArmPtr  - ARM address of the buffer
+*  @param nLength  - mapped length of the buffer
 *
-* @retval  OMX_ErrorNone Success, ready to roll
+*  @retval the cache entry, or NULL when the buffer is not mapped yet
 ** ==========================================================================*/
-void* MessagingThread(void* arg)
+static LCML_MAP_CACHE_ENTRY *MapCacheLookup(LCML_MAP_CACHE *pCache, void *pArmPtr, OMX_U32 nLength)
 {
-    /* OMX_ERRORTYPE eError = OMX_ErrorUndefined; */
-    DSP_STATUS status = DSP_SOK;
-    struct DSP_MSG msg = {0,0,0};
-    unsigned int index=0;
-    LCML_MESSAGINGTHREAD_STATE threadState = EMessagingThreadCodecStopped;
-    int waitForEventsTimeout = 1000;
-
-    // There is no need to set a timeout value for message retrieval.
-    // Just in case that we need to change it to a different value
-    // such as 10 ms?
-    const int getMessageTimeout = 0;
-
-#ifdef ANDROID
-    prctl(PR_SET_NAME, (unsigned long)"Messaging", 0, 0, 0);
-#endif
+    LCML_MAP_CACHE_ENTRY *pEntry = MapCacheFind(pCache, pArmPtr, nLength);
 
-    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Inside the Messaging thread\n");
-#ifdef __PERF_INSTRUMENTATION__
-    ((LCML_DSP_INTERFACE *)arg)->pPERFcomp =
-        PERF_Create(PERF_FOURCC('C','M','L','T'),
-                    PERF_ModuleAudioDecode | PERF_ModuleAudioEncode |
-                    PERF_ModuleVideoDecode | PERF_ModuleVideoEncode |
-                    PERF_ModuleImageDecode | PERF_ModuleImageEncode |
-                    PERF_ModuleCommonLayer);
-#endif
-    if (((LCML_DSP_INTERFACE *)arg)->ReUseMap)
+    if (pEntry != NULL)
     {
-        pthread_mutex_lock(&((LCML_DSP_INTERFACE *)arg)->m_isStopped_mutex);
+        pEntry->nLastUse = ++pCache->nClock;
+        pCache->nHits++;
+    }
+    else
+    {
+        pCache->nMisses++;
     }
+    return pEntry;
+}
 
-    /* get message from DSP */
-    while (1)
+/** ========================================================================
+*  MapCacheInsert () remembers a mapping made by DmmMap. When the cache is
+*  full the least recently used mapping that is not queued to the DSP is
+*  dropped to make room; the caller releases it once the codec mutex is
+*  unlocked. Call with the codec mutex held.
+*
+*  @param hInterface  - LCML handle
+*  @param nLength     - mapped length of the buffer
+*  @param pDmmBuf     - mapping, bufReserved must be set
+*  @param pEvicted    - receives the dropped mapping, pMapped is NULL when
+*                       nothing was dropped
+*
+*  @retval OMX_ErrorNone                    Success
+*          OMX_ErrorInsufficientResources   Every cached mapping is in use
+** ==========================================================================*/
+static OMX_ERRORTYPE MapCacheInsert(LCML_DSP_INTERFACE *hInterface, OMX_U32 nLength, DMM_BUFFER_OBJ *pDmmBuf,
+                                    DMM_BUFFER_OBJ *pEvicted)
+{
+    LCML_MAP_CACHE *pCache = &hInterface->mapCache;
+    LCML_MAP_CACHE_ENTRY *pEntry;
+    OMX_S32 index = -1;
+    OMX_S32 i;
+    OMX_U32 bucket;
+
+    memset(pEvicted, 0, sizeof(DMM_BUFFER_OBJ));
+
+    for (i = 0; i < LCML_MAP_CACHE_SIZE && index < 0; i++)
     {
-        if (((LCML_DSP_INTERFACE *)arg)->pshutdownFlag == 1)
+        if (pCache->entries[i].nLastUse == 0)
         {
-            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Breaking out of loop inmessaging thread \n");
-            break;
+            index = i;
         }
+    }
 
-        if (threadState == EMessagingThreadCodecRunning) {
-            waitForEventsTimeout = 10000;
+    if (index < 0)
+    {
+        for (i = 0; i < LCML_MAP_CACHE_SIZE; i++)
+        {
+            if ((index < 0 || pCache->entries[i].nLastUse < pCache->entries[index].nLastUse) &&
+                !MapCacheInFlight(hInterface, &pCache->entries[i]))
+            {
+                index = i;
+            }
         }
-        /* set the timeouts lower when the codec is stopped so that thread deletion response will be faster */
-        else if (threadState == EMessagingThreadCodecStopped) {
-            waitForEventsTimeout = 10;
+        if (index < 0)
+        {
+            OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+                    "%d :: LCML:: all %d cached mappings are in use\n", __LINE__, LCML_MAP_CACHE_SIZE);
+            return OMX_ErrorInsufficientResources;
         }
 
-#ifdef __ERROR_PROPAGATION__
-        status = DSPManager_WaitForEvents(((LCML_DSP_INTERFACE *)arg)->g_aNotificationObjects, 3, &index, waitForEventsTimeout);
-#else
-        status = DSPManager_WaitForEvents(((LCML_DSP_INTERFACE *)arg)->g_aNotificationObjects, 1, &index, waitForEventsTimeout);
+        pEntry = &pCache->entries[index];
+        OMX_PRBUFFER2 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+                "Evicting mapping of %p (%lu bytes) at %p\n",
+                pEntry->dmmBuf.pAllocated, pEntry->nLength, pEntry->dmmBuf.pMapped);
+#ifdef __PERF_INSTRUMENTATION__
+        PERF_Log(hInterface->pPERF, LCML_PERF_LOG_MAP_EVICT,
+                 (OMX_U32)pEntry->dmmBuf.pAllocated, pEntry->nLength);
 #endif
-        if (DSP_SUCCEEDED(status))
+        *pEvicted = pEntry->dmmBuf;
+        MapCacheUnlink(pCache, index);
+        pCache->nEvictions++;
+    }
+
+    pEntry = &pCache->entries[index];
+    bucket = MapCacheHash(pDmmBuf->pAllocated, nLength);
+    pEntry->dmmBuf = *pDmmBuf;
+    pEntry->nLength = nLength;
+    pEntry->nLastUse = ++pCache->nClock;
+    pEntry->nCpuAccess = LCML_CPU_ACCESS_READ | LCML_CPU_ACCESS_WRITE;
+    pEntry->nNext = pCache->buckets[bucket];
+    pCache->buckets[bucket] = index;
+    pCache->nCount++;
+    pCache->nMappedBytes += nLength;
+    if (pCache->nMappedBytes > pCache->nPeakMappedBytes)
+    {
+        pCache->nPeakMappedBytes = pCache->nMappedBytes;
+    }
+    return OMX_ErrorNone;
+}
+
+/** ========================================================================
+*  MapCacheFlush () unmaps every cached mapping and reports the cache
+*  statistics. Must be called once the messaging thread has exited.
+*
+*  @param hInterface  - LCML handle
+** ==========================================================================*/
+static void MapCacheFlush(LCML_DSP_INTERFACE *hInterface)
+{
+    LCML_MAP_CACHE *pCache = &hInterface->mapCache;
+    OMX_U32 i;
+
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+            "DMM map cache: %lu hits, %lu misses (%lu shared), %lu evictions, %lu bytes mapped (peak %lu)\n",
+            pCache->nHits, pCache->nMisses, pCache->nShared, pCache->nEvictions,
+            pCache->nMappedBytes, pCache->nPeakMappedBytes);
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+            "Cache maintenance (policy %d): %lu done, %lu skipped\n",
+            hInterface->eCachePolicy, pCache->nCacheOpsDone, pCache->nCacheOpsSkipped);
+    pthread_mutex_lock(&g_arenaMutex);
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+            "DSP address arena: %lu of %lu pages used (peak %lu), %lu reservations, %lu outside\n",
+            g_arena.nUsedPages, g_arena.nPages, g_arena.nPeakPages, g_arena.nAllocs, g_arena.nFallbacks);
+    pthread_mutex_unlock(&g_arenaMutex);
+#ifdef __PERF_INSTRUMENTATION__
+    PERF_Log(hInterface->pPERF, LCML_PERF_LOG_MAP_HITS, pCache->nHits, pCache->nMisses);
+    PERF_Log(hInterface->pPERF, LCML_PERF_LOG_MAP_BYTES, pCache->nEvictions, pCache->nPeakMappedBytes);
+    PERF_Log(hInterface->pPERF, LCML_PERF_LOG_CACHE_OPS, pCache->nCacheOpsDone, pCache->nCacheOpsSkipped);
+#endif
+
+    for (i = 0; i < LCML_MAP_CACHE_SIZE; i++)
+    {
+        if (pCache->entries[i].nLastUse != 0)
+        {
+            SharedMapRelease(hInterface, &pCache->entries[i].dmmBuf);
+        }
+    }
+    MapCacheInit(pCache);
+}
+
+/** ========================================================================
+*  SharedMapAcquire () maps a buffer for the map cache, or takes the mapping
+*  another LCML instance already holds for the same buffer and length.
+*
+*  @param hInterface  - LCML handle
+*  @param nLength     - length to map
+*  @param pArmPtr     - ARM address of the buffer
+*  @param pDmmBuf     - receives the mapping, with bufReserved set
+*  @param pbReused    - set when the mapping existed already, so the DSP
+*                       MMU setup did no cache maintenance for this call
+*
+*  @retval OMX_ErrorNone  - Success
+*          Errors of DmmMap
+** ==========================================================================*/
+static OMX_ERRORTYPE SharedMapAcquire(LCML_DSP_INTERFACE *hInterface, OMX_U32 nLength, void *pArmPtr,
+                                      DMM_BUFFER_OBJ *pDmmBuf, OMX_BOOL *pbReused)
+{
+    DSP_HPROCESSOR hProc = hInterface->dspCodec->hProc;
+    struct OMX_TI_Debug dbg = ((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg;
+    LCML_SHARED_MAP *pFree = NULL;
+    OMX_ERRORTYPE eError;
+    OMX_U32 i;
+
+    *pbReused = OMX_FALSE;
+    pthread_mutex_lock(&g_shareMutex);
+    for (i = 0; i < LCML_SHARED_MAPS; i++)
+    {
+        LCML_SHARED_MAP *pShared = &g_sharedMaps[i];
+
+        if (pShared->nUsers != 0 && !pShared->bStale && pShared->hProc == hProc &&
+            pShared->dmmBuf.pAllocated == pArmPtr && pShared->nLength == nLength)
+        {
+            pShared->nUsers++;
+            *pDmmBuf = pShared->dmmBuf;
+            *pbReused = OMX_TRUE;
+            pthread_mutex_unlock(&g_shareMutex);
+            return OMX_ErrorNone;
+        }
+    }
+    pthread_mutex_unlock(&g_shareMutex);
+
+    /* not mapped yet; map without the lock */
+    eError = DmmMap(hProc, nLength, pArmPtr, pDmmBuf, dbg);
+    if (eError != OMX_ErrorNone)
+    {
+        return eError;
+    }
+    pDmmBuf->bufReserved = pDmmBuf->pReserved;
+
+    pthread_mutex_lock(&g_shareMutex);
+    for (i = 0; i < LCML_SHARED_MAPS; i++)
+    {
+        LCML_SHARED_MAP *pShared = &g_sharedMaps[i];
+
+        if (pShared->nUsers == 0)
+        {
+            if (pFree == NULL)
+            {
+                pFree = pShared;
+            }
+        }
+        else if (!pShared->bStale && pShared->hProc == hProc &&
+                 pShared->dmmBuf.pAllocated == pArmPtr && pShared->nLength == nLength)
+        {
+            /* another instance mapped it meanwhile, use that one */
+            pShared->nUsers++;
+            pthread_mutex_unlock(&g_shareMutex);
+            DmmUnMap(hProc, pDmmBuf->pMapped, pDmmBuf->bufReserved, dbg);
+            *pDmmBuf = pShared->dmmBuf;
+            *pbReused = OMX_TRUE;
+            return OMX_ErrorNone;
+        }
+    }
+    if (pFree != NULL)
+    {
+        pFree->hProc = hProc;
+        pFree->dmmBuf = *pDmmBuf;
+        pFree->nLength = nLength;
+        pFree->nUsers = 1;
+        pFree->bStale = OMX_FALSE;
+    }
+    pthread_mutex_unlock(&g_shareMutex);
+    return OMX_ErrorNone;
+}
+
+/** ========================================================================
+*  SharedMapRelease () drops a mapping taken with SharedMapAcquire and
+*  unmaps it when no other map cache holds it.
+*
+*  @param hInterface  - LCML handle
+*  @param pDmmBuf     - the mapping
+** ==========================================================================*/
+static void SharedMapRelease(LCML_DSP_INTERFACE *hInterface, DMM_BUFFER_OBJ *pDmmBuf)
+{
+    DSP_HPROCESSOR hProc = hInterface->dspCodec->hProc;
+    OMX_U32 i;
+
+    pthread_mutex_lock(&g_shareMutex);
+    for (i = 0; i < LCML_SHARED_MAPS; i++)
+    {
+        LCML_SHARED_MAP *pShared = &g_sharedMaps[i];
+
+        if (pShared->nUsers != 0 && pShared->hProc == hProc &&
+            pShared->dmmBuf.pMapped == pDmmBuf->pMapped)
+        {
+            if (--pShared->nUsers != 0)
+            {
+                pthread_mutex_unlock(&g_shareMutex);
+                return;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_shareMutex);
+
+    /* last holder, or a private mapping */
+    DmmUnMap(hProc, pDmmBuf->pMapped, pDmmBuf->bufReserved,
+             ((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg);
+}
+
+/** ========================================================================
+*  SharedMapPurge () withdraws the shared mapping of a buffer its owner is
+*  about to free. The caches still holding it release it as usual, but the
+*  memory may be reallocated at the same address, so it is never handed out
+*  to a new holder again.
+*
+*  @param hInterface  - LCML handle
+*  @param pArmPtr     - ARM address of the buffer
+*  @param nLength     - mapped length
+** ==========================================================================*/
+static void SharedMapPurge(LCML_DSP_INTERFACE *hInterface, void *pArmPtr, OMX_U32 nLength)
+{
+    DSP_HPROCESSOR hProc = hInterface->dspCodec->hProc;
+    OMX_U32 i;
+
+    pthread_mutex_lock(&g_shareMutex);
+    for (i = 0; i < LCML_SHARED_MAPS; i++)
+    {
+        LCML_SHARED_MAP *pShared = &g_sharedMaps[i];
+
+        if (pShared->nUsers != 0 && pShared->hProc == hProc &&
+            pShared->dmmBuf.pAllocated == pArmPtr && pShared->nLength == nLength)
+        {
+            pShared->bStale = OMX_TRUE;
+        }
+    }
+    pthread_mutex_unlock(&g_shareMutex);
+}
+
+/** ========================================================================
+*  CacheMaintenanceNeeded () decides, according to the cache policy, whether
+*  a cached buffer has to be flushed or invalidated before the DSP gets it,
+*  and counts the decision.
+*
+*  @param hInterface   - LCML handle
+*  @param pEntry       - mapping of the buffer being queued
+*  @param nAccessMask  - CPU accesses that make the maintenance necessary
+*
+*  @retval OMX_TRUE when the flush or invalidate must be issued
+** ==========================================================================*/
+static OMX_BOOL CacheMaintenanceNeeded(LCML_DSP_INTERFACE *hInterface, LCML_MAP_CACHE_ENTRY *pEntry, OMX_U32 nAccessMask)
+{
+    OMX_BOOL bNeeded;
+
+    switch (hInterface->eCachePolicy)
+    {
+        case ELcmlCachePolicyNone:
+            bNeeded = OMX_FALSE;
+            break;
+        case ELcmlCachePolicyTracked:
+            bNeeded = (pEntry->nCpuAccess & nAccessMask) ? OMX_TRUE : OMX_FALSE;
+            break;
+        case ELcmlCachePolicyAlways:
+        default:
+            bNeeded = OMX_TRUE;
+            break;
+    }
+
+    if (bNeeded)
+    {
+        hInterface->mapCache.nCacheOpsDone++;
+    }
+    else
+    {
+        hInterface->mapCache.nCacheOpsSkipped++;
+    }
+    return bNeeded;
+}
+
+static TLcmlCachePolicy DefaultCachePolicy(void)
+{
+    char *policy = getenv("LCML_CACHE_POLICY");
+
+    if (policy != NULL)
+    {
+        if (!strcmp(policy, "always"))
+        {
+            return ELcmlCachePolicyAlways;
+        }
+        if (!strcmp(policy, "none"))
+        {
+            return ELcmlCachePolicyNone;
+        }
+    }
+    return ELcmlCachePolicyTracked;
+}
+
+/** ========================================================================
+*  LatencyNow () returns a monotonic time stamp in microseconds. It wraps
+*  after about 71 minutes, which unsigned differences tolerate.
+** ==========================================================================*/
+static OMX_U32 LatencyNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (OMX_U32)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+/* 0-3 us exact, then four buckets per power of two */
+static OMX_U32 LatencyBucket(OMX_U32 nUs)
+{
+    OMX_U32 nShift = 0;
+    OMX_U32 nBucket;
+
+    if (nUs < 4)
+    {
+        return nUs;
+    }
+    while ((nUs >> nShift) >= 8)
+    {
+        nShift++;
+    }
+    nBucket = 4 * (nShift + 1) + (nUs >> nShift) - 4;
+    return nBucket < LCML_LATENCY_BUCKETS ? nBucket : LCML_LATENCY_BUCKETS - 1;
+}
+
+/* largest latency counted in a bucket */
+static OMX_U32 LatencyBucketLimit(OMX_U32 nBucket)
+{
+    if (nBucket < 4)
+    {
+        return nBucket;
+    }
+    return ((nBucket % 4 + 5) << (nBucket / 4 - 1)) - 1;
+}
+
+static OMX_U32 LatencyPercentile(LCML_LATENCY_HIST *pHist, OMX_U32 nPercent)
+{
+    OMX_U32 nTarget = (pHist->nCount * nPercent + 99) / 100;
+    OMX_U32 nSeen = 0;
+    OMX_U32 i;
+
+    for (i = 0; i < LCML_LATENCY_BUCKETS; i++)
+    {
+        nSeen += pHist->buckets[i];
+        if (nSeen >= nTarget && nSeen > 0)
+        {
+            return LatencyBucketLimit(i) < pHist->nMax ? LatencyBucketLimit(i) : pHist->nMax;
+        }
+    }
+    return pHist->nMax;
+}
+
+/* buffers of a stream currently held by the DSP, with the LCML mutex held */
+static OMX_U32 LatencyInFlight(LCML_DSP_INTERFACE *hInterface, OMX_U32 streamId)
+{
+    TArmDspCommunicationStruct **storage = (streamId % 2) ? hInterface->Armoutputstorage : hInterface->Arminputstorage;
+    OMX_U32 nInFlight = 0;
+    OMX_U32 i;
+
+    for (i = 0; i < QUEUE_SIZE; i++)
+    {
+        if (storage[i] != NULL && storage[i]->iStreamID == streamId &&
+            !SlotPending(hInterface, storage[i]))
+        {
+            nInFlight++;
+        }
+    }
+    return nInFlight;
+}
+
+/** ========================================================================
+*  LatencyQueued () stamps a queue slot right before its buffer is sent to
+*  the DSP. Called with the LCML mutex held.
+*
+*  @param hInterface  - LCML handle
+*  @param streamId    - USN stream, even for input and odd for output
+*  @param slot        - index in Arminputstorage or Armoutputstorage
+** ==========================================================================*/
+static void LatencyQueued(LCML_DSP_INTERFACE *hInterface, OMX_U32 streamId, OMX_U32 slot)
+{
+    LCML_LATENCY_HIST *pHist;
+    OMX_U32 nInFlight;
+
+    if (streamId % 2)
+    {
+        hInterface->nOutputQueuedAt[slot] = LatencyNow();
+    }
+    else
+    {
+        hInterface->nInputQueuedAt[slot] = LatencyNow();
+    }
+    if (streamId < LCML_LATENCY_STREAMS)
+    {
+        pHist = &hInterface->latency[streamId];
+        /* the buffer being sent is still pending, count it as well */
+        nInFlight = LatencyInFlight(hInterface, streamId) + 1;
+        if (nInFlight > pHist->nPeakInFlight)
+        {
+            pHist->nPeakInFlight = nInFlight;
+        }
+    }
+}
+
+/** ========================================================================
+*  LatencyReturned () adds the round trip of a buffer released by the DSP
+*  with USN_DSPMSG_BUFF_FREE to the histogram of its stream. Called with
+*  the LCML mutex held.
+*
+*  @param hInterface  - LCML handle
+*  @param streamId    - USN stream, even for input and odd for output
+*  @param slot        - index the buffer had in the storage array
+** ==========================================================================*/
+static void LatencyReturned(LCML_DSP_INTERFACE *hInterface, OMX_U32 streamId, OMX_U32 slot)
+{
+    LCML_LATENCY_HIST *pHist;
+    OMX_U32 nUs;
+
+    if (streamId >= LCML_LATENCY_STREAMS || slot >= QUEUE_SIZE)
+    {
+        return;
+    }
+    nUs = LatencyNow() - ((streamId % 2) ? hInterface->nOutputQueuedAt[slot] : hInterface->nInputQueuedAt[slot]);
+    pHist = &hInterface->latency[streamId];
+    pHist->buckets[LatencyBucket(nUs)]++;
+    pHist->nCount++;
+    if (nUs > pHist->nMax)
+    {
+        pHist->nMax = nUs;
+    }
+}
+
+/** ========================================================================
+*  LatencyGetStats () summarises the histogram of a stream. Called with the
+*  LCML mutex held.
+** ==========================================================================*/
+static void LatencyGetStats(LCML_DSP_INTERFACE *hInterface, OMX_U32 streamId, LCML_LATENCY_STATS *pStats)
+{
+    LCML_LATENCY_HIST *pHist = &hInterface->latency[streamId];
+
+    pStats->nCount = pHist->nCount;
+    pStats->nP50 = LatencyPercentile(pHist, 50);
+    pStats->nP90 = LatencyPercentile(pHist, 90);
+    pStats->nP99 = LatencyPercentile(pHist, 99);
+    pStats->nMax = pHist->nMax;
+    pStats->nInFlight = LatencyInFlight(hInterface, streamId);
+    pStats->nPeakInFlight = pHist->nPeakInFlight;
+}
+
+/** ========================================================================
+*  LatencyReport () prints the latency summary of every active stream and
+*  logs it through PERF, where the real-time output shows it. Called with
+*  the LCML mutex held, about once a second from the thread receiving the
+*  DSP messages and once more when the codec is destroyed.
+*
+*  @param hInterface        - LCML handle
+*  @param bMessagingThread  - log to the messaging thread's PERF object
+** ==========================================================================*/
+static void LatencyReport(LCML_DSP_INTERFACE *hInterface, OMX_BOOL bMessagingThread)
+{
+    LCML_LATENCY_STATS stats;
+    OMX_U32 i;
+
+    hInterface->nLatencyReportedAt = LatencyNow();
+    for (i = 0; i < LCML_LATENCY_STREAMS; i++)
+    {
+        if (hInterface->latency[i].nCount == 0)
+        {
+            continue;
+        }
+        LatencyGetStats(hInterface, i, &stats);
+        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+                    "stream %lu DSP round trip: n=%lu p50=%lu p90=%lu p99=%lu max=%lu us, in flight %lu (peak %lu)\n",
+                    i, stats.nCount, stats.nP50, stats.nP90, stats.nP99, stats.nMax, stats.nInFlight, stats.nPeakInFlight);
+#ifdef __PERF_INSTRUMENTATION__
+        {
+            PERF_OBJHANDLE hPerf = bMessagingThread ? hInterface->pPERFcomp : hInterface->pPERF;
+
+            PERF_Log(hPerf, LCML_PERF_LOG_LAT_PCT | i, stats.nP50, stats.nP90);
+            PERF_Log(hPerf, LCML_PERF_LOG_LAT_MAX | i, stats.nP99, stats.nMax);
+            PERF_Log(hPerf, LCML_PERF_LOG_LAT_DEPTH | i, stats.nInFlight, stats.nPeakInFlight);
+        }
+#endif
+    }
+}
+
+/** ========================================================================
+*  CreateCommPool () allocates the ARM-DSP communication structures for every
+*  queue slot in one page aligned block and maps it to the DSP once, so that
+*  QueueBuffer does not have to allocate or map anything per buffer.
+*
+*  @param hInterface  - LCML handle, processor must already be attached
+*
+*  @retval OMX_ErrorNone                    Success
+*          OMX_ErrorInsufficientResources   Allocation or mapping failed
+** ==========================================================================*/
+static OMX_ERRORTYPE CreateCommPool(LCML_DSP_INTERFACE *hInterface)
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+
+    hInterface->pCommPool = (char *)memalign(DMM_PAGE_SIZE, LCML_COMM_POOL_SIZE);
+    if (hInterface->pCommPool == NULL)
+    {
+        OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+                "%d :: LCML:: cannot allocate comm struct pool\n", __LINE__);
+        eError = OMX_ErrorInsufficientResources;
+        goto EXIT;
+    }
+    memset(hInterface->pCommPool, 0, LCML_COMM_POOL_SIZE);
+    memset(&hInterface->commPoolDmmBuf, 0, sizeof(DMM_BUFFER_OBJ));
+
+    eError = DmmMap(hInterface->dspCodec->hProc, LCML_COMM_POOL_SIZE, hInterface->pCommPool,
+                    &hInterface->commPoolDmmBuf,
+                    ((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg);
+    if (eError != OMX_ErrorNone)
+    {
+        free(hInterface->pCommPool);
+        hInterface->pCommPool = NULL;
+        goto EXIT;
+    }
+    OMX_PRBUFFER2 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+            "comm struct pool %p mapped at %p, %d slots of %d bytes\n",
+            hInterface->pCommPool, hInterface->commPoolDmmBuf.pMapped,
+            2 * QUEUE_SIZE, (int)LCML_COMM_SLOT_SIZE);
+
+EXIT:
+    return eError;
+}
+
+/** ========================================================================
+*  DestroyCommPool () unmaps and frees the pool set up by CreateCommPool.
+*  Must be called once the messaging thread has exited.
+*
+*  @param hInterface  - LCML handle
+** ==========================================================================*/
+static void DestroyCommPool(LCML_DSP_INTERFACE *hInterface)
+{
+    if (hInterface->pCommPool == NULL)
+    {
+        return;
+    }
+    DmmUnMap(hInterface->dspCodec->hProc, hInterface->commPoolDmmBuf.pMapped,
+             hInterface->commPoolDmmBuf.pReserved,
+             ((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg);
+    free(hInterface->pCommPool);
+    hInterface->pCommPool = NULL;
+}
+
+/** ========================================================================
+*  RegisterStateNotify () registers the last notification of the node, its
+*  state change. The messaging thread waits on it with the DSP events, so
+*  that terminating the node ends that wait without a timeout.
+*
+*  @param hInterface  - LCML handle with a created node
+*
+*  @retval OMX_ErrorNone                    Success
+*          OMX_ErrorInsufficientResources   Out of memory
+*          OMX_ErrorHardware                Registration failed
+** ==========================================================================*/
+static OMX_ERRORTYPE RegisterStateNotify(LCML_DSP_INTERFACE *hInterface)
+{
+    struct DSP_NOTIFICATION *notification;
+    DSP_STATUS status;
+
+    LCML_MALLOC(notification, sizeof(struct DSP_NOTIFICATION), struct DSP_NOTIFICATION);
+    if (notification == NULL)
+    {
+        OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: malloc failed....\n", __LINE__);
+        return OMX_ErrorInsufficientResources;
+    }
+    memset(notification, 0, sizeof(struct DSP_NOTIFICATION));
+    /* owned by the handle from here, FreeResources releases it */
+    hInterface->g_aNotificationObjects[LCML_NOTIFY_STATECHANGE] = notification;
+
+    status = DSPNode_RegisterNotify(hInterface->dspCodec->hNode, DSP_NODESTATECHANGE, DSP_SIGNALEVENT, notification);
+    if (DSP_FAILED(status))
+    {
+        OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+                "%d :: LCML:: node state notification failed: 0x%lx\n", __LINE__, status);
+        return OMX_ErrorHardware;
+    }
+    return OMX_ErrorNone;
+}
+
+/* OMX_TRUE while the node runs or is paused, and so can still be terminated */
+static OMX_BOOL NodeRunning(LCML_DSP_INTERFACE *hInterface)
+{
+    struct DSP_NODEATTR nodeAttr;
+
+    if (hInterface->dspCodec == NULL || hInterface->dspCodec->hNode == NULL ||
+        DSP_FAILED(DSPNode_GetAttr(hInterface->dspCodec->hNode, &nodeAttr, sizeof(nodeAttr))))
+    {
+        return OMX_FALSE;
+    }
+    return (nodeAttr.iNodeInfo.nsExecutionState == NODE_RUNNING ||
+            nodeAttr.iNodeInfo.nsExecutionState == NODE_PAUSED) ? OMX_TRUE : OMX_FALSE;
+}
+
+/** ========================================================================
+*  TerminateNode () terminates the node unless it already stopped running.
+*  Destroy and DispatchUnregister call it before stopping the thread that
+*  serves the node, whose wait the resulting state change ends, and
+*  DeleteDspResource again for a node a failed init left running.
+*
+*  @param hInterface  - LCML handle
+*
+*  @retval DSP_SOK on success or when there is nothing to terminate
+** ==========================================================================*/
+static DSP_STATUS TerminateNode(LCML_DSP_INTERFACE *hInterface)
+{
+    DSP_STATUS nExit;
+    DSP_STATUS status;
+
+    if (!NodeRunning(hInterface))
+    {
+        return DSP_SOK;
+    }
+    status = DSPNode_Terminate(hInterface->dspCodec->hNode, &nExit);
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: LCML:: Node Has Been Terminated --1\n",__LINE__);
+    return status;
+}
+
+/** ========================================================================
+*  InitUndo () releases what a failed InitMMCodec or InitMMCodecEx set up,
+*  so that a failed init leaks neither the comm struct pool nor the node
+*  and its references on the processor attach and the node libraries.
+*  Safe on a partly initialised handle and when the component still sends
+*  EMMCodecControlDestroy afterwards.
+*
+*  @param hInterface  - LCML handle
+** ==========================================================================*/
+static void InitUndo(LCML_DSP_INTERFACE *hInterface)
+{
+    if (hInterface->pDispatcher != NULL)
+    {
+        DispatchUnregister(hInterface);
+    }
+    DestroyCommPool(hInterface);
+    DeleteDspResource(hInterface);
+}
+
+/** ========================================================================
+*  FindFreeSlot () returns the first queue slot at or after start (wrapping)
+*  whose comm struct is not owned by the DSP.
+*
+*  @param storage  - Arminputstorage or Armoutputstorage
+*  @param start    - slot to start searching from
+*
+*  @retval slot index, or -1 when every slot is in use
+** ==========================================================================*/
+static OMX_S32 FindFreeSlot(TArmDspCommunicationStruct *storage[], OMX_U32 start)
+{
+    OMX_U32 j;
+
+    for (j = 0; j < QUEUE_SIZE; j++)
+    {
+        OMX_U32 slot = (start + j) % QUEUE_SIZE;
+        if (storage[slot] == NULL)
+        {
+            return (OMX_S32)slot;
+        }
+    }
+    return -1;
+}
+
+/* a slot QueueBuffer has not sent to the DSP yet, with the LCML mutex held */
+static OMX_BOOL SlotPending(LCML_DSP_INTERFACE *hInterface, TArmDspCommunicationStruct *pComm)
+{
+    return (pComm == hInterface->pQueuePending[0] || pComm == hInterface->pQueuePending[1]) ? OMX_TRUE : OMX_FALSE;
+}
+
+/** ========================================================================
+* FreeResources () method is used to allocate the memory using DMM.
+*
+* @param hInterface  - Component identification number
+*
+* @retval OMX_ErrorNone           Success
+*         OMX_ErrorHardware       Hardware Error
+** ==========================================================================*/
+OMX_ERRORTYPE FreeResources (LCML_DSP_INTERFACE *hInterface)
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+    LCML_DSP_INTERFACE *codec;
+
+    OMX_PRINT1 ((struct OMX_TI_Debug)(((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg), "%d :: LCML:: FreeResources\n",__LINE__);
+    if(hInterface->dspCodec != NULL)
+    {
+        LCML_FREE(hInterface->dspCodec);
+        hInterface->dspCodec = NULL;
+    }
+    codec = (LCML_DSP_INTERFACE *)(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle)->pCodec);
+    if(codec != NULL)
+    {
+        pthread_mutex_destroy(&codec->m_isStopped_mutex);
+        pthread_mutex_lock(&codec->mutex);
+
+        if (codec->g_aNotificationObjects[LCML_NOTIFY_STATECHANGE] != NULL)
+        {
+            LCML_FREE(codec->g_aNotificationObjects[LCML_NOTIFY_STATECHANGE]);
+            codec->g_aNotificationObjects[LCML_NOTIFY_STATECHANGE] = NULL;
+        }
+
+        OMX_PRINT1 ((struct OMX_TI_Debug)(((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg), "%d :: LCML:: FreeResources\n",__LINE__);
+        if(codec->g_aNotificationObjects[0]!= NULL)
+        {
+            LCML_FREE(codec->g_aNotificationObjects[0]);
+            codec->g_aNotificationObjects[0] = NULL;
+#ifdef __ERROR_PROPAGATION__
+            if(codec->g_aNotificationObjects[1]!= NULL)
+            {
+                LCML_FREE(codec->g_aNotificationObjects[1]);
+                codec->g_aNotificationObjects[1] = NULL;
+            }
+            if(codec->g_aNotificationObjects[2]!= NULL)
+            {
+                LCML_FREE(codec->g_aNotificationObjects[2]);
+                codec->g_aNotificationObjects[2] = NULL;
+            }
+ #endif
+            OMX_DBG_CLOSE((struct OMX_TI_Debug )(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle)->dbg));
+            LCML_FREE(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle));
+            hInterface->pCodecinterfacehandle = NULL;
+        }
+        pthread_mutex_unlock(&codec->mutex);
+        pthread_mutex_destroy (&codec->mutex);
+        pthread_mutex_destroy (&codec->queueMutex[0]);
+        pthread_mutex_destroy (&codec->queueMutex[1]);
+        pthread_mutex_destroy (&codec->eventMutex);
+        pthread_cond_destroy (&codec->releaseCond);
+        LCML_FREE(codec);
+        codec = NULL;
+    }
+    return eError;
+}
+
+/** ========================================================================
+*  BridgeRelease () deletes the pooled nodes, unregisters every cached node
+*  library, releases the DSP address arena and detaches the shared
+*  processor handle. Called with g_bridgeMutex held and no users.
+** ==========================================================================*/
+static void BridgeRelease(void)
+{
+    OMX_U32 i;
+
+    NodePoolFlush();
+    for (i = 0; i < g_nRegisteredObjects; i++)
+    {
+        DSPManager_UnregisterObject(&g_registeredObjects[i].uuid, g_registeredObjects[i].eDllType);
+    }
+    g_nRegisteredObjects = 0;
+    if (g_hProc != NULL)
+    {
+        ArenaDestroy();
+        DSPProcessor_Detach(g_hProc);
+        DspManager_Close(0, NULL);
+        g_hProc = NULL;
+    }
+    g_bBridgeStale = OMX_FALSE;
+}
+
+/** ========================================================================
+*  BridgeAttach () hands out the process-wide processor handle, opening the
+*  bridge and attaching on first use. The attach is kept after the last
+*  user detaches so that a codec restart does not pay for it again; after a
+*  DSP fault the cache is dropped and the next user attaches afresh.
+*
+*  @param hInterface  - LCML handle, receives the processor handle
+*
+*  @retval DSP_SOK or the status of the failing bridge call
+** ==========================================================================*/
+static DSP_STATUS BridgeAttach(LCML_DSP_INTERFACE *hInterface)
+{
+    DSP_STATUS status = DSP_SOK;
+
+    pthread_mutex_lock(&g_bridgeMutex);
+    if (g_bBridgeStale && g_nProcUsers == 0)
+    {
+        BridgeRelease();
+    }
+    if (g_hProc == NULL)
+    {
+        status = DspManager_Open(0, NULL);
+        if (DSP_SUCCEEDED(status))
+        {
+            status = DSPProcessor_Attach(TI_PROCESSOR_DSP, NULL, &g_hProc);
+            if (DSP_FAILED(status))
+            {
+                DspManager_Close(0, NULL);
+                g_hProc = NULL;
+            }
+            else
+            {
+                ArenaCreate(g_hProc);
+            }
+        }
+    }
+    if (DSP_SUCCEEDED(status))
+    {
+        g_nProcUsers++;
+        hInterface->dspCodec->hProc = g_hProc;
+        hInterface->bBridgeAttached = OMX_TRUE;
+    }
+    pthread_mutex_unlock(&g_bridgeMutex);
+    return status;
+}
+
+/* drops the instance's use of the shared processor handle, which stays attached */
+static void BridgeDetach(LCML_DSP_INTERFACE *hInterface)
+{
+    if (!hInterface->bBridgeAttached)
+    {
+        return;
+    }
+    hInterface->bBridgeAttached = OMX_FALSE;
+    pthread_mutex_lock(&g_bridgeMutex);
+    if (g_nProcUsers > 0)
+    {
+        g_nProcUsers--;
+    }
+    if (g_bBridgeStale && g_nProcUsers == 0)
+    {
+        BridgeRelease();
+    }
+    pthread_mutex_unlock(&g_bridgeMutex);
+}
+
+/* the DSP faulted: redo the setup once the last user is gone */
+static void BridgeMarkStale(void)
+{
+    pthread_mutex_lock(&g_bridgeMutex);
+    g_bBridgeStale = OMX_TRUE;
+    pthread_mutex_unlock(&g_bridgeMutex);
+}
+
+/* tears the cache down when LCML is unloaded */
+static void __attribute__((destructor)) BridgeUnload(void)
+{
+    pthread_mutex_lock(&g_bridgeMutex);
+    g_bPoolStopping = OMX_TRUE;
+    if (g_bPoolThreadJoinable)
+    {
+        g_bPoolThreadJoinable = OMX_FALSE;
+        pthread_mutex_unlock(&g_bridgeMutex);
+        pthread_join(g_poolThread, NULL);
+        pthread_mutex_lock(&g_bridgeMutex);
+    }
+    if (g_nProcUsers == 0)
+    {
+        BridgeRelease();
+    }
+    pthread_mutex_unlock(&g_bridgeMutex);
+}
+
+/* cached registration of a node library, NULL if it is not registered */
+static LCML_REGISTERED_OBJECT *FindNodeObject(LCML_UUIDINFO *pInfo)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < g_nRegisteredObjects; i++)
+    {
+        if (g_registeredObjects[i].eDllType == pInfo->eDllType &&
+            !memcmp(&g_registeredObjects[i].uuid, pInfo->uuid, sizeof(struct DSP_UUID)) &&
+            !strncmp((char *)g_registeredObjects[i].DllName, (char *)pInfo->DllName, sizeof(pInfo->DllName)))
+        {
+            return &g_registeredObjects[i];
+        }
+    }
+    return NULL;
+}
+
+/** ========================================================================
+*  RegisterNodeObjects () registers the node libraries of the codec with the
+*  DCD unless an earlier instance already did. A full table evicts the
+*  libraries no running instance uses any more.
+*
+*  @param hInterface  - LCML handle with the node info filled in
+*
+*  @retval DSP_SOK, DSP_EINVALIDARG for a bad library path, DSP_EMEMORY
+*          when every cache slot is in use, or the bridge status
+** ==========================================================================*/
+static DSP_STATUS RegisterNodeObjects(LCML_DSP_INTERFACE *hInterface)
+{
+    DSP_STATUS status = DSP_SOK;
+    LCML_UUIDINFO *pInfo;
+    LCML_REGISTERED_OBJECT *pObject;
+    char abs_dsp_path[ABS_DLL_NAME_LENGTH];
+    OMX_U32 dllinfo, i, n;
+
+    pthread_mutex_lock(&g_bridgeMutex);
+    for (dllinfo = 0; dllinfo < hInterface->dspCodec->NodeInfo.nNumOfDLLs && DSP_SUCCEEDED(status); dllinfo++)
+    {
+        pInfo = &hInterface->dspCodec->NodeInfo.AllUUIDs[dllinfo];
+        pObject = FindNodeObject(pInfo);
+        if (pObject == NULL)
         {
-            OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "GOT notofication FROM DSP HANDLE IT \n");
+            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: Register Component Node\n", pInfo->eDllType);
+            if (g_nRegisteredObjects == LCML_MAX_REGISTERED_OBJECTS)
+            {
+                for (i = 0, n = 0; i < g_nRegisteredObjects; i++)
+                {
+                    if (g_registeredObjects[i].nRefs == 0)
+                    {
+                        DSPManager_UnregisterObject(&g_registeredObjects[i].uuid, g_registeredObjects[i].eDllType);
+                    }
+                    else
+                    {
+                        g_registeredObjects[n++] = g_registeredObjects[i];
+                    }
+                }
+                g_nRegisteredObjects = n;
+                if (n == LCML_MAX_REGISTERED_OBJECTS)
+                {
+                    status = DSP_EMEMORY;
+                    break;
+                }
+            }
+            if (append_dsp_path((char *)pInfo->DllName, abs_dsp_path) < 0)
+            {
+                OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: append_dsp_path returned an error!\n", __LINE__);
+                status = DSP_EINVALIDARG;
+                break;
+            }
+            status = DSPManager_RegisterObject(pInfo->uuid, pInfo->eDllType, abs_dsp_path);
+            if (DSP_FAILED(status))
+            {
+                break;
+            }
+            pObject = &g_registeredObjects[g_nRegisteredObjects++];
+            pObject->uuid = *pInfo->uuid;
+            pObject->eDllType = pInfo->eDllType;
+            strncpy((char *)pObject->DllName, (char *)pInfo->DllName, sizeof(pObject->DllName));
+            pObject->nRefs = 0;
+        }
+        pObject->nRefs++;
+    }
+    if (DSP_FAILED(status))
+    {
+        /* drop the references taken for the libraries before the failing one */
+        for (i = 0; i < dllinfo; i++)
+        {
+            pObject = FindNodeObject(&hInterface->dspCodec->NodeInfo.AllUUIDs[i]);
+            if (pObject != NULL && pObject->nRefs > 0)
+            {
+                pObject->nRefs--;
+            }
+        }
+    }
+    else
+    {
+        hInterface->bNodeObjectsRegistered = OMX_TRUE;
+    }
+    pthread_mutex_unlock(&g_bridgeMutex);
+    return status;
+}
+
+/* releases the node libraries of the codec, they stay registered */
+static void UnregisterNodeObjects(LCML_DSP_INTERFACE *hInterface)
+{
+    LCML_REGISTERED_OBJECT *pObject;
+    OMX_U32 dllinfo;
+
+    if (!hInterface->bNodeObjectsRegistered)
+    {
+        return;
+    }
+    hInterface->bNodeObjectsRegistered = OMX_FALSE;
+    pthread_mutex_lock(&g_bridgeMutex);
+    for (dllinfo = 0; dllinfo < hInterface->dspCodec->NodeInfo.nNumOfDLLs; dllinfo++)
+    {
+        pObject = FindNodeObject(&hInterface->dspCodec->NodeInfo.AllUUIDs[dllinfo]);
+        if (pObject != NULL && pObject->nRefs > 0)
+        {
+            pObject->nRefs--;
+        }
+    }
+    pthread_mutex_unlock(&g_bridgeMutex);
+}
+
+/** ========================================================================
+*  SetupPhaseDone () reports how long a node setup phase took and starts
+*  timing the next one.
+*
+*  @param hInterface  - LCML handle
+*  @param nPhase      - LCML_SETUP_xxx phase that just completed
+*  @param tStart      - LatencyNow() when the setup started
+*  @param ptPhase     - LatencyNow() when the phase started, updated
+** ==========================================================================*/
+static void SetupPhaseDone(LCML_DSP_INTERFACE *hInterface, OMX_U32 nPhase, OMX_U32 tStart, OMX_U32 *ptPhase)
+{
+    static const char *phaseNames[] = {"attach", "register", "allocate", "create", "run", "messaging"};
+    OMX_U32 now = LatencyNow();
+
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+                "setup %s took %lu us, %lu us so far\n", phaseNames[nPhase], now - *ptPhase, now - tStart);
+#ifdef __PERF_INSTRUMENTATION__
+    PERF_Log(hInterface->pPERF, LCML_PERF_LOG_SETUP | nPhase, now - *ptPhase, now - tStart);
+#endif
+    *ptPhase = now;
+}
+
+/* nodes kept per configuration, read from LCML_NODE_POOL; g_bridgeMutex held */
+static OMX_U32 NodePoolDepth(void)
+{
+    char *value;
+    int nDepth = 0;
+
+    if (g_nPoolDepth < 0)
+    {
+        value = getenv("LCML_NODE_POOL");
+        if (value != NULL)
+        {
+            nDepth = atoi(value);
+        }
+        if (nDepth < 0)
+        {
+            nDepth = 0;
+        }
+        if (nDepth > LCML_NODE_POOL_MAX_DEPTH)
+        {
+            nDepth = LCML_NODE_POOL_MAX_DEPTH;
+        }
+        g_nPoolDepth = nDepth;
+    }
+    return (OMX_U32)g_nPoolDepth;
+}
+
+/* pool of the configuration, NULL if it was never started; g_bridgeMutex held */
+static LCML_NODE_POOL_CONFIG *NodePoolFind(struct DSP_UUID *pUuid, LCML_CREATEPHASEARGS *pCrData,
+                                           struct DSP_NODEATTRIN *pAttrIn)
+{
+    LCML_NODE_POOL_CONFIG *pConfig;
+    OMX_U32 i;
+
+    for (i = 0; i < g_nPoolConfigs; i++)
+    {
+        pConfig = &g_poolConfigs[i];
+        if (!memcmp(&pConfig->uuid, pUuid, sizeof(struct DSP_UUID)) &&
+            pConfig->crData.cbData == pCrData->cbData &&
+            !memcmp(pConfig->crData.cData, pCrData->cData, pCrData->cbData) &&
+            pConfig->attrIn.iPriority == pAttrIn->iPriority &&
+            pConfig->attrIn.uTimeout == pAttrIn->uTimeout &&
+            pConfig->attrIn.uProfileID == pAttrIn->uProfileID)
+        {
+            return pConfig;
+        }
+    }
+    return NULL;
+}
+
+/** ========================================================================
+*  NodePoolTake () hands out an idle node created with the same create phase
+*  arguments and attributes, so the caller can skip DSPNode_Allocate and
+*  DSPNode_Create. Nodes connected to a DASF node are never pooled because
+*  the connection has to be made before the node is created.
+*
+*  @param hInterface  - LCML handle, receives the node on a hit
+*  @param pCrData     - create phase arguments of the codec
+*  @param pAttrIn     - node attributes of the codec
+*
+*  @retval OMX_TRUE if hInterface->dspCodec->hNode is a created pooled node
+** ==========================================================================*/
+static OMX_BOOL NodePoolTake(LCML_DSP_INTERFACE *hInterface, LCML_CREATEPHASEARGS *pCrData, struct DSP_NODEATTRIN *pAttrIn)
+{
+    LCML_NODE_POOL_CONFIG *pConfig;
+    OMX_BOOL bHit = OMX_FALSE;
+
+    if (hInterface->dspCodec->DeviceInfo.TypeofDevice == 1)
+    {
+        return OMX_FALSE;
+    }
+    pthread_mutex_lock(&g_bridgeMutex);
+    pConfig = NodePoolFind(hInterface->dspCodec->NodeInfo.AllUUIDs[0].uuid, pCrData, pAttrIn);
+    if (pConfig != NULL && pConfig->nNodes > 0 && !g_bBridgeStale)
+    {
+        hInterface->dspCodec->hNode = pConfig->hNodes[--pConfig->nNodes];
+        bHit = OMX_TRUE;
+    }
+    pthread_mutex_unlock(&g_bridgeMutex);
+    return bHit;
+}
+
+/** ========================================================================
+*  NodePoolThread () tops every pool up to the configured depth in the
+*  background, then exits. The node is created outside g_bridgeMutex with
+*  a processor reference held so the attach cannot go away meanwhile.
+** ==========================================================================*/
+static void* NodePoolThread(void *arg)
+{
+    LCML_NODE_POOL_CONFIG *pConfig, config;
+    DSP_HPROCESSOR hProc;
+    DSP_HNODE hNode;
+    DSP_STATUS status;
+    OMX_U32 i;
+
+    pthread_mutex_lock(&g_bridgeMutex);
+    while (!g_bPoolStopping && !g_bBridgeStale && g_hProc != NULL)
+    {
+        for (i = 0, pConfig = NULL; i < g_nPoolConfigs; i++)
+        {
+            if (!g_poolConfigs[i].bFailed && g_poolConfigs[i].nNodes < NodePoolDepth())
+            {
+                pConfig = &g_poolConfigs[i];
+                break;
+            }
+        }
+        if (pConfig == NULL)
+        {
+            break;
+        }
+        config = *pConfig;
+        hProc = g_hProc;
+        g_nProcUsers++;
+        pthread_mutex_unlock(&g_bridgeMutex);
+
+        hNode = NULL;
+        status = DSPNode_Allocate(hProc, &config.uuid, (struct DSP_CBDATA *)&config.crData,
+                                  &config.attrIn, &hNode);
+        if (DSP_SUCCEEDED(status))
+        {
+            status = DSPNode_Create(hNode);
+        }
+
+        pthread_mutex_lock(&g_bridgeMutex);
+        pConfig = NodePoolFind(&config.uuid, &config.crData, &config.attrIn);
+        if (DSP_SUCCEEDED(status) && pConfig != NULL && pConfig->nNodes < NodePoolDepth() &&
+            !g_bBridgeStale && !g_bPoolStopping)
+        {
+            pConfig->hNodes[pConfig->nNodes++] = hNode;
+            hNode = NULL;
+        }
+        else if (DSP_FAILED(status) && pConfig != NULL)
+        {
+            pConfig->bFailed = OMX_TRUE;
+        }
+        if (hNode != NULL)
+        {
+            DSPNode_Delete(hNode);
+        }
+        g_nProcUsers--;
+    }
+    g_bPoolThreadRunning = OMX_FALSE;
+    pthread_mutex_unlock(&g_bridgeMutex);
+    return NULL;
+}
+
+/** ========================================================================
+*  NodePoolStarted () accounts a codec start, reports the pool hit rate and
+*  start time, and asks the pool thread to replace the node just used. The
+*  first start of a configuration creates its pool, replacing the least
+*  recently started configuration when the table is full.
+*
+*  @param hInterface  - LCML handle
+*  @param pCrData     - create phase arguments of the codec
+*  @param pAttrIn     - node attributes of the codec
+*  @param bHit        - the node came from the pool
+*  @param tStart      - LatencyNow() when the setup started
+** ==========================================================================*/
+static void NodePoolStarted(LCML_DSP_INTERFACE *hInterface, LCML_CREATEPHASEARGS *pCrData, struct DSP_NODEATTRIN *pAttrIn,
+                            OMX_BOOL bHit, OMX_U32 tStart)
+{
+    LCML_NODE_POOL_CONFIG *pConfig;
+    OMX_U32 nStart = LatencyNow() - tStart;
+    OMX_U32 nStarts, nHits, i;
+
+    pthread_mutex_lock(&g_bridgeMutex);
+    nStarts = ++g_nPoolStarts;
+    nHits = bHit ? ++g_nPoolHits : g_nPoolHits;
+    if (NodePoolDepth() > 0 && hInterface->dspCodec->DeviceInfo.TypeofDevice != 1)
+    {
+        pConfig = NodePoolFind(hInterface->dspCodec->NodeInfo.AllUUIDs[0].uuid, pCrData, pAttrIn);
+        if (pConfig == NULL)
+        {
+            if (g_nPoolConfigs < LCML_NODE_POOL_MAX_CONFIGS)
+            {
+                pConfig = &g_poolConfigs[g_nPoolConfigs++];
+            }
+            else
+            {
+                pConfig = &g_poolConfigs[0];
+                for (i = 1; i < g_nPoolConfigs; i++)
+                {
+                    if (nStarts - g_poolConfigs[i].nLastUsed > nStarts - pConfig->nLastUsed)
+                    {
+                        pConfig = &g_poolConfigs[i];
+                    }
+                }
+                while (pConfig->nNodes > 0)
+                {
+                    DSPNode_Delete(pConfig->hNodes[--pConfig->nNodes]);
+                }
+            }
+            pConfig->uuid = *hInterface->dspCodec->NodeInfo.AllUUIDs[0].uuid;
+            pConfig->crData.cbData = pCrData->cbData;
+            memcpy(pConfig->crData.cData, pCrData->cData, pCrData->cbData);
+            pConfig->attrIn = *pAttrIn;
+            pConfig->nNodes = 0;
+        }
+        pConfig->nLastUsed = nStarts;
+        pConfig->bFailed = OMX_FALSE;
+        if (!g_bPoolThreadRunning && !g_bPoolStopping)
+        {
+            /* the last refill has finished and only waits to be reaped; it
+             * cleared g_bPoolThreadRunning under the mutex, so this is quick */
+            if (g_bPoolThreadJoinable)
+            {
+                pthread_join(g_poolThread, NULL);
+                g_bPoolThreadJoinable = OMX_FALSE;
+            }
+            if (!pthread_create(&g_poolThread, NULL, NodePoolThread, NULL))
+            {
+                g_bPoolThreadRunning = OMX_TRUE;
+                g_bPoolThreadJoinable = OMX_TRUE;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_bridgeMutex);
+
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+                "node pool %s, %lu of %lu starts from the pool, started in %lu us\n",
+                bHit ? "hit" : "miss", nHits, nStarts, nStart);
+#ifdef __PERF_INSTRUMENTATION__
+    PERF_Log(hInterface->pPERF, LCML_PERF_LOG_POOL, nHits, nStarts - nHits);
+    PERF_Log(hInterface->pPERF, LCML_PERF_LOG_POOL_START, (nStart & ~1) | (bHit ? 1 : 0), 0);
+#endif
+}
+
+/* deletes every pooled node, the configurations are kept; g_bridgeMutex held */
+static void NodePoolFlush(void)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < g_nPoolConfigs; i++)
+    {
+        while (g_poolConfigs[i].nNodes > 0)
+        {
+            DSPNode_Delete(g_poolConfigs[i].hNodes[--g_poolConfigs[i].nNodes]);
+        }
+    }
+}
+
+/** ========================================================================
+* DeleteDspResource () method is used to allocate the memory using DMM.
+*
+* @param hInterface                   Component identification number
+*
+* @retval OMX_ErrorNone           Success
+*         OMX_ErrorHardware       Hardware Error
+** ==========================================================================*/
+OMX_ERRORTYPE DeleteDspResource(LCML_DSP_INTERFACE *hInterface)
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+    DSP_STATUS status;
+    LCML_DSP_INTERFACE *codec;
+
+    codec = (LCML_DSP_INTERFACE *)(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle)->pCodec);
+#ifdef __ERROR_PROPAGATION__
+    /* the processor handle is shared and outlives this node, so the
+     * processor notifications have to be dropped explicitly */
+    if(codec->g_aNotificationObjects[1]!= NULL)
+    {
+        DSPProcessor_RegisterNotify(hInterface->dspCodec->hProc, 0, DSP_SIGNALEVENT, codec->g_aNotificationObjects[1]);
+    }
+    if(codec->g_aNotificationObjects[2]!= NULL)
+    {
+        DSPProcessor_RegisterNotify(hInterface->dspCodec->hProc, 0, DSP_SIGNALEVENT, codec->g_aNotificationObjects[2]);
+    }
+#endif
+    /* init may have failed before the node was allocated */
+    if (hInterface->dspCodec->hNode == NULL) {
+        goto EXIT;
+    }
+
+    /* Destroy terminated it already, a failed init may not have */
+    TerminateNode(hInterface);
+    if (hInterface->dspCodec->DeviceInfo.TypeofDevice == 1 &&
+        hInterface->dspCodec->hDasfNode != NULL) {
+        /* delete DASF node */
+        status = DSPNode_Delete(hInterface->dspCodec->hDasfNode);
+        DSP_ERROR_EXIT (status, "DeInit: DASF Node Delete ", EXIT);
+        hInterface->dspCodec->hDasfNode = NULL;
+        OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: Deleted the DASF node Successfully\n",__LINE__);
+    }
+	/* delete SN */
+    status = DSPNode_Delete(hInterface->dspCodec->hNode);
+    DSP_ERROR_EXIT (status, "DeInit: Codec Node Delete ", EXIT);
+    hInterface->dspCodec->hNode = NULL;
+    OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: Deleted the node Successfully\n",__LINE__);
+
+EXIT:
+    /* released on every path, or a failed delete pins g_nProcUsers and
+     * stale recovery never runs. The libraries stay registered and the
+     * processor attached for the next instance, see BridgeAttach() */
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: Entering UnLoadDLLs \n", __LINE__);
+    UnregisterNodeObjects(hInterface);
+    BridgeDetach(hInterface);
+    return eError;
+
+}
+
+
+/** ========================================================================
+* This is the function run in the message thread.  It waits for an event
+* signal from Bridge and then reads all available messages. For a node
+* registered with a dispatcher thread that was blocked at the time, it
+* only bridges the gap and leaves once the dispatcher took the node over.
+*
+* @param[in] arg  Unused - Required by pthreads API
+*
+* @retval  OMX_ErrorNone Success, ready to roll
+** ==========================================================================*/
+void* MessagingThread(void* arg)
+{
+    DSP_STATUS status = DSP_SOK;
+    unsigned int index=0;
+#ifdef __PERF_INSTRUMENTATION__
+    PERF_OBJHANDLE pPERF;
+#endif
+
+#ifdef ANDROID
+    prctl(PR_SET_NAME, (unsigned long)"Messaging", 0, 0, 0);
+#endif
+
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Inside the Messaging thread\n");
+#ifdef __PERF_INSTRUMENTATION__
+    /* a dispatcher thread may take pPERFcomp over before this one ends */
+    pPERF = PERF_Create(PERF_FOURCC('C','M','L','T'),
+                        PERF_ModuleAudioDecode | PERF_ModuleAudioEncode |
+                        PERF_ModuleVideoDecode | PERF_ModuleVideoEncode |
+                        PERF_ModuleImageDecode | PERF_ModuleImageEncode |
+                        PERF_ModuleCommonLayer);
+    ((LCML_DSP_INTERFACE *)arg)->pPERFcomp = pPERF;
+#endif
+    if (((LCML_DSP_INTERFACE *)arg)->ReUseMap)
+    {
+        pthread_mutex_lock(&((LCML_DSP_INTERFACE *)arg)->m_isStopped_mutex);
+    }
+
+    /* get message from DSP */
+    while (1)
+    {
+        if (((LCML_DSP_INTERFACE *)arg)->pshutdownFlag == 1)
+        {
+            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Breaking out of loop inmessaging thread \n");
+            break;
+        }
+
+        /* Destroy ends the wait by terminating the node. If the DSP is
+         * gone no state change comes, and the timeout lets the thread see
+         * pshutdownFlag. Once the node stopped by itself or the DSP failed
+         * no event can end the wait any more, so the thread leaves then */
+        status = DSPManager_WaitForEvents(((LCML_DSP_INTERFACE *)arg)->g_aNotificationObjects,
+                                          LCML_NUM_NOTIFICATIONS, &index, LCML_EVENT_TIMEOUT_MS);
+        if (DSP_SUCCEEDED(status) && index == LCML_NOTIFY_STATECHANGE)
+        {
+            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Node state changed\n");
+            if (!NodeRunning((LCML_DSP_INTERFACE *)arg))
+            {
+                if (((LCML_DSP_INTERFACE *)arg)->pshutdownFlag != 1)
+                {
+                    /* hand back what the node sent before it stopped */
+                    pthread_mutex_lock(&((LCML_DSP_INTERFACE *)arg)->eventMutex);
+                    ProcessNodeEvents(arg, 0);
+                    pthread_mutex_unlock(&((LCML_DSP_INTERFACE *)arg)->eventMutex);
+                }
+                break;
+            }
+        }
+        else if (DSP_SUCCEEDED(status))
+        {
+#ifdef __ERROR_PROPAGATION__
+            /* the dispatcher thread gets the processor event as well and
+             * reports it once it serves the node */
+            if (index != 0 && ((LCML_DSP_INTERFACE *)arg)->pDispatcher != NULL)
+            {
+                break;
+            }
+#endif
+            pthread_mutex_lock(&((LCML_DSP_INTERFACE *)arg)->eventMutex);
+            ProcessNodeEvents(arg, index);
+            pthread_mutex_unlock(&((LCML_DSP_INTERFACE *)arg)->eventMutex);
+#ifdef __ERROR_PROPAGATION__
+            if (index != 0)
+            {
+                break;
+            }
+#endif
+        }
+        else if (status != DSP_ETIMEOUT)
+        {
+            OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "%d :: DSPManager_WaitForEvents() failed: 0x%lx",__LINE__, status);
+        }
+        if (DispatchAdopted((LCML_DSP_INTERFACE *)arg))
+        {
+            break;
+        }
+
+    } /* end of external while(1) loop */
+
+	/* 720p implementation */
+    if (((LCML_DSP_INTERFACE *)arg)->ReUseMap)
+    {
+        pthread_mutex_unlock(&((LCML_DSP_INTERFACE *)arg)->m_isStopped_mutex);
+    }
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Exiting LOOP of LCML \n");
+#ifdef __PERF_INSTRUMENTATION__
+    PERF_Done(pPERF);
+#endif
+    return (void*)OMX_ErrorNone;
+}
+
+
+/** ========================================================================
+* Handles one signalled notification of a node: pulls every pending message
+* off the node and dispatches it (index 0), or reports an MMU fault or a
+* DSP system error (index 1 and 2). Runs on the instance's messaging thread
+* or on a shared dispatcher thread.
+*
+* @param[in] arg    LCML_DSP_INTERFACE of the node
+* @param[in] index  Index of the signalled object in g_aNotificationObjects
+** ==========================================================================*/
+static void ProcessNodeEvents(void *arg, unsigned int index)
+{
+    DSP_STATUS status = DSP_SOK;
+    struct DSP_MSG msg = {0,0,0};
+
+    // There is no need to set a timeout value for message retrieval.
+    // Just in case that we need to change it to a different value
+    // such as 10 ms?
+    const int getMessageTimeout = 0;
+
+    OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "GOT notofication FROM DSP HANDLE IT \n");
 #ifdef __ERROR_PROPAGATION__
-            if (index == 0){
+    if (index == 0){
+#endif
+    /* Pull all available messages out of the message loop */
+    while (DSP_SUCCEEDED(status))
+    {
+        /* since there is a message waiting, grab it and pass  */
+        status = DSPNode_GetMessage(((LCML_DSP_INTERFACE *)arg)->dspCodec->hNode, &msg, getMessageTimeout);
+        if (DSP_SUCCEEDED(status))
+        {
+            OMX_U32 streamId = (msg.dwCmd & 0x000000ff);
+            int commandId = msg.dwCmd & 0xffffff00;
+            TMMCodecBufferType bufType ;/* = EMMCodecScratchBuffer; */
+            TUsnCodecEvent  event = EMMCodecInternalError;
+            void * args[10] = {};
+            TArmDspCommunicationStruct  *tmpDspStructAddress = NULL;
+            LCML_DSP_INTERFACE *hDSPInterface = ((LCML_DSP_INTERFACE *)arg) ;
+            DMM_BUFFER_OBJ* pDmmBuf = NULL;
+            int nSlot = -1;
+
+            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                    "GOT MESSAGE FROM DSP HANDLE IT  %d \n", index);
+            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                    "msg = 0x%lx arg1 = 0x%lx arg2 = 0x%lx", msg.dwCmd, msg.dwArg1, msg.dwArg2);
+            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                    "Message EMMCodecOuputBuffer outside loop");
+#ifdef __PERF_INSTRUMENTATION__
+            PERF_ReceivedCommand(hDSPInterface->pPERFcomp,
+                                 msg.dwCmd, msg.dwArg1,
+                                 PERF_ModuleSocketNode);
 #endif
-            /* Pull all available messages out of the message loop */
-            while (DSP_SUCCEEDED(status))
+
+            if (commandId == USN_DSPMSG_BUFF_FREE )
             {
-                /* since there is a message waiting, grab it and pass  */
-                status = DSPNode_GetMessage(((LCML_DSP_INTERFACE *)arg)->dspCodec->hNode, &msg, getMessageTimeout);
-                if (DSP_SUCCEEDED(status))
+#ifdef __PERF_INSTRUMENTATION__
+                                PERF_XferingBuffer(hDSPInterface->pPERFcomp,
+                                                  args [1],
+                                                  (OMX_U32) args [8],
+                                                  PERF_ModuleSocketNode,
+                                                  PERF_ModuleLLMM);
+#endif
+                pthread_mutex_lock(&hDSPInterface->mutex);
+                if (!(streamId % 2))
                 {
-                    OMX_U32 streamId = (msg.dwCmd & 0x000000ff);
-                    int commandId = msg.dwCmd & 0xffffff00;
-                    TMMCodecBufferType bufType ;/* = EMMCodecScratchBuffer; */
-                    TUsnCodecEvent  event = EMMCodecInternalError;
-                    void * args[10] = {};
-                    TArmDspCommunicationStruct  *tmpDspStructAddress = NULL;
-                    LCML_DSP_INTERFACE *hDSPInterface = ((LCML_DSP_INTERFACE *)arg) ;
-                    DMM_BUFFER_OBJ* pDmmBuf = NULL;
-
+                    int i = 0;
+                    int j = 0;
+                    bufType = streamId + EMMCodecStream0;
                     OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                            "GOT MESSAGE FROM DSP HANDLE IT  %d \n", index);
+                            "Address Arminputstorage %p \n", ((LCML_DSP_INTERFACE *)arg)->Arminputstorage);
                     OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                            "msg = 0x%lx arg1 = 0x%lx arg2 = 0x%lx", msg.dwCmd, msg.dwArg1, msg.dwArg2);
+                            "Address dspinterface %p \n", ((LCML_DSP_INTERFACE *)arg));
+
+                    hDSPInterface->iBufinputcount = hDSPInterface->iBufinputcount % QUEUE_SIZE;
+                    i = hDSPInterface->iBufinputcount;
+                    while(j++ < QUEUE_SIZE)
+                    {
+                        if (hDSPInterface->Arminputstorage[i] != NULL && hDSPInterface ->Arminputstorage[i]->iArmArg == msg.dwArg1)
+                        {
+                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "InputBuffer loop");
+                            tmpDspStructAddress = ((LCML_DSP_INTERFACE *)arg)->Arminputstorage[i] ;
+                            nSlot = i;
+                            pDmmBuf = hDSPInterface ->dspCodec->InDmmBuffer;
+                            pDmmBuf = pDmmBuf + (tmpDspStructAddress->BufInindex);
+                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Address output  matching index= %ld \n ",tmpDspStructAddress->BufInindex);
+                            break;
+                        }
+                        i++;
+                        i = i % QUEUE_SIZE;
+                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Message EMMCodecInputBuffer loop");
+                    }
+                }
+                else if (streamId % 2)
+                {
+                    int i = 0;
+                    int j = 0;
+                    bufType = streamId + EMMCodecStream0;;
+                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Address Armoutputstorage %p \n ",((LCML_DSP_INTERFACE *)arg)->Armoutputstorage);
+                    OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Address dspinterface %p \n ",((LCML_DSP_INTERFACE *)arg));
+
+                    hDSPInterface->iBufoutputcount = hDSPInterface->iBufoutputcount % QUEUE_SIZE;
+                    i = hDSPInterface->iBufoutputcount;
+                    while(j++ < QUEUE_SIZE)
+                    {
+                        if( hDSPInterface ->Armoutputstorage[i] != NULL
+                                && hDSPInterface ->Armoutputstorage[i]->iArmArg == msg.dwArg1)
+                        {
+                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "output buffer loop");
+                            tmpDspStructAddress = hDSPInterface->Armoutputstorage[i] ;
+                            nSlot = i;
+                            pDmmBuf = hDSPInterface ->dspCodec->OutDmmBuffer;
+                            pDmmBuf = pDmmBuf + (tmpDspStructAddress->Bufoutindex);
+                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                    "Address output  matching index= %ld\n ",tmpDspStructAddress->Bufoutindex);
+                            break;
+                        }
+                        i++;
+                        i = i % QUEUE_SIZE;
+                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                "Message EMMCodecOuputBuffer loop");
+                    }
+                }
+
+                if (tmpDspStructAddress != NULL)
+                {
+                    LatencyReturned(hDSPInterface, streamId,
+                                    (streamId % 2) ? tmpDspStructAddress->Bufoutindex : tmpDspStructAddress->BufInindex);
+                    if (LatencyNow() - hDSPInterface->nLatencyReportedAt >= LCML_LATENCY_REPORT_US)
+                    {
+                        LatencyReport(hDSPInterface, OMX_TRUE);
+                    }
+                }
+                pthread_mutex_unlock(&hDSPInterface->mutex);
+
+                /* the slot is released only after the unmap, so neither the comm
+                 * struct nor its DMM object can be reused while the bridge calls
+                 * run without the mutex */
+                if (tmpDspStructAddress != NULL)
+                {
+                    /* invalidated on its own and before anything is read
+                     * from it: the parameter range below has to be the one
+                     * the DSP left in the comm struct, so it cannot share
+                     * a batched call with the comm struct */
+                    status = DSPProcessor_InvalidateMemory(hDSPInterface->dspCodec->hProc,
+                                    tmpDspStructAddress, sizeof(TArmDspCommunicationStruct));
+                    if (DSP_FAILED(status)) {
+                        LOGE("Invalidate for communication structure failed. status = 0x%x\n", status);
+                    }
+
+                    // Only invalidate the memory when the pointer points to some valid memory region
+                    // otherwise, we will get logging spam
+                    if (tmpDspStructAddress->iArmParamArg != NULL && tmpDspStructAddress->iParamSize > 0) {
+                        status = DSPProcessor_InvalidateMemory(hDSPInterface->dspCodec->hProc,
+                                        (PVOID)tmpDspStructAddress->iArmParamArg, tmpDspStructAddress->iParamSize);
+                        if (DSP_FAILED(status)) {
+                            LOGE("Invalidate for arm parameter arguments failed. status = 0x%x\n", status);
+                        }
+                    }
+
+                    event = EMMCodecBufferProcessed;
+                    args[0] = (void *) bufType;
+                    args[1] = (void *) tmpDspStructAddress->iArmbufferArg; /* arm address fpr buffer */
+                    args[2] = (void *) tmpDspStructAddress->iBufferSize;
+                    args[3] = (void *) tmpDspStructAddress->iArmParamArg; /* arm address for param */
+                    args[4] = (void *) tmpDspStructAddress->iParamSize;
+                    args[5] = (void *) tmpDspStructAddress->iArmArg;
+                    args[6] = (void *) arg;  /* handle */
+                    args[7] = (void *) tmpDspStructAddress->iUsrArg;  /* user arguments */
+
+                    if (((LCML_DSP_INTERFACE *)arg)->bUsnEos) {
+                        ((OMX_BUFFERHEADERTYPE*)args[7])->nFlags |= tmpDspStructAddress->iEOSFlag;
+                    }
+                    /* USN updates*/
+                    args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
+                    /* managing buffers  and free buffer logic */
+
                     OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                            "Message EMMCodecOuputBuffer outside loop");
-#ifdef __PERF_INSTRUMENTATION__
-                    PERF_ReceivedCommand(hDSPInterface->pPERFcomp,
-                                         msg.dwCmd, msg.dwArg1,
-                                         PERF_ModuleSocketNode);
-#endif
+                            "GOT MESSAGE EMMCodecBufferProcessed  and now unmapping buffer type %p \n", args[2]);
 
-                    if (commandId == USN_DSPMSG_BUFF_FREE )
+                    if (tmpDspStructAddress ->iBufferPtr != (OMX_U32)NULL)
                     {
-                        threadState = EMessagingThreadCodecRunning;
- #ifdef __PERF_INSTRUMENTATION__
-                                        PERF_XferingBuffer(hDSPInterface->pPERFcomp,
-                                                          args [1],
-                                                          (OMX_U32) args [8],
-                                                          PERF_ModuleSocketNode,
-                                                          PERF_ModuleLLMM);
-#endif
-                        pthread_mutex_lock(&hDSPInterface->mutex);
-                        if (!(streamId % 2))
+                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                "GOT MESSAGE EMMCodecBufferProcessed and now unmapping buufer %lx\n size=%ld",
+                                     tmpDspStructAddress ->iBufferPtr, tmpDspStructAddress ->iBufferSize);
+                        /* 720p implementation */
+                        if (!pDmmBuf->bCached)
                         {
-                            int i = 0;
-                            int j = 0;
-                            bufType = streamId + EMMCodecStream0;
-                            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                    "Address Arminputstorage %p \n", ((LCML_DSP_INTERFACE *)arg)->Arminputstorage);
-                            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                    "Address dspinterface %p \n", ((LCML_DSP_INTERFACE *)arg));
+                            DmmUnMap(hDSPInterface->dspCodec->hProc,
+                                    (void*)tmpDspStructAddress->iBufferPtr,
+                                    pDmmBuf->bufReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                        }
+                    }
+
+                    if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
+                    {
+                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                "GOT MESSAGE EMMCodecBufferProcessed and now unmapping parameter buufer\n");
+
+                        DmmUnMap(hDSPInterface ->dspCodec->hProc,
+                                 (void*)tmpDspStructAddress->iParamPtr,
+                                 pDmmBuf->paramReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                    }
+
+                    pthread_mutex_lock(&hDSPInterface->mutex);
+                    if (streamId % 2)
+                    {
+                        hDSPInterface->Armoutputstorage[nSlot] = NULL;
+                    }
+                    else
+                    {
+                        hDSPInterface->Arminputstorage[nSlot] = NULL;
+                    }
+                    pthread_mutex_unlock(&hDSPInterface->mutex);
+                    /* free(tmpDspStructAddress); */
+                    tmpDspStructAddress = NULL;
+                }
+            } /* End of USN_DSPMSG_BUFF_FREE */
+
+            else if (commandId == USN_DSPACK_STOP)
+            {
+
+                /* Start of USN_DSPACK_STOP */
+                int i = 0;
+                int j = 0;
+                int k = 0;
+                OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                        "GOT MESSAGE EMMCodecProcessingStoped \n");
+                pthread_mutex_lock(&hDSPInterface->mutex);
+                OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                        "LCMLSTOP: hDSPInterface->dspCodec->DeviceInfo.TypeofDevice %d\n", hDSPInterface->dspCodec->DeviceInfo.TypeofDevice);
+                if (hDSPInterface->dspCodec->DeviceInfo.TypeofDevice == 0)
+                {
+                    j = 0;
+                    hDSPInterface->iBufinputcount = hDSPInterface->iBufinputcount % QUEUE_SIZE;
+                    i = hDSPInterface->iBufinputcount;
+
+                    hDSPInterface->iBufoutputcount = hDSPInterface->iBufoutputcount % QUEUE_SIZE;
+                    k = hDSPInterface->iBufoutputcount;
+
+                    while(j++ < QUEUE_SIZE)
+                    {
+                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                "LCMLSTOP: %d hDSPInterface->Arminputstorage[i] = %p\n", i, hDSPInterface->Arminputstorage[i]);
+                        if (hDSPInterface->Arminputstorage[i] != NULL &&
+                            !SlotPending(hDSPInterface, hDSPInterface->Arminputstorage[i]))
+                        {
+                            /* callback the component with the buffers that are being freed */
+                            tmpDspStructAddress = hDSPInterface->Arminputstorage[i] ;
+
+                            pDmmBuf = hDSPInterface ->dspCodec->InDmmBuffer;
+                            pDmmBuf = pDmmBuf + (tmpDspStructAddress->BufInindex);
+                            OMX_PRBUFFER1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                    "pDmmBuf->pMapped %p\n", pDmmBuf->pMapped);
+
+                            event = EMMCodecBufferProcessed;
+                            args[0] = (void *) EMMCodecInputBuffer;
+                            args[1] = (void *) tmpDspStructAddress->iArmbufferArg; /* arm address fpr buffer */
+                            args[2] = (void *) tmpDspStructAddress->iBufferSize;
+                            args[3] = (void *) tmpDspStructAddress->iArmParamArg; /* arm address for param */
+                            args[4] = (void *) tmpDspStructAddress->iParamSize;
+                            args[5] = (void *) tmpDspStructAddress->iArmArg;
+                            args[6] = (void *) arg;  /* handle */
+                            args[7] = (void *) tmpDspStructAddress->iUsrArg;  /* user arguments */
+                            /* USN updates*/
+                            args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
 
-                            hDSPInterface->iBufinputcount = hDSPInterface->iBufinputcount % QUEUE_SIZE;
-                            i = hDSPInterface->iBufinputcount;
-                            while(j++ < QUEUE_SIZE)
+                            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                    "LCMLSTOP: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
+                                    (void *)tmpDspStructAddress->iBufferPtr,
+                                    (void *)tmpDspStructAddress->iParamPtr,
+                                    (void *)msg.dwArg1);
+                            if (tmpDspStructAddress->iBufferPtr != (OMX_U32)NULL)
                             {
-                                if (hDSPInterface->Arminputstorage[i] != NULL && hDSPInterface ->Arminputstorage[i]->iArmArg == msg.dwArg1)
+                                if (!pDmmBuf->bCached)
                                 {
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "InputBuffer loop");
-                                    tmpDspStructAddress = ((LCML_DSP_INTERFACE *)arg)->Arminputstorage[i] ;
-                                    hDSPInterface->Arminputstorage[i] =NULL;
-                                    pDmmBuf = hDSPInterface ->dspCodec->InDmmBuffer;
-                                    pDmmBuf = pDmmBuf + (tmpDspStructAddress->BufInindex);
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Address output  matching index= %ld \n ",tmpDspStructAddress->BufInindex);
-                                    break;
+                                    DmmUnMap(hDSPInterface->dspCodec->hProc,
+                                            (void*)tmpDspStructAddress->iBufferPtr,
+                                            pDmmBuf->bufReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
                                 }
-                                i++;
-                                i = i % QUEUE_SIZE;
-                                OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Message EMMCodecInputBuffer loop");
                             }
-                        }
-                        else if (streamId % 2)
-                        {
-                            int i = 0;
-                            int j = 0;
-                            bufType = streamId + EMMCodecStream0;;
-                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Address Armoutputstorage %p \n ",((LCML_DSP_INTERFACE *)arg)->Armoutputstorage);
-                            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Address dspinterface %p \n ",((LCML_DSP_INTERFACE *)arg));
-
-                            hDSPInterface->iBufoutputcount = hDSPInterface->iBufoutputcount % QUEUE_SIZE;
-                            i = hDSPInterface->iBufoutputcount;
-                            while(j++ < QUEUE_SIZE)
+
+                            if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
                             {
-                                if( hDSPInterface ->Armoutputstorage[i] != NULL
-                                        && hDSPInterface ->Armoutputstorage[i]->iArmArg == msg.dwArg1)
-                                {
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "output buffer loop");
-                                    tmpDspStructAddress = hDSPInterface->Armoutputstorage[i] ;
-                                    hDSPInterface ->Armoutputstorage[i] =NULL;
-                                    pDmmBuf = hDSPInterface ->dspCodec->OutDmmBuffer;
-                                    pDmmBuf = pDmmBuf + (tmpDspStructAddress->Bufoutindex);
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "Address output  matching index= %ld\n ",tmpDspStructAddress->Bufoutindex);
-                                    break;
-                                }
-                                i++;
-                                i = i % QUEUE_SIZE;
-                                OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                        "Message EMMCodecOuputBuffer loop");
+                                DmmUnMap(hDSPInterface ->dspCodec->hProc,
+                                         (void*)tmpDspStructAddress->iParamPtr,
+                                         pDmmBuf->paramReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
                             }
+
+                            hDSPInterface->Arminputstorage[i] = NULL;
+                            tmpDspStructAddress     = NULL;
+#ifdef __PERF_INSTRUMENTATION__
+                            PERF_XferingBuffer(hDSPInterface->pPERFcomp,
+                                              args [1],
+                                              (OMX_U32) args [2],
+                                              PERF_ModuleSocketNode,
+                                              PERF_ModuleLLMM);
+#endif
+                            hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
                         }
 
-                        if (tmpDspStructAddress != NULL)
+                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                "LCMLSTOP: %d hDSPInterface->Armoutputstorage[k] = %p\n", k, hDSPInterface->Armoutputstorage[k]);
+                        if (hDSPInterface->Armoutputstorage[k] != NULL &&
+                            !SlotPending(hDSPInterface, hDSPInterface->Armoutputstorage[k]))
                         {
-                            char *tmp2 = NULL;
-
-                            status = DSPProcessor_InvalidateMemory(hDSPInterface->dspCodec->hProc,
-                                            tmpDspStructAddress, sizeof(TArmDspCommunicationStruct));
-                            if (DSP_FAILED(status)) {
-                                LOGE("Invalidate for communication structure failed. status = 0x%x\n", status);
-                            }
+                            tmpDspStructAddress = hDSPInterface->Armoutputstorage[k] ;
 
-                            // Only invalidate the memory when the pointer points to some valid memory region
-                            // otherwise, we will get logging spam
-                            if (tmpDspStructAddress->iArmParamArg != NULL && tmpDspStructAddress->iParamSize > 0) {
-                                status = DSPProcessor_InvalidateMemory(hDSPInterface->dspCodec->hProc,
-                                                tmpDspStructAddress->iArmParamArg, tmpDspStructAddress->iParamSize);
-                                if (DSP_FAILED(status)) {
-                                    LOGE("Invalidate for arm parameter arguments failed. status = 0x%x\n", status);
-                                }
-                            }
+                            pDmmBuf = hDSPInterface ->dspCodec->OutDmmBuffer;
+                            pDmmBuf = pDmmBuf + (tmpDspStructAddress->Bufoutindex);
 
                             event = EMMCodecBufferProcessed;
-                            args[0] = (void *) bufType;
+                            args[0] = (void *) EMMCodecOuputBuffer;
                             args[1] = (void *) tmpDspStructAddress->iArmbufferArg; /* arm address fpr buffer */
                             args[2] = (void *) tmpDspStructAddress->iBufferSize;
                             args[3] = (void *) tmpDspStructAddress->iArmParamArg; /* arm address for param */
@@ -1878,24 +4047,18 @@ void* MessagingThread(void* arg)
                             args[5] = (void *) tmpDspStructAddress->iArmArg;
                             args[6] = (void *) arg;  /* handle */
                             args[7] = (void *) tmpDspStructAddress->iUsrArg;  /* user arguments */
-
-                            if (((LCML_DSP_INTERFACE *)arg)->bUsnEos) {
-                                ((OMX_BUFFERHEADERTYPE*)args[7])->nFlags |= tmpDspStructAddress->iEOSFlag;
-                            }
                             /* USN updates*/
-                            args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
-                            /* managing buffers  and free buffer logic */
-
-                            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                    "GOT MESSAGE EMMCodecBufferProcessed  and now unmapping buffer type %p \n", args[2]);
 
+                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg,
+                                    "LCMLSTOP: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
+                                    (void *)tmpDspStructAddress->iBufferPtr,
+                                    (void *)tmpDspStructAddress->iParamPtr,
+                                    (void *)msg.dwArg1);
                             if (tmpDspStructAddress ->iBufferPtr != (OMX_U32)NULL)
                             {
                                 OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                        "GOT MESSAGE EMMCodecBufferProcessed and now unmapping buufer %lx\n size=%ld",
-                                             tmpDspStructAddress ->iBufferPtr, tmpDspStructAddress ->iBufferSize);
-                                /* 720p implementation */
-                                if (!hDSPInterface->ReUseMap)
+                                        "tmpDspStructAddress ->iBufferPtr is not NULL\n");
+                                if (!pDmmBuf->bCached)
                                 {
                                     DmmUnMap(hDSPInterface->dspCodec->hProc,
                                             (void*)tmpDspStructAddress->iBufferPtr,
@@ -1906,763 +4069,964 @@ void* MessagingThread(void* arg)
                             if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
                             {
                                 OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                        "GOT MESSAGE EMMCodecBufferProcessed and now unmapping parameter buufer\n");
-
+                                        "tmpDspStructAddress->iParamPtr is not NULL\n");
                                 DmmUnMap(hDSPInterface ->dspCodec->hProc,
                                          (void*)tmpDspStructAddress->iParamPtr,
                                          pDmmBuf->paramReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
                             }
 
-                            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                    "GOT MESSAGE EMMCodecBufferProcessed  and now unmapping  structure =0x%p\n",tmpDspStructAddress );
-                            DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                            tmp2 = (char *)tmpDspStructAddress;
-                            tmp2 = (tmp2 - 128);
-                            if (tmp2)
-                            {
-                                LCML_FREE(tmp2);
-                                tmp2 = NULL;
-                            }
+                            tmpDspStructAddress->iBufSizeUsed = 0;
+                            args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
 
-                            /* free(tmpDspStructAddress); */
+                            hDSPInterface->Armoutputstorage[k] = NULL;
                             tmpDspStructAddress = NULL;
+#ifdef __PERF_INSTRUMENTATION__
+                            PERF_XferingBuffer(hDSPInterface->pPERFcomp,
+                                              args[1],
+                                              (OMX_U32) args[2],
+                                              PERF_ModuleSocketNode,
+                                              PERF_ModuleLLMM);
+#endif
+                            hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
                         }
-                        pthread_mutex_unlock(&hDSPInterface->mutex);
-                    } /* End of USN_DSPMSG_BUFF_FREE */
+                        i++;
+                        i = i % QUEUE_SIZE;
+                        k++;
+                        k = k % QUEUE_SIZE;
+                    }
+                }
+                pthread_mutex_unlock(&hDSPInterface->mutex);
+                args[6] = (void *) arg;  /* handle */
+                event = EMMCodecProcessingStoped;
+
+            } /* end of USN_DSPACK_STOP */
+            else if (commandId == USN_DSPACK_PAUSE)
+            {
+
+                event = EMMCodecProcessingPaused;
+                OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                        "GOT MESSAGE EMMCodecProcessingPaused \n");
+                args[6] = (void *) arg;  /* handle */
+            }
+            else if (commandId == USN_DSPMSG_EVENT)
+            {
+
+                event = EMMCodecDspError;
+                OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                        "GOT MESSAGE EMMCodecDspError \n");
+                args[0] = (void *) msg.dwCmd;
+                args[4] = (void *) msg.dwArg1;
+                args[5] = (void *) msg.dwArg2;
+                args[6] = (void *) arg;  /* handle */
+            }
+            else if (commandId == USN_DSPACK_ALGCTRL)
+            {
 
-                    else if (commandId == USN_DSPACK_STOP)
+                int i;
+                event = EMMCodecAlgCtrlAck;
+                pthread_mutex_lock(&hDSPInterface->mutex);
+                for (i = 0; i < QUEUE_SIZE; i++)
+                {
+                    pDmmBuf = ((LCML_DSP_INTERFACE *)arg)->pAlgcntlDmmBuf[i];
+                    if ((pDmmBuf) &&
+                        (((LCML_DSP_INTERFACE *)arg)->algcntlmapped[i]) &&
+                        (pDmmBuf->pMapped == (void *)msg.dwArg2))
                     {
-                        threadState = EMessagingThreadCodecStopped;
+                        DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, 
+                                ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                        LCML_FREE(pDmmBuf);
+                        pDmmBuf = NULL;
+                        ((LCML_DSP_INTERFACE *)arg)->algcntlmapped[i] = 0;
+                        ((LCML_DSP_INTERFACE *)arg)->pAlgcntlDmmBuf[i] = NULL;
+                        break;
+                    }
+                }
+                args[0] = (void *) msg.dwArg1;
+                args[6] = (void *) arg;  /* handle */
+                OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "GOT MESSAGE USN_DSPACK_ALGCTRL \n");
+                pthread_mutex_unlock(&hDSPInterface->mutex);
+            }
+            else if (commandId == USN_DSPACK_STRMCTRL)
+            {
 
-                        /* Start of USN_DSPACK_STOP */
-                        int i = 0;
-                        int j = 0;
-                        int k = 0;
-                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                "GOT MESSAGE EMMCodecProcessingStoped \n");
-                        pthread_mutex_lock(&hDSPInterface->mutex);
+                int i = 0;
+                int j = 0;
+                int ackType = 0;
+                pthread_mutex_lock(&hDSPInterface->mutex);
+                if (hDSPInterface->flush_pending[0] && (streamId == 0) && (msg.dwArg1 == USN_ERR_NONE))
+                {
+                    hDSPInterface->flush_pending[0] = 0;
+                    ackType = USN_STRMCMD_FLUSH;
+                    j = 0;
+                    hDSPInterface->iBufinputcount = hDSPInterface->iBufinputcount % QUEUE_SIZE;
+                    i = hDSPInterface->iBufinputcount;
+                    while(j++ < QUEUE_SIZE)
+                    {
                         OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                "LCMLSTOP: hDSPInterface->dspCodec->DeviceInfo.TypeofDevice %d\n", hDSPInterface->dspCodec->DeviceInfo.TypeofDevice);
-                        if (hDSPInterface->dspCodec->DeviceInfo.TypeofDevice == 0)
+                                "LCMLFLUSH: %d hDSPInterface->Arminputstorage[i] = %p\n", i, hDSPInterface->Arminputstorage[i]);
+                        if (hDSPInterface->Arminputstorage[i] != NULL &&
+                            !SlotPending(hDSPInterface, hDSPInterface->Arminputstorage[i]))
                         {
-                            j = 0;
-                            hDSPInterface->iBufinputcount = hDSPInterface->iBufinputcount % QUEUE_SIZE;
-                            i = hDSPInterface->iBufinputcount;
+                            tmpDspStructAddress = hDSPInterface->Arminputstorage[i] ;
+
+                            pDmmBuf = hDSPInterface ->dspCodec->InDmmBuffer;
+                            pDmmBuf = pDmmBuf + (tmpDspStructAddress->BufInindex);
+                            OMX_PRBUFFER2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                    "pDmmBuf->pMapped %p\n", pDmmBuf->pMapped);
+
+                            event = EMMCodecBufferProcessed;
+                            args[0] = (void *) EMMCodecInputBuffer;
+                            args[1] = (void *) tmpDspStructAddress->iArmbufferArg;
+                            args[2] = (void *) tmpDspStructAddress->iBufferSize;
+                            args[3] = (void *) tmpDspStructAddress->iArmParamArg;
+                            args[4] = (void *) tmpDspStructAddress->iParamSize;
+                            args[5] = (void *) tmpDspStructAddress->iArmArg;
+                            args[6] = (void *) arg;
+                            args[7] = (void *) tmpDspStructAddress->iUsrArg;
+
+                            args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
 
-                            hDSPInterface->iBufoutputcount = hDSPInterface->iBufoutputcount % QUEUE_SIZE;
-                            k = hDSPInterface->iBufoutputcount;
+                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                    "LCMLFLUSH: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
+                                    (void *)tmpDspStructAddress->iBufferPtr,
+                                    (void *)tmpDspStructAddress->iParamPtr,
+                                    (void *)msg.dwArg1);
 
-                            while(j++ < QUEUE_SIZE)
+                            if (tmpDspStructAddress->iBufferPtr != (OMX_U32)NULL)
                             {
-                                OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                        "LCMLSTOP: %d hDSPInterface->Arminputstorage[i] = %p\n", i, hDSPInterface->Arminputstorage[i]);
-                                if (hDSPInterface->Arminputstorage[i] != NULL)
+                                /* 720p implementation */
+                                if (!pDmmBuf->bCached)
                                 {
-                                    char *tmp2 = NULL;
-                                    /* callback the component with the buffers that are being freed */
-                                    tmpDspStructAddress = hDSPInterface->Arminputstorage[i] ;
-
-                                    pDmmBuf = hDSPInterface ->dspCodec->InDmmBuffer;
-                                    pDmmBuf = pDmmBuf + (tmpDspStructAddress->BufInindex);
-                                    OMX_PRBUFFER1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "pDmmBuf->pMapped %p\n", pDmmBuf->pMapped);
-
-                                    event = EMMCodecBufferProcessed;
-                                    args[0] = (void *) EMMCodecInputBuffer;
-                                    args[1] = (void *) tmpDspStructAddress->iArmbufferArg; /* arm address fpr buffer */
-                                    args[2] = (void *) tmpDspStructAddress->iBufferSize;
-                                    args[3] = (void *) tmpDspStructAddress->iArmParamArg; /* arm address for param */
-                                    args[4] = (void *) tmpDspStructAddress->iParamSize;
-                                    args[5] = (void *) tmpDspStructAddress->iArmArg;
-                                    args[6] = (void *) arg;  /* handle */
-                                    args[7] = (void *) tmpDspStructAddress->iUsrArg;  /* user arguments */
-                                    /* USN updates*/
-                                    args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
-
-                                    OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "LCMLSTOP: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
-                                            (void *)tmpDspStructAddress->iBufferPtr,
-                                            (void *)tmpDspStructAddress->iParamPtr,
-                                            (void *)msg.dwArg1);
-                                    if (tmpDspStructAddress->iBufferPtr != (OMX_U32)NULL)
-                                    {
-                                        if (!hDSPInterface->ReUseMap)
-                                        {
-                                            DmmUnMap(hDSPInterface->dspCodec->hProc,
-                                                    (void*)tmpDspStructAddress->iBufferPtr,
-                                                    pDmmBuf->bufReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                        }
-                                    }
-
-                                    if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
-                                    {
-                                        DmmUnMap(hDSPInterface ->dspCodec->hProc,
-                                                 (void*)tmpDspStructAddress->iParamPtr,
-                                                 pDmmBuf->paramReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                    }
-                                    DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-
-                                    if (NULL != tmpDspStructAddress)
-                                    {
-                                        tmp2 = (char*)tmpDspStructAddress;
-                                        tmp2 = ( tmp2 - 128);
-                                    }
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "%d :: LCML:: FreeResources\n",__LINE__);
-                                    if (tmp2)
-                                    {
-                                        LCML_FREE(tmp2);
-                                        tmp2 = NULL;
-                                    }
-                                    hDSPInterface->Arminputstorage[i] = NULL;
-                                    tmpDspStructAddress     = NULL;
-#ifdef __PERF_INSTRUMENTATION__
-                                    PERF_XferingBuffer(hDSPInterface->pPERFcomp,
-                                                      args [1],
-                                                      (OMX_U32) args [2],
-                                                      PERF_ModuleSocketNode,
-                                                      PERF_ModuleLLMM);
-#endif
-                                    hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
+                                    DmmUnMap(hDSPInterface->dspCodec->hProc,
+                                            (void*)tmpDspStructAddress->iBufferPtr,
+                                            pDmmBuf->bufReserved, 
+                                            ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
                                 }
+                            }
 
-                                OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                        "LCMLSTOP: %d hDSPInterface->Armoutputstorage[k] = %p\n", k, hDSPInterface->Armoutputstorage[k]);
-                                if (hDSPInterface->Armoutputstorage[k] != NULL)
-                                {
-                                    char * tmp2 = NULL;
-                                    tmpDspStructAddress = hDSPInterface->Armoutputstorage[k] ;
-
-                                    pDmmBuf = hDSPInterface ->dspCodec->OutDmmBuffer;
-                                    pDmmBuf = pDmmBuf + (tmpDspStructAddress->Bufoutindex);
-
-                                    event = EMMCodecBufferProcessed;
-                                    args[0] = (void *) EMMCodecOuputBuffer;
-                                    args[1] = (void *) tmpDspStructAddress->iArmbufferArg; /* arm address fpr buffer */
-                                    args[2] = (void *) tmpDspStructAddress->iBufferSize;
-                                    args[3] = (void *) tmpDspStructAddress->iArmParamArg; /* arm address for param */
-                                    args[4] = (void *) tmpDspStructAddress->iParamSize;
-                                    args[5] = (void *) tmpDspStructAddress->iArmArg;
-                                    args[6] = (void *) arg;  /* handle */
-                                    args[7] = (void *) tmpDspStructAddress->iUsrArg;  /* user arguments */
-                                    /* USN updates*/
-
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg,
-                                            "LCMLSTOP: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
-                                            (void *)tmpDspStructAddress->iBufferPtr,
-                                            (void *)tmpDspStructAddress->iParamPtr,
-                                            (void *)msg.dwArg1);
-                                    if (tmpDspStructAddress ->iBufferPtr != (OMX_U32)NULL)
-                                    {
-                                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                                "tmpDspStructAddress ->iBufferPtr is not NULL\n");
-                                        if (!hDSPInterface->ReUseMap)
-                                        {
-                                            DmmUnMap(hDSPInterface->dspCodec->hProc,
-                                                    (void*)tmpDspStructAddress->iBufferPtr,
-                                                    pDmmBuf->bufReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                        }
-                                    }
-
-                                    if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
-                                    {
-                                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                                "tmpDspStructAddress->iParamPtr is not NULL\n");
-                                        DmmUnMap(hDSPInterface ->dspCodec->hProc,
-                                                 (void*)tmpDspStructAddress->iParamPtr,
-                                                 pDmmBuf->paramReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                    }
-                                    DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-
-                                    tmp2 = (char *) tmpDspStructAddress;
-                                    tmp2 = ( tmp2 - 128);
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "%d :: LCML:: FreeResources\n",__LINE__);
-                                    if(tmp2)
-                                    {
-                                        LCML_FREE(tmp2);
-                                        tmp2 = NULL;
-                                    }
-                                    tmpDspStructAddress->iBufSizeUsed = 0;
-                                    args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
-
-                                    hDSPInterface->Armoutputstorage[k] = NULL;
-                                    tmpDspStructAddress = NULL;
+                            if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
+                            {
+                                DmmUnMap(hDSPInterface ->dspCodec->hProc,
+                                         (void*)tmpDspStructAddress->iParamPtr,
+                                         pDmmBuf->paramReserved, 
+                                         ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                            }
+
+                            hDSPInterface->Arminputstorage[i] = NULL;
+                            tmpDspStructAddress     = NULL;
 #ifdef __PERF_INSTRUMENTATION__
-                                    PERF_XferingBuffer(hDSPInterface->pPERFcomp,
-                                                      args[1],
-                                                      (OMX_U32) args[2],
-                                                      PERF_ModuleSocketNode,
-                                                      PERF_ModuleLLMM);
+                            PERF_XferingBuffer(hDSPInterface->pPERFcomp,
+                                              args [1],
+                                              (OMX_U32) args [2],
+                                              PERF_ModuleSocketNode,
+                                              PERF_ModuleLLMM);
 #endif
-                                    hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
-                                }
-                                i++;
-                                i = i % QUEUE_SIZE;
-                                k++;
-                                k = k % QUEUE_SIZE;
-                            }
+                            hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
                         }
-                        pthread_mutex_unlock(&hDSPInterface->mutex);
-                        args[6] = (void *) arg;  /* handle */
-                        event = EMMCodecProcessingStoped;
-
-                    } /* end of USN_DSPACK_STOP */
-                    else if (commandId == USN_DSPACK_PAUSE)
-                    {
-
-                        event = EMMCodecProcessingPaused;
-                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                "GOT MESSAGE EMMCodecProcessingPaused \n");
-                        args[6] = (void *) arg;  /* handle */
-                    }
-                    else if (commandId == USN_DSPMSG_EVENT)
-                    {
-                        threadState = EMessagingThreadCodecStopped;
-
-                        event = EMMCodecDspError;
-                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                "GOT MESSAGE EMMCodecDspError \n");
-                        args[0] = (void *) msg.dwCmd;
-                        args[4] = (void *) msg.dwArg1;
-                        args[5] = (void *) msg.dwArg2;
-                        args[6] = (void *) arg;  /* handle */
+                        i++;
+                        i = i % QUEUE_SIZE;
                     }
-                    else if (commandId == USN_DSPACK_ALGCTRL)
+                    for (i = 0; i < QUEUE_SIZE; i++)
                     {
-
-                        int i;
-                        event = EMMCodecAlgCtrlAck;
-                        pthread_mutex_lock(&hDSPInterface->mutex);
-                        for (i = 0; i < QUEUE_SIZE; i++)
+                        pDmmBuf = ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i];
+                        if ((pDmmBuf) &&
+                            (((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i]) &&
+                            (pDmmBuf->pMapped == (void *)msg.dwArg2))
                         {
-                            pDmmBuf = ((LCML_DSP_INTERFACE *)arg)->pAlgcntlDmmBuf[i];
-                            if ((pDmmBuf) &&
-                                (((LCML_DSP_INTERFACE *)arg)->algcntlmapped[i]) &&
-                                (pDmmBuf->pMapped == (void *)msg.dwArg2))
-                            {
-                                DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, 
-                                        ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                LCML_FREE(pDmmBuf);
-                                pDmmBuf = NULL;
-                                ((LCML_DSP_INTERFACE *)arg)->algcntlmapped[i] = 0;
-                                ((LCML_DSP_INTERFACE *)arg)->pAlgcntlDmmBuf[i] = NULL;
-                                break;
-                            }
+                            DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, 
+                                    ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                            LCML_FREE(pDmmBuf);
+                            pDmmBuf = NULL;
+                            ((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i] = 0;
+                            ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i] = NULL;
+                            break;
                         }
-                        args[0] = (void *) msg.dwArg1;
-                        args[6] = (void *) arg;  /* handle */
-                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "GOT MESSAGE USN_DSPACK_ALGCTRL \n");
-                        pthread_mutex_unlock(&hDSPInterface->mutex);
                     }
-                    else if (commandId == USN_DSPACK_STRMCTRL)
+                }
+                else if (hDSPInterface->flush_pending[1] && (streamId == 1) && (msg.dwArg1 == USN_ERR_NONE))
+                {
+                    hDSPInterface->flush_pending[1] = 0;
+                    ackType = USN_STRMCMD_FLUSH;
+                    j = 0;
+                    hDSPInterface->iBufoutputcount = hDSPInterface->iBufoutputcount % QUEUE_SIZE;
+                    i = hDSPInterface->iBufoutputcount;
+                    while(j++ < QUEUE_SIZE)
                     {
-
-                        int i = 0;
-                        int j = 0;
-                        int ackType = 0;
-                        pthread_mutex_lock(&hDSPInterface->mutex);
-                        if (hDSPInterface->flush_pending[0] && (streamId == 0) && (msg.dwArg1 == USN_ERR_NONE))
+                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                "LCMLFLUSH: %d hDSPInterface->Armoutputstorage[i] = %p\n", i, hDSPInterface->Armoutputstorage[i]);
+                        if (hDSPInterface->Armoutputstorage[i] != NULL &&
+                            !SlotPending(hDSPInterface, hDSPInterface->Armoutputstorage[i]))
                         {
-                            hDSPInterface->flush_pending[0] = 0;
-                            ackType = USN_STRMCMD_FLUSH;
-                            j = 0;
-                            hDSPInterface->iBufinputcount = hDSPInterface->iBufinputcount % QUEUE_SIZE;
-                            i = hDSPInterface->iBufinputcount;
-                            while(j++ < QUEUE_SIZE)
-                            {
-                                OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                        "LCMLFLUSH: %d hDSPInterface->Arminputstorage[i] = %p\n", i, hDSPInterface->Arminputstorage[i]);
-                                if (hDSPInterface->Arminputstorage[i] != NULL)
-                                {
-                                    char *tmp2 = NULL;
-                                    tmpDspStructAddress = hDSPInterface->Arminputstorage[i] ;
-
-                                    pDmmBuf = hDSPInterface ->dspCodec->InDmmBuffer;
-                                    pDmmBuf = pDmmBuf + (tmpDspStructAddress->BufInindex);
-                                    OMX_PRBUFFER2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "pDmmBuf->pMapped %p\n", pDmmBuf->pMapped);
-
-                                    event = EMMCodecBufferProcessed;
-                                    args[0] = (void *) EMMCodecInputBuffer;
-                                    args[1] = (void *) tmpDspStructAddress->iArmbufferArg;
-                                    args[2] = (void *) tmpDspStructAddress->iBufferSize;
-                                    args[3] = (void *) tmpDspStructAddress->iArmParamArg;
-                                    args[4] = (void *) tmpDspStructAddress->iParamSize;
-                                    args[5] = (void *) tmpDspStructAddress->iArmArg;
-                                    args[6] = (void *) arg;
-                                    args[7] = (void *) tmpDspStructAddress->iUsrArg;
-
-                                    args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
-
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "LCMLFLUSH: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
-                                            (void *)tmpDspStructAddress->iBufferPtr,
-                                            (void *)tmpDspStructAddress->iParamPtr,
-                                            (void *)msg.dwArg1);
-
-                                    if (tmpDspStructAddress->iBufferPtr != (OMX_U32)NULL)
-                                    {
-                                        /* 720p implementation */
-                                        if (!hDSPInterface->ReUseMap)
-                                        {
-                                            DmmUnMap(hDSPInterface->dspCodec->hProc,
-                                                    (void*)tmpDspStructAddress->iBufferPtr,
-                                                    pDmmBuf->bufReserved, 
-                                                    ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                        }
-                                    }
-
-                                    if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
-                                    {
-                                        DmmUnMap(hDSPInterface ->dspCodec->hProc,
-                                                 (void*)tmpDspStructAddress->iParamPtr,
-                                                 pDmmBuf->paramReserved, 
-                                                 ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                    }
-                                    DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, 
-                                            ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                            tmpDspStructAddress = hDSPInterface->Armoutputstorage[i] ;
 
-                                    if (NULL != tmpDspStructAddress)
-                                    {
-                                        tmp2 = (char*)tmpDspStructAddress;
-                                        tmp2 = ( tmp2 - 128);
-                                    }
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "%d :: LCML:: FreeResources\n",__LINE__);
-                                    if (tmp2)
-                                    {
-                                        LCML_FREE(tmp2);
-                                        tmp2 = NULL;
-                                    }
-                                    hDSPInterface->Arminputstorage[i] = NULL;
-                                    tmpDspStructAddress     = NULL;
-#ifdef __PERF_INSTRUMENTATION__
-                                    PERF_XferingBuffer(hDSPInterface->pPERFcomp,
-                                                      args [1],
-                                                      (OMX_U32) args [2],
-                                                      PERF_ModuleSocketNode,
-                                                      PERF_ModuleLLMM);
-#endif
-                                    hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
-                                }
-                                i++;
-                                i = i % QUEUE_SIZE;
-                            }
-                            for (i = 0; i < QUEUE_SIZE; i++)
+                            pDmmBuf = hDSPInterface ->dspCodec->OutDmmBuffer;
+                            pDmmBuf = pDmmBuf + (tmpDspStructAddress->Bufoutindex);
+
+                            event = EMMCodecBufferProcessed;
+                            args[0] = (void *) EMMCodecOuputBuffer;
+                            args[1] = (void *) tmpDspStructAddress->iArmbufferArg;
+                            args[2] = (void *) tmpDspStructAddress->iBufferSize;
+                            args[3] = (void *) tmpDspStructAddress->iArmParamArg;
+                            args[4] = (void *) tmpDspStructAddress->iParamSize;
+                            args[5] = (void *) tmpDspStructAddress->iArmArg;
+                            args[6] = (void *) arg;
+                            args[7] = (void *) tmpDspStructAddress->iUsrArg;
+
+
+                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                    "LCMLFLUSH: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
+                                    (void *)tmpDspStructAddress->iBufferPtr,
+                                    (void *)tmpDspStructAddress->iParamPtr,
+                                    (void *)msg.dwArg1);
+                            if (tmpDspStructAddress ->iBufferPtr != (OMX_U32)NULL)
                             {
-                                pDmmBuf = ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i];
-                                if ((pDmmBuf) &&
-                                    (((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i]) &&
-                                    (pDmmBuf->pMapped == (void *)msg.dwArg2))
+                                /* 720p implementation */
+                                OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                        "tmpDspStructAddress ->iBufferPtr is not NULL\n");
+                                if (!pDmmBuf->bCached)
                                 {
-                                    DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, 
+                                    DmmUnMap(hDSPInterface->dspCodec->hProc,
+                                            (void*)tmpDspStructAddress->iBufferPtr,
+                                            pDmmBuf->bufReserved, 
                                             ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                    LCML_FREE(pDmmBuf);
-                                    pDmmBuf = NULL;
-                                    ((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i] = 0;
-                                    ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i] = NULL;
-                                    break;
                                 }
                             }
-                        }
-                        else if (hDSPInterface->flush_pending[1] && (streamId == 1) && (msg.dwArg1 == USN_ERR_NONE))
-                        {
-                            hDSPInterface->flush_pending[1] = 0;
-                            ackType = USN_STRMCMD_FLUSH;
-                            j = 0;
-                            hDSPInterface->iBufoutputcount = hDSPInterface->iBufoutputcount % QUEUE_SIZE;
-                            i = hDSPInterface->iBufoutputcount;
-                            while(j++ < QUEUE_SIZE)
+
+                            if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
                             {
                                 OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                        "LCMLFLUSH: %d hDSPInterface->Armoutputstorage[i] = %p\n", i, hDSPInterface->Armoutputstorage[i]);
-                                if (hDSPInterface->Armoutputstorage[i] != NULL)
-                                {
-                                    char * tmp2 = NULL;
-                                    tmpDspStructAddress = hDSPInterface->Armoutputstorage[i] ;
-
-                                    pDmmBuf = hDSPInterface ->dspCodec->OutDmmBuffer;
-                                    pDmmBuf = pDmmBuf + (tmpDspStructAddress->Bufoutindex);
-
-                                    event = EMMCodecBufferProcessed;
-                                    args[0] = (void *) EMMCodecOuputBuffer;
-                                    args[1] = (void *) tmpDspStructAddress->iArmbufferArg;
-                                    args[2] = (void *) tmpDspStructAddress->iBufferSize;
-                                    args[3] = (void *) tmpDspStructAddress->iArmParamArg;
-                                    args[4] = (void *) tmpDspStructAddress->iParamSize;
-                                    args[5] = (void *) tmpDspStructAddress->iArmArg;
-                                    args[6] = (void *) arg;
-                                    args[7] = (void *) tmpDspStructAddress->iUsrArg;
-
-
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "LCMLFLUSH: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
-                                            (void *)tmpDspStructAddress->iBufferPtr,
-                                            (void *)tmpDspStructAddress->iParamPtr,
-                                            (void *)msg.dwArg1);
-                                    if (tmpDspStructAddress ->iBufferPtr != (OMX_U32)NULL)
-                                    {
-                                        /* 720p implementation */
-                                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                                "tmpDspStructAddress ->iBufferPtr is not NULL\n");
-                                        if (!hDSPInterface->ReUseMap)
-                                        {
-                                            DmmUnMap(hDSPInterface->dspCodec->hProc,
-                                                    (void*)tmpDspStructAddress->iBufferPtr,
-                                                    pDmmBuf->bufReserved, 
-                                                    ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                        }
-                                    }
-
-                                    if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
-                                    {
-                                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                                "tmpDspStructAddress->iParamPtr is not NULL\n");
-                                        DmmUnMap(hDSPInterface ->dspCodec->hProc,
-                                                 (void*)tmpDspStructAddress->iParamPtr,
-                                                 pDmmBuf->paramReserved, 
-                                                 ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                    }
-                                    DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, 
-                                            ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                                        "tmpDspStructAddress->iParamPtr is not NULL\n");
+                                DmmUnMap(hDSPInterface ->dspCodec->hProc,
+                                         (void*)tmpDspStructAddress->iParamPtr,
+                                         pDmmBuf->paramReserved, 
+                                         ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                            }
+
+                            tmpDspStructAddress->iBufSizeUsed = 0;
+                            args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
 
-                                    tmp2 = (char *) tmpDspStructAddress;
-                                    tmp2 = ( tmp2 - 128);
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "%d :: LCML:: FreeResources\n",__LINE__);
-                                    if(tmp2)
-                                    {
-                                        LCML_FREE(tmp2);
-                                        tmp2 = NULL;
-                                    }
-                                    tmpDspStructAddress->iBufSizeUsed = 0;
-                                    args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
-
-                                    hDSPInterface->Armoutputstorage[i] = NULL;
-                                    tmpDspStructAddress = NULL;
+                            hDSPInterface->Armoutputstorage[i] = NULL;
+                            tmpDspStructAddress = NULL;
 #ifdef __PERF_INSTRUMENTATION__
-                                    PERF_XferingBuffer(hDSPInterface->pPERFcomp,
-                                                      args[1],
-                                                      (OMX_U32) args[2],
-                                                      PERF_ModuleSocketNode,
-                                                      PERF_ModuleLLMM);
+                            PERF_XferingBuffer(hDSPInterface->pPERFcomp,
+                                              args[1],
+                                              (OMX_U32) args[2],
+                                              PERF_ModuleSocketNode,
+                                              PERF_ModuleLLMM);
 #endif
-                                    hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
-                                }
-                                i++;
-                                i = i % QUEUE_SIZE;
-                            }
-                            for (i = 0; i < QUEUE_SIZE; i++)
+                            hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
+                        }
+                        i++;
+                        i = i % QUEUE_SIZE;
+                    }
+                    for (i = 0; i < QUEUE_SIZE; i++)
+                    {
+                        pDmmBuf = ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i];
+                        if ((pDmmBuf) &&
+                            (((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i]) &&
+                            (pDmmBuf->pMapped == (void *)msg.dwArg2))
+                        {
+                            DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, 
+                                    ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                            LCML_FREE(pDmmBuf);
+                            pDmmBuf = NULL;
+                            ((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i] = 0;
+                            ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i] = NULL;
+                            break;
+                        }
+                    }
+                }
+                if (hDSPInterface->flush_pending[2] && (streamId == 2) && (msg.dwArg1 == USN_ERR_NONE))
+                {
+                    hDSPInterface->flush_pending[0] = 0;
+                    ackType = USN_STRMCMD_FLUSH;
+                    j = 0;
+                    hDSPInterface->iBufinputcount = hDSPInterface->iBufinputcount % QUEUE_SIZE;
+                    i = hDSPInterface->iBufinputcount;
+                    while(j++ < QUEUE_SIZE)
+                    {
+                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                "LCMLFLUSH (port 2): %d hDSPInterface->Arminputstorage[i] = %p (stream ID %lu)\n", i, hDSPInterface->Arminputstorage[i], streamId);
+                        if ((hDSPInterface->Arminputstorage[i] != NULL) && (hDSPInterface->Arminputstorage[i]->iStreamID == streamId) &&
+                            !SlotPending(hDSPInterface, hDSPInterface->Arminputstorage[i]))
+                        {
+                            tmpDspStructAddress = hDSPInterface->Arminputstorage[i] ;
+
+                            pDmmBuf = hDSPInterface ->dspCodec->InDmmBuffer;
+                            pDmmBuf = pDmmBuf + (tmpDspStructAddress->BufInindex);
+                            OMX_PRBUFFER2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                    "pDmmBuf->pMapped %p\n", pDmmBuf->pMapped);
+
+                            event = EMMCodecBufferProcessed;
+                            args[0] = (void *) EMMCodecInputBuffer;
+                            args[1] = (void *) tmpDspStructAddress->iArmbufferArg;
+                            args[2] = (void *) tmpDspStructAddress->iBufferSize;
+                            args[3] = (void *) tmpDspStructAddress->iArmParamArg;
+                            args[4] = (void *) tmpDspStructAddress->iParamSize;
+                            args[5] = (void *) tmpDspStructAddress->iArmArg;
+                            args[6] = (void *) arg;
+                            args[7] = (void *) tmpDspStructAddress->iUsrArg;
+
+                            args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
+
+                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                    "LCMLFLUSH: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
+                                    (void *)tmpDspStructAddress->iBufferPtr,
+                                    (void *)tmpDspStructAddress->iParamPtr,
+                                    (void *)msg.dwArg1);
+                            if (tmpDspStructAddress->iBufferPtr != (OMX_U32)NULL)
                             {
-                                pDmmBuf = ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i];
-                                if ((pDmmBuf) &&
-                                    (((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i]) &&
-                                    (pDmmBuf->pMapped == (void *)msg.dwArg2))
+                                /* 720p implementation */
+                                if (!pDmmBuf->bCached)
                                 {
-                                    DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, 
-                                            ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                    LCML_FREE(pDmmBuf);
-                                    pDmmBuf = NULL;
-                                    ((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i] = 0;
-                                    ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i] = NULL;
-                                    break;
+                                    DmmUnMap(hDSPInterface->dspCodec->hProc,
+                                            (void*)tmpDspStructAddress->iBufferPtr,
+                                            pDmmBuf->bufReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
                                 }
-                            }
-                        }
-                        if (hDSPInterface->flush_pending[2] && (streamId == 2) && (msg.dwArg1 == USN_ERR_NONE))
-                        {
-                            hDSPInterface->flush_pending[0] = 0;
-                            ackType = USN_STRMCMD_FLUSH;
-                            j = 0;
-                            hDSPInterface->iBufinputcount = hDSPInterface->iBufinputcount % QUEUE_SIZE;
-                            i = hDSPInterface->iBufinputcount;
-                            while(j++ < QUEUE_SIZE)
+                            }
+
+                            if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
                             {
-                                OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                        "LCMLFLUSH (port 2): %d hDSPInterface->Arminputstorage[i] = %p (stream ID %lu)\n", i, hDSPInterface->Arminputstorage[i], streamId);
-                                if ((hDSPInterface->Arminputstorage[i] != NULL) && (hDSPInterface->Arminputstorage[i]->iStreamID == streamId))
-                                {
-                                    char *tmp2 = NULL;
-                                    tmpDspStructAddress = hDSPInterface->Arminputstorage[i] ;
-
-                                    pDmmBuf = hDSPInterface ->dspCodec->InDmmBuffer;
-                                    pDmmBuf = pDmmBuf + (tmpDspStructAddress->BufInindex);
-                                    OMX_PRBUFFER2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "pDmmBuf->pMapped %p\n", pDmmBuf->pMapped);
-
-                                    event = EMMCodecBufferProcessed;
-                                    args[0] = (void *) EMMCodecInputBuffer;
-                                    args[1] = (void *) tmpDspStructAddress->iArmbufferArg;
-                                    args[2] = (void *) tmpDspStructAddress->iBufferSize;
-                                    args[3] = (void *) tmpDspStructAddress->iArmParamArg;
-                                    args[4] = (void *) tmpDspStructAddress->iParamSize;
-                                    args[5] = (void *) tmpDspStructAddress->iArmArg;
-                                    args[6] = (void *) arg;
-                                    args[7] = (void *) tmpDspStructAddress->iUsrArg;
-
-                                    args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
-
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "LCMLFLUSH: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
-                                            (void *)tmpDspStructAddress->iBufferPtr,
-                                            (void *)tmpDspStructAddress->iParamPtr,
-                                            (void *)msg.dwArg1);
-                                    if (tmpDspStructAddress->iBufferPtr != (OMX_U32)NULL)
-                                    {
-                                        /* 720p implementation */
-                                        if (!hDSPInterface->ReUseMap)
-                                        {
-                                            DmmUnMap(hDSPInterface->dspCodec->hProc,
-                                                    (void*)tmpDspStructAddress->iBufferPtr,
-                                                    pDmmBuf->bufReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                        }
-                                    }
-
-                                    if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
-                                    {
-                                        DmmUnMap(hDSPInterface ->dspCodec->hProc,
-                                                 (void*)tmpDspStructAddress->iParamPtr,
-                                                 pDmmBuf->paramReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                    }
-                                    DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved,
-                                            ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                                DmmUnMap(hDSPInterface ->dspCodec->hProc,
+                                         (void*)tmpDspStructAddress->iParamPtr,
+                                         pDmmBuf->paramReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                            }
 
-                                    tmp2 = (char*)tmpDspStructAddress;
-                                    tmp2 = ( tmp2 - 128);
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "%d :: LCML:: FreeResources\n",__LINE__);
-                                    if (tmp2)
-                                    {
-                                        LCML_FREE(tmp2);
-                                        tmp2 = NULL;
-                                    }
-                                    hDSPInterface->Arminputstorage[i] = NULL;
-                                    tmpDspStructAddress     = NULL;
+                            hDSPInterface->Arminputstorage[i] = NULL;
+                            tmpDspStructAddress     = NULL;
 #ifdef __PERF_INSTRUMENTATION__
-                                    PERF_XferingBuffer(hDSPInterface->pPERFcomp,
-                                                      args [1],
-                                                      (OMX_U32) args [2],
-                                                      PERF_ModuleSocketNode,
-                                                      PERF_ModuleLLMM);
+                            PERF_XferingBuffer(hDSPInterface->pPERFcomp,
+                                              args [1],
+                                              (OMX_U32) args [2],
+                                              PERF_ModuleSocketNode,
+                                              PERF_ModuleLLMM);
 #endif
-                                    hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
-                                }
-                                i++;
-                                i = i % QUEUE_SIZE;
-                            }
+                            hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
                         }
-                        else if (hDSPInterface->flush_pending[3] && (streamId == 3) && (msg.dwArg1 == USN_ERR_NONE))
+                        i++;
+                        i = i % QUEUE_SIZE;
+                    }
+                }
+                else if (hDSPInterface->flush_pending[3] && (streamId == 3) && (msg.dwArg1 == USN_ERR_NONE))
+                {
+                    hDSPInterface->flush_pending[1] = 0;
+                    ackType = USN_STRMCMD_FLUSH;
+                    j = 0;
+                    hDSPInterface->iBufoutputcount = hDSPInterface->iBufoutputcount % QUEUE_SIZE;
+                    i = hDSPInterface->iBufoutputcount;
+                    while(j++ < QUEUE_SIZE)
+                    {
+                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg,
+                                "LCMLFLUSH: %d hDSPInterface->Armoutputstorage[i] = %p (stream id %lu)\n", i, hDSPInterface->Armoutputstorage[i], streamId);
+                        if ((hDSPInterface->Armoutputstorage[i] != NULL) && (hDSPInterface->Armoutputstorage[i]->iStreamID == streamId) &&
+                            !SlotPending(hDSPInterface, hDSPInterface->Armoutputstorage[i]))
                         {
-                            hDSPInterface->flush_pending[1] = 0;
-                            ackType = USN_STRMCMD_FLUSH;
-                            j = 0;
-                            hDSPInterface->iBufoutputcount = hDSPInterface->iBufoutputcount % QUEUE_SIZE;
-                            i = hDSPInterface->iBufoutputcount;
-                            while(j++ < QUEUE_SIZE)
+                            tmpDspStructAddress = hDSPInterface->Armoutputstorage[i] ;
+
+                            pDmmBuf = hDSPInterface ->dspCodec->OutDmmBuffer;
+                            pDmmBuf = pDmmBuf + (tmpDspStructAddress->Bufoutindex);
+
+                            event = EMMCodecBufferProcessed;
+                            args[0] = (void *) EMMCodecOuputBuffer;
+                            args[1] = (void *) tmpDspStructAddress->iArmbufferArg;
+                            args[2] = (void *) tmpDspStructAddress->iBufferSize;
+                            args[3] = (void *) tmpDspStructAddress->iArmParamArg;
+                            args[4] = (void *) tmpDspStructAddress->iParamSize;
+                            args[5] = (void *) tmpDspStructAddress->iArmArg;
+                            args[6] = (void *) arg;
+                            args[7] = (void *) tmpDspStructAddress->iUsrArg;
+
+
+                            OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                    "LCMLFLUSH: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
+                                    (void *)tmpDspStructAddress->iBufferPtr,
+                                    (void *)tmpDspStructAddress->iParamPtr,
+                                    (void *)msg.dwArg1);
+                            if (tmpDspStructAddress ->iBufferPtr != (OMX_U32)NULL)
                             {
-                                OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg,
-                                        "LCMLFLUSH: %d hDSPInterface->Armoutputstorage[i] = %p (stream id %lu)\n", i, hDSPInterface->Armoutputstorage[i], streamId);
-                                if ((hDSPInterface->Armoutputstorage[i] != NULL) && (hDSPInterface->Armoutputstorage[i]->iStreamID == streamId))
+                                /* 720p implementation */
+                                OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                        "tmpDspStructAddress ->iBufferPtr is not NULL\n");
+                                if (!pDmmBuf->bCached)
                                 {
-                                    char * tmp2 = NULL;
-                                    tmpDspStructAddress = hDSPInterface->Armoutputstorage[i] ;
-
-                                    pDmmBuf = hDSPInterface ->dspCodec->OutDmmBuffer;
-                                    pDmmBuf = pDmmBuf + (tmpDspStructAddress->Bufoutindex);
-
-                                    event = EMMCodecBufferProcessed;
-                                    args[0] = (void *) EMMCodecOuputBuffer;
-                                    args[1] = (void *) tmpDspStructAddress->iArmbufferArg;
-                                    args[2] = (void *) tmpDspStructAddress->iBufferSize;
-                                    args[3] = (void *) tmpDspStructAddress->iArmParamArg;
-                                    args[4] = (void *) tmpDspStructAddress->iParamSize;
-                                    args[5] = (void *) tmpDspStructAddress->iArmArg;
-                                    args[6] = (void *) arg;
-                                    args[7] = (void *) tmpDspStructAddress->iUsrArg;
-
-
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "LCMLFLUSH: tmpDspStructAddress->iBufferPtr %p, tmpDspStructAddress->iParamPtr %p, msg.dwArg1 %p\n",
-                                            (void *)tmpDspStructAddress->iBufferPtr,
-                                            (void *)tmpDspStructAddress->iParamPtr,
-                                            (void *)msg.dwArg1);
-                                    if (tmpDspStructAddress ->iBufferPtr != (OMX_U32)NULL)
-                                    {
-                                        /* 720p implementation */
-                                        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                                "tmpDspStructAddress ->iBufferPtr is not NULL\n");
-                                        if (!hDSPInterface->ReUseMap)
-                                        {
-                                            DmmUnMap(hDSPInterface->dspCodec->hProc,
-                                                    (void*)tmpDspStructAddress->iBufferPtr,
-                                                    pDmmBuf->bufReserved,
-                                                    ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                        }
-                                    }
-
-                                    if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
-                                    {
-                                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                                "tmpDspStructAddress->iParamPtr is not NULL\n");
-                                        DmmUnMap(hDSPInterface ->dspCodec->hProc,
-                                                 (void*)tmpDspStructAddress->iParamPtr,
-                                                 pDmmBuf->paramReserved,
-                                                 ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                    }
-                                    DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved,
+                                    DmmUnMap(hDSPInterface->dspCodec->hProc,
+                                            (void*)tmpDspStructAddress->iBufferPtr,
+                                            pDmmBuf->bufReserved,
                                             ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-
-                                    tmp2 = (char *) tmpDspStructAddress;
-                                    tmp2 = ( tmp2 - 128);
-                                    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
-                                            "%d :: LCML:: FreeResources\n",__LINE__);
-                                    if(tmp2)
-                                    {
-                                        LCML_FREE(tmp2);
-                                        tmp2 = NULL;
-                                    }
-                                    tmpDspStructAddress->iBufSizeUsed = 0;
-                                    args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
-
-                                    hDSPInterface->Armoutputstorage[i] = NULL;
-                                    tmpDspStructAddress = NULL;
-#ifdef __PERF_INSTRUMENTATION__
-                                    PERF_XferingBuffer(hDSPInterface->pPERFcomp,
-                                                      args[1],
-                                                      (OMX_U32) args[2],
-                                                      PERF_ModuleSocketNode,
-                                                      PERF_ModuleLLMM);
-#endif
-                                    hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
                                 }
-                                i++;
-                                i = i % QUEUE_SIZE;
                             }
-                        }
 
-                        if (ackType != USN_STRMCMD_FLUSH) {
-                            for (i = 0; i < QUEUE_SIZE; i++)
+                            if (tmpDspStructAddress->iParamPtr != (OMX_U32)NULL)
                             {
-                                pDmmBuf = ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i];
-                                if ((pDmmBuf) &&
-                                    (((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i]) &&
-                                    (pDmmBuf->pMapped == (void *)msg.dwArg2))
-                                {
-                                    DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved,
-                                            ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
-                                    LCML_FREE(pDmmBuf);
-                                    pDmmBuf = NULL;
-                                    ((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i] = 0;
-                                    ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i] = NULL;
-                                    break;
-                                }
+                                OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
+                                        "tmpDspStructAddress->iParamPtr is not NULL\n");
+                                DmmUnMap(hDSPInterface ->dspCodec->hProc,
+                                         (void*)tmpDspStructAddress->iParamPtr,
+                                         pDmmBuf->paramReserved,
+                                         ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
                             }
+
+                            tmpDspStructAddress->iBufSizeUsed = 0;
+                            args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
+
+                            hDSPInterface->Armoutputstorage[i] = NULL;
+                            tmpDspStructAddress = NULL;
+#ifdef __PERF_INSTRUMENTATION__
+                            PERF_XferingBuffer(hDSPInterface->pPERFcomp,
+                                              args[1],
+                                              (OMX_U32) args[2],
+                                              PERF_ModuleSocketNode,
+                                              PERF_ModuleLLMM);
+#endif
+                            hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
                         }
-                        pthread_mutex_unlock(&hDSPInterface->mutex);
-
-                        event = EMMCodecStrmCtrlAck;
-                        bufType = streamId + EMMCodecStream0;
-                        args[0] = (void *) msg.dwArg1; /* SN error status */
-                        args[1] = (void *) ackType;    /* acknowledge Id */
-                        args[2] = (void *) bufType;    /* port Id */
-                        args[6] = (void *) arg;        /* handle */
-                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "GOT MESSAGE USN_DSPACK_STRMCTRL \n");
+                        i++;
+                        i = i % QUEUE_SIZE;
                     }
-                    else
+                }
+
+                if (ackType != USN_STRMCMD_FLUSH) {
+                    for (i = 0; i < QUEUE_SIZE; i++)
                     {
-                        event = EMMCodecDspMessageRecieved;
-                        args[0] = (void *) msg.dwCmd;
-                        args[1] = (void *) msg.dwArg1;
-                        args[2] = (void *) msg.dwArg2;
-                        args[6] = (void *) arg;  /* handle */
-                        OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "GOT MESSAGE EMMCodecDspMessageRecieved \n");
+                        pDmmBuf = ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i];
+                        if ((pDmmBuf) &&
+                            (((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i]) &&
+                            (pDmmBuf->pMapped == (void *)msg.dwArg2))
+                        {
+                            DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved,
+                                    ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
+                            LCML_FREE(pDmmBuf);
+                            pDmmBuf = NULL;
+                            ((LCML_DSP_INTERFACE *)arg)->strmcntlmapped[i] = 0;
+                            ((LCML_DSP_INTERFACE *)arg)->pStrmcntlDmmBuf[i] = NULL;
+                            break;
+                        }
                     }
+                }
+                pthread_mutex_unlock(&hDSPInterface->mutex);
+
+                event = EMMCodecStrmCtrlAck;
+                bufType = streamId + EMMCodecStream0;
+                args[0] = (void *) msg.dwArg1; /* SN error status */
+                args[1] = (void *) ackType;    /* acknowledge Id */
+                args[2] = (void *) bufType;    /* port Id */
+                args[6] = (void *) arg;        /* handle */
+                OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "GOT MESSAGE USN_DSPACK_STRMCTRL \n");
+            }
+            else
+            {
+                event = EMMCodecDspMessageRecieved;
+                args[0] = (void *) msg.dwCmd;
+                args[1] = (void *) msg.dwArg1;
+                args[2] = (void *) msg.dwArg2;
+                args[6] = (void *) arg;  /* handle */
+                OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "GOT MESSAGE EMMCodecDspMessageRecieved \n");
+            }
 
-                    /* call callback */
-                    OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "calling callback in application %p \n",((LCML_DSP_INTERFACE *)arg)->dspCodec);
+            /* call callback */
+            OMX_PRINT2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "calling callback in application %p \n",((LCML_DSP_INTERFACE *)arg)->dspCodec);
 #ifdef __PERF_INSTRUMENTATION__
-                    PERF_SendingCommand(hDSPInterface->pPERFcomp,
-                                        msg.dwCmd,
-                                        msg.dwArg1,
-                                        PERF_ModuleLLMM);
+            PERF_SendingCommand(hDSPInterface->pPERFcomp,
+                                msg.dwCmd,
+                                msg.dwArg1,
+                                PERF_ModuleLLMM);
 #endif
-                    hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
+            hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
 
-                }/* end of internal if(DSP_SUCCEEDED(status)) */
-                else
-                {
-                    OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "%d :: DSPManager_getmessage() failed: 0x%lx",__LINE__, status);
-                }
+        }/* end of internal if(DSP_SUCCEEDED(status)) */
+        else
+        {
+            OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "%d :: DSPManager_getmessage() failed: 0x%lx",__LINE__, status);
+        }
+
+    }/* end of internal while loop*/
 
-            }/* end of internal while loop*/
+    /* buffers may have come back that a release is waiting for */
+    pthread_mutex_lock(&((LCML_DSP_INTERFACE *)arg)->mutex);
+    if (((LCML_DSP_INTERFACE *)arg)->nReleaseWaiters)
+    {
+        pthread_cond_broadcast(&((LCML_DSP_INTERFACE *)arg)->releaseCond);
+    }
+    pthread_mutex_unlock(&((LCML_DSP_INTERFACE *)arg)->mutex);
 #ifdef __ERROR_PROPAGATION__
-            }/*end of if(index == 0)*/
-            if (index == 1){
-
-                struct DSP_PROCESSORSTATE  procState;
-                DSPProcessor_GetState(((LCML_DSP_INTERFACE *)arg)->dspCodec->hProc, &procState, sizeof(procState));
-
-                /*
-                fprintf(stdout, " dwErrMask = %0x \n",procState.errInfo.dwErrMask);
-                fprintf(stdout, " dwVal1 = %0x \n",procState.errInfo.dwVal1);
-                fprintf(stdout, " dwVal2 = %0x \n",procState.errInfo.dwVal2);
-                fprintf(stdout, " dwVal3 = %0x \n",procState.errInfo.dwVal3);
-                fprintf(stdout, "MMU Fault Error.\n");
-                */
-
-                TUsnCodecEvent  event = EMMCodecDspError;
-                void * args[10];
-                LCML_DSP_INTERFACE *hDSPInterface = ((LCML_DSP_INTERFACE *)arg) ;
-                args[0] = NULL;
-                args[4] = NULL;
-                args[5] = NULL;
-                args[6] = (void *) arg;  /* handle */
-                hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
+    }/*end of if(index == 0)*/
+    if (index == 1){
+
+        struct DSP_PROCESSORSTATE  procState;
+        DSPProcessor_GetState(((LCML_DSP_INTERFACE *)arg)->dspCodec->hProc, &procState, sizeof(procState));
+
+        /*
+        fprintf(stdout, " dwErrMask = %0x \n",procState.errInfo.dwErrMask);
+        fprintf(stdout, " dwVal1 = %0x \n",procState.errInfo.dwVal1);
+        fprintf(stdout, " dwVal2 = %0x \n",procState.errInfo.dwVal2);
+        fprintf(stdout, " dwVal3 = %0x \n",procState.errInfo.dwVal3);
+        fprintf(stdout, "MMU Fault Error.\n");
+        */
+        BridgeMarkStale();
+
+        TUsnCodecEvent  event = EMMCodecDspError;
+        void * args[10];
+        LCML_DSP_INTERFACE *hDSPInterface = ((LCML_DSP_INTERFACE *)arg) ;
+        args[0] = NULL;
+        args[4] = NULL;
+        args[5] = NULL;
+        args[6] = (void *) arg;  /* handle */
+        hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
 
-            }
-            if (index == 2){
-
-                struct DSP_PROCESSORSTATE  procState;
-                DSPProcessor_GetState(((LCML_DSP_INTERFACE *)arg)->dspCodec->hProc, &procState, sizeof(procState));
-
-                /*
-                fprintf(stdout, " dwErrMask = %0x \n",procState.errInfo.dwErrMask);
-                fprintf(stdout, " dwVal1 = %0x \n",procState.errInfo.dwVal1);
-                fprintf(stdout, " dwVal2 = %0x \n",procState.errInfo.dwVal2);
-                fprintf(stdout, " dwVal3 = %0x \n",procState.errInfo.dwVal3);
-                fprintf(stdout, "SYS_ERROR Error.\n");
-                */
-
-                TUsnCodecEvent  event = EMMCodecDspError;
-                void * args[10];
-                LCML_DSP_INTERFACE *hDSPInterface = ((LCML_DSP_INTERFACE *)arg) ;
-                args[0] = NULL;
-                args[4] = NULL;
-                args[5] = NULL;
-                args[6] = (void *) arg;  /* handle */
-                hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
+    }
+    if (index == 2){
+
+        struct DSP_PROCESSORSTATE  procState;
+        DSPProcessor_GetState(((LCML_DSP_INTERFACE *)arg)->dspCodec->hProc, &procState, sizeof(procState));
+
+        /*
+        fprintf(stdout, " dwErrMask = %0x \n",procState.errInfo.dwErrMask);
+        fprintf(stdout, " dwVal1 = %0x \n",procState.errInfo.dwVal1);
+        fprintf(stdout, " dwVal2 = %0x \n",procState.errInfo.dwVal2);
+        fprintf(stdout, " dwVal3 = %0x \n",procState.errInfo.dwVal3);
+        fprintf(stdout, "SYS_ERROR Error.\n");
+        */
+        BridgeMarkStale();
+
+        TUsnCodecEvent  event = EMMCodecDspError;
+        void * args[10];
+        LCML_DSP_INTERFACE *hDSPInterface = ((LCML_DSP_INTERFACE *)arg) ;
+        args[0] = NULL;
+        args[4] = NULL;
+        args[5] = NULL;
+        args[6] = (void *) arg;  /* handle */
+        hDSPInterface->dspCodec->Callbacks.LCML_Callback(event,args);
 
-            }
+    }
 #endif
-        } /* end of external if(DSP_SUCCEEDED(status)) */
+}
+
+
+/** ========================================================================
+* Reads the number of shared dispatcher threads from LCML_DISPATCH_THREADS.
+* Unset or 0 keeps one MessagingThread per instance. Called with
+* g_dispatchMutex held.
+*
+* @retval  number of dispatcher threads, 0 when disabled
+** ==========================================================================*/
+static OMX_U32 DispatchThreadCount(void)
+{
+    char *value;
+    int nThreads = 0;
+
+    if (g_nDispatchThreads < 0)
+    {
+        value = getenv("LCML_DISPATCH_THREADS");
+        if (value != NULL)
+        {
+            nThreads = atoi(value);
+        }
+        if (nThreads < 0)
+        {
+            nThreads = 0;
+        }
+        if (nThreads > LCML_DISPATCH_MAX_THREADS)
+        {
+            nThreads = LCML_DISPATCH_MAX_THREADS;
+        }
+        g_nDispatchThreads = nThreads;
+    }
+    return (OMX_U32)g_nDispatchThreads;
+}
+
+/** ========================================================================
+* Starts the configured dispatcher threads. A thread that cannot be created
+* just leaves the dispatcher with fewer threads. Called with g_dispatchMutex
+* held.
+** ==========================================================================*/
+static void DispatchStart(OMX_U32 nThreads)
+{
+    LCML_DISPATCH_THREAD *pThread;
+    OMX_U32 i;
+
+    for (i = 0; i < nThreads; i++)
+    {
+        pThread = &g_dispatchThreads[g_nDispatchActive];
+        memset(pThread, 0, sizeof(*pThread));
+        if (pthread_create(&pThread->tid, NULL, DispatchThread, pThread) != 0)
+        {
+            break;
+        }
+        g_nDispatchActive++;
+    }
+}
+
+/** ========================================================================
+* Registers the notifications only the dispatcher thread of the node waits
+* on. Two threads must never wait on the same notification, and the node's
+* own set stays with the MessagingThread that serves it until the
+* dispatcher takes it over.
+*
+* @param[in] hInterface  LCML instance with a created node
+*
+* @retval  OMX_ErrorNone                   Success
+* @retval  OMX_ErrorInsufficientResources  Out of memory
+* @retval  OMX_ErrorHardware               Registration failed
+** ==========================================================================*/
+static OMX_ERRORTYPE DispatchNotifyRegister(LCML_DSP_INTERFACE *hInterface)
+{
+    struct DSP_NOTIFICATION *notification;
+    DSP_STATUS status = DSP_SOK;
+    OMX_U32 i;
+
+    for (i = 0; i < LCML_NUM_NOTIFICATIONS && DSP_SUCCEEDED(status); i++)
+    {
+        LCML_MALLOC(notification, sizeof(struct DSP_NOTIFICATION), struct DSP_NOTIFICATION);
+        if (notification == NULL)
+        {
+            DispatchNotifyRelease(hInterface);
+            return OMX_ErrorInsufficientResources;
+        }
+        memset(notification, 0, sizeof(struct DSP_NOTIFICATION));
+        hInterface->aDispatchNotifications[i] = notification;
+
+        if (i == 0)
+        {
+            status = DSPNode_RegisterNotify(hInterface->dspCodec->hNode, DSP_NODEMESSAGEREADY, DSP_SIGNALEVENT, notification);
+        }
+        else if (i == LCML_NOTIFY_STATECHANGE)
+        {
+            status = DSPNode_RegisterNotify(hInterface->dspCodec->hNode, DSP_NODESTATECHANGE, DSP_SIGNALEVENT, notification);
+        }
+#ifdef __ERROR_PROPAGATION__
         else
         {
-            OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "%d :: DSPManager_WaitForEvents() failed: 0x%lx",__LINE__, status);
+            status = DSPProcessor_RegisterNotify(hInterface->dspCodec->hProc, i == 1 ? DSP_MMUFAULT : DSP_SYSERROR,
+                                                 DSP_SIGNALEVENT, notification);
         }
+#endif
+    }
+    if (DSP_FAILED(status))
+    {
+        OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg,
+                "%d :: LCML:: dispatcher notification %lu failed: 0x%lx\n", __LINE__, i - 1, status);
+        DispatchNotifyRelease(hInterface);
+        return OMX_ErrorHardware;
+    }
+    return OMX_ErrorNone;
+}
 
-    } /* end of external while(1) loop */
+/* unregisters and frees the dispatcher notifications, no thread may wait on them */
+static void DispatchNotifyRelease(LCML_DSP_INTERFACE *hInterface)
+{
+    OMX_U32 i;
 
-	/* 720p implementation */
-    if (((LCML_DSP_INTERFACE *)arg)->ReUseMap)
+    for (i = 0; i < LCML_NUM_NOTIFICATIONS; i++)
     {
-        pthread_mutex_unlock(&((LCML_DSP_INTERFACE *)arg)->m_isStopped_mutex);
+        if (hInterface->aDispatchNotifications[i] == NULL)
+        {
+            continue;
+        }
+        if (i == 0 || i == LCML_NOTIFY_STATECHANGE)
+        {
+            DSPNode_RegisterNotify(hInterface->dspCodec->hNode, 0, DSP_SIGNALEVENT, hInterface->aDispatchNotifications[i]);
+        }
+        else
+        {
+            DSPProcessor_RegisterNotify(hInterface->dspCodec->hProc, 0, DSP_SIGNALEVENT, hInterface->aDispatchNotifications[i]);
+        }
+        LCML_FREE(hInterface->aDispatchNotifications[i]);
+        hInterface->aDispatchNotifications[i] = NULL;
     }
-    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "Exiting LOOP of LCML \n");
+}
+
+/** ========================================================================
+* Hands the node of an instance to the least loaded dispatcher thread,
+* starting the dispatcher on first use. A thread that is parked or about
+* to wait again picks the node up right away. One blocked in the bridge
+* only does so at its next wake, so *pbBootstrap then asks the caller for
+* a MessagingThread that serves the node until then.
+*
+* @param[in]  hInterface   LCML instance whose notifications are set up
+* @param[out] pbBootstrap  OMX_TRUE when the node needs a bootstrap thread
+*
+* @retval  OMX_ErrorNone                   node is served by the dispatcher
+* @retval  OMX_ErrorNotImplemented         dispatcher disabled
+* @retval  OMX_ErrorInsufficientResources  no thread could take the node
+** ==========================================================================*/
+static OMX_ERRORTYPE DispatchRegister(LCML_DSP_INTERFACE *hInterface, OMX_BOOL *pbBootstrap)
+{
+    LCML_DISPATCH_THREAD *pThread = NULL;
+    OMX_U32 nThreads;
+    OMX_U32 i;
+
+    *pbBootstrap = OMX_FALSE;
+    hInterface->pDispatcher = NULL;
+    pthread_mutex_lock(&g_dispatchMutex);
+    nThreads = DispatchThreadCount();
+    pthread_mutex_unlock(&g_dispatchMutex);
+    if (nThreads == 0)
+    {
+        return OMX_ErrorNotImplemented;
+    }
+    if (DispatchNotifyRegister(hInterface) != OMX_ErrorNone)
+    {
+        return OMX_ErrorInsufficientResources;
+    }
+
+    pthread_mutex_lock(&g_dispatchMutex);
+    while (g_bDispatchStopping)
+    {
+        pthread_cond_wait(&g_dispatchCond, &g_dispatchMutex);
+    }
+    if (g_nDispatchActive == 0)
+    {
+        DispatchStart(nThreads);
+    }
+    for (i = 0; i < g_nDispatchActive; i++)
+    {
+        if (g_dispatchThreads[i].nNodes < LCML_DISPATCH_MAX_NODES &&
+            (pThread == NULL || g_dispatchThreads[i].nNodes < pThread->nNodes))
+        {
+            pThread = &g_dispatchThreads[i];
+        }
+    }
+    if (pThread == NULL)
+    {
+        pthread_mutex_unlock(&g_dispatchMutex);
+        DispatchNotifyRelease(hInterface);
+        return OMX_ErrorInsufficientResources;
+    }
+    hInterface->nDispatchState = LCML_DISPATCH_PENDING;
+    pThread->nodes[pThread->nNodes++] = hInterface;
+    pThread->nGeneration++;
+    hInterface->pDispatcher = pThread;
+    g_nDispatchUsers++;
+    *pbBootstrap = pThread->bBlocked;
+    /* a parked thread adds the node to its wait now */
+    pthread_cond_broadcast(&g_dispatchCond);
+    pthread_mutex_unlock(&g_dispatchMutex);
+    return OMX_ErrorNone;
+}
+
+/** ========================================================================
+* Removes the node of an instance from its dispatcher thread and
+* terminates it. The state change that raises ends the wait of the thread,
+* which acknowledges the removal through nSeenGeneration, and the wait of a
+* bootstrap MessagingThread still running. When the node cannot be
+* terminated, both see the removal once their wait times out, within
+* LCML_EVENT_TIMEOUT_MS. On return no thread waits on
+* the node's notifications nor runs its callbacks. The last instance to
+* leave stops the dispatcher threads.
+*
+* @param[in] hInterface  LCML instance registered with DispatchRegister
+** ==========================================================================*/
+static void DispatchUnregister(LCML_DSP_INTERFACE *hInterface)
+{
+    LCML_DISPATCH_THREAD *pThread = hInterface->pDispatcher;
+    DSP_STATUS status;
+    OMX_BOOL bWatched;
+    OMX_U32 nGeneration;
+    OMX_U32 nStop = 0;
+    OMX_U32 i;
+
+    pthread_mutex_lock(&g_dispatchMutex);
+    for (i = 0; i < pThread->nNodes; i++)
+    {
+        if (pThread->nodes[i] == hInterface)
+        {
+            pThread->nodes[i] = pThread->nodes[--pThread->nNodes];
+            break;
+        }
+    }
+    bWatched = (hInterface->nDispatchState == LCML_DISPATCH_WATCHED) ? OMX_TRUE : OMX_FALSE;
+    nGeneration = ++pThread->nGeneration;
+    pthread_mutex_unlock(&g_dispatchMutex);
+
+    hInterface->pshutdownFlag = 1;
+    status = TerminateNode(hInterface);
+    if (DSP_FAILED(status))
+    {
+        OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: Node terminate failed: 0x%lx\n", __LINE__, status);
+    }
+
+    pthread_mutex_lock(&g_dispatchMutex);
+    while (bWatched && (OMX_S32)(pThread->nSeenGeneration - nGeneration) < 0)
+    {
+        pthread_cond_wait(&g_dispatchCond, &g_dispatchMutex);
+    }
+    pthread_mutex_unlock(&g_dispatchMutex);
+
+    if (hInterface->g_tidMessageThread != 0)
+    {
+        pthread_join(hInterface->g_tidMessageThread, NULL);
+        hInterface->g_tidMessageThread = 0;
+    }
+    DispatchNotifyRelease(hInterface);
+
+    pthread_mutex_lock(&g_dispatchMutex);
+    hInterface->pDispatcher = NULL;
+    if (--g_nDispatchUsers == 0)
+    {
+        /* every thread is left without nodes and parked */
+        g_bDispatchStopping = OMX_TRUE;
+        nStop = g_nDispatchActive;
+        for (i = 0; i < nStop; i++)
+        {
+            g_dispatchThreads[i].bExit = OMX_TRUE;
+        }
+        g_nDispatchActive = 0;
+        pthread_cond_broadcast(&g_dispatchCond);
+    }
+    pthread_mutex_unlock(&g_dispatchMutex);
+
+    if (nStop == 0)
+    {
+        return;
+    }
+    for (i = 0; i < nStop; i++)
+    {
+        pthread_join(g_dispatchThreads[i].tid, NULL);
+    }
+    pthread_mutex_lock(&g_dispatchMutex);
+    g_bDispatchStopping = OMX_FALSE;
+    pthread_cond_broadcast(&g_dispatchCond);
+    pthread_mutex_unlock(&g_dispatchMutex);
+}
+
+/* leaves a node that stopped or whose DSP failed out of later waits */
+static void DispatchDrop(LCML_DSP_INTERFACE *hInterface)
+{
+    pthread_mutex_lock(&g_dispatchMutex);
+    hInterface->nDispatchState = LCML_DISPATCH_DROPPED;
+    pthread_mutex_unlock(&g_dispatchMutex);
+}
+
+/* OMX_TRUE once the dispatcher thread of the node waits on it itself */
+static OMX_BOOL DispatchAdopted(LCML_DSP_INTERFACE *hInterface)
+{
+    OMX_BOOL bAdopted;
+
+    if (hInterface->pDispatcher == NULL)
+    {
+        return OMX_FALSE;
+    }
+    pthread_mutex_lock(&g_dispatchMutex);
+    bAdopted = (hInterface->nDispatchState != LCML_DISPATCH_PENDING) ? OMX_TRUE : OMX_FALSE;
+    pthread_mutex_unlock(&g_dispatchMutex);
+    return bAdopted;
+}
+
+/** ========================================================================
+* Shared dispatcher thread. Waits directly in the bridge on the dispatcher
+* notifications of all nodes it serves and runs ProcessNodeEvents for the
+* node that was signalled. Only node events end that wait early: nodes
+* added meanwhile are picked up at the next wake, and a removal terminates
+* the node, whose state change wakes the thread. A node that cannot be
+* terminated is let go when the wait times out after LCML_EVENT_TIMEOUT_MS.
+* Without nodes to wait on the thread parks on g_dispatchCond instead.
+*
+* @param[in] arg  LCML_DISPATCH_THREAD run by this thread
+** ==========================================================================*/
+static void* DispatchThread(void *arg)
+{
+    LCML_DISPATCH_THREAD *pThread = (LCML_DISPATCH_THREAD *)arg;
+    struct DSP_NOTIFICATION *aNotifications[LCML_DISPATCH_MAX_EVENTS];
+    LCML_DSP_INTERFACE *aOwners[LCML_DISPATCH_MAX_EVENTS];
+    LCML_DSP_INTERFACE *pNode;
+    DSP_STATUS status;
+    unsigned int nEvents = 0;
+    unsigned int index = 0;
+    OMX_U32 i, j;
+
+#ifdef ANDROID
+    prctl(PR_SET_NAME, (unsigned long)"LCMLDispatch", 0, 0, 0);
+#endif
 #ifdef __PERF_INSTRUMENTATION__
-    PERF_Done(((LCML_DSP_INTERFACE *)arg)->pPERFcomp);
+    pThread->pPERF =
+        PERF_Create(PERF_FOURCC('C','M','L','D'),
+                    PERF_ModuleAudioDecode | PERF_ModuleAudioEncode |
+                    PERF_ModuleVideoDecode | PERF_ModuleVideoEncode |
+                    PERF_ModuleImageDecode | PERF_ModuleImageEncode |
+                    PERF_ModuleCommonLayer);
 #endif
-    return (void*)OMX_ErrorNone;
+
+    pthread_mutex_lock(&g_dispatchMutex);
+    while (1)
+    {
+        pThread->bBlocked = OMX_FALSE;
+        if (pThread->bExit)
+        {
+            break;
+        }
+        nEvents = 0;
+        for (i = 0; i < pThread->nNodes; i++)
+        {
+            pNode = pThread->nodes[i];
+            if (pNode->nDispatchState == LCML_DISPATCH_DROPPED)
+            {
+                continue;
+            }
+            pNode->nDispatchState = LCML_DISPATCH_WATCHED;
+#ifdef __PERF_INSTRUMENTATION__
+            pNode->pPERFcomp = pThread->pPERF;
+#endif
+            for (j = 0; j < LCML_NUM_NOTIFICATIONS; j++)
+            {
+                aNotifications[nEvents] = pNode->aDispatchNotifications[j];
+                aOwners[nEvents++] = pNode;
+            }
+        }
+        if (pThread->nSeenGeneration != pThread->nGeneration)
+        {
+            pThread->nSeenGeneration = pThread->nGeneration;
+            pthread_cond_broadcast(&g_dispatchCond);
+        }
+        if (nEvents == 0)
+        {
+            pthread_cond_wait(&g_dispatchCond, &g_dispatchMutex);
+            continue;
+        }
+        pThread->bBlocked = OMX_TRUE;
+        pthread_mutex_unlock(&g_dispatchMutex);
+
+        /* see above for what ends the wait early */
+        status = DSPManager_WaitForEvents(aNotifications, nEvents, &index, LCML_EVENT_TIMEOUT_MS);
+        if (DSP_SUCCEEDED(status) && index < nEvents)
+        {
+            pNode = aOwners[index];
+            j = index % LCML_NUM_NOTIFICATIONS;
+            if (j == LCML_NOTIFY_STATECHANGE)
+            {
+                if (!NodeRunning(pNode))
+                {
+                    if (pNode->pshutdownFlag != 1)
+                    {
+                        pthread_mutex_lock(&pNode->eventMutex);
+                        ProcessNodeEvents(pNode, 0);
+                        pthread_mutex_unlock(&pNode->eventMutex);
+                    }
+                    DispatchDrop(pNode);
+                }
+            }
+            else
+            {
+                pthread_mutex_lock(&pNode->eventMutex);
+                ProcessNodeEvents(pNode, j);
+                pthread_mutex_unlock(&pNode->eventMutex);
+                if (j != 0)
+                {
+                    DispatchDrop(pNode);
+                }
+            }
+        }
+        else if (status != DSP_ETIMEOUT)
+        {
+            OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)aOwners[0]->pCodecinterfacehandle)->dbg, "%d :: DSPManager_WaitForEvents() failed: 0x%lx",__LINE__, status);
+        }
+        pthread_mutex_lock(&g_dispatchMutex);
+    }
+    pthread_mutex_unlock(&g_dispatchMutex);
+
+#ifdef __PERF_INSTRUMENTATION__
+    PERF_Done(pThread->pPERF);
+#endif
+    return NULL;
 }
 
 
@@ -0,0 +1,82 @@
+ifeq ($(BUILD_LCML_TEST),1)
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+# LCML built against the BridgeSim stand-in instead of libbridge
+LOCAL_SRC_FILES:= \
+	../src/LCML_DspCodec.c \
+	BridgeSim.c \
+	LcmlStressTest.c
+
+LOCAL_C_INCLUDES := \
+	$(TI_OMX_COMP_C_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := \
+	libdl \
+	liblog \
+	libOMX_Core
+
+ifeq ($(PERF_INSTRUMENTATION),1)
+LOCAL_SHARED_LIBRARIES += \
+	libPERF
+endif
+
+LOCAL_CFLAGS := $(TI_OMX_CFLAGS)
+
+LOCAL_MODULE:= LcmlStressTest
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	../src/LCML_DspCodec.c \
+	BridgeSim.c \
+	LcmlTunnelBench.c
+
+LOCAL_C_INCLUDES := \
+	$(TI_OMX_COMP_C_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := \
+	libdl \
+	liblog \
+	libOMX_Core
+
+ifeq ($(PERF_INSTRUMENTATION),1)
+LOCAL_SHARED_LIBRARIES += \
+	libPERF
+endif
+
+LOCAL_CFLAGS := $(TI_OMX_CFLAGS)
+
+LOCAL_MODULE:= LcmlTunnelBench
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	../src/LCML_DspCodec.c \
+	BridgeSim.c \
+	LcmlInstanceTest.c
+
+LOCAL_C_INCLUDES := \
+	$(TI_OMX_COMP_C_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := \
+	libdl \
+	liblog \
+	libOMX_Core
+
+ifeq ($(PERF_INSTRUMENTATION),1)
+LOCAL_SHARED_LIBRARIES += \
+	libPERF
+endif
+
+LOCAL_CFLAGS := $(TI_OMX_CFLAGS)
+
+LOCAL_MODULE:= LcmlInstanceTest
+
+include $(BUILD_EXECUTABLE)
+endif
@@ -0,0 +1,570 @@
+
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  BridgeSim.c
+*
+*  Stand-in for the subset of the DSP/BIOS Bridge API used by LCML.
+*
+*  Mappings are identity mappings and reservations hand out addresses that are
+*  never dereferenced, so the comm structs LCML sends to the node are plain ARM
+*  pointers. A thread per node plays the DSP: it takes USN_GPPMSG_SET_BUFF
+*  messages in order, spends BRIDGE_SIM_PROCESS_US on each and answers with
+*  USN_DSPMSG_BUFF_FREE for the same comm struct. Every other message is
+*  swallowed. Flush and invalidate sleep BRIDGE_SIM_FLUSH_NS_PER_KB per KB.
+*
+*  All waiting is done on one mutex and condition variable; notification
+*  objects are signalled by setting their handle.
+* =========================================================================== */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <dbapi.h>
+#include "usn.h"
+#include "BridgeSim.h"
+
+#define SIM_MSG_QUEUE   64
+#define SIM_VA_BASE     0x20000000UL
+#define SIM_MAX_NOTIFY  4
+
+typedef struct SIM_MSG_RING {
+    struct DSP_MSG msgs[SIM_MSG_QUEUE];
+    unsigned int nHead;
+    unsigned int nCount;
+} SIM_MSG_RING;
+
+typedef struct SIM_NODE {
+    pthread_t tid;
+    int bRunning;
+    int bStopping;
+    SIM_MSG_RING toDsp;
+    SIM_MSG_RING fromDsp;
+    DSP_NODESTATE state;
+    /* like the bridge, any number of objects may wait for each event */
+    struct DSP_NOTIFICATION *pMsgReady[SIM_MAX_NOTIFY];
+    struct DSP_NOTIFICATION *pStateChange[SIM_MAX_NOTIFY];
+} SIM_NODE;
+
+static pthread_mutex_t g_simMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_simCond = PTHREAD_COND_INITIALIZER;
+static BRIDGE_SIM_STATS g_simStats;
+static unsigned long g_nextVa = SIM_VA_BASE;
+static unsigned long g_nFlushNsPerKb = BRIDGE_SIM_DEFAULT_FLUSH_NS_PER_KB;
+static unsigned long g_nProcessUs = BRIDGE_SIM_DEFAULT_PROCESS_US;
+static unsigned long g_nMapNsPerKb = BRIDGE_SIM_DEFAULT_MAP_NS_PER_KB;
+static int g_nProcessor;
+static int g_bCrashed;
+
+static void SimSleepNs(unsigned long long ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        ;
+}
+
+/* kernel work, so unlike the DSP side it burns the calling CPU */
+static void SimSpinNs(unsigned long long ns)
+{
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000000ULL + now.tv_nsec - start.tv_nsec < ns);
+}
+
+static unsigned long SimEnv(const char *name, unsigned long def)
+{
+    char *value = getenv(name);
+
+    return value ? strtoul(value, NULL, 0) : def;
+}
+
+/* called with g_simMutex held */
+static void SimPush(SIM_MSG_RING *pRing, const struct DSP_MSG *pMsg)
+{
+    pRing->msgs[(pRing->nHead + pRing->nCount) % SIM_MSG_QUEUE] = *pMsg;
+    pRing->nCount++;
+}
+
+/* called with g_simMutex held */
+static void SimPop(SIM_MSG_RING *pRing, struct DSP_MSG *pMsg)
+{
+    *pMsg = pRing->msgs[pRing->nHead];
+    pRing->nHead = (pRing->nHead + 1) % SIM_MSG_QUEUE;
+    pRing->nCount--;
+}
+
+/* called with g_simMutex held */
+static void SimSignal(struct DSP_NOTIFICATION *pNotification)
+{
+    if (pNotification != NULL)
+    {
+        pNotification->handle = (HANDLE)1;
+        pthread_cond_broadcast(&g_simCond);
+    }
+}
+
+/* called with g_simMutex held */
+static void SimSignalAll(struct DSP_NOTIFICATION **aNotifications)
+{
+    int i;
+
+    for (i = 0; i < SIM_MAX_NOTIFY; i++)
+    {
+        SimSignal(aNotifications[i]);
+    }
+}
+
+/* called with g_simMutex held */
+static DSP_STATUS SimRegister(struct DSP_NOTIFICATION **aNotifications,
+                              int bRegister, struct DSP_NOTIFICATION *hNotification)
+{
+    int i;
+
+    for (i = 0; i < SIM_MAX_NOTIFY; i++)
+    {
+        if (aNotifications[i] == hNotification)
+        {
+            aNotifications[i] = NULL;
+        }
+    }
+    for (i = 0; bRegister && i < SIM_MAX_NOTIFY; i++)
+    {
+        if (aNotifications[i] == NULL)
+        {
+            aNotifications[i] = hNotification;
+            return DSP_SOK;
+        }
+    }
+    return bRegister ? DSP_EMEMORY : DSP_SOK;
+}
+
+/* called with g_simMutex held */
+static void SimSetState(SIM_NODE *pNode, DSP_NODESTATE state)
+{
+    pNode->state = state;
+    SimSignalAll(pNode->pStateChange);
+}
+
+static void *SimDspThread(void *arg)
+{
+    SIM_NODE *pNode = arg;
+    struct DSP_MSG msg;
+
+    pthread_mutex_lock(&g_simMutex);
+    for (;;)
+    {
+        while (pNode->toDsp.nCount == 0 && !pNode->bStopping)
+        {
+            pthread_cond_wait(&g_simCond, &g_simMutex);
+        }
+        if (pNode->bStopping)
+        {
+            break;
+        }
+        SimPop(&pNode->toDsp, &msg);
+        pthread_cond_broadcast(&g_simCond);
+        if ((msg.dwCmd & 0xffffff00) != USN_GPPMSG_SET_BUFF || g_bCrashed)
+        {
+            continue;
+        }
+
+        pthread_mutex_unlock(&g_simMutex);
+        SimSleepNs(g_nProcessUs * 1000ULL);
+        pthread_mutex_lock(&g_simMutex);
+
+        while (pNode->fromDsp.nCount == SIM_MSG_QUEUE && !pNode->bStopping)
+        {
+            pthread_cond_wait(&g_simCond, &g_simMutex);
+        }
+        msg.dwCmd = USN_DSPMSG_BUFF_FREE | (msg.dwCmd & 0xff);
+        SimPush(&pNode->fromDsp, &msg);
+        g_simStats.nBuffersReturned++;
+        SimSignalAll(pNode->pMsgReady);
+    }
+    pthread_mutex_unlock(&g_simMutex);
+    return NULL;
+}
+
+static DSP_STATUS SimCacheOp(ULONG ulSize)
+{
+    pthread_mutex_lock(&g_simMutex);
+    g_simStats.nCacheOps++;
+    g_simStats.nCacheBytes += ulSize;
+    pthread_mutex_unlock(&g_simMutex);
+    SimSleepNs((unsigned long long)ulSize * g_nFlushNsPerKb / 1024);
+    return DSP_SOK;
+}
+
+void BridgeSim_Crash(void)
+{
+    pthread_mutex_lock(&g_simMutex);
+    g_bCrashed = 1;
+    pthread_mutex_unlock(&g_simMutex);
+}
+
+void BridgeSim_GetStats(BRIDGE_SIM_STATS *pStats)
+{
+    pthread_mutex_lock(&g_simMutex);
+    *pStats = g_simStats;
+    pthread_mutex_unlock(&g_simMutex);
+}
+
+/* ---------------------------------------------------------------- manager */
+
+DBAPI DspManager_Open(UINT argc, PVOID argp)
+{
+    return DSP_SOK;
+}
+
+DBAPI DspManager_Close(UINT argc, PVOID argp)
+{
+    return DSP_SOK;
+}
+
+DBAPI DSPManager_RegisterObject(struct DSP_UUID *pUuid, DSP_DCDOBJTYPE objType,
+                                CHAR *pszPathName)
+{
+    return DSP_SOK;
+}
+
+DBAPI DSPManager_UnregisterObject(struct DSP_UUID *pUuid, DSP_DCDOBJTYPE objType)
+{
+    return DSP_SOK;
+}
+
+DBAPI DSPManager_WaitForEvents(struct DSP_NOTIFICATION **aNotifications,
+                               UINT uCount, OUT UINT *puIndex, UINT uTimeout)
+{
+    DSP_STATUS status = DSP_ETIMEOUT;
+    struct timespec deadline;
+    UINT i;
+
+    if (puIndex == NULL || (uCount && aNotifications == NULL))
+    {
+        return DSP_EPOINTER;
+    }
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += uTimeout / 1000;
+    deadline.tv_nsec += (uTimeout % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&g_simMutex);
+    for (;;)
+    {
+        for (i = 0; i < uCount; i++)
+        {
+            if (aNotifications[i] != NULL && aNotifications[i]->handle != NULL)
+            {
+                aNotifications[i]->handle = NULL;
+                *puIndex = i;
+                status = DSP_SOK;
+                goto EXIT;
+            }
+        }
+        if (uTimeout == (UINT)DSP_FOREVER)
+        {
+            pthread_cond_wait(&g_simCond, &g_simMutex);
+        }
+        else if (pthread_cond_timedwait(&g_simCond, &g_simMutex, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+EXIT:
+    pthread_mutex_unlock(&g_simMutex);
+    return status;
+}
+
+
+/* -------------------------------------------------------------- processor */
+
+DBAPI DSPProcessor_Attach(UINT uProcessor,
+                          OPTIONAL CONST struct DSP_PROCESSORATTRIN *pAttrIn,
+                          OUT DSP_HPROCESSOR *phProcessor)
+{
+    g_nFlushNsPerKb = SimEnv(BRIDGE_SIM_FLUSH_NS_PER_KB_ENV, BRIDGE_SIM_DEFAULT_FLUSH_NS_PER_KB);
+    g_nProcessUs = SimEnv(BRIDGE_SIM_PROCESS_US_ENV, BRIDGE_SIM_DEFAULT_PROCESS_US);
+    g_nMapNsPerKb = SimEnv(BRIDGE_SIM_MAP_NS_PER_KB_ENV, BRIDGE_SIM_DEFAULT_MAP_NS_PER_KB);
+    *phProcessor = &g_nProcessor;
+    return DSP_SOK;
+}
+
+DBAPI DSPProcessor_Detach(DSP_HPROCESSOR hProcessor)
+{
+    return DSP_SOK;
+}
+
+DBAPI DSPProcessor_GetState(DSP_HPROCESSOR hProcessor,
+                            OUT struct DSP_PROCESSORSTATE *pProcStatus,
+                            UINT uStateInfoSize)
+{
+    memset(pProcStatus, 0, uStateInfoSize);
+    pProcStatus->iState = PROC_RUNNING;
+    return DSP_SOK;
+}
+
+DBAPI DSPProcessor_RegisterNotify(DSP_HPROCESSOR hProcessor, UINT uEventMask,
+                                  UINT uNotifyType,
+                                  struct DSP_NOTIFICATION *hNotification)
+{
+    /* the simulated processor never faults */
+    return DSP_SOK;
+}
+
+DBAPI DSPProcessor_ReserveMemory(DSP_HPROCESSOR hProcessor, ULONG ulSize,
+                                 PVOID *ppRsvAddr)
+{
+    pthread_mutex_lock(&g_simMutex);
+    *ppRsvAddr = (PVOID)g_nextVa;
+    g_nextVa += (ulSize + 4095) & ~4095UL;
+    pthread_mutex_unlock(&g_simMutex);
+    return DSP_SOK;
+}
+
+DBAPI DSPProcessor_UnReserveMemory(DSP_HPROCESSOR hProcessor, PVOID pRsvAddr)
+{
+    return DSP_SOK;
+}
+
+DBAPI DSPProcessor_Map(DSP_HPROCESSOR hProcessor, PVOID pMpuAddr, ULONG ulSize,
+                       PVOID pReqAddr, PVOID *ppMapAddr, ULONG ulMapAttr)
+{
+    pthread_mutex_lock(&g_simMutex);
+    g_simStats.nMaps++;
+    pthread_mutex_unlock(&g_simMutex);
+    SimSpinNs((unsigned long long)ulSize * g_nMapNsPerKb / 1024);
+    *ppMapAddr = pMpuAddr;
+    return DSP_SOK;
+}
+
+DBAPI DSPProcessor_UnMap(DSP_HPROCESSOR hProcessor, PVOID pMapAddr)
+{
+    pthread_mutex_lock(&g_simMutex);
+    g_simStats.nUnMaps++;
+    pthread_mutex_unlock(&g_simMutex);
+    return DSP_SOK;
+}
+
+DBAPI DSPProcessor_FlushMemory(DSP_HPROCESSOR hProcessor, PVOID pMpuAddr,
+                               ULONG ulSize, ULONG ulFlags)
+{
+    return SimCacheOp(ulSize);
+}
+
+DBAPI DSPProcessor_InvalidateMemory(DSP_HPROCESSOR hProcessor, PVOID pMpuAddr,
+                                    ULONG ulSize)
+{
+    return SimCacheOp(ulSize);
+}
+
+DBAPI DSPProcessor_CacheOperations(DSP_HPROCESSOR hProcessor,
+                                   struct DSP_CACHEOP *aOps, UINT uCount)
+{
+    ULONG ulSize = 0;
+    UINT i;
+
+    /* one bridge call for the whole batch */
+    for (i = 0; i < uCount; i++)
+    {
+        ulSize += aOps[i].ulSize;
+    }
+    return SimCacheOp(ulSize);
+}
+
+/* ------------------------------------------------------------------- node */
+
+DBAPI DSPNode_Allocate(DSP_HPROCESSOR hProcessor,
+                       IN CONST struct DSP_UUID *pNodeID,
+                       IN CONST OPTIONAL struct DSP_CBDATA *pArgs,
+                       IN OPTIONAL struct DSP_NODEATTRIN *pAttrIn,
+                       OUT DSP_HNODE *phNode)
+{
+    SIM_NODE *pNode = calloc(1, sizeof(SIM_NODE));
+
+    if (pNode == NULL)
+    {
+        return DSP_EMEMORY;
+    }
+    *phNode = pNode;
+    return DSP_SOK;
+}
+
+DBAPI DSPNode_Connect(DSP_HNODE hNode, UINT uStream, DSP_HNODE hOtherNode,
+                      UINT uOtherStream, IN OPTIONAL struct DSP_STRMATTR *pAttr)
+{
+    return DSP_SOK;
+}
+
+DBAPI DSPNode_ConnectEx(DSP_HNODE hNode, UINT uStream, DSP_HNODE hOtherNode,
+                        UINT uOtherStream, IN OPTIONAL struct DSP_STRMATTR *pAttr,
+                        IN OPTIONAL struct DSP_CBDATA *pConnParam)
+{
+    return DSP_SOK;
+}
+
+DBAPI DSPNode_Create(DSP_HNODE hNode)
+{
+    ((SIM_NODE *)hNode)->state = NODE_CREATED;
+    return DSP_SOK;
+}
+
+DBAPI DSPNode_Run(DSP_HNODE hNode)
+{
+    SIM_NODE *pNode = hNode;
+
+    if (!pNode->bRunning)
+    {
+        if (pthread_create(&pNode->tid, NULL, SimDspThread, pNode))
+        {
+            return DSP_EFAIL;
+        }
+        pNode->bRunning = 1;
+        pthread_mutex_lock(&g_simMutex);
+        SimSetState(pNode, NODE_RUNNING);
+        pthread_mutex_unlock(&g_simMutex);
+    }
+    return DSP_SOK;
+}
+
+/* stops the thread standing in for the node, without a state change */
+static void SimStop(SIM_NODE *pNode)
+{
+    if (pNode->bRunning)
+    {
+        pthread_mutex_lock(&g_simMutex);
+        pNode->bStopping = 1;
+        pthread_cond_broadcast(&g_simCond);
+        pthread_mutex_unlock(&g_simMutex);
+        pthread_join(pNode->tid, NULL);
+        pNode->bRunning = 0;
+    }
+}
+
+DBAPI DSPNode_Terminate(DSP_HNODE hNode, DSP_STATUS *pStatus)
+{
+    SIM_NODE *pNode = hNode;
+
+    /* a crashed DSP no longer answers the terminate command */
+    if (g_bCrashed)
+    {
+        return DSP_EFAIL;
+    }
+    if (pNode->bRunning)
+    {
+        SimStop(pNode);
+        pthread_mutex_lock(&g_simMutex);
+        SimSetState(pNode, NODE_DONE);
+        pthread_mutex_unlock(&g_simMutex);
+    }
+    if (pStatus != NULL)
+    {
+        *pStatus = DSP_SOK;
+    }
+    return DSP_SOK;
+}
+
+DBAPI DSPNode_Delete(DSP_HNODE hNode)
+{
+    DSPNode_Terminate(hNode, NULL);
+    SimStop(hNode);
+    free(hNode);
+    return DSP_SOK;
+}
+
+DBAPI DSPNode_GetAttr(DSP_HNODE hNode, OUT struct DSP_NODEATTR *pAttr,
+                      UINT uAttrSize)
+{
+    SIM_NODE *pNode = hNode;
+
+    memset(pAttr, 0, uAttrSize);
+    pAttr->cbStruct = uAttrSize;
+    pthread_mutex_lock(&g_simMutex);
+    pAttr->iNodeInfo.nsExecutionState = pNode->state;
+    pthread_mutex_unlock(&g_simMutex);
+    return DSP_SOK;
+}
+
+DBAPI DSPNode_RegisterNotify(DSP_HNODE hNode, UINT uEventMask, UINT uNotifyType,
+                             struct DSP_NOTIFICATION *hNotification)
+{
+    SIM_NODE *pNode = hNode;
+    DSP_STATUS status = DSP_SOK;
+
+    /* a zero mask unregisters the object from every event */
+    pthread_mutex_lock(&g_simMutex);
+    if (uEventMask == 0 || (uEventMask & DSP_NODEMESSAGEREADY))
+    {
+        status = SimRegister(pNode->pMsgReady, uEventMask != 0, hNotification);
+        if (uEventMask != 0 && pNode->fromDsp.nCount)
+        {
+            SimSignal(hNotification);
+        }
+    }
+    if (DSP_SUCCEEDED(status) && (uEventMask == 0 || (uEventMask & DSP_NODESTATECHANGE)))
+    {
+        status = SimRegister(pNode->pStateChange, uEventMask != 0, hNotification);
+    }
+    pthread_mutex_unlock(&g_simMutex);
+    return status;
+}
+
+DBAPI DSPNode_PutMessage(DSP_HNODE hNode, IN CONST struct DSP_MSG *pMessage,
+                         UINT uTimeout)
+{
+    SIM_NODE *pNode = hNode;
+
+    pthread_mutex_lock(&g_simMutex);
+    while (pNode->toDsp.nCount == SIM_MSG_QUEUE)
+    {
+        pthread_cond_wait(&g_simCond, &g_simMutex);
+    }
+    SimPush(&pNode->toDsp, pMessage);
+    g_simStats.nMessagesIn++;
+    pthread_cond_broadcast(&g_simCond);
+    pthread_mutex_unlock(&g_simMutex);
+    return DSP_SOK;
+}
+
+DBAPI DSPNode_GetMessage(DSP_HNODE hNode, OUT struct DSP_MSG *pMessage,
+                         UINT uTimeout)
+{
+    SIM_NODE *pNode = hNode;
+    DSP_STATUS status = DSP_ETIMEOUT;
+
+    pthread_mutex_lock(&g_simMutex);
+    if (pNode->fromDsp.nCount)
+    {
+        SimPop(&pNode->fromDsp, pMessage);
+        pthread_cond_broadcast(&g_simCond);
+        status = DSP_SOK;
+    }
+    pthread_mutex_unlock(&g_simMutex);
+    return status;
+}
@@ -0,0 +1,56 @@
+
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  BridgeSim.h
+*
+*  In-process stand-in for the DSP/BIOS Bridge calls made by LCML. Linking it
+*  in place of libbridge lets LCML_DspCodec.c queue buffers against a node
+*  that returns every USN_GPPMSG_SET_BUFF as a USN_DSPMSG_BUFF_FREE after a
+*  fixed processing time, with cache operations that cost time in proportion
+*  to their size and DSP MMU mappings that cost CPU time in proportion to
+*  theirs.
+* =========================================================================== */
+
+#ifndef BRIDGE_SIM_H
+#define BRIDGE_SIM_H
+
+/* environment variables read when the processor is attached */
+#define BRIDGE_SIM_FLUSH_NS_PER_KB_ENV  "BRIDGE_SIM_FLUSH_NS_PER_KB"
+#define BRIDGE_SIM_PROCESS_US_ENV       "BRIDGE_SIM_PROCESS_US"
+#define BRIDGE_SIM_MAP_NS_PER_KB_ENV    "BRIDGE_SIM_MAP_NS_PER_KB"
+
+#define BRIDGE_SIM_DEFAULT_FLUSH_NS_PER_KB  1000    /* 1 ms per MB */
+#define BRIDGE_SIM_DEFAULT_PROCESS_US       50
+#define BRIDGE_SIM_DEFAULT_MAP_NS_PER_KB    500     /* page walk and MMU setup */
+
+typedef struct BRIDGE_SIM_STATS {
+    unsigned long nMessagesIn;       /* DSPNode_PutMessage calls */
+    unsigned long nBuffersReturned;  /* USN_DSPMSG_BUFF_FREE sent back */
+    unsigned long nCacheOps;         /* flush and invalidate calls, a batch counting once */
+    unsigned long long nCacheBytes;
+    unsigned long nMaps;
+    unsigned long nUnMaps;
+} BRIDGE_SIM_STATS;
+
+/* snapshot of the counters accumulated since program start */
+void BridgeSim_GetStats(BRIDGE_SIM_STATS *pStats);
+
+/* from here on the DSP hands nothing back, raises no event and fails
+ * DSPNode_Terminate, as after an MMU fault or a DSP exception */
+void BridgeSim_Crash(void);
+
+#endif /* BRIDGE_SIM_H */
@@ -0,0 +1,290 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  LcmlInstanceTest.c
+*
+*  Opens many LCML instances at once on top of the BridgeSim stand-in, runs
+*  buffers through every one of them and destroys them again, timing each
+*  whole EMMCodecControlDestroy. Set LCML_DISPATCH_THREADS to run the
+*  instances on the shared dispatcher.
+*
+*  The test fails when an instance cannot be initialised, when a buffer does
+*  not come back, or when the median destroy takes longer than the given
+*  limit (-t, default 5 ms).
+*
+*  With -c the DSP crashes before the instances are destroyed, so no node
+*  can be terminated; the test then fails when any destroy takes longer
+*  than the limit (default twice LCML_EVENT_TIMEOUT_MS) or never returns.
+*
+*  usage: LcmlInstanceTest [-n instances] [-b rounds] [-t max_ms] [-c]
+* =========================================================================== */
+
+#include <dirent.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "LCML_DspCodec.h"
+#include "BridgeSim.h"
+
+#define INSTANCE_NUM_OUT            4
+#define INSTANCE_BUF_SIZE           4096
+#define INSTANCE_DEFAULT_COUNT      16
+#define INSTANCE_DEFAULT_ROUNDS     50
+#define INSTANCE_DEFAULT_MEDIAN_MS  5.0
+
+typedef struct INSTANCE {
+    OMX_HANDLETYPE hLcml;
+    LCML_CODEC_INTERFACE *pCodec;
+    OMX_U8 *pBuffers[INSTANCE_NUM_OUT];
+} INSTANCE;
+
+static pthread_mutex_t g_instanceMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_instanceCond = PTHREAD_COND_INITIALIZER;
+static OMX_U32 g_nReturned;
+
+static double NowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void InstanceCallback(TUsnCodecEvent event, void *args[10])
+{
+    if (event != EMMCodecBufferProcessed)
+    {
+        return;
+    }
+    pthread_mutex_lock(&g_instanceMutex);
+    g_nReturned++;
+    pthread_cond_broadcast(&g_instanceCond);
+    pthread_mutex_unlock(&g_instanceMutex);
+}
+
+/* waits up to a second for the node to hand back nCount buffers in total */
+static int WaitReturned(OMX_U32 nCount)
+{
+    struct timespec ts;
+    int ret = 0;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += 1;
+    pthread_mutex_lock(&g_instanceMutex);
+    while (g_nReturned < nCount && ret == 0)
+    {
+        ret = pthread_cond_timedwait(&g_instanceCond, &g_instanceMutex, &ts);
+    }
+    ret = g_nReturned < nCount ? -1 : 0;
+    pthread_mutex_unlock(&g_instanceMutex);
+    return ret;
+}
+
+/* threads of the process, the test's own included */
+static int CountThreads(void)
+{
+    DIR *pDir = opendir("/proc/self/task");
+    struct dirent *pEntry;
+    int nThreads = 0;
+
+    if (pDir == NULL)
+    {
+        return -1;
+    }
+    while ((pEntry = readdir(pDir)) != NULL)
+    {
+        if (pEntry->d_name[0] != '.')
+        {
+            nThreads++;
+        }
+    }
+    closedir(pDir);
+    return nThreads;
+}
+
+static OMX_ERRORTYPE OpenInstance(INSTANCE *pInstance)
+{
+    static struct DSP_UUID uuid = {
+        0x1a2b3c4d, 0x5e6f, 0x7081, 0x92, 0xa3, {0xb4, 0xc5, 0xd6, 0xe7, 0xf8, 0x09}
+    };
+    static OMX_U16 crPhArgs[] = {1, 0, 1, 1, 0, INSTANCE_NUM_OUT, END_OF_CR_PHASE_ARGS};
+    LCML_DSP_INTERFACE *pLcml;
+    LCML_DSP *pDsp;
+    LCML_CALLBACKTYPE cb;
+    OMX_ERRORTYPE eError;
+    OMX_U32 i;
+
+    for (i = 0; i < INSTANCE_NUM_OUT; i++)
+    {
+        pInstance->pBuffers[i] = memalign(4096, INSTANCE_BUF_SIZE);
+        if (pInstance->pBuffers[i] == NULL)
+        {
+            return OMX_ErrorInsufficientResources;
+        }
+        memset(pInstance->pBuffers[i], 0, INSTANCE_BUF_SIZE);
+    }
+
+    eError = GetHandle(&pInstance->hLcml);
+    if (eError != OMX_ErrorNone)
+    {
+        return eError;
+    }
+    pLcml = (LCML_DSP_INTERFACE *)pInstance->hLcml;
+    pInstance->pCodec = (LCML_CODEC_INTERFACE *)pLcml->pCodecinterfacehandle;
+    pDsp = pLcml->dspCodec;
+
+    pDsp->In_BufInfo.nBuffers = 1;
+    pDsp->In_BufInfo.nSize = INSTANCE_BUF_SIZE;
+    pDsp->In_BufInfo.DataTrMethod = DMM_METHOD;
+    pDsp->Out_BufInfo.nBuffers = INSTANCE_NUM_OUT;
+    pDsp->Out_BufInfo.nSize = INSTANCE_BUF_SIZE;
+    pDsp->Out_BufInfo.DataTrMethod = DMM_METHOD;
+    pDsp->NodeInfo.nNumOfDLLs = 1;
+    pDsp->NodeInfo.AllUUIDs[0].uuid = &uuid;
+    strcpy((char *)pDsp->NodeInfo.AllUUIDs[0].DllName, "instance_sn.dll64P");
+    pDsp->NodeInfo.AllUUIDs[0].eDllType = DLL_NODEOBJECT;
+    pDsp->DeviceInfo.TypeofDevice = 0;
+    pDsp->pCrPhArgs = crPhArgs;
+    pDsp->SegID = 0;
+    pDsp->Timeout = -1;
+    pDsp->Priority = 5;
+    pDsp->ProfileID = -1;
+
+    cb.LCML_Callback = InstanceCallback;
+    return pInstance->pCodec->InitMMCodec(pInstance->pCodec, "", NULL, NULL, &cb);
+}
+
+static int CompareMs(const void *a, const void *b)
+{
+    double d = *(const double *)a - *(const double *)b;
+
+    return d < 0 ? -1 : d > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    INSTANCE *pInstances;
+    double *pDestroyMs;
+    double fLimit = 0.0, fDestroyMs, fStart;
+    OMX_U32 nCount = INSTANCE_DEFAULT_COUNT, nRounds = INSTANCE_DEFAULT_ROUNDS;
+    OMX_U32 nOpened, nQueued = 0, i, j, k;
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+    void *args[10] = {0};
+    int opt, bLost = 0, bCrash = 0, ret;
+
+    while ((opt = getopt(argc, argv, "n:b:t:c")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                nCount = atoi(optarg);
+                break;
+            case 'b':
+                nRounds = atoi(optarg);
+                break;
+            case 't':
+                fLimit = atof(optarg);
+                break;
+            case 'c':
+                bCrash = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n instances] [-b rounds] [-t max_ms] [-c]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (fLimit == 0.0)
+    {
+        fLimit = bCrash ? 2.0 * LCML_EVENT_TIMEOUT_MS : INSTANCE_DEFAULT_MEDIAN_MS;
+    }
+
+    pInstances = calloc(nCount, sizeof(INSTANCE));
+    pDestroyMs = calloc(nCount, sizeof(double));
+    if (nCount == 0 || pInstances == NULL || pDestroyMs == NULL)
+    {
+        fprintf(stderr, "cannot allocate %lu instances\n", nCount);
+        return 1;
+    }
+
+    for (nOpened = 0; nOpened < nCount; nOpened++)
+    {
+        eError = OpenInstance(&pInstances[nOpened]);
+        if (eError != OMX_ErrorNone)
+        {
+            fprintf(stderr, "instance %lu: init failed: 0x%x\n", nOpened + 1, eError);
+            break;
+        }
+    }
+    printf("%lu of %lu instances opened\n", nOpened, nCount);
+
+    for (k = 0; k < nRounds && !bLost; k++)
+    {
+        for (i = 0; i < nOpened; i++)
+        {
+            for (j = 0; j < INSTANCE_NUM_OUT; j++)
+            {
+                if (pInstances[i].pCodec->QueueBuffer(pInstances[i].pCodec, EMMCodecOutputBufferMapReuse,
+                                                      pInstances[i].pBuffers[j], INSTANCE_BUF_SIZE,
+                                                      INSTANCE_BUF_SIZE, NULL, 0, NULL) == OMX_ErrorNone)
+                {
+                    nQueued++;
+                }
+            }
+        }
+        bLost = WaitReturned(nQueued);
+    }
+    printf("%lu buffers queued, %lu returned, %d threads\n", nQueued, g_nReturned, CountThreads());
+    if (bCrash)
+    {
+        BridgeSim_Crash();
+        printf("DSP crashed\n");
+    }
+
+    for (i = 0; i < nOpened; i++)
+    {
+        fStart = NowMs();
+        pInstances[i].pCodec->ControlCodec(pInstances[i].pCodec, EMMCodecControlDestroy, args);
+        pDestroyMs[i] = NowMs() - fStart;
+    }
+    for (i = 0; i < nCount; i++)
+    {
+        for (j = 0; j < INSTANCE_NUM_OUT; j++)
+        {
+            free(pInstances[i].pBuffers[j]);
+        }
+    }
+
+    qsort(pDestroyMs, nOpened, sizeof(double), CompareMs);
+    if (nOpened)
+    {
+        printf("destroy: median %.3f ms, max %.3f ms\n",
+               pDestroyMs[nOpened / 2], pDestroyMs[nOpened - 1]);
+    }
+
+    /* after a crash every destroy has to return in time, not just most */
+    fDestroyMs = nOpened ? pDestroyMs[bCrash ? nOpened - 1 : nOpened / 2] : 0.0;
+    ret = nOpened == nCount && nQueued && !bLost && fDestroyMs <= fLimit ? 0 : 1;
+    printf("%s: %lu instances, %s destroy %.3f ms (limit %.1f ms)\n",
+           ret ? "FAIL" : "PASS", nOpened, bCrash ? "max" : "median", fDestroyMs, fLimit);
+    free(pDestroyMs);
+    free(pInstances);
+    return ret;
+}
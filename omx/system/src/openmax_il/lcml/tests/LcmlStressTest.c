@@ -0,0 +1,324 @@
+
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  LcmlStressTest.c
+*
+*  Drives LCML_DspCodec.c on top of the BridgeSim stand-in and measures how
+*  fast output buffers come back from the node, first with output traffic
+*  alone and then while another thread keeps queueing large input buffers
+*  whose cache flush is slow.
+*
+*  Output buffers must not wait behind the input flushes: the test fails when
+*  the output rate under input load drops below the given fraction (-r,
+*  default 0.5) of the rate without it.
+*
+*  usage: LcmlStressTest [-d seconds] [-i input_kb] [-o output_kb] [-r ratio]
+* =========================================================================== */
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "LCML_DspCodec.h"
+#include "BridgeSim.h"
+
+#define STRESS_NUM_IN           4
+#define STRESS_NUM_OUT          8
+#define STRESS_DEFAULT_SECONDS  3
+#define STRESS_DEFAULT_IN_KB    4096
+#define STRESS_DEFAULT_OUT_KB   4
+#define STRESS_DEFAULT_RATIO    0.5
+
+/* buffers the node has handed back and that wait to be queued again */
+typedef struct STRESS_PORT {
+    TMMCodecBufferType eQueueType;
+    OMX_U8 *pBuffers[STRESS_NUM_OUT];
+    OMX_U32 nBuffers;
+    OMX_U32 nSize;
+    OMX_U8 *pFree[STRESS_NUM_OUT];
+    OMX_U32 nFree;
+    OMX_U32 nReturned;
+    OMX_U32 nQueueCalls;
+    double fQueueMaxMs;
+    double fQueueTotalMs;
+    int bFeeding;
+    pthread_t tid;
+} STRESS_PORT;
+
+static pthread_mutex_t g_stressMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_stressCond = PTHREAD_COND_INITIALIZER;
+static STRESS_PORT g_ports[2];     /* 0 input, 1 output */
+static LCML_CODEC_INTERFACE *g_pCodec;
+
+static double NowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void StressCallback(TUsnCodecEvent event, void *args[10])
+{
+    STRESS_PORT *pPort;
+
+    if (event != EMMCodecBufferProcessed)
+    {
+        return;
+    }
+    pPort = &g_ports[(TMMCodecBufferType)args[0] == EMMCodecOuputBuffer ? 1 : 0];
+
+    pthread_mutex_lock(&g_stressMutex);
+    pPort->pFree[pPort->nFree++] = (OMX_U8 *)args[1];
+    pPort->nReturned++;
+    pthread_cond_broadcast(&g_stressCond);
+    pthread_mutex_unlock(&g_stressMutex);
+}
+
+/* queues every buffer the node gives back until bFeeding is cleared */
+static void *FeedThread(void *arg)
+{
+    STRESS_PORT *pPort = arg;
+    OMX_ERRORTYPE eError;
+    OMX_U8 *pBuffer;
+    double fStart, fMs;
+
+    pthread_mutex_lock(&g_stressMutex);
+    for (;;)
+    {
+        while (pPort->nFree == 0 && pPort->bFeeding)
+        {
+            pthread_cond_wait(&g_stressCond, &g_stressMutex);
+        }
+        if (!pPort->bFeeding)
+        {
+            break;
+        }
+        pBuffer = pPort->pFree[--pPort->nFree];
+        pthread_mutex_unlock(&g_stressMutex);
+
+        fStart = NowMs();
+        eError = g_pCodec->QueueBuffer(g_pCodec, pPort->eQueueType, pBuffer,
+                                       pPort->nSize, pPort->nSize, NULL, 0, NULL);
+        fMs = NowMs() - fStart;
+
+        pthread_mutex_lock(&g_stressMutex);
+        if (eError != OMX_ErrorNone)
+        {
+            fprintf(stderr, "QueueBuffer failed: 0x%x\n", eError);
+            pPort->pFree[pPort->nFree++] = pBuffer;
+            pPort->bFeeding = 0;
+            break;
+        }
+        pPort->nQueueCalls++;
+        pPort->fQueueTotalMs += fMs;
+        if (fMs > pPort->fQueueMaxMs)
+        {
+            pPort->fQueueMaxMs = fMs;
+        }
+    }
+    pthread_mutex_unlock(&g_stressMutex);
+    return NULL;
+}
+
+static void StartFeeding(STRESS_PORT *pPort)
+{
+    pthread_mutex_lock(&g_stressMutex);
+    pPort->nReturned = 0;
+    pPort->nQueueCalls = 0;
+    pPort->fQueueMaxMs = 0;
+    pPort->fQueueTotalMs = 0;
+    pPort->bFeeding = 1;
+    pthread_mutex_unlock(&g_stressMutex);
+    pthread_create(&pPort->tid, NULL, FeedThread, pPort);
+}
+
+/* stops queueing and waits until the node has returned every buffer */
+static void StopFeeding(STRESS_PORT *pPort)
+{
+    pthread_mutex_lock(&g_stressMutex);
+    pPort->bFeeding = 0;
+    pthread_cond_broadcast(&g_stressCond);
+    pthread_mutex_unlock(&g_stressMutex);
+    pthread_join(pPort->tid, NULL);
+
+    pthread_mutex_lock(&g_stressMutex);
+    while (pPort->nFree < pPort->nBuffers)
+    {
+        pthread_cond_wait(&g_stressCond, &g_stressMutex);
+    }
+    pthread_mutex_unlock(&g_stressMutex);
+}
+
+static void PrintPort(const char *name, STRESS_PORT *pPort, double fSeconds)
+{
+    printf("  %-8s %8.1f buffers/s, QueueBuffer mean %.3f ms max %.3f ms\n",
+           name, pPort->nReturned / fSeconds,
+           pPort->nQueueCalls ? pPort->fQueueTotalMs / pPort->nQueueCalls : 0.0,
+           pPort->fQueueMaxMs);
+}
+
+static int SetupPort(STRESS_PORT *pPort, TMMCodecBufferType eQueueType,
+                     OMX_U32 nBuffers, OMX_U32 nSize)
+{
+    OMX_U32 i;
+
+    pPort->eQueueType = eQueueType;
+    pPort->nBuffers = nBuffers;
+    pPort->nSize = nSize;
+    for (i = 0; i < nBuffers; i++)
+    {
+        pPort->pBuffers[i] = memalign(4096, nSize);
+        if (pPort->pBuffers[i] == NULL)
+        {
+            return -1;
+        }
+        memset(pPort->pBuffers[i], 0, nSize);
+        pPort->pFree[i] = pPort->pBuffers[i];
+    }
+    pPort->nFree = nBuffers;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static struct DSP_UUID uuid = {
+        0x1a2b3c4d, 0x5e6f, 0x7081, 0x92, 0xa3, {0xb4, 0xc5, 0xd6, 0xe7, 0xf8, 0x09}
+    };
+    OMX_U16 crPhArgs[] = {1, 0, STRESS_NUM_IN, 1, 0, STRESS_NUM_OUT, END_OF_CR_PHASE_ARGS};
+    OMX_HANDLETYPE hLcml = NULL;
+    LCML_DSP_INTERFACE *pLcml;
+    LCML_DSP *pDsp;
+    LCML_CALLBACKTYPE cb;
+    BRIDGE_SIM_STATS sim;
+    OMX_ERRORTYPE eError;
+    double fSeconds = STRESS_DEFAULT_SECONDS, fRatio = STRESS_DEFAULT_RATIO;
+    double fAloneRate, fLoadedRate, fStart, fElapsed;
+    OMX_U32 nInKb = STRESS_DEFAULT_IN_KB, nOutKb = STRESS_DEFAULT_OUT_KB, i;
+    void *args[10] = {0};
+    int opt, ret;
+
+    while ((opt = getopt(argc, argv, "d:i:o:r:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                fSeconds = atof(optarg);
+                break;
+            case 'i':
+                nInKb = atoi(optarg);
+                break;
+            case 'o':
+                nOutKb = atoi(optarg);
+                break;
+            case 'r':
+                fRatio = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-d seconds] [-i input_kb] [-o output_kb] [-r ratio]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (SetupPort(&g_ports[0], EMMCodecInputBufferMapReuse, STRESS_NUM_IN, nInKb * 1024) ||
+        SetupPort(&g_ports[1], EMMCodecOutputBufferMapReuse, STRESS_NUM_OUT, nOutKb * 1024))
+    {
+        fprintf(stderr, "cannot allocate buffers\n");
+        return 1;
+    }
+
+    eError = GetHandle(&hLcml);
+    if (eError != OMX_ErrorNone)
+    {
+        fprintf(stderr, "GetHandle failed: 0x%x\n", eError);
+        return 1;
+    }
+    pLcml = (LCML_DSP_INTERFACE *)hLcml;
+    g_pCodec = (LCML_CODEC_INTERFACE *)pLcml->pCodecinterfacehandle;
+    pDsp = pLcml->dspCodec;
+
+    pDsp->In_BufInfo.nBuffers = STRESS_NUM_IN;
+    pDsp->In_BufInfo.nSize = nInKb * 1024;
+    pDsp->In_BufInfo.DataTrMethod = DMM_METHOD;
+    pDsp->Out_BufInfo.nBuffers = STRESS_NUM_OUT;
+    pDsp->Out_BufInfo.nSize = nOutKb * 1024;
+    pDsp->Out_BufInfo.DataTrMethod = DMM_METHOD;
+    pDsp->NodeInfo.nNumOfDLLs = 1;
+    pDsp->NodeInfo.AllUUIDs[0].uuid = &uuid;
+    strcpy((char *)pDsp->NodeInfo.AllUUIDs[0].DllName, "stress_sn.dll64P");
+    pDsp->NodeInfo.AllUUIDs[0].eDllType = DLL_NODEOBJECT;
+    pDsp->DeviceInfo.TypeofDevice = 0;
+    pDsp->pCrPhArgs = crPhArgs;
+    pDsp->SegID = 0;
+    pDsp->Timeout = -1;
+    pDsp->Priority = 5;
+    pDsp->ProfileID = -1;
+
+    cb.LCML_Callback = StressCallback;
+    eError = g_pCodec->InitMMCodec(g_pCodec, "", NULL, NULL, &cb);
+    if (eError != OMX_ErrorNone)
+    {
+        fprintf(stderr, "InitMMCodec failed: 0x%x\n", eError);
+        return 1;
+    }
+
+    printf("%u x %lu KB output buffers, %u x %lu KB input buffers, %.1f s per phase\n",
+           STRESS_NUM_OUT, nOutKb, STRESS_NUM_IN, nInKb, fSeconds);
+
+    /* phase A: output traffic alone */
+    fStart = NowMs();
+    StartFeeding(&g_ports[1]);
+    usleep(fSeconds * 1000000);
+    StopFeeding(&g_ports[1]);
+    fElapsed = (NowMs() - fStart) / 1000.0;
+    fAloneRate = g_ports[1].nReturned / fElapsed;
+    printf("output alone:\n");
+    PrintPort("output", &g_ports[1], fElapsed);
+
+    /* phase B: the same output traffic next to large input buffers */
+    fStart = NowMs();
+    StartFeeding(&g_ports[0]);
+    StartFeeding(&g_ports[1]);
+    usleep(fSeconds * 1000000);
+    StopFeeding(&g_ports[1]);
+    fElapsed = (NowMs() - fStart) / 1000.0;
+    fLoadedRate = g_ports[1].nReturned / fElapsed;
+    StopFeeding(&g_ports[0]);
+    printf("output with input load:\n");
+    PrintPort("output", &g_ports[1], fElapsed);
+    PrintPort("input", &g_ports[0], fElapsed);
+
+    BridgeSim_GetStats(&sim);
+    printf("bridge: %lu messages, %lu buffers returned, %lu cache ops on %llu KB, %lu maps\n",
+           sim.nMessagesIn, sim.nBuffersReturned, sim.nCacheOps, sim.nCacheBytes / 1024, sim.nMaps);
+
+    g_pCodec->ControlCodec(g_pCodec, EMMCodecControlDestroy, args);
+    for (i = 0; i < STRESS_NUM_OUT; i++)
+    {
+        free(g_ports[0].pBuffers[i]);
+        free(g_ports[1].pBuffers[i]);
+    }
+
+    ret = fAloneRate > 0 && fLoadedRate >= fRatio * fAloneRate ? 0 : 1;
+    printf("%s: output rate under input load is %.0f%% of the rate without it\n",
+           ret ? "FAIL" : "PASS", fAloneRate > 0 ? 100.0 * fLoadedRate / fAloneRate : 0.0);
+    return ret;
+}
@@ -0,0 +1,435 @@
+
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  LcmlTunnelBench.c
+*
+*  Runs two LCML instances on top of the BridgeSim stand-in as a producer
+*  (say a decoder) whose output frames feed the input of a consumer (say the
+*  VPP), and compares two ways of moving the frames:
+*
+*    copy    - as two non-tunneled components: every frame is copied into a
+*              consumer buffer and both buffers are mapped and unmapped each
+*              time they are queued.
+*    tunnel  - the producer's buffer itself is queued on the consumer with
+*              LCML_BUFFER_TUNNEL, so both instances share one mapping per
+*              buffer and the CPU never touches the frame.
+*
+*  Reports frames/s, the CPU time spent per frame and the CPU load of the
+*  process, the DSP mappings made and the bytes flushed, for each mode. Fails when the tunnel
+*  is slower than the copy (-r, default 1.0 times its rate) or maps a buffer
+*  more than once.
+*
+*  Then releases a frame while the producer still holds it, as a FreeBuffer
+*  would, and fails when the release does not wait for the buffer or when
+*  the freed frame is later handed the consumer's shared mapping.
+*
+*  usage: LcmlTunnelBench [-d seconds] [-f frame_kb] [-n buffers] [-r ratio]
+* =========================================================================== */
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "LCML_DspCodec.h"
+#include "BridgeSim.h"
+
+#define BENCH_MAX_BUFS          16
+#define BENCH_DEFAULT_SECONDS   3
+#define BENCH_DEFAULT_FRAME_KB  450     /* VGA YUV 4:2:0 */
+#define BENCH_DEFAULT_BUFS      4
+#define BENCH_DEFAULT_RATIO     1.0
+
+/* one buffer handed back by a node, waiting for the pump thread */
+typedef struct BENCH_EVENT {
+    LCML_DSP_INTERFACE *pLcml;
+    TMMCodecBufferType eType;
+    OMX_U8 *pBuffer;
+} BENCH_EVENT;
+
+typedef struct BENCH_RESULT {
+    double fSeconds;
+    double fCpuSeconds;
+    OMX_U32 nFrames;
+    unsigned long nMaps;
+    unsigned long long nCacheKb;
+} BENCH_RESULT;
+
+static pthread_mutex_t g_benchMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_benchCond = PTHREAD_COND_INITIALIZER;
+static BENCH_EVENT g_events[4 * BENCH_MAX_BUFS];
+static OMX_U32 g_nEvents;
+static LCML_DSP_INTERFACE *g_pProducer;
+static LCML_DSP_INTERFACE *g_pConsumer;
+
+static double NowSeconds(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static void BenchCallback(TUsnCodecEvent event, void *args[10])
+{
+    if (event != EMMCodecBufferProcessed)
+    {
+        return;
+    }
+    pthread_mutex_lock(&g_benchMutex);
+    g_events[g_nEvents].pLcml = (LCML_DSP_INTERFACE *)args[6];
+    g_events[g_nEvents].eType = (TMMCodecBufferType)args[0];
+    g_events[g_nEvents].pBuffer = (OMX_U8 *)args[1];
+    g_nEvents++;
+    pthread_cond_broadcast(&g_benchCond);
+    pthread_mutex_unlock(&g_benchMutex);
+}
+
+static OMX_ERRORTYPE Queue(LCML_DSP_INTERFACE *pLcml, int eType, OMX_U8 *pBuffer, OMX_U32 nSize)
+{
+    LCML_CODEC_INTERFACE *pCodec = (LCML_CODEC_INTERFACE *)pLcml->pCodecinterfacehandle;
+
+    return pCodec->QueueBuffer(pCodec, (TMMCodecBufferType)eType, pBuffer,
+                               nSize, nSize, NULL, 0, NULL);
+}
+
+/* waits for the next returned buffer; 0 once nothing is in flight */
+static int NextEvent(BENCH_EVENT *pEvent, OMX_U32 nInFlight)
+{
+    pthread_mutex_lock(&g_benchMutex);
+    while (g_nEvents == 0 && nInFlight != 0)
+    {
+        pthread_cond_wait(&g_benchCond, &g_benchMutex);
+    }
+    if (g_nEvents == 0)
+    {
+        pthread_mutex_unlock(&g_benchMutex);
+        return 0;
+    }
+    *pEvent = g_events[0];
+    memmove(&g_events[0], &g_events[1], --g_nEvents * sizeof(BENCH_EVENT));
+    pthread_mutex_unlock(&g_benchMutex);
+    return 1;
+}
+
+/* runs one mode for fSeconds, then drains every buffer back */
+static int RunMode(int bTunnel, OMX_U8 *pFrames[], OMX_U8 *pCopies[], OMX_U32 nBufs,
+                   OMX_U32 nSize, double fSeconds, BENCH_RESULT *pResult)
+{
+    int nTunnel = bTunnel ? LCML_BUFFER_TUNNEL : 0;
+    OMX_U8 *pFreeCopies[BENCH_MAX_BUFS];
+    OMX_U8 *pPending[BENCH_MAX_BUFS];
+    OMX_U32 nFreeCopies = 0, nPending = 0, nInFlight = 0, i;
+    BRIDGE_SIM_STATS before, after;
+    BENCH_EVENT event;
+    double fStart, fCpuStart, fEnd;
+    int bRunning = 1;
+
+    BridgeSim_GetStats(&before);
+    fStart = NowSeconds(CLOCK_MONOTONIC);
+    fCpuStart = NowSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    fEnd = fStart + fSeconds;
+    pResult->nFrames = 0;
+
+    for (i = 0; i < nBufs; i++)
+    {
+        if (!bTunnel)
+        {
+            pFreeCopies[nFreeCopies++] = pCopies[i];
+        }
+        if (Queue(g_pProducer, EMMCodecOuputBuffer | nTunnel, pFrames[i], nSize) != OMX_ErrorNone)
+        {
+            return -1;
+        }
+        nInFlight++;
+    }
+
+    while (NextEvent(&event, nInFlight))
+    {
+        nInFlight--;
+        if (bRunning && NowSeconds(CLOCK_MONOTONIC) >= fEnd)
+        {
+            bRunning = 0;
+        }
+
+        if (event.pLcml == g_pProducer)
+        {
+            if (!bRunning)
+            {
+                continue;
+            }
+            if (bTunnel)
+            {
+                /* the frame goes on as it is */
+                if (Queue(g_pConsumer, EMMCodecInputBuffer | LCML_BUFFER_TUNNEL, event.pBuffer, nSize) != OMX_ErrorNone)
+                {
+                    return -1;
+                }
+                nInFlight++;
+                continue;
+            }
+            pPending[nPending++] = event.pBuffer;
+        }
+        else
+        {
+            pResult->nFrames++;
+            if (bTunnel)
+            {
+                if (bRunning)
+                {
+                    if (Queue(g_pProducer, EMMCodecOuputBuffer | LCML_BUFFER_TUNNEL, event.pBuffer, nSize) != OMX_ErrorNone)
+                    {
+                        return -1;
+                    }
+                    nInFlight++;
+                }
+                continue;
+            }
+            pFreeCopies[nFreeCopies++] = event.pBuffer;
+        }
+
+        /* copy mode: move every decoded frame that has a consumer buffer */
+        while (bRunning && nPending != 0 && nFreeCopies != 0)
+        {
+            OMX_U8 *pFrame = pPending[--nPending];
+            OMX_U8 *pCopy = pFreeCopies[--nFreeCopies];
+
+            memcpy(pCopy, pFrame, nSize);
+            if (Queue(g_pConsumer, EMMCodecInputBuffer, pCopy, nSize) != OMX_ErrorNone ||
+                Queue(g_pProducer, EMMCodecOuputBuffer, pFrame, nSize) != OMX_ErrorNone)
+            {
+                return -1;
+            }
+            nInFlight += 2;
+        }
+    }
+
+    pResult->fSeconds = NowSeconds(CLOCK_MONOTONIC) - fStart;
+    pResult->fCpuSeconds = NowSeconds(CLOCK_PROCESS_CPUTIME_ID) - fCpuStart;
+    BridgeSim_GetStats(&after);
+    pResult->nMaps = after.nMaps - before.nMaps;
+    pResult->nCacheKb = (after.nCacheBytes - before.nCacheBytes) / 1024;
+    return 0;
+}
+
+static void PrintResult(const char *name, BENCH_RESULT *pResult)
+{
+    printf("  %-7s %8.1f frames/s, %7.3f ms CPU per frame, CPU load %5.1f%%, %lu maps, %llu KB flushed\n",
+           name, pResult->nFrames / pResult->fSeconds,
+           pResult->nFrames ? 1000.0 * pResult->fCpuSeconds / pResult->nFrames : 0.0,
+           100.0 * pResult->fCpuSeconds / pResult->fSeconds,
+           pResult->nMaps, pResult->nCacheKb);
+}
+
+static LCML_DSP_INTERFACE *CreateInstance(OMX_U32 nBufs, OMX_U32 nSize)
+{
+    static struct DSP_UUID uuid = {
+        0x1a2b3c4d, 0x5e6f, 0x7081, 0x92, 0xa3, {0xb4, 0xc5, 0xd6, 0xe7, 0xf8, 0x0a}
+    };
+    static OMX_U16 crPhArgs[] = {1, 0, BENCH_MAX_BUFS, 1, 0, BENCH_MAX_BUFS, END_OF_CR_PHASE_ARGS};
+    OMX_HANDLETYPE hLcml = NULL;
+    LCML_DSP_INTERFACE *pLcml;
+    LCML_CODEC_INTERFACE *pCodec;
+    LCML_DSP *pDsp;
+    LCML_CALLBACKTYPE cb;
+    OMX_ERRORTYPE eError;
+
+    eError = GetHandle(&hLcml);
+    if (eError != OMX_ErrorNone)
+    {
+        fprintf(stderr, "GetHandle failed: 0x%x\n", eError);
+        return NULL;
+    }
+    pLcml = (LCML_DSP_INTERFACE *)hLcml;
+    pCodec = (LCML_CODEC_INTERFACE *)pLcml->pCodecinterfacehandle;
+    pDsp = pLcml->dspCodec;
+
+    pDsp->In_BufInfo.nBuffers = nBufs;
+    pDsp->In_BufInfo.nSize = nSize;
+    pDsp->In_BufInfo.DataTrMethod = DMM_METHOD;
+    pDsp->Out_BufInfo.nBuffers = nBufs;
+    pDsp->Out_BufInfo.nSize = nSize;
+    pDsp->Out_BufInfo.DataTrMethod = DMM_METHOD;
+    pDsp->NodeInfo.nNumOfDLLs = 1;
+    pDsp->NodeInfo.AllUUIDs[0].uuid = &uuid;
+    strcpy((char *)pDsp->NodeInfo.AllUUIDs[0].DllName, "tunnel_sn.dll64P");
+    pDsp->NodeInfo.AllUUIDs[0].eDllType = DLL_NODEOBJECT;
+    pDsp->DeviceInfo.TypeofDevice = 0;
+    pDsp->pCrPhArgs = crPhArgs;
+    pDsp->SegID = 0;
+    pDsp->Timeout = -1;
+    pDsp->Priority = 5;
+    pDsp->ProfileID = -1;
+
+    cb.LCML_Callback = BenchCallback;
+    eError = pCodec->InitMMCodec(pCodec, "", NULL, NULL, &cb);
+    if (eError != OMX_ErrorNone)
+    {
+        fprintf(stderr, "InitMMCodec failed: 0x%x\n", eError);
+        return NULL;
+    }
+    return pLcml;
+}
+
+static OMX_ERRORTYPE Release(LCML_DSP_INTERFACE *pLcml, OMX_U8 *pBuffer, OMX_U32 nSize, OMX_U32 nFlags)
+{
+    LCML_CODEC_INTERFACE *pCodec = (LCML_CODEC_INTERFACE *)pLcml->pCodecinterfacehandle;
+    void *args[10] = {0};
+
+    args[0] = pBuffer;
+    args[1] = (void *)nSize;
+    args[2] = (void *)nFlags;
+    return pCodec->ControlCodec(pCodec, EMMCodecControlReleaseBuffer, args);
+}
+
+/* frees a frame in flight on the producer and queues it again as a new
+ * buffer at the same address; it has to get a mapping of its own */
+static int CheckRelease(OMX_U8 *pFrame, OMX_U32 nSize)
+{
+    BRIDGE_SIM_STATS before, after;
+    BENCH_EVENT event;
+    OMX_ERRORTYPE eError;
+    OMX_U32 nInFlight;
+
+    if (Queue(g_pProducer, EMMCodecOuputBuffer | LCML_BUFFER_TUNNEL, pFrame, nSize) != OMX_ErrorNone)
+    {
+        return -1;
+    }
+    nInFlight = 1;
+    eError = Release(g_pProducer, pFrame, nSize, LCML_RELEASE_WAIT | LCML_RELEASE_OWNER);
+    while (NextEvent(&event, nInFlight))
+    {
+        nInFlight--;
+    }
+    if (eError != OMX_ErrorNone)
+    {
+        fprintf(stderr, "release of a queued buffer failed: 0x%x\n", eError);
+        return -1;
+    }
+
+    BridgeSim_GetStats(&before);
+    if (Queue(g_pProducer, EMMCodecOuputBuffer | LCML_BUFFER_TUNNEL, pFrame, nSize) != OMX_ErrorNone)
+    {
+        return -1;
+    }
+    nInFlight = 1;
+    while (NextEvent(&event, nInFlight))
+    {
+        nInFlight--;
+    }
+    BridgeSim_GetStats(&after);
+    printf("  release waited for the DSP, freed frame mapped %lu time(s) on reuse\n",
+           after.nMaps - before.nMaps);
+    return after.nMaps - before.nMaps == 1 ? 0 : -1;
+}
+
+static void DestroyInstance(LCML_DSP_INTERFACE *pLcml)
+{
+    LCML_CODEC_INTERFACE *pCodec = (LCML_CODEC_INTERFACE *)pLcml->pCodecinterfacehandle;
+    void *args[10] = {0};
+
+    pCodec->ControlCodec(pCodec, EMMCodecControlDestroy, args);
+}
+
+int main(int argc, char *argv[])
+{
+    OMX_U8 *pFrames[BENCH_MAX_BUFS], *pCopies[BENCH_MAX_BUFS];
+    BENCH_RESULT copy, tunnel;
+    double fSeconds = BENCH_DEFAULT_SECONDS, fRatio = BENCH_DEFAULT_RATIO;
+    double fCopyRate, fTunnelRate;
+    OMX_U32 nFrameKb = BENCH_DEFAULT_FRAME_KB, nBufs = BENCH_DEFAULT_BUFS, nSize, i;
+    int opt, ret, bReleaseFailed;
+
+    while ((opt = getopt(argc, argv, "d:f:n:r:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'd':
+                fSeconds = atof(optarg);
+                break;
+            case 'f':
+                nFrameKb = atoi(optarg);
+                break;
+            case 'n':
+                nBufs = atoi(optarg);
+                break;
+            case 'r':
+                fRatio = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-d seconds] [-f frame_kb] [-n buffers] [-r ratio]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (nBufs == 0 || nBufs > BENCH_MAX_BUFS || nFrameKb == 0)
+    {
+        fprintf(stderr, "1 to %d buffers of at least 1 KB\n", BENCH_MAX_BUFS);
+        return 1;
+    }
+    nSize = nFrameKb * 1024;
+
+    for (i = 0; i < nBufs; i++)
+    {
+        pFrames[i] = memalign(4096, nSize);
+        pCopies[i] = memalign(4096, nSize);
+        if (pFrames[i] == NULL || pCopies[i] == NULL)
+        {
+            fprintf(stderr, "cannot allocate buffers\n");
+            return 1;
+        }
+        memset(pFrames[i], 0x80, nSize);
+        memset(pCopies[i], 0, nSize);
+    }
+
+    g_pProducer = CreateInstance(nBufs, nSize);
+    g_pConsumer = CreateInstance(nBufs, nSize);
+    if (g_pProducer == NULL || g_pConsumer == NULL)
+    {
+        return 1;
+    }
+
+    printf("%lu x %lu KB frames, producer -> consumer, %.1f s per mode\n",
+           nBufs, nFrameKb, fSeconds);
+    if (RunMode(0, pFrames, pCopies, nBufs, nSize, fSeconds, &copy) ||
+        RunMode(1, pFrames, pCopies, nBufs, nSize, fSeconds, &tunnel))
+    {
+        fprintf(stderr, "QueueBuffer failed\n");
+        return 1;
+    }
+    PrintResult("copy", &copy);
+    PrintResult("tunnel", &tunnel);
+    bReleaseFailed = CheckRelease(pFrames[0], nSize) != 0;
+
+    DestroyInstance(g_pConsumer);
+    DestroyInstance(g_pProducer);
+    for (i = 0; i < nBufs; i++)
+    {
+        free(pFrames[i]);
+        free(pCopies[i]);
+    }
+
+    fCopyRate = copy.nFrames / copy.fSeconds;
+    fTunnelRate = tunnel.nFrames / tunnel.fSeconds;
+    ret = fTunnelRate > 0 && fTunnelRate >= fRatio * fCopyRate && tunnel.nMaps <= nBufs && !bReleaseFailed ? 0 : 1;
+    printf("%s: tunnel runs at %.0f%% of the copy rate with %lu maps for %lu buffers\n",
+           ret ? "FAIL" : "PASS", fCopyRate > 0 ? 100.0 * fTunnelRate / fCopyRate : 0.0,
+           tunnel.nMaps, nBufs);
+    return ret;
+}
@@ -3,20 +3,61 @@
 /* macros */
 #define MAX_ROLES 20
 #define MAX_TABLE_SIZE 30
+#ifndef MAX_CONCURRENT_INSTANCES
 #define MAX_CONCURRENT_INSTANCES 1
+#endif
     /* limit the number of max occuring instances of same component,
        tune this if you like
     */
 
+#define LIBRARY_IDLE_MS_ENV "TIOMX_LIBRARY_IDLE_MS"
+#define LIBRARY_IDLE_MS 10000
+    /* how long a component library stays loaded after its last instance
+       is freed; 0 unloads it at once, a negative value never does
+    */
+
+#define DSP_BUDGET_MHZ_ENV "TIOMX_DSP_BUDGET_MHZ"
+#define DSP_BUDGET_MHZ 430
+    /* DSP MHz the instances may commit together with TIOMX_CommitDspLoad,
+       the IVA2 clock at its highest OPP; 0 turns admission control off
+    */
+
+#define DSP_ADMIT_WAIT_MS_ENV "TIOMX_DSP_ADMIT_WAIT_MS"
+#define DSP_ADMIT_WAIT_MS 0
+    /* how long a commit that does not fit waits for other instances to
+       release their load before it is refused; 0 refuses at once
+    */
+
+#define INIT_HIST_BUCKETS 24
+    /* log2 buckets of GetHandle time in microseconds, the last one open */
+
 /* struct definitions */
+typedef struct _InitHistogram {
+    unsigned int nCount;
+    unsigned int nMaxUs;
+    unsigned int nBucket[INIT_HIST_BUCKETS];
+}InitHistogram;
+
 typedef struct _ComponentTable {
     OMX_STRING name;
     OMX_U16 nRoles;
     OMX_STRING pRoleArray[MAX_ROLES];
     OMX_HANDLETYPE* pHandle[MAX_CONCURRENT_INSTANCES];
+    /* instances, counting those still in OMX_ComponentInit; pHandle
+       holds NULL for each of those */
     int refCount;
+    /* resident library, kept open by the core between instances */
+    void* pModule;
+    /* a GetHandle is opening the library without the core lock */
+    int bLoading;
+    OMX_ERRORTYPE (*pComponentInit)(OMX_HANDLETYPE*);
+    unsigned long long nIdleSinceMs;
+    /* GetHandle time, [0] when the library had to be loaded, [1] when
+       it was resident */
+    InitHistogram sInitTime[2];
 }ComponentTable;
 
 /* function prototypes */
 OMX_ERRORTYPE TIOMX_BuildComponentTable();
+void TIOMX_DumpInstantiationStats();
 
@@ -1422,6 +1422,52 @@ OMX_API OMX_ERRORTYPE TIOMX_GetRolesOfComponent (
     OMX_INOUT   OMX_U32 *pNumRoles,
     OMX_OUT     OMX_U8 **roles);
 
+
+/** The TIOMX_CommitDspLoad method is called by a DSP based component when
+    it goes to OMX_StateIdle, with the DSP load it estimates for its current
+    settings. The core keeps the load of all instances within a budget, so
+    an instance that would overload the DSP is refused instead of all of
+    them dropping frames. A second call replaces the earlier commit.
+
+    @param [in] hComponent
+        Handle of the committing component.
+    @param [in] nMHz
+        The DSP MHz the component needs.
+    @return OMX_ERRORTYPE
+        OMX_ErrorInsufficientResources if the load does not fit within the
+        budget, after waiting for other instances to release theirs if the
+        core is configured to.
+    @ingroup core
+ */
+OMX_API OMX_ERRORTYPE TIOMX_CommitDspLoad(
+    OMX_IN  OMX_HANDLETYPE hComponent,
+    OMX_IN  OMX_U32 nMHz);
+
+/** The TIOMX_ReleaseDspLoad method gives back the DSP load committed by a
+    component, when it returns to OMX_StateLoaded. The core releases it as
+    well when the handle is freed.
+
+    @param [in] hComponent
+        Handle of the component.
+    @ingroup core
+ */
+OMX_API OMX_ERRORTYPE TIOMX_ReleaseDspLoad(
+    OMX_IN  OMX_HANDLETYPE hComponent);
+
+/** The TIOMX_GetDspLoad method returns the DSP load committed by all the
+    instances and the budget it is kept within, both in MHz. A budget of 0
+    means the core does not limit the load.
+
+    @param [out] pCommittedMHz
+        If non-NULL, receives the committed load.
+    @param [out] pBudgetMHz
+        If non-NULL, receives the budget.
+    @ingroup core
+ */
+OMX_API OMX_ERRORTYPE TIOMX_GetDspLoad(
+    OMX_OUT OMX_U32 *pCommittedMHz,
+    OMX_OUT OMX_U32 *pBudgetMHz);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
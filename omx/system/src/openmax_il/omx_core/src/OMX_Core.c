@@ -11,6 +11,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <time.h>
 #include <utils/Log.h>
 
 #undef LOG_TAG
@@ -31,6 +32,14 @@
 #define MAXNAMESIZE (130)
 #define EMPTY_STRING "\0"
 
+/** component libraries are lib<component name>.so */
+#ifndef COMPONENT_LIBRARY_PREFIX
+#define COMPONENT_LIBRARY_PREFIX "lib"
+#endif
+
+/** marks a slot of pModules reserved by a GetHandle still in progress */
+#define SLOT_RESERVED ((void*)-1)
+
 /** Determine the number of elements in an array */
 #define COUNTOF(x) (sizeof(x)/sizeof(x[0]))
 
@@ -40,11 +49,39 @@ static void* pModules[MAXCOMP] = {0};
 /** Array to hold the component handles for each allocated component */
 static void* pComponents[COUNTOF(pModules)] = {0};
 
+/** Array to hold the componentTable index of each allocated component */
+static int pEntries[COUNTOF(pModules)] = {0};
+
+/** Open-addressed name -> componentTable index map, built together with
+ * the table. Slots hold index + 1, 0 is empty. */
+#define HASH_SIZE (64)
+static int componentHash[HASH_SIZE] = {0};
+
+/** Library idle timeout in ms, from LIBRARY_IDLE_MS_ENV */
+static long nLibraryIdleMs = LIBRARY_IDLE_MS;
+
 /** count will be used as a reference counter for OMX_Init()
     so all changes to count should be mutex protected */
 int count = 0;
 static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/** signalled when a component library has been opened, see LoadModule */
+static pthread_cond_t loadCond = PTHREAD_COND_INITIALIZER;
+
+/** DSP load committed by each instance, see TIOMX_CommitDspLoad; an
+ * owner of NULL marks a free entry */
+static OMX_HANDLETYPE pLoadOwners[COUNTOF(pModules)] = {0};
+static OMX_U32 pLoadMHz[COUNTOF(pModules)] = {0};
+static OMX_U32 nDspCommittedMHz = 0;
+
+/** DSP budget and admission wait, from DSP_BUDGET_MHZ_ENV and
+ * DSP_ADMIT_WAIT_MS_ENV */
+static long nDspBudgetMHz = DSP_BUDGET_MHZ;
+static long nDspAdmitWaitMs = DSP_ADMIT_WAIT_MS;
+
+/** signalled when DSP load has been released */
+static pthread_cond_t dspLoadCond = PTHREAD_COND_INITIALIZER;
+
 int tableCount = 0;
 ComponentTable componentTable[MAX_TABLE_SIZE];
 char * sRoleArray[60][20];
@@ -103,6 +140,347 @@ char *tComponentName[MAXCOMP][2] = {
 };
 
 
+/*************************************************************************
+* NowMs() / NowUs()
+*
+* Description: monotonic clock, for library idle times and GetHandle times
+*
+**************************************************************************/
+static unsigned long long NowUs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static unsigned long long NowMs()
+{
+    return NowUs() / 1000;
+}
+
+/*************************************************************************
+* HashName()
+*
+* Description: FNV-1a hash of a component name, reduced to the hash table
+*
+**************************************************************************/
+static unsigned int HashName(const char* cName)
+{
+    unsigned int nHash = 2166136261u;
+
+    while (*cName) {
+        nHash ^= (unsigned char)*cName++;
+        nHash *= 16777619u;
+    }
+    return nHash & (HASH_SIZE - 1);
+}
+
+/*************************************************************************
+* FindComponent()
+*
+* Description: componentTable index of the named component, or -1
+*
+**************************************************************************/
+static int FindComponent(const char* cComponentName)
+{
+    unsigned int nSlot = HashName(cComponentName);
+    int nEntry;
+
+    while ((nEntry = componentHash[nSlot]) != 0) {
+        if (strcmp(componentTable[nEntry - 1].name, cComponentName) == 0) {
+            return nEntry - 1;
+        }
+        nSlot = (nSlot + 1) & (HASH_SIZE - 1);
+    }
+    return -1;
+}
+
+/*************************************************************************
+* LoadModule()
+*
+* Description: make the library of a component resident and look up its
+* OMX_ComponentInit, unless that was done already. Called with the mutex
+* held; it is dropped while the library is opened, so the caller must hold
+* an instance of the component (refCount) to keep it from being unloaded.
+*
+**************************************************************************/
+static OMX_ERRORTYPE LoadModule(ComponentTable* pEntry)
+{
+    static const char prefix[] = COMPONENT_LIBRARY_PREFIX;
+    static const char postfix[] = ".so";
+    OMX_ERRORTYPE err = OMX_ErrorNone;
+    void* pModule;
+    void* pInit = NULL;
+    const char* pErr;
+
+    /* another GetHandle of the same component may be opening it */
+    while (pEntry->bLoading) {
+        pthread_cond_wait(&loadCond, &mutex);
+    }
+    if (pEntry->pModule != NULL) {
+        return OMX_ErrorNone;
+    }
+    pEntry->bLoading = 1;
+    pthread_mutex_unlock(&mutex);
+
+    /* load the component and check for an error.  If filename is not an
+     * absolute path (i.e., it does not  begin with a "/"), then the
+     * file is searched for in the following locations:
+     *
+     *     The LD_LIBRARY_PATH environment variable locations
+     *     The library cache, /etc/ld.so.cache.
+     *     /lib
+     *     /usr/lib
+     *
+     * If there is an error, we can't go on, so set the error code and exit */
+
+    /* the lengths are defined herein or have been
+     * checked already, so strcpy and strcat are
+     * are safe to use in this context. */
+    char buf[sizeof(prefix) + MAXNAMESIZE + sizeof(postfix)];
+    strcpy(buf, prefix);
+    strcat(buf, pEntry->name);
+    strcat(buf, postfix);
+
+    dlerror();
+    pModule = dlopen(buf, RTLD_LAZY | RTLD_GLOBAL);
+    if (pModule == NULL) {
+        LOGE("dlopen %s failed because %s\n", buf, dlerror());
+        err = OMX_ErrorComponentNotFound;
+    }
+    else {
+        /* Get a function pointer to the "OMX_ComponentInit" function.  If
+         * there is an error, we can't go on, so set the error code and exit */
+        pInit = dlsym(pModule, "OMX_ComponentInit");
+        pErr = dlerror();
+        if ((pErr != NULL) || (pInit == NULL)) {
+            LOGE("%d:: dlsym failed for module %p\n", __LINE__, pModule);
+            dlclose(pModule);
+            pModule = NULL;
+            pInit = NULL;
+            err = OMX_ErrorInvalidComponent;
+        }
+    }
+
+    pthread_mutex_lock(&mutex);
+    pEntry->pModule = pModule;
+    pEntry->pComponentInit = pInit;
+    pEntry->bLoading = 0;
+    pthread_cond_broadcast(&loadCond);
+    return err;
+}
+
+/*************************************************************************
+* AddHandle() / RemoveHandle()
+*
+* Description: pHandle of a component is kept packed below refCount, with
+* NULL for each instance that is still being initialized. AddHandle fills
+* the slot of such an instance; RemoveHandle drops one instance, the one
+* with the given handle, or an uninitialized one for NULL. Called with the
+* mutex held.
+*
+**************************************************************************/
+static void AddHandle(ComponentTable* pEntry, OMX_HANDLETYPE hComponent)
+{
+    int handleIndex;
+
+    for (handleIndex = 0; handleIndex < pEntry->refCount; handleIndex++) {
+        if (pEntry->pHandle[handleIndex] == NULL) {
+            pEntry->pHandle[handleIndex] = hComponent;
+            return;
+        }
+    }
+}
+
+static OMX_BOOL RemoveHandle(ComponentTable* pEntry, OMX_HANDLETYPE hComponent)
+{
+    int handleIndex;
+
+    for (handleIndex = 0; handleIndex < pEntry->refCount; handleIndex++) {
+        if (pEntry->pHandle[handleIndex] == hComponent) {
+            pEntry->refCount -= 1;
+            pEntry->pHandle[handleIndex] = pEntry->pHandle[pEntry->refCount];
+            pEntry->pHandle[pEntry->refCount] = NULL;
+            return OMX_TRUE;
+        }
+    }
+    return OMX_FALSE;
+}
+
+/*************************************************************************
+* UnloadIdleModules()
+*
+* Description: close the libraries that have had no instance for longer
+* than the idle timeout; with bAll, every library without an instance.
+* Called with the mutex held.
+*
+**************************************************************************/
+static void UnloadIdleModules(OMX_BOOL bAll)
+{
+    unsigned long long nNow = 0;
+    int i;
+
+    if (!bAll) {
+        if (nLibraryIdleMs < 0) {
+            return;
+        }
+        nNow = NowMs();
+    }
+    for (i = 0; i < tableCount; i++) {
+        ComponentTable* pEntry = &componentTable[i];
+
+        if ((pEntry->pModule == NULL) || (pEntry->refCount != 0)) {
+            continue;
+        }
+        if (bAll || (nNow - pEntry->nIdleSinceMs >= (unsigned long long)nLibraryIdleMs)) {
+            LOGD("Unloading idle component library %s\n", pEntry->name);
+            dlclose(pEntry->pModule);
+            pEntry->pModule = NULL;
+            pEntry->pComponentInit = NULL;
+        }
+    }
+}
+
+/*************************************************************************
+* ReleaseModule()
+*
+* Description: called when an instance of a component goes away, or failed
+* to come up. The library stays resident for the idle timeout after its
+* last instance. Called with the mutex held.
+*
+**************************************************************************/
+static void ReleaseModule(ComponentTable* pEntry)
+{
+    if (pEntry->refCount != 0) {
+        return;
+    }
+    pEntry->nIdleSinceMs = NowMs();
+    if (nLibraryIdleMs == 0) {
+        UnloadIdleModules(OMX_FALSE);
+    }
+}
+
+/*************************************************************************
+* FindDspLoad() / ReleaseDspLoad()
+*
+* Description: FindDspLoad returns the pLoadOwners index of an instance,
+* or -1 when it has no load committed. ReleaseDspLoad frees an entry and
+* wakes the commits waiting for room. Called with the mutex held.
+*
+**************************************************************************/
+static int FindDspLoad(OMX_HANDLETYPE hComponent)
+{
+    int i;
+
+    for (i = 0; i < COUNTOF(pLoadOwners); i++) {
+        if (pLoadOwners[i] == hComponent) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void ReleaseDspLoad(int nIndex)
+{
+    nDspCommittedMHz -= pLoadMHz[nIndex];
+    LOGD("Released %lu DSP MHz of %p, %lu committed\n",
+         (unsigned long)pLoadMHz[nIndex], pLoadOwners[nIndex],
+         (unsigned long)nDspCommittedMHz);
+    pLoadOwners[nIndex] = NULL;
+    pLoadMHz[nIndex] = 0;
+    pthread_cond_broadcast(&dspLoadCond);
+}
+
+/*************************************************************************
+* DspLoadFits()
+*
+* Description: whether nMHz more can be committed on top of nOthersMHz.
+* Without a budget everything fits, and so does any load on an idle DSP,
+* or an instance needing more than the budget could never run. Called
+* with the mutex held.
+*
+**************************************************************************/
+static int DspLoadFits(OMX_U32 nOthersMHz, OMX_U32 nMHz)
+{
+    if ((nDspBudgetMHz <= 0) || (nOthersMHz == 0)) {
+        return 1;
+    }
+    return (unsigned long)nOthersMHz + nMHz <= (unsigned long)nDspBudgetMHz;
+}
+
+/*************************************************************************
+* RecordInitTime()
+*
+* Description: add one GetHandle time to a histogram
+*
+**************************************************************************/
+static void RecordInitTime(InitHistogram* pHist, unsigned long long nUs)
+{
+    unsigned int nBucket = 0;
+
+    while ((nBucket < INIT_HIST_BUCKETS - 1) && ((1ULL << nBucket) <= nUs)) {
+        nBucket++;
+    }
+    pHist->nBucket[nBucket]++;
+    pHist->nCount++;
+    if (nUs > pHist->nMaxUs) {
+        pHist->nMaxUs = nUs > 0xFFFFFFFFu ? 0xFFFFFFFFu : (unsigned int)nUs;
+    }
+}
+
+/*************************************************************************
+* InitTimePercentile()
+*
+* Description: upper bound in us of the bucket holding the given percentile
+*
+**************************************************************************/
+static unsigned int InitTimePercentile(InitHistogram* pHist, unsigned int nPercent)
+{
+    unsigned int nTarget = (pHist->nCount * nPercent + 99) / 100;
+    unsigned int nSeen = 0;
+    unsigned int nBucket;
+
+    for (nBucket = 0; nBucket < INIT_HIST_BUCKETS - 1; nBucket++) {
+        nSeen += pHist->nBucket[nBucket];
+        if (nSeen >= nTarget) {
+            return 1u << nBucket;
+        }
+    }
+    return pHist->nMaxUs;
+}
+
+/*************************************************************************
+* TIOMX_DumpInstantiationStats()
+*
+* Description: log the GetHandle time histograms of every component that
+* has been instantiated, split by whether its library had to be loaded.
+* Also done by the last TIOMX_Deinit.
+*
+**************************************************************************/
+void TIOMX_DumpInstantiationStats()
+{
+    static const char* const sKind[2] = { "load", "resident" };
+    int i;
+    int k;
+
+    pthread_mutex_lock(&mutex);
+    for (i = 0; i < tableCount; i++) {
+        for (k = 0; k < 2; k++) {
+            InitHistogram* pHist = &componentTable[i].sInitTime[k];
+
+            if (pHist->nCount == 0) {
+                continue;
+            }
+            LOGI("%s GetHandle (%s): n=%u p50<%uus p90<%uus max=%uus\n",
+                 componentTable[i].name, sKind[k], pHist->nCount,
+                 InitTimePercentile(pHist, 50), InitTimePercentile(pHist, 90),
+                 pHist->nMaxUs);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
 /******************************Public*Routine******************************\
 * OMX_Init()
 *
@@ -161,18 +539,21 @@ OMX_ERRORTYPE TIOMX_Init()
 * @retval OMX_NOERROR                      Successful
 *
 * Note
+* The core lock is only held to reserve the slot and the instance, and to
+* publish or roll them back; OMX_ComponentInit and SetCallbacks run without
+* it, so different components can be created at the same time.
 *
 \**************************************************************************/
 
 OMX_ERRORTYPE TIOMX_GetHandle( OMX_HANDLETYPE* pHandle, OMX_STRING cComponentName,
     OMX_PTR pAppData, OMX_CALLBACKTYPE* pCallBacks)
 {
-    static const char prefix[] = "lib";
-    static const char postfix[] = ".so";
-    OMX_ERRORTYPE (*pComponentInit)(OMX_HANDLETYPE*);
     OMX_ERRORTYPE err = OMX_ErrorNone;
     OMX_COMPONENTTYPE *componentType;
-    const char* pErr = dlerror();
+    OMX_HANDLETYPE hComponent = NULL;
+    ComponentTable *pEntry = NULL;
+    unsigned long long nStartUs = NowUs();
+    int bResident = 0;
 
     if(pthread_mutex_lock(&mutex) != 0)
     {
@@ -204,105 +585,97 @@ OMX_ERRORTYPE TIOMX_GetHandle( OMX_HANDLETYPE* pHandle, OMX_STRING cComponentNam
         goto UNLOCK_MUTEX;
     }
 
-    int refIndex = 0;
-    for (refIndex=0; refIndex < MAX_TABLE_SIZE; refIndex++) {
-        //get the index for the component in the table
-        if (strcmp(componentTable[refIndex].name, cComponentName) == 0) {
-            LOGD("Found component %s with refCount %d\n",
-                  cComponentName, componentTable[refIndex].refCount);
-
-            /* check if the component is already loaded */
-            if (componentTable[refIndex].refCount >= MAX_CONCURRENT_INSTANCES) {
-                err = OMX_ErrorInsufficientResources;
-                LOGE("Max instances of component %s already created.\n", cComponentName);
-                goto UNLOCK_MUTEX;
-            } else {  // we have not reached the limit yet
-                /* do what was done before need to limit concurrent instances of each component */
-
-                /* load the component and check for an error.  If filename is not an
-                 * absolute path (i.e., it does not  begin with a "/"), then the
-                 * file is searched for in the following locations:
-                 *
-                 *     The LD_LIBRARY_PATH environment variable locations
-                 *     The library cache, /etc/ld.so.cache.
-                 *     /lib
-                 *     /usr/lib
-                 *
-                 * If there is an error, we can't go on, so set the error code and exit */
-
-                /* the lengths are defined herein or have been
-                 * checked already, so strcpy and strcat are
-                 * are safe to use in this context. */
-                char buf[sizeof(prefix) + MAXNAMESIZE + sizeof(postfix)];
-                strcpy(buf, prefix);
-                strcat(buf, cComponentName);
-                strcat(buf, postfix);
-
-                pModules[i] = dlopen(buf, RTLD_LAZY | RTLD_GLOBAL);
-                if( pModules[i] == NULL ) {
-                    LOGE("dlopen %s failed because %s\n", buf, dlerror());
-                    err = OMX_ErrorComponentNotFound;
-                    goto UNLOCK_MUTEX;
-                }
+    //get the index for the component in the table
+    int refIndex = FindComponent(cComponentName);
+    if (refIndex < 0) {
+        // If we are here, we have not found the component
+        err = OMX_ErrorComponentNotFound;
+        goto UNLOCK_MUTEX;
+    }
+    pEntry = &componentTable[refIndex];
+    LOGD("Found component %s with refCount %d\n",
+          cComponentName, pEntry->refCount);
 
-                /* Get a function pointer to the "OMX_ComponentInit" function.  If
-                 * there is an error, we can't go on, so set the error code and exit */
-                pComponentInit = dlsym(pModules[i], "OMX_ComponentInit");
-                pErr = dlerror();
-                if( (pErr != NULL) || (pComponentInit == NULL) ) {
-                    LOGE("%d:: dlsym failed for module %p\n", __LINE__, pModules[i]);
-                    err = OMX_ErrorInvalidComponent;
-                    goto CLEAN_UP;
-                }
+    /* check if the component is already loaded */
+    if (pEntry->refCount >= MAX_CONCURRENT_INSTANCES) {
+        err = OMX_ErrorInsufficientResources;
+        LOGE("Max instances of component %s already created.\n", cComponentName);
+        goto UNLOCK_MUTEX;
+    }
 
-               /* We now can access the dll.  So, we need to call the "OMX_ComponentInit"
-                * method to load up the "handle" (which is just a list of functions to
-                * call) and we should be all set.*/
-                *pHandle = malloc(sizeof(OMX_COMPONENTTYPE));
-                if(*pHandle == NULL) {
-                    err = OMX_ErrorInsufficientResources;
-                    LOGE("%d:: malloc of pHandle* failed\n", __LINE__);
-                    goto CLEAN_UP;
-                }
+    /* reserve the slot and the instance; the pHandle entry stays NULL
+     * until the component is up */
+    pModules[i] = SLOT_RESERVED;
+    pEntries[i] = refIndex;
+    pEntry->pHandle[pEntry->refCount] = NULL;
+    pEntry->refCount += 1;
+
+    /* libraries that have been idle too long go now, before this one
+     * is (re)used */
+    UnloadIdleModules(OMX_FALSE);
+    bResident = (pEntry->pModule != NULL);
+    err = LoadModule(pEntry);
+    if (err != OMX_ErrorNone) {
+        goto CLEAN_UP;
+    }
 
-                pComponents[i] = *pHandle;
-                componentType = (OMX_COMPONENTTYPE*) *pHandle;
-                componentType->nSize = sizeof(OMX_COMPONENTTYPE);
-                err = (*pComponentInit)(*pHandle);
-                if (OMX_ErrorNone == err) {
-                    err = (componentType->SetCallbacks)(*pHandle, pCallBacks, pAppData);
-                    if (err != OMX_ErrorNone) {
-                        LOGE("%d :: Core: SetCallBack failed %d\n",__LINE__, err);
-                        goto CLEAN_UP;
-                    }
-                    /* finally, OMX_ComponentInit() was successful and
-                       SetCallbacks was successful, we have a valid instance,
-                       so no we increment refCount */
-                    componentTable[refIndex].pHandle[componentTable[refIndex].refCount] = *pHandle;
-                    componentTable[refIndex].refCount += 1;
-                    goto UNLOCK_MUTEX;  // Component is found, and thus we are done
-                }
-                else if (err == OMX_ErrorInsufficientResources) {
-                        LOGE("%d :: Core: Insufficient Resources for Component %d\n",__LINE__, err);
-                        goto CLEAN_UP;
-                }
+    /* OMX_ComponentInit may take long on the DSP; other components are
+     * created and freed meanwhile */
+    if(pthread_mutex_unlock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex unlock\n",__LINE__);
+    }
+
+   /* We now can access the dll.  So, we need to call the "OMX_ComponentInit"
+    * method to load up the "handle" (which is just a list of functions to
+    * call) and we should be all set.*/
+    hComponent = malloc(sizeof(OMX_COMPONENTTYPE));
+    if(hComponent == NULL) {
+        err = OMX_ErrorInsufficientResources;
+        LOGE("%d:: malloc of pHandle* failed\n", __LINE__);
+    }
+    else {
+        componentType = (OMX_COMPONENTTYPE*) hComponent;
+        componentType->nSize = sizeof(OMX_COMPONENTTYPE);
+        err = (*pEntry->pComponentInit)(hComponent);
+        if (OMX_ErrorNone == err) {
+            err = (componentType->SetCallbacks)(hComponent, pCallBacks, pAppData);
+            if (err != OMX_ErrorNone) {
+                LOGE("%d :: Core: SetCallBack failed %d\n",__LINE__, err);
             }
         }
+        else if (err == OMX_ErrorInsufficientResources) {
+            LOGE("%d :: Core: Insufficient Resources for Component %d\n",__LINE__, err);
+        }
+    }
+
+    if(pthread_mutex_lock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex lock\n",__LINE__);
+    }
+
+    if (err == OMX_ErrorNone) {
+        /* finally, OMX_ComponentInit() was successful and
+           SetCallbacks was successful, we have a valid instance */
+        pModules[i] = pEntry->pModule;
+        pComponents[i] = hComponent;
+        AddHandle(pEntry, hComponent);
+        *pHandle = hComponent;
+        RecordInitTime(&pEntry->sInitTime[bResident ? 1 : 0],
+                       NowUs() - nStartUs);
+        goto UNLOCK_MUTEX;  // Component is found, and thus we are done
     }
 
-    // If we are here, we have not found the component
-    err = OMX_ErrorComponentNotFound;
-    goto UNLOCK_MUTEX;
 CLEAN_UP:
-    if(*pHandle != NULL)
     /* cover the case where we error out before malloc'd */
+    if(hComponent != NULL)
     {
-        free(*pHandle);
-        *pHandle = NULL;
+        free(hComponent);
     }
-    pComponents[i] = NULL;
-    dlclose(pModules[i]);
+    *pHandle = NULL;
+    RemoveHandle(pEntry, NULL);
     pModules[i] = NULL;
+    ReleaseModule(pEntry);
 
 UNLOCK_MUTEX:
     if(pthread_mutex_unlock(&mutex) != 0)
@@ -347,37 +720,50 @@ OMX_ERRORTYPE TIOMX_FreeHandle (OMX_HANDLETYPE hComponent)
         if(pComponents[i] == hComponent) break;
     }
 
-    if(i == COUNTOF(pModules)) {
+    if((hComponent == NULL) || (i == COUNTOF(pModules))) {
         LOGE("%d :: Core: component %p is not found\n", __LINE__, hComponent);
         retVal = OMX_ErrorBadParameter;
         goto EXIT;
     }
 
+    /* hide the handle from other FreeHandle calls while the component
+     * deinitializes without the mutex; the slot stays taken */
+    pComponents[i] = NULL;
+    if(pthread_mutex_unlock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex unlock\n",__LINE__);
+    }
+
     retVal = pHandle->ComponentDeInit(hComponent);
+
+    if(pthread_mutex_lock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex lock\n",__LINE__);
+    }
+
     if (retVal != OMX_ErrorNone) {
         LOGE("%d :: ComponentDeInit failed %d\n",__LINE__, retVal);
+        pComponents[i] = hComponent;
         goto EXIT;
     }
 
-    int refIndex = 0, handleIndex = 0;
-    for (refIndex=0; refIndex < MAX_TABLE_SIZE; refIndex++) {
-        for (handleIndex=0; handleIndex < componentTable[refIndex].refCount; handleIndex++){
-            /* get the position for the component in the table */
-            if (componentTable[refIndex].pHandle[handleIndex] == hComponent){
-                LOGD("Found matching pHandle(%p) at index %d with refCount %d",
-                      hComponent, refIndex, componentTable[refIndex].refCount);
-                if (componentTable[refIndex].refCount) {
-                    componentTable[refIndex].refCount -= 1;
-                }
-                componentTable[refIndex].pHandle[handleIndex] = NULL;
-                dlclose(pModules[i]);
-                pModules[i] = NULL;
-                free(pComponents[i]);
-                pComponents[i] = NULL;
-                retVal = OMX_ErrorNone;
-                goto EXIT;
-            }
-        }
+    /* load the component did not release itself, e.g. when freed
+     * without going back to OMX_StateLoaded */
+    int nLoad = FindDspLoad(hComponent);
+    if (nLoad >= 0) {
+        ReleaseDspLoad(nLoad);
+    }
+
+    int refIndex = pEntries[i];
+    ComponentTable *pEntry = &componentTable[refIndex];
+    if (RemoveHandle(pEntry, hComponent)) {
+        LOGD("Freed pHandle(%p) of component %d, refCount now %d",
+              hComponent, refIndex, pEntry->refCount);
+        ReleaseModule(pEntry);
+        pModules[i] = NULL;
+        free(hComponent);
+        retVal = OMX_ErrorNone;
+        goto EXIT;
     }
 
     // If we are here, we have not found the matching component
@@ -408,6 +794,8 @@ EXIT:
 \**************************************************************************/
 OMX_ERRORTYPE TIOMX_Deinit()
 {
+    int nCount;
+
     if(pthread_mutex_lock(&mutex) != 0) {
         LOGE("%d :: Core: Error in Mutex lock\n",__LINE__);
         return OMX_ErrorUndefined;
@@ -418,12 +806,165 @@ OMX_ERRORTYPE TIOMX_Deinit()
     }
 
     LOGD("deinit count = %d\n", count);
+    nCount = count;
+
+    if (nCount == 0) {
+        /* the idle libraries go with the last user of the core */
+        UnloadIdleModules(OMX_TRUE);
+    }
 
     if(pthread_mutex_unlock(&mutex) != 0) {
         LOGE("%d :: Core: Error in Mutex unlock\n",__LINE__);
         return OMX_ErrorUndefined;
     }
 
+    if (nCount == 0) {
+        TIOMX_DumpInstantiationStats();
+    }
+    return OMX_ErrorNone;
+}
+
+/*************************************************************************
+* TIOMX_CommitDspLoad()
+*
+* Description: admission control for the DSP. A component commits the DSP
+* MHz it will need when going to OMX_StateIdle, and replaces its commit if
+* it is done again. When the load of the other instances leaves no room
+* within the budget, the commit waits up to the admission wait for load to
+* be released and is then refused, rather than every session on the DSP
+* degrading into dropped frames.
+*
+* Parameters:
+* @param[in] hComponent  the committing component
+* @param[in] nMHz        its estimated DSP load
+*
+* Returns:    OMX_NOERROR          Successful
+*             OMX_ErrorInsufficientResources  the load does not fit; a
+*                                  previous commit of the component stays
+*
+**************************************************************************/
+OMX_ERRORTYPE TIOMX_CommitDspLoad(OMX_HANDLETYPE hComponent, OMX_U32 nMHz)
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+    struct timespec tsDeadline;
+    OMX_U32 nOwnMHz = 0;
+    int nWaitResult = 0;
+    int nIndex;
+
+    if (hComponent == NULL) {
+        return OMX_ErrorBadParameter;
+    }
+    if(pthread_mutex_lock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex lock\n",__LINE__);
+        return OMX_ErrorUndefined;
+    }
+
+    nIndex = FindDspLoad(hComponent);
+    if (nIndex >= 0) {
+        nOwnMHz = pLoadMHz[nIndex];
+    }
+    if (nDspAdmitWaitMs > 0) {
+        clock_gettime(CLOCK_REALTIME, &tsDeadline);
+        tsDeadline.tv_sec += nDspAdmitWaitMs / 1000;
+        tsDeadline.tv_nsec += (nDspAdmitWaitMs % 1000) * 1000000;
+        if (tsDeadline.tv_nsec >= 1000000000) {
+            tsDeadline.tv_sec += 1;
+            tsDeadline.tv_nsec -= 1000000000;
+        }
+    }
+    while (!DspLoadFits(nDspCommittedMHz - nOwnMHz, nMHz)) {
+        if ((nDspAdmitWaitMs <= 0) || (nWaitResult != 0)) {
+            LOGE("DSP load of %lu MHz refused for %p, %lu of %ld MHz committed\n",
+                 (unsigned long)nMHz, hComponent,
+                 (unsigned long)nDspCommittedMHz, nDspBudgetMHz);
+            eError = OMX_ErrorInsufficientResources;
+            goto UNLOCK_MUTEX;
+        }
+        nWaitResult = pthread_cond_timedwait(&dspLoadCond, &mutex, &tsDeadline);
+    }
+
+    /* entries may have been taken or freed while waiting */
+    if (nIndex < 0) {
+        nIndex = FindDspLoad(NULL);
+        if (nIndex < 0) {
+            eError = OMX_ErrorInsufficientResources;
+            goto UNLOCK_MUTEX;
+        }
+    }
+    pLoadOwners[nIndex] = hComponent;
+    pLoadMHz[nIndex] = nMHz;
+    nDspCommittedMHz = nDspCommittedMHz - nOwnMHz + nMHz;
+    LOGD("Committed %lu DSP MHz for %p, %lu of %ld MHz committed\n",
+         (unsigned long)nMHz, hComponent,
+         (unsigned long)nDspCommittedMHz, nDspBudgetMHz);
+
+UNLOCK_MUTEX:
+    if(pthread_mutex_unlock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex unlock\n",__LINE__);
+        eError = OMX_ErrorUndefined;
+    }
+    return eError;
+}
+
+/*************************************************************************
+* TIOMX_ReleaseDspLoad()
+*
+* Description: give back the DSP load committed by a component, when it
+* leaves OMX_StateIdle for OMX_StateLoaded. Nothing happens if it has
+* none; FreeHandle releases what is left.
+*
+**************************************************************************/
+OMX_ERRORTYPE TIOMX_ReleaseDspLoad(OMX_HANDLETYPE hComponent)
+{
+    int nIndex;
+
+    if (hComponent == NULL) {
+        return OMX_ErrorBadParameter;
+    }
+    if(pthread_mutex_lock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex lock\n",__LINE__);
+        return OMX_ErrorUndefined;
+    }
+    nIndex = FindDspLoad(hComponent);
+    if (nIndex >= 0) {
+        ReleaseDspLoad(nIndex);
+    }
+    if(pthread_mutex_unlock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex unlock\n",__LINE__);
+        return OMX_ErrorUndefined;
+    }
+    return OMX_ErrorNone;
+}
+
+/*************************************************************************
+* TIOMX_GetDspLoad()
+*
+* Description: the DSP MHz committed by all instances, and the budget;
+* a budget of 0 means admission control is off. Either may be NULL.
+*
+**************************************************************************/
+OMX_ERRORTYPE TIOMX_GetDspLoad(OMX_U32* pCommittedMHz, OMX_U32* pBudgetMHz)
+{
+    if(pthread_mutex_lock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex lock\n",__LINE__);
+        return OMX_ErrorUndefined;
+    }
+    if (pCommittedMHz != NULL) {
+        *pCommittedMHz = nDspCommittedMHz;
+    }
+    if (pBudgetMHz != NULL) {
+        *pBudgetMHz = (nDspBudgetMHz > 0) ? (OMX_U32)nDspBudgetMHz : 0;
+    }
+    if(pthread_mutex_unlock(&mutex) != 0)
+    {
+        LOGE("%d :: Core: Error in Mutex unlock\n",__LINE__);
+        return OMX_ErrorUndefined;
+    }
     return OMX_ErrorNone;
 }
 
@@ -542,6 +1083,7 @@ OMX_API OMX_ERRORTYPE TIOMX_GetRolesOfComponent (
     OMX_ERRORTYPE eError = OMX_ErrorNone;
     OMX_U32 i = 0;
     OMX_U32 j = 0;
+    int nIndex = -1;
     OMX_BOOL bFound = OMX_FALSE;
 
     if (cComponentName == NULL || pNumRoles == NULL)
@@ -557,14 +1099,11 @@ OMX_API OMX_ERRORTYPE TIOMX_GetRolesOfComponent (
         eError = OMX_ErrorBadParameter;
         goto EXIT;       
     }
-    while (i < tableCount)
-    {
-        if (strcmp(cComponentName, componentTable[i].name) == 0)
-        {
-            bFound = OMX_TRUE;
-            break;
-        }
-        i++;
+    nIndex = FindComponent(cComponentName);
+    if (nIndex >= 0)
+    {
+        i = nIndex;
+        bFound = OMX_TRUE;
     }
     if (!bFound)
     {
@@ -757,6 +1296,32 @@ OMX_ERRORTYPE TIOMX_BuildComponentTable()
         }
     }
     tableCount = numFiles;
+
+    /* index the names; libraries from a previous OMX_Init may still be
+     * resident and are kept */
+    memset(componentHash, 0, sizeof(componentHash));
+    for (i = 0; i < tableCount; i++) {
+        unsigned int nSlot = HashName(componentTable[i].name);
+
+        while (componentHash[nSlot] != 0) {
+            nSlot = (nSlot + 1) & (HASH_SIZE - 1);
+        }
+        componentHash[nSlot] = i + 1;
+    }
+
+    char* pIdle = getenv(LIBRARY_IDLE_MS_ENV);
+    if (pIdle != NULL) {
+        nLibraryIdleMs = atol(pIdle);
+    }
+    char* pBudget = getenv(DSP_BUDGET_MHZ_ENV);
+    if (pBudget != NULL) {
+        nDspBudgetMHz = atol(pBudget);
+    }
+    char* pWait = getenv(DSP_ADMIT_WAIT_MS_ENV);
+    if (pWait != NULL) {
+        nDspAdmitWaitMs = atol(pWait);
+    }
+
     if (eError != OMX_ErrorNone){
         LOGE("Could not build Component Table\n");
     }
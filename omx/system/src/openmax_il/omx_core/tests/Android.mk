@@ -0,0 +1,50 @@
+ifeq ($(BUILD_OMX_CORE_TEST),1)
+LOCAL_PATH:= $(call my-dir)
+
+# stub component libraries, opened by the test's core as
+# libOmxCoreStub_<component name>.so; they are not linked to the test
+OMX_CORE_STUB_CFLAGS := $(TI_OMX_CFLAGS) -DMAX_CONCURRENT_INSTANCES=24
+
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= CoreStubComponent.c
+LOCAL_C_INCLUDES := $(TI_OMX_COMP_C_INCLUDES)
+LOCAL_CFLAGS := $(OMX_CORE_STUB_CFLAGS)
+LOCAL_MODULE:= libOmxCoreStub_OMX.TI.JPEG.Encoder
+include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= CoreStubComponent.c
+LOCAL_C_INCLUDES := $(TI_OMX_COMP_C_INCLUDES)
+LOCAL_CFLAGS := $(OMX_CORE_STUB_CFLAGS)
+LOCAL_MODULE:= libOmxCoreStub_OMX.TI.Video.Decoder
+include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= CoreStubComponent.c
+LOCAL_C_INCLUDES := $(TI_OMX_COMP_C_INCLUDES)
+LOCAL_CFLAGS := $(OMX_CORE_STUB_CFLAGS)
+LOCAL_MODULE:= libOmxCoreStub_OMX.TI.Video.encoder
+include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+
+# the core built into the test, with room for several instances per
+# component and the stub libraries in place of the real ones
+LOCAL_SRC_FILES:= \
+	../src/OMX_Core.c \
+	OmxCoreStressTest.c
+
+LOCAL_C_INCLUDES := \
+	$(TI_OMX_COMP_C_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := \
+	libdl \
+	liblog
+
+LOCAL_CFLAGS := $(OMX_CORE_STUB_CFLAGS) -DNO_OPENCORE \
+	-DCOMPONENT_LIBRARY_PREFIX=\"libOmxCoreStub_\"
+
+LOCAL_MODULE:= OmxCoreStressTest
+
+include $(BUILD_EXECUTABLE)
+endif
@@ -0,0 +1,83 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  CoreStubComponent.c
+*
+*  Stand-in component for OmxCoreStressTest. It is built once per component
+*  name the test uses, as libOmxCoreStub_<name>.so, so that every library
+*  counts its own instances.
+*
+*  OMX_ComponentInit sleeps CORE_STUB_INIT_US_ENV microseconds, as a DSP
+*  component does while it sets up its node, and ComponentDeInit sleeps
+*  CORE_STUB_DEINIT_US_ENV. An instance beyond MAX_CONCURRENT_INSTANCES is
+*  refused with OMX_ErrorUndefined, which the test reports as a failure.
+* =========================================================================== */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "OMX_Component.h"
+#include "OMX_Core.h"
+#include "OMX_ComponentRegistry.h"
+#include "CoreStubComponent.h"
+
+static volatile int g_nInstances;
+
+static OMX_ERRORTYPE StubSetCallbacks(OMX_HANDLETYPE hComponent,
+                                      OMX_CALLBACKTYPE *pCallbacks,
+                                      OMX_PTR pAppData)
+{
+    OMX_COMPONENTTYPE *pComp = (OMX_COMPONENTTYPE *)hComponent;
+
+    pComp->pApplicationPrivate = pAppData;
+    return pCallbacks != NULL ? OMX_ErrorNone : OMX_ErrorBadParameter;
+}
+
+static OMX_ERRORTYPE StubDeInit(OMX_HANDLETYPE hComponent)
+{
+    char *pDelay = getenv(CORE_STUB_DEINIT_US_ENV);
+
+    (void)hComponent;
+    if (pDelay != NULL)
+    {
+        usleep(atoi(pDelay));
+    }
+    __sync_fetch_and_sub(&g_nInstances, 1);
+    return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE OMX_ComponentInit(OMX_HANDLETYPE hComponent)
+{
+    OMX_COMPONENTTYPE *pComp = (OMX_COMPONENTTYPE *)hComponent;
+    char *pDelay = getenv(CORE_STUB_INIT_US_ENV);
+    int nInstances = __sync_add_and_fetch(&g_nInstances, 1);
+
+    if (nInstances > MAX_CONCURRENT_INSTANCES)
+    {
+        fprintf(stderr, "stub: %d instances, more than %d\n",
+                nInstances, MAX_CONCURRENT_INSTANCES);
+        __sync_fetch_and_sub(&g_nInstances, 1);
+        return OMX_ErrorUndefined;
+    }
+    if (pDelay != NULL)
+    {
+        usleep(atoi(pDelay));
+    }
+    pComp->SetCallbacks = StubSetCallbacks;
+    pComp->ComponentDeInit = StubDeInit;
+    return OMX_ErrorNone;
+}
@@ -0,0 +1,29 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  CoreStubComponent.h
+*
+*  Settings shared by OmxCoreStressTest and its stub components.
+* =========================================================================== */
+
+#ifndef CORE_STUB_COMPONENT_H
+#define CORE_STUB_COMPONENT_H
+
+/* time spent in OMX_ComponentInit and ComponentDeInit, in microseconds */
+#define CORE_STUB_INIT_US_ENV   "OMX_CORE_STUB_INIT_US"
+#define CORE_STUB_DEINIT_US_ENV "OMX_CORE_STUB_DEINIT_US"
+
+#endif
@@ -0,0 +1,445 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* =============================================================================
+*  @file  OmxCoreStressTest.c
+*
+*  Drives OMX_Core.c against the CoreStubComponent libraries, whose
+*  OMX_ComponentInit takes a while as a DSP component's does.
+*
+*  1. One GetHandle and FreeHandle per component, all at once: they must
+*     overlap, i.e. take less than twice as long as for one component.
+*  2. Many threads create and destroy handles of random components, holding
+*     up to STRESS_MAX_HELD each. Live handles must never exceed
+*     MAX_CONCURRENT_INSTANCES per component nor STRESS_MAXCOMP in total,
+*     and GetHandle may only fail with OMX_ErrorInsufficientResources.
+*  3. Afterwards exactly the capacity of the core can be taken again, so no
+*     slot or instance has leaked.
+*  4. DSP admission: commits beyond STRESS_DSP_BUDGET_MHZ are refused after
+*     the admission wait, or admitted once enough load is released meanwhile;
+*     FreeHandle releases the load of its instance.
+*
+*  usage: OmxCoreStressTest [-t threads] [-n iterations] [-i init_us]
+* =========================================================================== */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "OMX_Component.h"
+#include "OMX_Core.h"
+#include "OMX_ComponentRegistry.h"
+#include "CoreStubComponent.h"
+
+#define STRESS_MAXCOMP              50      /* MAXCOMP of OMX_Core.c */
+#define STRESS_MAX_HELD             3
+#define STRESS_DEFAULT_THREADS      32
+#define STRESS_DEFAULT_ITERATIONS   50
+#define STRESS_DEFAULT_INIT_US      20000
+#define STRESS_DEINIT_US            2000
+#define STRESS_DSP_BUDGET_MHZ       "430"
+#define STRESS_DSP_WAIT_MS          100
+#define STRESS_DSP_LOAD_MHZ         200
+
+OMX_ERRORTYPE TIOMX_Init();
+OMX_ERRORTYPE TIOMX_Deinit();
+OMX_ERRORTYPE TIOMX_GetHandle(OMX_HANDLETYPE *pHandle, OMX_STRING cComponentName,
+                              OMX_PTR pAppData, OMX_CALLBACKTYPE *pCallBacks);
+OMX_ERRORTYPE TIOMX_FreeHandle(OMX_HANDLETYPE hComponent);
+OMX_ERRORTYPE TIOMX_CommitDspLoad(OMX_HANDLETYPE hComponent, OMX_U32 nMHz);
+OMX_ERRORTYPE TIOMX_ReleaseDspLoad(OMX_HANDLETYPE hComponent);
+OMX_ERRORTYPE TIOMX_GetDspLoad(OMX_U32 *pCommittedMHz, OMX_U32 *pBudgetMHz);
+
+/* components of the core table that have a stub library */
+static const char *g_names[] = {
+    "OMX.TI.JPEG.Encoder",
+    "OMX.TI.Video.Decoder",
+    "OMX.TI.Video.encoder",
+};
+#define STRESS_NUM_COMPS (sizeof(g_names) / sizeof(g_names[0]))
+
+static pthread_mutex_t g_stressMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_stressCond = PTHREAD_COND_INITIALIZER;
+static OMX_CALLBACKTYPE g_callbacks;
+static int g_nLive[STRESS_NUM_COMPS];
+static int g_nLiveTotal;
+static int g_nMaxLiveTotal;
+static int g_nStarted;
+static unsigned int g_nCreated;
+static unsigned int g_nRefused;
+static unsigned int g_nErrors;
+static int g_nIterations = STRESS_DEFAULT_ITERATIONS;
+static int g_nThreads = STRESS_DEFAULT_THREADS;
+
+static double NowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int Capacity(void)
+{
+    int nCapacity = STRESS_NUM_COMPS * MAX_CONCURRENT_INSTANCES;
+
+    return nCapacity < STRESS_MAXCOMP ? nCapacity : STRESS_MAXCOMP;
+}
+
+/* GetHandle and account for the result; returns the handle or NULL */
+static OMX_HANDLETYPE Create(int nComp)
+{
+    OMX_HANDLETYPE hComp = NULL;
+    OMX_ERRORTYPE eError;
+
+    eError = TIOMX_GetHandle(&hComp, (OMX_STRING)g_names[nComp], NULL, &g_callbacks);
+
+    pthread_mutex_lock(&g_stressMutex);
+    if (eError == OMX_ErrorNone)
+    {
+        g_nCreated++;
+        g_nLive[nComp]++;
+        g_nLiveTotal++;
+        if (g_nLiveTotal > g_nMaxLiveTotal)
+        {
+            g_nMaxLiveTotal = g_nLiveTotal;
+        }
+        if (g_nLive[nComp] > MAX_CONCURRENT_INSTANCES || g_nLiveTotal > STRESS_MAXCOMP)
+        {
+            fprintf(stderr, "%s: %d live, %d in total\n",
+                    g_names[nComp], g_nLive[nComp], g_nLiveTotal);
+            g_nErrors++;
+        }
+    }
+    else if (eError == OMX_ErrorInsufficientResources)
+    {
+        g_nRefused++;
+    }
+    else
+    {
+        fprintf(stderr, "GetHandle %s failed: 0x%x\n", g_names[nComp], eError);
+        g_nErrors++;
+    }
+    pthread_mutex_unlock(&g_stressMutex);
+    return eError == OMX_ErrorNone ? hComp : NULL;
+}
+
+static void Destroy(int nComp, OMX_HANDLETYPE hComp)
+{
+    OMX_ERRORTYPE eError = TIOMX_FreeHandle(hComp);
+
+    pthread_mutex_lock(&g_stressMutex);
+    if (eError != OMX_ErrorNone)
+    {
+        fprintf(stderr, "FreeHandle %s failed: 0x%x\n", g_names[nComp], eError);
+        g_nErrors++;
+    }
+    g_nLive[nComp]--;
+    g_nLiveTotal--;
+    pthread_mutex_unlock(&g_stressMutex);
+}
+
+/* waits until all threads of a phase are there, so that they start together */
+static void StartTogether(int nThreads)
+{
+    pthread_mutex_lock(&g_stressMutex);
+    g_nStarted++;
+    pthread_cond_broadcast(&g_stressCond);
+    while (g_nStarted < nThreads)
+    {
+        pthread_cond_wait(&g_stressCond, &g_stressMutex);
+    }
+    pthread_mutex_unlock(&g_stressMutex);
+}
+
+static void *OverlapThread(void *arg)
+{
+    int nComp = (int)(long)arg;
+    OMX_HANDLETYPE hComp;
+
+    StartTogether(STRESS_NUM_COMPS);
+    hComp = Create(nComp);
+    if (hComp != NULL)
+    {
+        Destroy(nComp, hComp);
+    }
+    return NULL;
+}
+
+static void *StressThread(void *arg)
+{
+    unsigned int nSeed = (unsigned int)(long)arg + 1;
+    OMX_HANDLETYPE hHeld[STRESS_MAX_HELD];
+    int nHeldComp[STRESS_MAX_HELD];
+    int nHeld, nWant, i, j;
+
+    StartTogether(g_nThreads);
+    for (i = 0; i < g_nIterations; i++)
+    {
+        nWant = 1 + rand_r(&nSeed) % STRESS_MAX_HELD;
+        nHeld = 0;
+        for (j = 0; j < nWant; j++)
+        {
+            nHeldComp[nHeld] = rand_r(&nSeed) % STRESS_NUM_COMPS;
+            hHeld[nHeld] = Create(nHeldComp[nHeld]);
+            if (hHeld[nHeld] != NULL)
+            {
+                nHeld++;
+            }
+        }
+        usleep(rand_r(&nSeed) % 1000);
+        for (j = 0; j < nHeld; j++)
+        {
+            Destroy(nHeldComp[j], hHeld[j]);
+        }
+    }
+    return NULL;
+}
+
+static void *CommitThread(void *arg)
+{
+    return (void *)(long)TIOMX_CommitDspLoad((OMX_HANDLETYPE)arg, STRESS_DSP_LOAD_MHZ);
+}
+
+/* checks the committed DSP load, returns 1 if it is not nExpected */
+static int CheckDspLoad(const char *sWhen, OMX_U32 nExpected)
+{
+    OMX_U32 nCommitted = 0;
+    OMX_U32 nBudget = 0;
+
+    TIOMX_GetDspLoad(&nCommitted, &nBudget);
+    printf("DSP load %s: %lu of %lu MHz\n", sWhen,
+           (unsigned long)nCommitted, (unsigned long)nBudget);
+    if (nCommitted != nExpected)
+    {
+        printf("FAIL: %lu MHz committed, %lu expected\n",
+               (unsigned long)nCommitted, (unsigned long)nExpected);
+        return 1;
+    }
+    return 0;
+}
+
+/* phase 4, with three handles; returns 0 on success */
+static int TestDspAdmission(OMX_HANDLETYPE hLoad[3])
+{
+    pthread_t tid;
+    void *pResult;
+    double fStart, fElapsed;
+    int ret = 0;
+
+    if (TIOMX_CommitDspLoad(hLoad[0], STRESS_DSP_LOAD_MHZ) != OMX_ErrorNone ||
+        TIOMX_CommitDspLoad(hLoad[1], STRESS_DSP_LOAD_MHZ) != OMX_ErrorNone)
+    {
+        printf("FAIL: commit within the budget refused\n");
+        ret = 1;
+    }
+
+    /* no room, and nothing is released: refused after the wait */
+    fStart = NowMs();
+    if (TIOMX_CommitDspLoad(hLoad[2], STRESS_DSP_LOAD_MHZ) != OMX_ErrorInsufficientResources)
+    {
+        printf("FAIL: commit over the budget admitted\n");
+        ret = 1;
+    }
+    fElapsed = NowMs() - fStart;
+    printf("over budget: refused after %.1f ms\n", fElapsed);
+    if (fElapsed < STRESS_DSP_WAIT_MS * 0.9)
+    {
+        printf("FAIL: refused without waiting\n");
+        ret = 1;
+    }
+    ret |= CheckDspLoad("with two instances", 2 * STRESS_DSP_LOAD_MHZ);
+
+    /* room is made while the commit waits */
+    pthread_create(&tid, NULL, CommitThread, hLoad[2]);
+    usleep(STRESS_DSP_WAIT_MS * 1000 / 4);
+    TIOMX_ReleaseDspLoad(hLoad[1]);
+    pthread_join(tid, &pResult);
+    if ((OMX_ERRORTYPE)(long)pResult != OMX_ErrorNone)
+    {
+        printf("FAIL: waiting commit refused after a release: 0x%x\n",
+               (OMX_ERRORTYPE)(long)pResult);
+        ret = 1;
+    }
+    ret |= CheckDspLoad("after the queued commit", 2 * STRESS_DSP_LOAD_MHZ);
+
+    /* FreeHandle releases what its instance left committed */
+    Destroy(0, hLoad[0]);
+    hLoad[0] = NULL;
+    ret |= CheckDspLoad("after FreeHandle", STRESS_DSP_LOAD_MHZ);
+
+    /* a recommit replaces the earlier one; alone it may exceed the budget */
+    if (TIOMX_CommitDspLoad(hLoad[2], 3 * STRESS_DSP_LOAD_MHZ) != OMX_ErrorNone)
+    {
+        printf("FAIL: commit on an idle DSP refused\n");
+        ret = 1;
+    }
+    ret |= CheckDspLoad("alone over the budget", 3 * STRESS_DSP_LOAD_MHZ);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    OMX_HANDLETYPE hAll[STRESS_MAXCOMP + 1];
+    int nAllComp[STRESS_MAXCOMP + 1];
+    pthread_t tids[STRESS_NUM_COMPS];
+    pthread_t *pStress;
+    int nInitUs = STRESS_DEFAULT_INIT_US;
+    int nTaken, opt, i, ret = 0;
+    double fStart, fElapsed;
+    char sDelayUs[16];
+
+    while ((opt = getopt(argc, argv, "t:n:i:")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                g_nThreads = atoi(optarg);
+                break;
+            case 'n':
+                g_nIterations = atoi(optarg);
+                break;
+            case 'i':
+                nInitUs = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-t threads] [-n iterations] [-i init_us]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (g_nThreads < 1)
+    {
+        fprintf(stderr, "at least one thread is needed\n");
+        return 1;
+    }
+
+    snprintf(sDelayUs, sizeof(sDelayUs), "%d", nInitUs);
+    setenv(CORE_STUB_INIT_US_ENV, sDelayUs, 1);
+    snprintf(sDelayUs, sizeof(sDelayUs), "%d", STRESS_DEINIT_US);
+    setenv(CORE_STUB_DEINIT_US_ENV, sDelayUs, 1);
+    setenv(DSP_BUDGET_MHZ_ENV, STRESS_DSP_BUDGET_MHZ, 1);
+    snprintf(sDelayUs, sizeof(sDelayUs), "%d", STRESS_DSP_WAIT_MS);
+    setenv(DSP_ADMIT_WAIT_MS_ENV, sDelayUs, 1);
+
+    if (TIOMX_Init() != OMX_ErrorNone)
+    {
+        fprintf(stderr, "TIOMX_Init failed\n");
+        return 1;
+    }
+    printf("%u components, %d instances each, %d slots, init %d us\n",
+           (unsigned int)STRESS_NUM_COMPS, MAX_CONCURRENT_INSTANCES,
+           STRESS_MAXCOMP, nInitUs);
+
+    /* phase 1: one handle of every component at the same moment */
+    fStart = NowMs();
+    for (i = 0; i < STRESS_NUM_COMPS; i++)
+    {
+        pthread_create(&tids[i], NULL, OverlapThread, (void *)(long)i);
+    }
+    for (i = 0; i < STRESS_NUM_COMPS; i++)
+    {
+        pthread_join(tids[i], NULL);
+    }
+    fElapsed = NowMs() - fStart;
+    printf("%u concurrent GetHandle/FreeHandle: %.1f ms, one takes %.1f ms\n",
+           (unsigned int)STRESS_NUM_COMPS, fElapsed, (nInitUs + STRESS_DEINIT_US) / 1000.0);
+    if (fElapsed >= 2 * (nInitUs + STRESS_DEINIT_US) / 1000.0)
+    {
+        printf("FAIL: component initialization is serialized\n");
+        ret = 1;
+    }
+
+    /* phase 2: churn */
+    g_nStarted = 0;
+    g_nCreated = 0;
+    g_nRefused = 0;
+    pStress = malloc(g_nThreads * sizeof(pthread_t));
+    if (pStress == NULL)
+    {
+        fprintf(stderr, "cannot allocate threads\n");
+        return 1;
+    }
+    fStart = NowMs();
+    for (i = 0; i < g_nThreads; i++)
+    {
+        pthread_create(&pStress[i], NULL, StressThread, (void *)(long)i);
+    }
+    for (i = 0; i < g_nThreads; i++)
+    {
+        pthread_join(pStress[i], NULL);
+    }
+    fElapsed = NowMs() - fStart;
+    free(pStress);
+    printf("%d threads x %d iterations: %u handles, %u refused, at most %d live, %.0f ms\n",
+           g_nThreads, g_nIterations, g_nCreated, g_nRefused, g_nMaxLiveTotal, fElapsed);
+    if (g_nErrors != 0 || g_nLiveTotal != 0)
+    {
+        printf("FAIL: %u errors, %d handles left\n", g_nErrors, g_nLiveTotal);
+        ret = 1;
+    }
+
+    /* phase 3: the full capacity is available again */
+    setenv(CORE_STUB_INIT_US_ENV, "0", 1);
+    setenv(CORE_STUB_DEINIT_US_ENV, "0", 1);
+    for (nTaken = 0; nTaken <= Capacity(); nTaken++)
+    {
+        nAllComp[nTaken] = nTaken % STRESS_NUM_COMPS;
+        hAll[nTaken] = Create(nAllComp[nTaken]);
+        if (hAll[nTaken] == NULL)
+        {
+            break;
+        }
+    }
+    printf("capacity: %d handles taken, %d expected\n", nTaken, Capacity());
+    if (nTaken != Capacity() || g_nErrors != 0)
+    {
+        printf("FAIL: slots or instances leaked\n");
+        ret = 1;
+    }
+    for (i = 0; i < nTaken; i++)
+    {
+        Destroy(nAllComp[i], hAll[i]);
+    }
+
+    /* phase 4: DSP admission */
+    for (i = 0; i < 3; i++)
+    {
+        hAll[i] = Create(0);
+    }
+    if (hAll[0] == NULL || hAll[1] == NULL || hAll[2] == NULL)
+    {
+        printf("FAIL: no handles for the DSP admission test\n");
+        ret = 1;
+    }
+    else if (TestDspAdmission(hAll) != 0)
+    {
+        ret = 1;
+    }
+    for (i = 0; i < 3; i++)
+    {
+        if (hAll[i] != NULL)
+        {
+            Destroy(0, hAll[i]);
+        }
+    }
+    ret |= CheckDspLoad("after all FreeHandles", 0);
+
+    TIOMX_Deinit();
+    printf("%s\n", ret ? "FAIL" : "PASS");
+    return ret;
+}
@@ -780,9 +780,16 @@ void __rt_Log(PERF_Private *perf,
               unsigned long ulData3)
 {
     /* get real-time private structure */
-    /* PERF_RT_Private *me = perf->cip.pRT; */
+    PERF_RT_Private *me = perf->cip.pRT;
 
-    /* there is nothing to do at this point */
+    /* logs are rare and already aggregated by the caller (e.g. LCML latency
+       summaries), so pass them through as they come */
+    if (me->fRt)
+    {
+        fprintf(me->fRt, "rtPERF: [%ld] %c%c%c%c log 0x%lX: %lu %lu\n",
+                TIME_DELTA(perf->time, me->first_time)/1000000,
+                PERF_FOUR_CHARS(perf->ulID), ulData1, ulData2, ulData3);
+    }
 }
 
 void __rt_SyncAV(PERF_Private *perf,
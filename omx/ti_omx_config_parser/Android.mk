@@ -46,7 +46,8 @@ LOCAL_COPY_HEADERS := \
  	inc/ti_omx_config_parser.h 
 
 LOCAL_C_INCLUDES := \
-    $(PV_INCLUDES)
+    $(PV_INCLUDES) \
+    $(TI_OMX_SYSTEM)/common/inc
 
 -include $(PV_TOP)/Android_platform_extras.mk
 
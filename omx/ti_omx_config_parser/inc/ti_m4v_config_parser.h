@@ -58,15 +58,10 @@
 #define H264_PROFILE_IDC_EXTENDED 88
 #define H264_PROFILE_IDC_HIGH 100
 
-typedef struct
-{
-    uint8 *data;
-    uint32 numBytes;
-    uint32 bytePos;
-    uint32 bitBuf;
-    uint32 dataBitPos;
-    uint32  bitPos;
-} mp4StreamType;
+/* bytes of the header with the read position and a 64-bit cache of the
+   next bits; OMX_TI_BitReaderInit() sets one up. Only declared here, the
+   parser sources include OMX_TI_BitReader.h, which is not exported */
+typedef struct OMX_TI_BITREADERTYPE mp4StreamType;
 
 
 int16 ShowBits(
@@ -19,66 +19,30 @@
 #include "ti_m4v_config_parser.h"
 #include "oscl_mem.h"
 #include "oscl_dll.h"
+#include "OMX_TI_StartCode.h"
+#include "OMX_TI_BitReader.h"
 OSCL_DLL_ENTRY_POINT_DEFAULT()
 
-#define PV_CLZ(A,B) while (((B) & 0x8000) == 0) {(B) <<=1; A++;}
-
-static const uint32 mask[33] =
-{
-    0x00000000, 0x00000001, 0x00000003, 0x00000007,
-    0x0000000f, 0x0000001f, 0x0000003f, 0x0000007f,
-    0x000000ff, 0x000001ff, 0x000003ff, 0x000007ff,
-    0x00000fff, 0x00001fff, 0x00003fff, 0x00007fff,
-    0x0000ffff, 0x0001ffff, 0x0003ffff, 0x0007ffff,
-    0x000fffff, 0x001fffff, 0x003fffff, 0x007fffff,
-    0x00ffffff, 0x01ffffff, 0x03ffffff, 0x07ffffff,
-    0x0fffffff, 0x1fffffff, 0x3fffffff, 0x7fffffff,
-    0xffffffff
-};
-
 int32 LocateFrameHeader(uint8 *ptr, int32 size)
 {
-    int32 count = 0;
-    int32 i = size;
-
     if (size < 1)
     {
         return 0;
     }
-    while (i--)
-    {
-        if ((count > 1) && (*ptr == 0x01))
-        {
-            i += 2;
-            break;
-        }
-
-        if (*ptr++)
-            count = 0;
-        else
-            count++;
-    }
-    return (size - (i + 1));
+    return (int32) OMX_TI_FindStartCode(ptr, (OMX_U32) size, 0);
 }
 
 void movePointerTo(mp4StreamType *psBits, int32 pos)
 {
-    uint32 byte_pos;
     if (pos < 0)
     {
         pos = 0;
     }
-
-    byte_pos = pos >> 3;
-
-    if (byte_pos > (psBits->numBytes - psBits->bytePos))
+    if ((uint32)pos > (psBits->nSize << 3))
     {
-        byte_pos = (psBits->numBytes - psBits->bytePos);
+        pos = psBits->nSize << 3;
     }
-
-    psBits->bytePos = byte_pos & -4;
-    psBits->dataBitPos = psBits->bytePos << 3;
-    FlushBits(psBits, ((pos & 0x7) + ((byte_pos & 0x3) << 3)));
+    OMX_TI_BitReaderSeek(psBits, (OMX_U32) pos);
 }
 
 int16 SearchNextM4VFrame(mp4StreamType *psBits)
@@ -86,12 +50,12 @@ int16 SearchNextM4VFrame(mp4StreamType *psBits)
     int16 status = 0;
     uint8 *ptr;
     int32 i;
-    uint32 initial_byte_aligned_position = (psBits->dataBitPos + 7) >> 3;
+    uint32 initial_byte_aligned_position = (OMX_TI_BitReaderTell(psBits) + 7) >> 3;
 
-    ptr = psBits->data + initial_byte_aligned_position;
+    ptr = (uint8 *) psBits->pData + initial_byte_aligned_position;
 
-    i = LocateFrameHeader(ptr, psBits->numBytes - initial_byte_aligned_position);
-    if (psBits->numBytes <= initial_byte_aligned_position + i)
+    i = LocateFrameHeader(ptr, psBits->nSize - initial_byte_aligned_position);
+    if (psBits->nSize <= initial_byte_aligned_position + i)
     {
         status = -1;
     }
@@ -103,15 +67,10 @@ OSCL_EXPORT_REF int16 iGetM4VConfigInfo(uint8 *buffer, int32 length, int32 *widt
 {
     int16 status;
     mp4StreamType psBits;
-    psBits.data = buffer;
-    psBits.numBytes = length;
-    psBits.bitBuf = 0;
-    psBits.bitPos = 32;
-    psBits.bytePos = 0;
-    psBits.dataBitPos = 0;
+    OMX_TI_BitReaderInit(&psBits, buffer, (OMX_U32) length);
     *width = *height = *display_height = *display_width = 0;
 
-    if (length == 0)
+    if (length <= 0)
     {
         return MP4_INVALID_VOL_PARAM;
     }
@@ -230,7 +189,7 @@ OSCL_EXPORT_REF int16 iDecodeVOLHeader(mp4StreamType *psBits, int32 *width, int3
         ReadBits(psBits, 28, &codeword);
         if (codeword != VOL_START_CODE)
         {
-            if (psBits->dataBitPos >= (psBits->numBytes << 3))
+            if (OMX_TI_BitsLeft(psBits) == 0)
             {
                 return SHORT_HEADER_MODE; /* SH */
             }
@@ -626,39 +585,8 @@ int16 ShowBits(
     uint32 *pulOutData      /* output target */
 )
 {
-    uint8 *bits;
-    uint32 dataBitPos = pStream->dataBitPos;
-    uint32 bitPos = pStream->bitPos;
-    uint32 dataBytePos;
-
-    uint i;
-
-    if (ucNBits > (32 - bitPos))    /* not enough bits */
-    {
-        dataBytePos = dataBitPos >> 3; /* Byte Aligned Position */
-        bitPos = dataBitPos & 7; /* update bit position */
-        if (dataBytePos > pStream->numBytes - 4)
-        {
-            pStream->bitBuf = 0;
-            for (i = 0;i < pStream->numBytes - dataBytePos;i++)
-            {
-                pStream->bitBuf |= pStream->data[dataBytePos+i];
-                pStream->bitBuf <<= 8;
-            }
-            pStream->bitBuf <<= 8 * (3 - i);
-        }
-        else
-        {
-            bits = &pStream->data[dataBytePos];
-            pStream->bitBuf = (bits[0] << 24) | (bits[1] << 16) | (bits[2] << 8) | bits[3];
-        }
-        pStream->bitPos = bitPos;
-    }
-
-    bitPos += ucNBits;
-
-    *pulOutData = (pStream->bitBuf >> (32 - bitPos)) & mask[(uint16)ucNBits];
-
+    /* bits past the end of the stream read as zero */
+    *pulOutData = OMX_TI_ShowBits(pStream, ucNBits);
 
     return 0;
 }
@@ -668,28 +596,10 @@ int16 FlushBits(
     uint8 ucNBits                      /* number of bits to flush */
 )
 {
-    uint8 *bits;
-    uint32 dataBitPos = pStream->dataBitPos;
-    uint32 bitPos = pStream->bitPos;
-    uint32 dataBytePos;
-
-
-    if ((dataBitPos + ucNBits) > (uint32)(pStream->numBytes << 3))
+    if (ucNBits > OMX_TI_BitsLeft(pStream))
         return (-2); // Buffer over run
 
-    dataBitPos += ucNBits;
-    bitPos     += ucNBits;
-
-    if (bitPos > 32)
-    {
-        dataBytePos = dataBitPos >> 3;    /* Byte Aligned Position */
-        bitPos = dataBitPos & 7; /* update bit position */
-        bits = &pStream->data[dataBytePos];
-        pStream->bitBuf = (bits[0] << 24) | (bits[1] << 16) | (bits[2] << 8) | bits[3];
-    }
-
-    pStream->dataBitPos = dataBitPos;
-    pStream->bitPos     = bitPos;
+    OMX_TI_SkipBits(pStream, ucNBits);
 
     return 0;
 }
@@ -700,32 +610,13 @@ int16 ReadBits(
     uint32 *pulOutData                 /* output target */
 )
 {
-    uint8 *bits;
-    uint32 dataBitPos = pStream->dataBitPos;
-    uint32 bitPos = pStream->bitPos;
-    uint32 dataBytePos;
-
-
-    if ((dataBitPos + ucNBits) > (pStream->numBytes << 3))
+    if (ucNBits > OMX_TI_BitsLeft(pStream))
     {
         *pulOutData = 0;
         return (-2); // Buffer over run
     }
 
-    //  dataBitPos += ucNBits;
-
-    if (ucNBits > (32 - bitPos))    /* not enough bits */
-    {
-        dataBytePos = dataBitPos >> 3;    /* Byte Aligned Position */
-        bitPos = dataBitPos & 7; /* update bit position */
-        bits = &pStream->data[dataBytePos];
-        pStream->bitBuf = (bits[0] << 24) | (bits[1] << 16) | (bits[2] << 8) | bits[3];
-    }
-
-    pStream->dataBitPos += ucNBits;
-    pStream->bitPos      = (unsigned char)(bitPos + ucNBits);
-
-    *pulOutData = (pStream->bitBuf >> (32 - pStream->bitPos)) & mask[(uint16)ucNBits];
+    *pulOutData = OMX_TI_ReadBits(pStream, ucNBits);
 
     return 0;
 }
@@ -736,37 +627,14 @@ int16 ByteAlign(
     mp4StreamType *pStream           /* Input Stream */
 )
 {
-    uint8 *bits;
-    uint32 dataBitPos = pStream->dataBitPos;
-    uint32 bitPos = pStream->bitPos;
-    uint32 dataBytePos;
     uint32 leftBits;
 
-    leftBits =  8 - (dataBitPos & 0x7);
-    if (leftBits == 8)
-    {
-        if ((dataBitPos + 8) > (uint32)(pStream->numBytes << 3))
-            return (-2); // Buffer over run
-        dataBitPos += 8;
-        bitPos += 8;
-    }
-    else
-    {
-        dataBytePos = dataBitPos >> 3;
-        dataBitPos += leftBits;
-        bitPos += leftBits;
-    }
-
-
-    if (bitPos > 32)
-    {
-        dataBytePos = dataBitPos >> 3;    /* Byte Aligned Position */
-        bits = &pStream->data[dataBytePos];
-        pStream->bitBuf = (bits[0] << 24) | (bits[1] << 16) | (bits[2] << 8) | bits[3];
-    }
+    /* a whole byte when already aligned */
+    leftBits =  8 - (OMX_TI_BitReaderTell(pStream) & 0x7);
+    if (leftBits > OMX_TI_BitsLeft(pStream))
+        return (-2); // Buffer over run
 
-    pStream->dataBitPos = dataBitPos;
-    pStream->bitPos     = bitPos;
+    OMX_TI_SkipBits(pStream, leftBits);
 
     return 0;
 }
@@ -799,6 +667,7 @@ OSCL_EXPORT_REF int16 iGetAVCConfigInfo(uint8 *buffer, int32 length, int32 *widt
     int16 status;
     mp4StreamType psBits;
     uint16 sps_length, pps_length;
+    uint32 next_sc;
     int32 size;
     int32 i = 0;
     uint8* sps = NULL;
@@ -837,19 +706,15 @@ OSCL_EXPORT_REF int16 iGetAVCConfigInfo(uint8 *buffer, int32 length, int32 *widt
         {
             sps += i;
 
-            sps_length = 0;
             // search for the next start code
-            while (!(sps[sps_length] == 0 && sps[sps_length+1] == 0 && sps[sps_length+2] == 1) &&
-                    sps_length < length - i - 2)
-            {
-                sps_length++;
-            }
+            next_sc = OMX_TI_FindStartCode(sps, (OMX_U32)(length - i), 0);
 
-            if (sps_length >= length - i - 2)
+            if (next_sc >= (uint32)(length - i))
             {
                 OSCL_FREE(temp);
                 return MP4_INVALID_VOL_PARAM;
             }
+            sps_length = (uint16) next_sc;
 
             pps_length = length - i - sps_length - 3;
             pps = sps + sps_length + 3;
@@ -879,12 +744,7 @@ OSCL_EXPORT_REF int16 iGetAVCConfigInfo(uint8 *buffer, int32 length, int32 *widt
 
     Parser_EBSPtoRBSP(sps, &size);
 
-    psBits.data = sps;
-    psBits.numBytes = size;
-    psBits.bitBuf = 0;
-    psBits.bitPos = 32;
-    psBits.bytePos = 0;
-    psBits.dataBitPos = 0;
+    OMX_TI_BitReaderInit(&psBits, sps, (OMX_U32) size);
 
     if (DecodeSPS(&psBits, width, height, display_width, display_height, profile_idc, level_idc))
     {
@@ -896,12 +756,7 @@ OSCL_EXPORT_REF int16 iGetAVCConfigInfo(uint8 *buffer, int32 length, int32 *widt
     size = pps_length;
 
     Parser_EBSPtoRBSP(pps, &size);
-    psBits.data = pps;
-    psBits.numBytes = size;
-    psBits.bitBuf = 0;
-    psBits.bitPos = 32;
-    psBits.bytePos = 0;
-    psBits.dataBitPos = 0;
+    OMX_TI_BitReaderInit(&psBits, pps, (OMX_U32) size);
 
     status = DecodePPS(&psBits, entropy_coding_mode_flag);
 
@@ -1038,7 +893,7 @@ int16 DecodeSPS(mp4StreamType *psBits, int32 *width, int32 *height, int32 *displ
         se_v(psBits, &temp0);
         ue_v(psBits, &temp);
 
-        for (i = 0; i < temp; i++)
+        for (i = 0; i < temp && !psBits->bError; i++)
         {
             se_v(psBits, &temp0);
         }
@@ -1086,6 +941,11 @@ int16 DecodeSPS(mp4StreamType *psBits, int32 *width, int32 *height, int32 *displ
         }
     }
 #endif
+    if (psBits->bError)
+    {
+        // the SPS ended early or holds an invalid ue(v) code
+        return MP4_INVALID_VOL_PARAM;
+    }
     return 0; // return 0 for success
 }
 
@@ -1227,50 +1087,22 @@ int32 DecodePPS(mp4StreamType *psBits, uint32 *entropy_coding_mode_flag)
 
     ReadBits(psBits, 1, entropy_coding_mode_flag);
 
+    if (psBits->bError)
+    {
+        return MP4_INVALID_VOL_PARAM;
+    }
     return 0;
 }
 
 void ue_v(mp4StreamType *psBits, uint32 *codeNum)
 {
-    uint32 temp;
-    uint tmp_cnt;
-    int32 leading_zeros = 0;
-    ShowBits(psBits, 16, &temp);
-    tmp_cnt = temp  | 0x1;
-
-    PV_CLZ(leading_zeros, tmp_cnt)
-
-    if (leading_zeros < 8)
-    {
-        *codeNum = (temp >> (15 - (leading_zeros << 1))) - 1;
-        FlushBits(psBits, (leading_zeros << 1) + 1);
-    }
-    else
-    {
-        ReadBits(psBits, (leading_zeros << 1) + 1, &temp);
-        *codeNum = temp - 1;
-    }
-
+    *codeNum = OMX_TI_ReadUE(psBits);
 }
 
 
 void se_v(mp4StreamType *psBits, int32 *value)
 {
-    int32 leadingZeros = 0;
-    uint32 temp;
-
-    OSCL_UNUSED_ARG(value);
-
-    ReadBits(psBits, 1, &temp);
-    while (!temp)
-    {
-        leadingZeros++;
-        if (ReadBits(psBits, 1, &temp))
-        {
-            break;
-        }
-    }
-    ReadBits(psBits, leadingZeros, &temp);
+    *value = OMX_TI_ReadSE(psBits);
 }
 
 void Parser_EBSPtoRBSP(uint8 *nal_unit, int32 *size)
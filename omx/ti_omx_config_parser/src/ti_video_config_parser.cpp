@@ -21,6 +21,8 @@
 #include "oscl_mem.h"
 
 #include "oscl_dll.h"
+#include "OMX_TI_StartCode.h"
+#include "OMX_TI_BitReader.h"
 
 #define GetUnalignedWord( pb, w ) \
             (w) = ((uint16) *(pb + 1) << 8) + *pb;
@@ -68,16 +70,11 @@ OSCL_EXPORT_REF int16 ti_video_config_parser(tiVideoConfigParserInputs *aInputs,
     if (aInputs->iMimeType == PVMF_MIME_M4V) //m4v
     {
         mp4StreamType psBits;
-        psBits.data = aInputs->inPtr;
         if (aInputs->inBytes <= 0)
         {
             return -1;
         }
-        psBits.numBytes = aInputs->inBytes;
-        psBits.bytePos = 0;
-        psBits.bitBuf = 0;
-        psBits.dataBitPos = 0;
-        psBits.bitPos = 32;
+        OMX_TI_BitReaderInit(&psBits, aInputs->inPtr, (OMX_U32) aInputs->inBytes);
 
         int32 width, height, display_width, display_height = 0;
         int32 profile_level = 0;
@@ -262,7 +259,6 @@ int32 GetNAL_Config(uint8** bitstream, int32* size)
     int i = 0;
     int j;
     uint8* nal_unit = *bitstream;
-    int count = 0;
 
     /* find SC at the beginning of the NAL */
     while (nal_unit[i++] == 0 && i < *size)
@@ -283,20 +279,7 @@ int32 GetNAL_Config(uint8** bitstream, int32* size)
     j = i;
 
     /* found the SC at the beginning of the NAL, now find the SC at the beginning of the next NAL */
-    while (i < *size)
-    {
-        if (count == 2 && nal_unit[i] == 0x01)
-        {
-            i -= 2;
-            break;
-        }
-
-        if (nal_unit[i])
-            count = 0;
-        else
-            count++;
-        i++;
-    }
+    i = (int) OMX_TI_FindStartCode(nal_unit, (OMX_U32) *size, (OMX_U32) i);
 
     *size -= i;
     return (i -j);
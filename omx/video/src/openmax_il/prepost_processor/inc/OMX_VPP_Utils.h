@@ -333,6 +333,7 @@ typedef struct VPP_BUFFERDATA_PROPAGATION {
 typedef struct VPP_PORT_TYPE 
 {
     OMX_HANDLETYPE               hTunnelComponent;
+    OMX_BOOL                     bDspTunnelPeer;        /* peer is in LCML_DSP_TUNNEL_PEERS */
     OMX_U32                      nTunnelPort;
     OMX_BUFFERSUPPLIERTYPE       eSupplierSetting;
     OMX_BUFFERSUPPLIERTYPE       eSupplierPreference;
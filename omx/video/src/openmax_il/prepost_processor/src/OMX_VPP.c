@@ -371,6 +371,7 @@ OMX_IN  OMX_BUFFERHEADERTYPE* pBufHeader)
     OMX_U8  *pBufferStart = NULL;
     OMX_ERRORTYPE eError = OMX_ErrorNone;
     OMX_U32 nCount = 0;
+    OMX_ERRORTYPE eRelease = OMX_ErrorNone;
 
     OMX_CHECK_CMD(hComponent, pBufHeader, OMX_TRUE);
 
@@ -393,6 +394,20 @@ OMX_IN  OMX_BUFFERHEADERTYPE* pBufHeader)
 
     pBufferStart = pMyData->sCompPorts[nPortIndex].pVPPBufHeader[nCount].pBufferStart;
 
+    /* tunneled buffers stay mapped in LCML until they are freed */
+    if (pMyData->sCompPorts[nPortIndex].hTunnelComponent != NULL && pMyData->pLCML != NULL) {
+        void *aRelease[3];
+        aRelease[0] = pBufHeader->pBuffer;
+        aRelease[1] = (void *)pBufHeader->nAllocLen;
+        aRelease[2] = (void *)(LCML_RELEASE_WAIT |
+            (pMyData->sCompPorts[nPortIndex].pVPPBufHeader[nCount].bSelfAllocated == OMX_TRUE ? LCML_RELEASE_OWNER : 0));
+        eRelease = LCML_ControlCodec(pMyData->pLCML->pCodecinterfacehandle, EMMCodecControlReleaseBuffer, aRelease);
+        if (eRelease != OMX_ErrorNone) {
+            /* the DSP still maps it: keep the memory rather than free it under the DSP */
+            VPP_DPRINT("VPP::%d :: buffer %p still mapped in the DSP (0x%X), not freed\n", __LINE__, pBufHeader->pBuffer, eRelease);
+        }
+    }
+
     VPP_DPRINT(" Free_ComponentResources --nPortIndex= %d, Header = %p \n", nPortIndex,
         pMyData->sCompPorts[nPortIndex].pVPPBufHeader[nCount].pBufHeader);
 
@@ -409,7 +424,9 @@ OMX_IN  OMX_BUFFERHEADERTYPE* pBufHeader)
                                 PERF_ModuleMemory);
 #endif
                VPP_DPRINT ("VPP::%d :: FreeBuffer --1.5\n",__LINE__);
-                OMX_FREE(pBufferStart);
+                if (eRelease == OMX_ErrorNone) {
+                    OMX_FREE(pBufferStart);
+                }
                 pBufferStart = NULL;
                 pBufHeader->pBuffer = NULL;
                 VPP_DPRINT ("VPP::%d :: FreeBuffer --1.6\n",__LINE__);
@@ -2469,6 +2486,7 @@ static OMX_ERRORTYPE VPP_ComponentTunnelRequest (OMX_HANDLETYPE hComponent,
     if (pTunnelSetup == NULL || hTunneledComp == 0) {
         /* cancel previous tunnel */
         pPort->hTunnelComponent = 0;
+        pPort->bDspTunnelPeer = OMX_FALSE;
         pPort->nTunnelPort = 0;
         pPort->eSupplierSetting = OMX_BufferSupplyUnspecified;
         eError = OMX_ErrorNone;
@@ -2489,6 +2507,7 @@ static OMX_ERRORTYPE VPP_ComponentTunnelRequest (OMX_HANDLETYPE hComponent,
     }
 
     pPort->hTunnelComponent = hTunneledComp;
+    pPort->bDspTunnelPeer   = LCML_IsDspTunnelPeer(hTunneledComp);
     pPort->nTunnelPort      = nTunneledPort;
     VPP_DPRINT("VPP comp = %x, tunneled comp = %x\n",(int)hComponent, (int)pPort->hTunnelComponent);
 
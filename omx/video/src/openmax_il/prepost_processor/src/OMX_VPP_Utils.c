@@ -1593,7 +1593,8 @@ OMX_ERRORTYPE VPP_StateToExecuting(VPP_COMPONENT_PRIVATE *pComponentPrivate)
                     VPP_DPRINT("LCML_QueueBuffer YUV: %s::%s: %d: VPP\n", __FILE__, __FUNCTION__, __LINE__);
                     eError = LCML_QueueBuffer(
                                 ((LCML_DSP_INTERFACE*)pLcmlHandle)->pCodecinterfacehandle,
-                                EMMCodecStream3,
+                                EMMCodecStream3 |
+                                (pComponentPrivate->sCompPorts[OMX_VPP_YUV_OUTPUT_PORT].bDspTunnelPeer ? LCML_BUFFER_TUNNEL : 0),
                                 pBufHdr->pBuffer,
                                 pBufHdr->nAllocLen,0,
                                 (OMX_U8 *)pComponentPrivate->pOpYUVFrameStatus,
@@ -1623,7 +1624,8 @@ OMX_ERRORTYPE VPP_StateToExecuting(VPP_COMPONENT_PRIVATE *pComponentPrivate)
                     VPP_DPRINT("LCML_QueueBuffer RGB: %s::%s: %d: VPP\n", __FILE__, __FUNCTION__, __LINE__);
                     eError = LCML_QueueBuffer(
                                 ((LCML_DSP_INTERFACE*)pLcmlHandle)->pCodecinterfacehandle,
-                                EMMCodecStream2,
+                                EMMCodecStream2 |
+                                (pComponentPrivate->sCompPorts[OMX_VPP_RGB_OUTPUT_PORT].bDspTunnelPeer ? LCML_BUFFER_TUNNEL : 0),
                                 pBufHdr->pBuffer,
                                 pBufHdr->nAllocLen,0,
                                 (OMX_U8 *)pComponentPrivate->pOpRGBFrameStatus,
@@ -2097,6 +2099,7 @@ OMX_ERRORTYPE VPP_Process_FilledInBuf(VPP_COMPONENT_PRIVATE* pComponentPrivate)
     OMX_BUFFERHEADERTYPE* pBufHeader = NULL;
     OMX_COMPONENTTYPE               *pHandle = NULL;
     OMX_U8 *pTemp = NULL;
+    OMX_U32 nTunnel = 0;
     int nRet=0;
     
     pHandle = pComponentPrivate->pHandle;
@@ -2126,6 +2129,11 @@ OMX_ERRORTYPE VPP_Process_FilledInBuf(VPP_COMPONENT_PRIVATE* pComponentPrivate)
         OMX_SET_ERROR_BAIL(eError, OMX_ErrorBadParameter);
     }
     pComponentPrivate->sCompPorts[portDef->nPortIndex].pVPPBufHeader[nIndex].bHolding = OMX_TRUE;
+    /* buffers tunneled to a DSP component keep their DSP mapping between frames */
+    if (pComponentPrivate->sCompPorts[portDef->nPortIndex].hTunnelComponent != NULL &&
+        pComponentPrivate->sCompPorts[portDef->nPortIndex].bDspTunnelPeer) {
+        nTunnel = LCML_BUFFER_TUNNEL;
+    }
     
     if (!pComponentPrivate->sCompPorts[portDef->nPortIndex].pPortDef.bEnabled) {
         VPP_DPRINT("cur port %p is disabled\n", portDef);
@@ -2209,7 +2217,7 @@ OMX_ERRORTYPE VPP_Process_FilledInBuf(VPP_COMPONENT_PRIVATE* pComponentPrivate)
                 pComponentPrivate->pIpFrameStatus->ulMirror);
             
             eError = LCML_QueueBuffer(pLcmlHandle->pCodecinterfacehandle,
-                        EMMCodecInputBuffer,
+                        EMMCodecInputBuffer | nTunnel,
                         pBufHeader->pBuffer,
                         pBufHeader->nAllocLen,
                         pBufHeader->nFilledLen,
@@ -2257,7 +2265,7 @@ OMX_ERRORTYPE VPP_Process_FilledInBuf(VPP_COMPONENT_PRIVATE* pComponentPrivate)
             pComponentPrivate->sCompPorts[portDef->nPortIndex].pVPPBufHeader[nIndex].eBufferOwner = VPP_BUFFER_DSP;
             eError = LCML_QueueBuffer(
                         pLcmlHandle->pCodecinterfacehandle,
-                        EMMCodecStream1,
+                        EMMCodecStream1 | nTunnel,
                         pBufHeader->pBuffer,
                         pBufHeader->nAllocLen,
                         pBufHeader->nFilledLen,
@@ -2302,6 +2310,7 @@ OMX_ERRORTYPE VPP_Process_FreeOutBuf(VPP_COMPONENT_PRIVATE* pComponentPrivate)
     LCML_DSP_INTERFACE *pLcmlHandle = NULL;
     OMX_BUFFERHEADERTYPE* pBufHeader = NULL;
     OMX_COMPONENTTYPE               *pHandle = NULL;
+    OMX_U32 nTunnel = 0;
     int nRet = 0;
 
     VPP_DPRINT("In VPP_Process_FreeOutBuf\n");
@@ -2330,6 +2339,11 @@ OMX_ERRORTYPE VPP_Process_FreeOutBuf(VPP_COMPONENT_PRIVATE* pComponentPrivate)
     if ( eError != OMX_ErrorNone) {
         goto EXIT;
     }
+    /* buffers tunneled to a DSP component keep their DSP mapping between frames */
+    if (pComponentPrivate->sCompPorts[portDef->nPortIndex].hTunnelComponent != NULL &&
+        pComponentPrivate->sCompPorts[portDef->nPortIndex].bDspTunnelPeer) {
+        nTunnel = LCML_BUFFER_TUNNEL;
+    }
 
     if ((pComponentPrivate->bIsStopping != OMX_FALSE ) || (pComponentPrivate->curState == OMX_StateIdle)) {
         VPP_DPRINT("VPP is not in executing state (in FreeOutBuf %d %d %p)\n", portDef->nPortIndex, nIndex, pBufHeader);
@@ -2391,7 +2405,7 @@ OMX_ERRORTYPE VPP_Process_FreeOutBuf(VPP_COMPONENT_PRIVATE* pComponentPrivate)
         if (portDef->nPortIndex == OMX_VPP_RGB_OUTPUT_PORT) {
             eError = LCML_QueueBuffer(
                     pLcmlHandle->pCodecinterfacehandle,
-                    EMMCodecStream2,
+                    EMMCodecStream2 | nTunnel,
                     pBufHeader->pBuffer,
                     pBufHeader->nAllocLen,0,
                     (OMX_U8 *) pComponentPrivate->pOpRGBFrameStatus,
@@ -2401,7 +2415,7 @@ OMX_ERRORTYPE VPP_Process_FreeOutBuf(VPP_COMPONENT_PRIVATE* pComponentPrivate)
         } else { /* portDef->nPortIndex == OMX_VPP_YUV_OUTPUT_PORT) */
            eError = LCML_QueueBuffer(
                     pLcmlHandle->pCodecinterfacehandle,
-                    EMMCodecStream3,
+                    EMMCodecStream3 | nTunnel,
                     pBufHeader->pBuffer,
                     pBufHeader->nAllocLen,0,
                     (OMX_U8 *) pComponentPrivate->pOpYUVFrameStatus,
@@ -3469,7 +3483,6 @@ EXIT:
 } /* End of IsTIOMXComponent */
 
 
-
 /*-------------------------------------------------------------------*/
 /**
   *  VPP_InitBufferDataPropagation()
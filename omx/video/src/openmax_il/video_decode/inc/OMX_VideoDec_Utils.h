@@ -175,6 +175,7 @@ typedef enum VIDDEC_ENUM_MEMLEVELS{
 #define VIDDEC_MAX_NAMESIZE                 128
 #define VIDDEC_NOPORT                       0xfffffffe
 #define VIDDEC_MPU                          50
+#define VIDDEC_CORE_LIBRARY                 "libOMX_Core.so"
 
 #define IUALG_CMD_SETSTATUS                 3
 
@@ -610,6 +611,7 @@ typedef struct VIDDEC_CBUFFER_BUFFERFLAGS{
 typedef struct VIDDEC_PORT_TYPE
 {
     OMX_HANDLETYPE hTunnelComponent;
+    OMX_BOOL bDspTunnelPeer;    /* peer is in LCML_DSP_TUNNEL_PEERS */
     OMX_U32 nTunnelPort;
     OMX_BUFFERSUPPLIERTYPE eSupplierSetting;
     VIDDEC_BUFFER_PRIVATE* pBufferPrivate[MAX_PRIVATE_BUFFERS];
@@ -897,6 +899,9 @@ typedef struct VIDDEC_COMPONENT_PRIVATE
     OMX_U32 lcml_compID;
     void* pLcmlHandle;
     void* pModLCML;
+    /* OMX core the DSP load is committed to, see VIDDEC_CommitDspLoad */
+    void* pModCore;
+    OMX_U32 nDspLoadMHz;
     OMX_U16 arr[100];
     int frameCounter;
     LCML_DSP_INTERFACE* pLCML;
@@ -1228,14 +1233,6 @@ typedef struct VIDDEC_COMPONENT_PRIVATE
     goto EXIT;                                  \
 }
 
-
-#define OMX_PARSER_CHECKLIMIT(_total, _actual, _step) /*  \
-    if(((_actual + _step) >> 3) >= _total){                \
-    printf("_total %d _actual %d\n",_total,((_actual + _step)>>3)); \
-        eError = OMX_ErrorStreamCorrupt;                \
-        goto EXIT;                                      \
-    }*/
-
 /*sMutex*/
 #define VIDDEC_PTHREAD_MUTEX_INIT(_mutex_)    \
     if(!((_mutex_).bInitialized)) {            \
@@ -1376,6 +1373,7 @@ typedef struct VIDDEC_COMPONENT_PRIVATE
  
 /*-------function prototypes -------------------------------------------------*/
 typedef OMX_ERRORTYPE (*VIDDEC_fpo)(OMX_HANDLETYPE);
+typedef OMX_ERRORTYPE (*VIDDEC_fpCommitLoad)(OMX_HANDLETYPE, OMX_U32);
 
 OMX_ERRORTYPE OMX_ComponentInit (OMX_HANDLETYPE hComponent);
 OMX_ERRORTYPE VIDDEC_Start_ComponentThread (OMX_HANDLETYPE pHandle);
@@ -1400,6 +1398,8 @@ OMX_ERRORTYPE VIDDEC_HandleCommandMarkBuffer(VIDDEC_COMPONENT_PRIVATE *pComponen
 OMX_ERRORTYPE VIDDEC_HandleCommandFlush(VIDDEC_COMPONENT_PRIVATE *pComponentPrivate, OMX_U32 nParam1, OMX_BOOL bPass);
 OMX_ERRORTYPE VIDDEC_Load_Defaults (VIDDEC_COMPONENT_PRIVATE* pComponentPrivate, OMX_S32 nPassing);
 OMX_U32 VIDDEC_GetRMFrecuency(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate);
+OMX_ERRORTYPE VIDDEC_CommitDspLoad(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate);
+void VIDDEC_ReleaseDspLoad(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate);
 OMX_ERRORTYPE VIDDEC_Handle_InvalidState (VIDDEC_COMPONENT_PRIVATE* pComponentPrivate);
 
 OMX_ERRORTYPE VIDDEC_CircBuf_Init(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate, VIDDEC_CBUFFER_TYPE nTypeIndex, VIDDEC_PORT_INDEX nPortIndex);
@@ -1438,8 +1438,6 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
                                      OMX_BUFFERHEADERTYPE* pBuffHead,OMX_S32* nWidth,
                                      OMX_S32* nHeight, OMX_S32* nCropWidth, OMX_S32* nCropHeight, OMX_U32 nType);
 OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG2( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BUFFERHEADERTYPE *pBuffHead);
-OMX_U32 VIDDEC_GetBits(OMX_U32* nPosition, OMX_U8 nBits, OMX_U8* pBuffer, OMX_BOOL bIcreasePosition);
-OMX_S32 VIDDEC_UVLC_dec(OMX_U32 *nPosition, OMX_U8* pBuffer);
 OMX_ERRORTYPE AddStateTransition(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate);
 OMX_ERRORTYPE RemoveStateTransition(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate, OMX_BOOL bEnableSignal);
 OMX_ERRORTYPE IncrementCount (OMX_U8 * pCounter, pthread_mutex_t *pMutex);
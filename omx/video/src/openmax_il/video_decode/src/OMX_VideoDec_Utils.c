@@ -54,10 +54,14 @@
 #include "OMX_VideoDec_Utils.h"
 #include "OMX_VideoDec_DSP.h"
 #include "OMX_VideoDec_Thread.h"
+#include "OMX_TI_StartCode.h"
+#include "OMX_TI_BitReader.h"
 #define LOG_TAG "TI_Video_Decoder"
 /*----------------------------------------------------------------------------*/
 /**
   * VIDDEC_GetRMFrecuency() Return the value for frecuecny to use RM.
+  * Also the DSP load committed to the OMX core, so it is estimated with or
+  * without the resource manager.
   **/
 /*----------------------------------------------------------------------------*/
 OMX_U32 VIDDEC_GetRMFrecuency(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate)
@@ -65,7 +69,6 @@ OMX_U32 VIDDEC_GetRMFrecuency(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate)
    OMX_U32 nReturnValue = VIDDEC_MPU;
 
    OMX_PRINT1(pComponentPrivate->dbg, "+++ENTERING\n");
-#ifdef RESOURCE_MANAGER_ENABLED
         /*resolution for greater than CIF*/
         if ((OMX_U16)(pComponentPrivate->pInPortDef->format.video.nFrameWidth > VIDDEC_CIF_WIDTH) ||
             (OMX_U16)(pComponentPrivate->pInPortDef->format.video.nFrameHeight > VIDDEC_CIF_HEIGHT)) {
@@ -163,14 +166,74 @@ OMX_U32 VIDDEC_GetRMFrecuency(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate)
             nReturnValue = VIDDEC_MPU;
     }
     OMX_PRDSP2(pComponentPrivate->dbg, "Used RM Frec value = %d\n",(int)nReturnValue);
-#else
-    OMX_PRDSP2(pComponentPrivate->dbg, "Used RM Frec defaulted value = %d\n",(int)nReturnValue);
-#endif
     OMX_PRINT1(pComponentPrivate->dbg, "---EXITING\n");
     return nReturnValue;
 
 }
 
+/*----------------------------------------------------------------------------*/
+/**
+  * VIDDEC_CommitDspLoad() Commit the DSP load of the current settings to the
+  * OMX core before the codec is created, so that an instance that would
+  * overload the DSP is refused with OMX_ErrorInsufficientResources. Without
+  * the TI core there is no admission control and the call succeeds.
+  **/
+/*----------------------------------------------------------------------------*/
+OMX_ERRORTYPE VIDDEC_CommitDspLoad(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate)
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+#ifndef UNDER_CE
+    VIDDEC_fpCommitLoad fpCommitLoad = NULL;
+    OMX_U32 nMHz = VIDDEC_GetRMFrecuency(pComponentPrivate);
+
+    if (pComponentPrivate->pModCore == NULL) {
+        pComponentPrivate->pModCore = dlopen(VIDDEC_CORE_LIBRARY, RTLD_LAZY);
+        if (pComponentPrivate->pModCore == NULL) {
+            OMX_PRDSP2(pComponentPrivate->dbg, "No OMX core for DSP admission: %s\n", dlerror());
+            goto EXIT;
+        }
+    }
+    fpCommitLoad = (VIDDEC_fpCommitLoad)dlsym(pComponentPrivate->pModCore, "TIOMX_CommitDspLoad");
+    if (fpCommitLoad == NULL) {
+        OMX_PRDSP2(pComponentPrivate->dbg, "OMX core without DSP admission\n");
+        goto EXIT;
+    }
+    eError = (*fpCommitLoad)(pComponentPrivate->pHandle, nMHz);
+    if (eError == OMX_ErrorNone) {
+        pComponentPrivate->nDspLoadMHz = nMHz;
+    }
+    else {
+        OMX_PRDSP4(pComponentPrivate->dbg, "DSP load of %lu MHz refused 0x%x\n", nMHz, eError);
+    }
+EXIT:
+#endif
+    return eError;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+  * VIDDEC_ReleaseDspLoad() Give back the load of VIDDEC_CommitDspLoad once the
+  * codec is destroyed.
+  **/
+/*----------------------------------------------------------------------------*/
+void VIDDEC_ReleaseDspLoad(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate)
+{
+#ifndef UNDER_CE
+    VIDDEC_fpo fpReleaseLoad = NULL;
+
+    if (pComponentPrivate->pModCore == NULL) {
+        return;
+    }
+    fpReleaseLoad = (VIDDEC_fpo)dlsym(pComponentPrivate->pModCore, "TIOMX_ReleaseDspLoad");
+    if (fpReleaseLoad != NULL) {
+        (*fpReleaseLoad)(pComponentPrivate->pHandle);
+    }
+    pComponentPrivate->nDspLoadMHz = 0;
+    dlclose(pComponentPrivate->pModCore);
+    pComponentPrivate->pModCore = NULL;
+#endif
+}
+
 OMX_ERRORTYPE VIDDEC_Queue_Init(VIDDEC_QUEUE_TYPE *queue, VIDDEC_QUEUE_TYPES type)
 {
     OMX_ERRORTYPE eError = OMX_ErrorUndefined;
@@ -2459,6 +2522,23 @@ OMX_ERRORTYPE VIDDEC_HandleCommand (OMX_HANDLETYPE phandle, OMX_U32 nParam1)
             }
 #endif
 
+            /* refuse the instance rather than overload the DSP */
+            eError = VIDDEC_CommitDspLoad(pComponentPrivate);
+            if (eError != OMX_ErrorNone) {
+                pComponentPrivate->eState = OMX_StateLoaded;
+                pComponentPrivate->cbInfo.EventHandler(pComponentPrivate->pHandle,
+                                                       pComponentPrivate->pHandle->pApplicationPrivate,
+                                                       OMX_EventError,
+                                                       OMX_ErrorInsufficientResources,
+                                                       OMX_TI_ErrorMajor,
+                                                       "DSP load over budget");
+                OMX_PRDSP4(pComponentPrivate->dbg, "OMX_ErrorInsufficientResources 0x%x\n",eError);
+                if(RemoveStateTransition(pComponentPrivate, OMX_TRUE) != OMX_ErrorNone) {
+                      return OMX_ErrorUndefined;
+                }
+                break;
+            }
+
 #if 1
 #ifndef UNDER_CE
                 pMyLCML = dlopen("libLCML.so", RTLD_LAZY);
@@ -3281,6 +3361,7 @@ OMX_ERRORTYPE VIDDEC_HandleCommand (OMX_HANDLETYPE phandle, OMX_U32 nParam1)
                 }
 #endif
             pComponentPrivate->eLCMLState = VidDec_LCML_State_Unload;
+            VIDDEC_ReleaseDspLoad(pComponentPrivate);
 
                OMX_PRDSP1(pComponentPrivate->dbg, "Closed LCML lib 0x%p\n",pComponentPrivate->pModLCML);
                OMX_PRBUFFER2(pComponentPrivate->dbg, "Waiting for unpopulate ports IN 0x%x OUT 0x%x\n",pPortDefIn->bEnabled,pPortDefOut->bEnabled);
@@ -3894,8 +3975,12 @@ OMX_ERRORTYPE VIDDEC_HandleFreeOutputBufferFromApp(VIDDEC_COMPONENT_PRIVATE *pCo
 #endif
 
             OMX_PRDSP1(pComponentPrivate->dbg, "LCML_QueueBuffer(OUTPUT)\n");
+            /* a frame tunneled to a DSP component goes straight to the next
+             * DSP node, keep it mapped */
             eError = LCML_QueueBuffer(((LCML_DSP_INTERFACE*)pLcmlHandle)->pCodecinterfacehandle,
-                                      EMMCodecOutputBufferMapBufLen,
+                                      EMMCodecOutputBufferMapBufLen |
+                                      ((pComponentPrivate->pCompPort[VIDDEC_OUTPUT_PORT]->hTunnelComponent != NULL &&
+                                        pComponentPrivate->pCompPort[VIDDEC_OUTPUT_PORT]->bDspTunnelPeer) ? LCML_BUFFER_TUNNEL : 0),
                                       pBuffHead->pBuffer,
                                       pBuffHead->nAllocLen,
                                       pBuffHead->nFilledLen,
@@ -3948,7 +4033,7 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG2( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
     /*OMX_U8*    pTempSize = 0;*/
     /*OMX_U32    nProfile = 0;*/
     /*OMX_U32    nLevel = 0;*/
-    OMX_U32    nBitPosition = 0;
+    OMX_TI_BITREADERTYPE sBits;
     OMX_U8*    pHeaderStream = (OMX_U8*)pBuffHead->pBuffer;
     OMX_BOOL   nStartFlag = OMX_FALSE;
     OMX_U32    nInBytePosition = 0;
@@ -3956,24 +4041,20 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG2( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
     OMX_U32    nNalUnitType = 0;
 
     nTotalInBytes = pBuffHead->nFilledLen;
+    OMX_TI_BitReaderInit(&sBits, pHeaderStream, nTotalInBytes);
 
     do{
-        for (; (!nStartFlag) && (nInBytePosition < nTotalInBytes - 3); ) {
-           if (VIDDEC_GetBits(&nBitPosition, 24, pHeaderStream, OMX_FALSE) != 0x000001) {
-                nBitPosition += 8;
-                nInBytePosition++;
-           }
-           else {
-               nStartFlag = OMX_TRUE;
-               nBitPosition += 24;
-               nInBytePosition += 3;
-           }
+        nInBytePosition = OMX_TI_FindStartCode(pHeaderStream, nTotalInBytes, nInBytePosition);
+        if (nInBytePosition + 3 < nTotalInBytes) {
+            nStartFlag = OMX_TRUE;
+            nInBytePosition += 3;
+            OMX_TI_BitReaderSeek(&sBits, nInBytePosition * 8);
         }
         if (!nStartFlag) {
             eError = OMX_ErrorStreamCorrupt;
             goto EXIT;
         }
-        nNalUnitType = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
+        nNalUnitType = OMX_TI_ReadBits(&sBits, 8);
         nInBytePosition++;
         if (nNalUnitType != 0xB3) {
             nStartFlag = OMX_FALSE;
@@ -3981,11 +4062,11 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG2( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
     }while (nNalUnitType != 0xB3);
 
     if (nNalUnitType == 0xB3) {
-        nTempValue = VIDDEC_GetBits(&nBitPosition, 12, pHeaderStream, OMX_TRUE);
+        nTempValue = OMX_TI_ReadBits(&sBits, 12);
         (*nWidth) = (nTempValue);
-        nTempValue = VIDDEC_GetBits(&nBitPosition, 12, pHeaderStream, OMX_TRUE);
+        nTempValue = OMX_TI_ReadBits(&sBits, 12);
         (*nHeight) = (nTempValue);
-        eError = OMX_ErrorNone;
+        eError = sBits.bError ? OMX_ErrorStreamCorrupt : OMX_ErrorNone;
     }
 
 EXIT:
@@ -4007,7 +4088,7 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_WMV9_VC1( OMX_S32* nWidth, OMX_S32* nHeight, OMX
     /*OMX_U8*    pTempSize = 0;*/
     OMX_U32    nProfile = 0;
     OMX_U32    nLevel = 0;
-    OMX_U32    nBitPosition = 0;
+    OMX_TI_BITREADERTYPE sBits;
     OMX_U8*    pHeaderStream = (OMX_U8*)pBuffHead->pBuffer;
     OMX_BOOL   nStartFlag = OMX_FALSE;
     OMX_U32    nInBytePosition = 0;
@@ -4015,24 +4096,20 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_WMV9_VC1( OMX_S32* nWidth, OMX_S32* nHeight, OMX
     OMX_U32    nNalUnitType = 0;
 
     nTotalInBytes = pBuffHead->nFilledLen;
+    OMX_TI_BitReaderInit(&sBits, pHeaderStream, nTotalInBytes);
 
     do{
-        for (; (!nStartFlag) && (nInBytePosition < nTotalInBytes - 3); ) {
-           if (VIDDEC_GetBits(&nBitPosition, 24, pHeaderStream, OMX_FALSE) != 0x000001) {
-                nBitPosition += 8;
-                nInBytePosition++;
-           }
-           else {
-               nStartFlag = OMX_TRUE;
-               nBitPosition += 24;
-               nInBytePosition += 3;
-           }
+        nInBytePosition = OMX_TI_FindStartCode(pHeaderStream, nTotalInBytes, nInBytePosition);
+        if (nInBytePosition + 3 < nTotalInBytes) {
+            nStartFlag = OMX_TRUE;
+            nInBytePosition += 3;
+            OMX_TI_BitReaderSeek(&sBits, nInBytePosition * 8);
         }
         if (!nStartFlag) {
             eError = OMX_ErrorStreamCorrupt;
             goto EXIT;
         }
-        nNalUnitType = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
+        nNalUnitType = OMX_TI_ReadBits(&sBits, 8);
         nInBytePosition++;
         if (nNalUnitType != 0x0f && nNalUnitType != 0x0e) {
             nStartFlag = OMX_FALSE;
@@ -4040,14 +4117,14 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_WMV9_VC1( OMX_S32* nWidth, OMX_S32* nHeight, OMX
     }while (nNalUnitType != 0x0f && nNalUnitType != 0x0e);
 
     if (nNalUnitType == 0x0f || nNalUnitType == 0x0e) {
-        nProfile = VIDDEC_GetBits(&nBitPosition, 2, pHeaderStream, OMX_TRUE);
-        nLevel = VIDDEC_GetBits(&nBitPosition, 3, pHeaderStream, OMX_TRUE);
-        nTempValue = VIDDEC_GetBits(&nBitPosition, 11, pHeaderStream, OMX_TRUE);
-        nTempValue = VIDDEC_GetBits(&nBitPosition, 12, pHeaderStream, OMX_TRUE);
+        nProfile = OMX_TI_ReadBits(&sBits, 2);
+        nLevel = OMX_TI_ReadBits(&sBits, 3);
+        nTempValue = OMX_TI_ReadBits(&sBits, 11);
+        nTempValue = OMX_TI_ReadBits(&sBits, 12);
         (*nWidth) = (nTempValue * 2) + 2;
-        nTempValue = VIDDEC_GetBits(&nBitPosition, 12, pHeaderStream, OMX_TRUE);
+        nTempValue = OMX_TI_ReadBits(&sBits, 12);
         (*nHeight) = (nTempValue * 2) + 2;
-        eError = OMX_ErrorNone;
+        eError = sBits.bError ? OMX_ErrorStreamCorrupt : OMX_ErrorNone;
     }
 
 EXIT:
@@ -4069,26 +4146,27 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_WMV9_RCV( OMX_S32* nWidth, OMX_S32* nHeight, OMX
     /*OMX_U8*    pTempSize = 0;*/
     OMX_U32    Profile = 0;
     /*OMX_U32    i = 0;*/
-    OMX_U32    nBitPosition = 0;
+    OMX_TI_BITREADERTYPE sBits;
     OMX_U8*    pHeaderStream = (OMX_U8*)pBuffHead->pBuffer;
 
     if (pBuffHead->nFilledLen >= 20) {
-        nTempValue = VIDDEC_GetBits(&nBitPosition, 32, pHeaderStream, OMX_TRUE);
-        nTempValue = VIDDEC_GetBits(&nBitPosition, 32, pHeaderStream, OMX_TRUE);
-        Profile = VIDDEC_GetBits(&nBitPosition, 4, pHeaderStream, OMX_TRUE);
-        nTempValue = VIDDEC_GetBits(&nBitPosition, 28, pHeaderStream, OMX_TRUE);
+        OMX_TI_BitReaderInit(&sBits, pHeaderStream, pBuffHead->nFilledLen);
+        nTempValue = OMX_TI_ReadBits(&sBits, 32);
+        nTempValue = OMX_TI_ReadBits(&sBits, 32);
+        Profile = OMX_TI_ReadBits(&sBits, 4);
+        nTempValue = OMX_TI_ReadBits(&sBits, 28);
 
         pTempValue = (OMX_U8*)&nTempValue;
-        pTempValue[0] = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
-        pTempValue[1] = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
-        pTempValue[2] = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
-        pTempValue[3] = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
+        pTempValue[0] = OMX_TI_ReadBits(&sBits, 8);
+        pTempValue[1] = OMX_TI_ReadBits(&sBits, 8);
+        pTempValue[2] = OMX_TI_ReadBits(&sBits, 8);
+        pTempValue[3] = OMX_TI_ReadBits(&sBits, 8);
         (*nHeight) = nTempValue;
 
-        pTempValue[0] = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
-        pTempValue[1] = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
-        pTempValue[2] = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
-        pTempValue[3] = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);
+        pTempValue[0] = OMX_TI_ReadBits(&sBits, 8);
+        pTempValue[1] = OMX_TI_ReadBits(&sBits, 8);
+        pTempValue[2] = OMX_TI_ReadBits(&sBits, 8);
+        pTempValue[3] = OMX_TI_ReadBits(&sBits, 8);
         (*nWidth) = nTempValue;
         eError = OMX_ErrorNone;
     }
@@ -4112,12 +4190,11 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG4( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
 {
     OMX_ERRORTYPE eError = OMX_ErrorUndefined;
     OMX_U32    nSartCode = 0;
-    OMX_U32    nBitPosition = 0;
+    OMX_TI_BITREADERTYPE sBits;
     OMX_BOOL   bHeaderParseCompleted = OMX_FALSE;
     OMX_BOOL   bFillHeaderInfo = OMX_FALSE;
     OMX_U8* pHeaderStream = (OMX_U8*)pBuffHead->pBuffer;
-
-    /*OMX_U32 nTotalInBytes = pBuffHead->nFilledLen;*/
+    OMX_U32 nTotalInBytes = pBuffHead->nFilledLen;
     VIDDEC_MPEG4_ParserParam MPEG4_Param;
     VIDDEC_MPEG4UncompressedVideoFormat iOutputFormat = {0};
     VIDDEC_MPEG4_ParserParam* sMPEG4_Param = &MPEG4_Param;
@@ -4127,258 +4204,185 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG4( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
     VIDDEC_MPEG4VisualVOLHeader* sVolHeaderPtr = &sVolHeaderDummy;
 
     pPictHeaderPtr->cnOptional = (OMX_U8*)malloc( sizeof(VIDDEC_MPEG4VisualVOLHeader));
+    OMX_TI_BitReaderInit(&sBits, pHeaderStream, nTotalInBytes);
     while (!bHeaderParseCompleted)
     {
-        nSartCode = VIDDEC_GetBits(&nBitPosition, 32, pHeaderStream, OMX_TRUE);
+        nSartCode = OMX_TI_ReadBits(&sBits, 32);
+        if (sBits.bError)
+        {
+            /* no VOL or short header before the end of the buffer */
+            eError = OMX_ErrorStreamCorrupt;
+            goto EXIT;
+        }
         if (nSartCode == 0x1B0)
         {
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 4);
-            pPictHeaderPtr->nProfile = VIDDEC_GetBits(&nBitPosition, 4, pHeaderStream, OMX_TRUE);
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 4);
-            pPictHeaderPtr->nLevel = VIDDEC_GetBits(&nBitPosition, 4, pHeaderStream, OMX_TRUE);
+            pPictHeaderPtr->nProfile = OMX_TI_ReadBits(&sBits, 4);
+            pPictHeaderPtr->nLevel = OMX_TI_ReadBits(&sBits, 4);
         }
         else if (nSartCode == 0x1B5)
         {
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nIsVisualObjectIdentifier = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
+            sMPEG4_Param->nIsVisualObjectIdentifier = OMX_TI_ReadBits(&sBits, 1);
             if (sMPEG4_Param->nIsVisualObjectIdentifier)
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 7);
-                (void)VIDDEC_GetBits(&nBitPosition, 7, pHeaderStream, OMX_TRUE); /* DISCARD THIS INFO (7 bits)*/
+                (void)OMX_TI_ReadBits(&sBits, 7); /* DISCARD THIS INFO (7 bits)*/
             }
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 4);
-            sMPEG4_Param->nVisualObjectType = VIDDEC_GetBits(&nBitPosition, 4, pHeaderStream, OMX_TRUE);
+            sMPEG4_Param->nVisualObjectType = OMX_TI_ReadBits(&sBits, 4);
             if (sMPEG4_Param->nVisualObjectType== 1|| sMPEG4_Param->nVisualObjectType== 2)
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                sMPEG4_Param->nVideoSignalType = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
+                sMPEG4_Param->nVideoSignalType = OMX_TI_ReadBits(&sBits, 1);
                 if (sMPEG4_Param->nVideoSignalType)
                 {
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 3);
-                    sMPEG4_Param->nVideoFormat = VIDDEC_GetBits(&nBitPosition, 3, pHeaderStream, OMX_TRUE);
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                    sMPEG4_Param->nVideoRange = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                    sMPEG4_Param->nColorDescription = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
+                    sMPEG4_Param->nVideoFormat = OMX_TI_ReadBits(&sBits, 3);
+                    sMPEG4_Param->nVideoRange = OMX_TI_ReadBits(&sBits, 1);
+                    sMPEG4_Param->nColorDescription = OMX_TI_ReadBits(&sBits, 1);
                     if (sMPEG4_Param->nColorDescription)
                     {
                         /*Discard this info*/
-                        OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 24);
-                        (void)VIDDEC_GetBits(&nBitPosition, 24, pHeaderStream, OMX_TRUE);
+                        (void)OMX_TI_ReadBits(&sBits, 24);
                     }
                 }
             }
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->NBitZero = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
-            while ((nBitPosition%8)!= 0) {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);/*discard align bits*/
-            }
+            sMPEG4_Param->NBitZero = OMX_TI_ReadBits(&sBits, 1);
+            OMX_TI_ByteAlign(&sBits); /*discard align bits*/
         }
         else if ((nSartCode >= 0x100)&&(nSartCode <= 0x11F))
         {
             /*Do nothing*/
-            /*    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 8);
-                  (void)VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);*/
         }
         else if (nSartCode == 0x1B3) /*GOV*/
         {
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 20);
-            (void)VIDDEC_GetBits(&nBitPosition, 20, pHeaderStream, OMX_TRUE);
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->NBitZero = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
-            while ((nBitPosition%8)!= 0){
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);/*discard align bits*/
-            }
+            (void)OMX_TI_ReadBits(&sBits, 20);
+            sMPEG4_Param->NBitZero = OMX_TI_ReadBits(&sBits, 1);
+            OMX_TI_ByteAlign(&sBits); /*discard align bits*/
         }
         else if (nSartCode == 0x1B2) /*user data*/
         {
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 24);
-            while (VIDDEC_GetBits(&nBitPosition, 24, pHeaderStream, OMX_TRUE)!= 0x1)
-                nBitPosition-=16;        /*discard only 8 bits and try againg until*/
-                                        /*the next start code is found*/
-            nBitPosition -=24;            /* prepare to read the entire start code*/
-        /*    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->NBitZero = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
-            PRINT("sMPEG4_Param->NBitZero = %d", sMPEG4_Param->NBitZero);
-            while ((nBitPosition%8)!= 0) {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);*//*discard align bits*/
-            /*}*/
+            /* skip to the next start code, or to the end of the buffer */
+            OMX_TI_BitReaderSeek(&sBits, OMX_TI_FindStartCode(pHeaderStream, nTotalInBytes,
+                                 OMX_TI_BitReaderTell(&sBits) / 8) * 8);
         }
         else if ((nSartCode >= 0x120)&&(nSartCode <= 0x12F))
         {
             sVolHeaderPtr->nVideoObjectLayerId = nSartCode&0x0000000f;
             sVolHeaderPtr->bShortVideoHeader = 0;
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            pPictHeaderPtr->bIsRandomAccessible = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);    /*1 bit*/
+            pPictHeaderPtr->bIsRandomAccessible = OMX_TI_ReadBits(&sBits, 1);    /*1 bit*/
             sVolHeaderPtr->bRandomAccessibleVOL = pPictHeaderPtr->bIsRandomAccessible;
             if (pPictHeaderPtr->bIsRandomAccessible)
             {
                 /* it seems this never happens*/
             }
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 8);
-            sMPEG4_Param->nVideoObjectTypeIndication = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);    /* 8 bits*/
+            sMPEG4_Param->nVideoObjectTypeIndication = OMX_TI_ReadBits(&sBits, 8);    /* 8 bits*/
             sVolHeaderPtr->nVideoObjectTypeIndication = sMPEG4_Param->nVideoObjectTypeIndication;
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nIsVisualObjectLayerIdentifier = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);/*1 bit*/
+            sMPEG4_Param->nIsVisualObjectLayerIdentifier = OMX_TI_ReadBits(&sBits, 1);/*1 bit*/
             sVolHeaderPtr->nVideoObjectLayerId = sMPEG4_Param->nIsVisualObjectLayerIdentifier;
             sMPEG4_Param->nLayerVerId = 0;
             if (sMPEG4_Param->nIsVisualObjectLayerIdentifier)
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 4);
-                sMPEG4_Param->nLayerVerId = VIDDEC_GetBits(&nBitPosition, 4, pHeaderStream, OMX_TRUE);                        /*4 bits*/
+                sMPEG4_Param->nLayerVerId = OMX_TI_ReadBits(&sBits, 4);                        /*4 bits*/
                 sVolHeaderPtr->nVideoObjectLayerVerId = sMPEG4_Param->nLayerVerId;
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 3);
-                sMPEG4_Param->nLayerPriority = VIDDEC_GetBits(&nBitPosition, 3, pHeaderStream, OMX_TRUE);            /*3 bits*/
+                sMPEG4_Param->nLayerPriority = OMX_TI_ReadBits(&sBits, 3);            /*3 bits*/
                 sVolHeaderPtr->nVideoObjectLayerPriority = sMPEG4_Param->nLayerPriority;
             }
 
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 4);
-            sMPEG4_Param->nAspectRadio = VIDDEC_GetBits(&nBitPosition, 4, pHeaderStream, OMX_TRUE);                    /*4 bits*/
+            sMPEG4_Param->nAspectRadio = OMX_TI_ReadBits(&sBits, 4);                    /*4 bits*/
             if (sMPEG4_Param->nAspectRadio == 0xf)
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 8);
-                sMPEG4_Param->nParWidth = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);                    /*8 bits*/
+                sMPEG4_Param->nParWidth = OMX_TI_ReadBits(&sBits, 8);                    /*8 bits*/
                 sVolHeaderPtr->nAspectRatioNum = sMPEG4_Param->nParWidth;
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 8);
-                sMPEG4_Param->nParHeight = VIDDEC_GetBits(&nBitPosition, 8, pHeaderStream, OMX_TRUE);                /*8 bits*/
+                sMPEG4_Param->nParHeight = OMX_TI_ReadBits(&sBits, 8);                /*8 bits*/
                 sVolHeaderPtr->nAspectRatioDenom = sMPEG4_Param->nParHeight;
             }
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nControlParameters = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);            /*1 bit*/
+            sMPEG4_Param->nControlParameters = OMX_TI_ReadBits(&sBits, 1);            /*1 bit*/
             if ( sMPEG4_Param->nControlParameters )
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 2);
-                sMPEG4_Param->nChromaFormat = VIDDEC_GetBits(&nBitPosition, 2, pHeaderStream, OMX_TRUE);                /*2 bits*/
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                sMPEG4_Param->nLowDelay = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                    /*1 bit*/
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                sMPEG4_Param->nVbvParameters = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);            /*1 bit*/
+                sMPEG4_Param->nChromaFormat = OMX_TI_ReadBits(&sBits, 2);                /*2 bits*/
+                sMPEG4_Param->nLowDelay = OMX_TI_ReadBits(&sBits, 1);                    /*1 bit*/
+                sMPEG4_Param->nVbvParameters = OMX_TI_ReadBits(&sBits, 1);            /*1 bit*/
                 if (sMPEG4_Param->nVbvParameters)
                 {
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 15);
-                    sMPEG4_Param->nBitRate = VIDDEC_GetBits(&nBitPosition, 15, pHeaderStream, OMX_TRUE)<<15;                /*15 bit*/
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                    (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                        /*1 bit*/
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 15);
-                    sMPEG4_Param->nBitRate |= VIDDEC_GetBits(&nBitPosition, 15, pHeaderStream, OMX_TRUE);                    /*15 bit*/
+                    sMPEG4_Param->nBitRate = OMX_TI_ReadBits(&sBits, 15)<<15;                /*15 bit*/
+                    (void)OMX_TI_ReadBits(&sBits, 1);                        /*1 bit*/
+                    sMPEG4_Param->nBitRate |= OMX_TI_ReadBits(&sBits, 15);                    /*15 bit*/
                     sVolHeaderPtr->sVbvParams.nBitRate = sMPEG4_Param->nBitRate;
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                    (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 15);
-                    sMPEG4_Param->nFirstHalfVbvBufferSize = VIDDEC_GetBits(&nBitPosition, 15, pHeaderStream, OMX_TRUE);
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                    (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 3);
-                    sMPEG4_Param->nLatterHalfVbvBufferSize = VIDDEC_GetBits(&nBitPosition, 3, pHeaderStream, OMX_TRUE);
+                    (void)OMX_TI_ReadBits(&sBits, 1);
+                    sMPEG4_Param->nFirstHalfVbvBufferSize = OMX_TI_ReadBits(&sBits, 15);
+                    (void)OMX_TI_ReadBits(&sBits, 1);
+                    sMPEG4_Param->nLatterHalfVbvBufferSize = OMX_TI_ReadBits(&sBits, 3);
                     sVolHeaderPtr->sVbvParams.nVbvBufferSize =
                         (((sMPEG4_Param->nFirstHalfVbvBufferSize) << 3) + sMPEG4_Param->nLatterHalfVbvBufferSize) * 2048;
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 11);
-                    sMPEG4_Param->nFirstHalfVbvOccupancy = VIDDEC_GetBits(&nBitPosition, 11, pHeaderStream, OMX_TRUE);
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                    (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 15);
-                    sMPEG4_Param->nLatterHalfVbvOccupancy = VIDDEC_GetBits(&nBitPosition, 15, pHeaderStream, OMX_TRUE);
+                    sMPEG4_Param->nFirstHalfVbvOccupancy = OMX_TI_ReadBits(&sBits, 11);
+                    (void)OMX_TI_ReadBits(&sBits, 1);
+                    sMPEG4_Param->nLatterHalfVbvOccupancy = OMX_TI_ReadBits(&sBits, 15);
                     sVolHeaderPtr->sVbvParams.nVbvOccupancy =
                         (((sMPEG4_Param->nFirstHalfVbvOccupancy) << 15) + sMPEG4_Param->nLatterHalfVbvOccupancy) * 2048;
-                    OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                    (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
-
-                    /*OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 48);
-                    (void)VIDDEC_GetBits(&nBitPosition, 48, pHeaderStream, OMX_TRUE);*/
+                    (void)OMX_TI_ReadBits(&sBits, 1);
                 }
                 else
                 {
                     sMPEG4_Param->nBitRate = 0;
                 }
             }
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 2);
-            sMPEG4_Param->nLayerShape = VIDDEC_GetBits(&nBitPosition, 2, pHeaderStream, OMX_TRUE);                    /*2 bits*/
+            sMPEG4_Param->nLayerShape = OMX_TI_ReadBits(&sBits, 2);                    /*2 bits*/
             /*skip one marker_bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                                /*1 bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 16);
-            sMPEG4_Param->nTimeIncrementResolution = VIDDEC_GetBits(&nBitPosition, 16, pHeaderStream, OMX_TRUE);        /*16 bits*/
+            (void)OMX_TI_ReadBits(&sBits, 1);                                /*1 bit*/
+            sMPEG4_Param->nTimeIncrementResolution = OMX_TI_ReadBits(&sBits, 16);        /*16 bits*/
             sVolHeaderPtr->nVOPTimeIncrementResolution = sMPEG4_Param->nTimeIncrementResolution;
             /*skip one market bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                                /*1 bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nFnXedVopRate = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                    /*1 bit*/
+            (void)OMX_TI_ReadBits(&sBits, 1);                                /*1 bit*/
+            sMPEG4_Param->nFnXedVopRate = OMX_TI_ReadBits(&sBits, 1);                    /*1 bit*/
             sVolHeaderPtr->bnFnXedVopRate = sMPEG4_Param->nFnXedVopRate;
             if (sMPEG4_Param->nFnXedVopRate)
             {
                 sMPEG4_Param->nNum_bits = GET_NUM_BIT_REQ (sMPEG4_Param->nTimeIncrementResolution);
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, sMPEG4_Param->nNum_bits);
-                sVolHeaderPtr->nFnXedVOPTimeIncrement = VIDDEC_GetBits (&nBitPosition, sMPEG4_Param->nNum_bits, pHeaderStream, OMX_TRUE);
+                sVolHeaderPtr->nFnXedVOPTimeIncrement = OMX_TI_ReadBits(&sBits, sMPEG4_Param->nNum_bits);
             }
             /*skip one market bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                                /*1 bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 13);
-            (*nWidth) = VIDDEC_GetBits(&nBitPosition, 13, pHeaderStream, OMX_TRUE);                        /*13 bits*/
+            (void)OMX_TI_ReadBits(&sBits, 1);                                /*1 bit*/
+            (*nWidth) = OMX_TI_ReadBits(&sBits, 13);                        /*13 bits*/
             /*skip one market bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                                /*1 bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 13);
-            (*nHeight) = VIDDEC_GetBits(&nBitPosition, 13, pHeaderStream, OMX_TRUE);                        /*13 bits*/
+            (void)OMX_TI_ReadBits(&sBits, 1);                                /*1 bit*/
+            (*nHeight) = OMX_TI_ReadBits(&sBits, 13);                        /*13 bits*/
 
             /*skip one market bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                                /*1 bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nInterlaced = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                    /*1 bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nObmc = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                            /*1 bit*/
+            (void)OMX_TI_ReadBits(&sBits, 1);                                /*1 bit*/
+            sMPEG4_Param->nInterlaced = OMX_TI_ReadBits(&sBits, 1);                    /*1 bit*/
+            sMPEG4_Param->nObmc = OMX_TI_ReadBits(&sBits, 1);                            /*1 bit*/
             if (sMPEG4_Param->nLayerVerId)
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                sMPEG4_Param->NSpriteNotSupported = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);        /*1 bit*/
+                sMPEG4_Param->NSpriteNotSupported = OMX_TI_ReadBits(&sBits, 1);        /*1 bit*/
                 if (sMPEG4_Param->NSpriteNotSupported)
                 {
                 }
             }
             else
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 2);
-                sMPEG4_Param->NSpriteNotSupported = VIDDEC_GetBits(&nBitPosition, 2, pHeaderStream, OMX_TRUE);        /*2 bits*/
+                sMPEG4_Param->NSpriteNotSupported = OMX_TI_ReadBits(&sBits, 2);        /*2 bits*/
                 if (sMPEG4_Param->NSpriteNotSupported)
                 {
                 }
             }
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nNot8Bit = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                        /*1 bits*/
+            sMPEG4_Param->nNot8Bit = OMX_TI_ReadBits(&sBits, 1);                        /*1 bits*/
             sMPEG4_Param->nQuantPrecision = 5;
             sMPEG4_Param->nBitsPerPnXel = 8;
             if (sMPEG4_Param->nNot8Bit)
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 4);
-                sMPEG4_Param->nQuantPrecision = VIDDEC_GetBits(&nBitPosition,4, pHeaderStream, OMX_TRUE);                    /* 4 bits*/
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 4);
-            sMPEG4_Param->nBitsPerPnXel = VIDDEC_GetBits(&nBitPosition,4, pHeaderStream, OMX_TRUE);                    /* 4 bits*/
+                sMPEG4_Param->nQuantPrecision = OMX_TI_ReadBits(&sBits, 4);                    /* 4 bits*/
+            sMPEG4_Param->nBitsPerPnXel = OMX_TI_ReadBits(&sBits, 4);                    /* 4 bits*/
             }
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nIsInverseQuantMethodFirst = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);    /*1 bits*/
+            sMPEG4_Param->nIsInverseQuantMethodFirst = OMX_TI_ReadBits(&sBits, 1);    /*1 bits*/
             if (sMPEG4_Param->nLayerVerId !=1)
             {
                 /*does not support quater sample*/
                 /*kip one market bit*/
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                            /*1 bit*/
-            }
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nComplexityEstimationDisable = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);    /*1 bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nIsResyncMarkerDisabled = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);        /*1 bit*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nIsDataPartitioned = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);            /*1 bit*/
+                (void)OMX_TI_ReadBits(&sBits, 1);                            /*1 bit*/
+            }
+            sMPEG4_Param->nComplexityEstimationDisable = OMX_TI_ReadBits(&sBits, 1);    /*1 bit*/
+            sMPEG4_Param->nIsResyncMarkerDisabled = OMX_TI_ReadBits(&sBits, 1);        /*1 bit*/
+            sMPEG4_Param->nIsDataPartitioned = OMX_TI_ReadBits(&sBits, 1);            /*1 bit*/
             sVolHeaderPtr->bDataPartitioning = sMPEG4_Param->nIsDataPartitioned;
             if (sMPEG4_Param->nIsDataPartitioned)
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-                sMPEG4_Param->nRvlc = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                        /*1 bit*/
+                sMPEG4_Param->nRvlc = OMX_TI_ReadBits(&sBits, 1);                        /*1 bit*/
                 sVolHeaderPtr->bReversibleVLC = sMPEG4_Param->nRvlc;
                 if (sMPEG4_Param->nRvlc)
                 {
@@ -4386,11 +4390,9 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG4( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
             }
             if (sMPEG4_Param->nLayerVerId !=1)
             {
-                OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 2);
-                (void)VIDDEC_GetBits(&nBitPosition, 2, pHeaderStream, OMX_TRUE);                            /*2 bit*/
+                (void)OMX_TI_ReadBits(&sBits, 2);                            /*2 bit*/
             }
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 1);
-            sMPEG4_Param->nScalability = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);                    /*1 bit*/
+            sMPEG4_Param->nScalability = OMX_TI_ReadBits(&sBits, 1);                    /*1 bit*/
             /*pPictHeaderPtr->sSizeInMemory.nWidth              = (*nWidth);
             pPictHeaderPtr->sSizeInMemory.nHeight             = (*nHeight);
             pPictHeaderPtr->sDisplayedRect                    = TRect(TSize((*nWidth),(*nHeight)));*/
@@ -4411,10 +4413,8 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG4( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
             sVolHeaderPtr->bShortVideoHeader = 1;
             /* discard 3 bits for split_screen_indicator, document_camera_indicator*/
             /* and full_picture_freeze_release*/
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 3);
-            (void)VIDDEC_GetBits(&nBitPosition, 3, pHeaderStream, OMX_TRUE);
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 3);
-            sMPEG4_Param->nSourceFormat = VIDDEC_GetBits(&nBitPosition, 3, pHeaderStream, OMX_TRUE);
+            (void)OMX_TI_ReadBits(&sBits, 3);
+            sMPEG4_Param->nSourceFormat = OMX_TI_ReadBits(&sBits, 3);
             if (sMPEG4_Param->nSourceFormat == 0x1)
             {
                 (*nWidth) = 128;
@@ -4442,9 +4442,9 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG4( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
             }
             else if (sMPEG4_Param->nSourceFormat == 0x7)
             {
-                sMPEG4_Param->nUFEP = VIDDEC_GetBits(&nBitPosition, 3, pHeaderStream, OMX_TRUE);
+                sMPEG4_Param->nUFEP = OMX_TI_ReadBits(&sBits, 3);
                 if(sMPEG4_Param->nUFEP == 1) {
-                    sMPEG4_Param->nSourceFormat = VIDDEC_GetBits(&nBitPosition, 3, pHeaderStream, OMX_TRUE);
+                    sMPEG4_Param->nSourceFormat = OMX_TI_ReadBits(&sBits, 3);
                     if (sMPEG4_Param->nSourceFormat == 0x1)
                     {
                         (*nWidth) = 128;
@@ -4473,25 +4473,25 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG4( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
                     }
                     else if (sMPEG4_Param->nSourceFormat == 0x6)
                     {
-                        (void)VIDDEC_GetBits(&nBitPosition, 24, pHeaderStream, OMX_TRUE);
-                        sMPEG4_Param->nCPM = VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
+                        (void)OMX_TI_ReadBits(&sBits, 24);
+                        sMPEG4_Param->nCPM = OMX_TI_ReadBits(&sBits, 1);
                         if(sMPEG4_Param->nCPM)
-                            (void)VIDDEC_GetBits(&nBitPosition, 2, pHeaderStream, OMX_TRUE);
+                            (void)OMX_TI_ReadBits(&sBits, 2);
 
-                        (void)VIDDEC_GetBits(&nBitPosition, 4, pHeaderStream, OMX_TRUE);
+                        (void)OMX_TI_ReadBits(&sBits, 4);
 
-                        sMPEG4_Param->nPWI = VIDDEC_GetBits(&nBitPosition, 9, pHeaderStream, OMX_TRUE);
+                        sMPEG4_Param->nPWI = OMX_TI_ReadBits(&sBits, 9);
                         (*nWidth) = (sMPEG4_Param->nPWI + 1)*4;
 
-                        (void)VIDDEC_GetBits(&nBitPosition, 1, pHeaderStream, OMX_TRUE);
+                        (void)OMX_TI_ReadBits(&sBits, 1);
 
-                        sMPEG4_Param->nPHI = VIDDEC_GetBits(&nBitPosition, 9, pHeaderStream, OMX_TRUE);
+                        sMPEG4_Param->nPHI = OMX_TI_ReadBits(&sBits, 9);
                         (*nHeight) = sMPEG4_Param->nPHI*4;
 
                     }
                     else if (sMPEG4_Param->nSourceFormat == 0x7)
                     {
-                        sMPEG4_Param->nSourceFormat = VIDDEC_GetBits(&nBitPosition, 3, pHeaderStream, OMX_TRUE);
+                        sMPEG4_Param->nSourceFormat = OMX_TI_ReadBits(&sBits, 3);
                         (*nWidth) = 1408;
                         (*nHeight) = 1152;
                     }
@@ -4516,6 +4516,11 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG4( OMX_S32* nWidth, OMX_S32* nHeight, OMX_BU
             goto EXIT;
         }
     }
+    if (sBits.bError)
+    {
+        /* the header ended before its last field */
+        eError = OMX_ErrorStreamCorrupt;
+    }
 EXIT:
     if(pPictHeaderPtr->cnOptional != NULL)
     {
@@ -4530,28 +4535,10 @@ EXIT:
 /*  ==========================================================================*/
 /*  func    VIDDEC_ScanConfigBufferAVC                                            */
 /*                                                                            */
-/*  desc    Use to scan buffer for certain patter. Used to know if ConfigBuffers are together                             */
+/*  desc    Count the start codes of a buffer. Used to know if ConfigBuffers are together                             */
 /*  ==========================================================================*/
-static OMX_U32 VIDDEC_ScanConfigBufferAVC(OMX_BUFFERHEADERTYPE* pBuffHead,  OMX_U32 pattern){
-    OMX_U32 nBitPosition = 0;
-    OMX_U32 nInBytePosition = 0;
-    OMX_U32 nPatternCounter = 0;
-    OMX_U32 nTotalInBytes = pBuffHead->nFilledLen;
-    OMX_U8* nBitStream = (OMX_U8*)pBuffHead->pBuffer;
-    
-    while (nInBytePosition < nTotalInBytes - 3){
-         if (VIDDEC_GetBits(&nBitPosition, 24, nBitStream, OMX_FALSE) != pattern) {
-              nBitPosition += 8;
-              nInBytePosition++;
-         }
-         else {
-             /*Pattern found; add count*/
-             nPatternCounter++;
-             nBitPosition += 24;
-             nInBytePosition += 3;
-         }
-    }
-    return nPatternCounter;
+static OMX_U32 VIDDEC_ScanConfigBufferAVC(OMX_BUFFERHEADERTYPE* pBuffHead){
+    return OMX_TI_ScanStartCodes((OMX_U8*)pBuffHead->pBuffer, pBuffHead->nFilledLen, NULL, 0);
 }
 
 /*  ==========================================================================*/
@@ -4569,8 +4556,7 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
     VIDDEC_AVC_ParserParam* sParserParam = NULL;
     /*OMX_S32 nRetVal = 0;*/
     OMX_BOOL nStartFlag = OMX_FALSE;
-    OMX_U32 nBitPosition = 0;
-    OMX_U32 nRbspPosition = 0;
+    OMX_TI_BITREADERTYPE sBits;
     OMX_U32 nTotalInBytes = 0;
     OMX_U32 nInBytePosition = 0;
     OMX_U32 nInPositionTemp = 0;
@@ -4602,7 +4588,7 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
     if (nType == 0) {
         /* Start of Handle fragmentation of Config Buffer  Code*/
         /*Scan for 2 "0x000001", requiered on buffer to parser properly*/
-        nConfigBufferCounter += VIDDEC_ScanConfigBufferAVC(pBuffHead, 0x000001);
+        nConfigBufferCounter += VIDDEC_ScanConfigBufferAVC(pBuffHead);
         if(nConfigBufferCounter < 2){ /*If less of 2 we need to store the data internally to later assembly the complete ConfigBuffer*/
             /*Set flag to False, the Config Buffer is not complete */
             OMX_PRINT2(pComponentPrivate->dbg, "Setting bConfigBufferCompleteAVC = OMX_FALSE");
@@ -4686,43 +4672,26 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
             }
         }
          /* End of Handle fragmentation Config Buffer Code*/
+        OMX_TI_BitReaderInit(&sBits, nBitStream, nTotalInBytes);
 
         do{
-            for (; (!nStartFlag) && (nInBytePosition < nTotalInBytes - 3); )
+            nInBytePosition = OMX_TI_FindStartCode(nBitStream, nTotalInBytes, nInBytePosition);
+            if (nInBytePosition + 3 < nTotalInBytes)
             {
-               if (VIDDEC_GetBits(&nBitPosition, 24, nBitStream, OMX_FALSE) != 0x000001)
-               {
-                    nBitPosition += 8;
-                    nInBytePosition++;
-               }
-               else
-               {
-                   /*Start Code found*/
-                   nStartFlag = OMX_TRUE;
-                   nBitPosition += 24;
-                   nInBytePosition += 3;
-               }
+               /*Start Code found*/
+                nInBytePosition += 3;
             }
+            OMX_TI_BitReaderSeek(&sBits, nInBytePosition * 8);
             nStartFlag = OMX_FALSE;
-            /* offset to NumBytesInNALunit*/
-            nNumBytesInNALunit = nInBytePosition;
-            sParserParam->nBitPosTemp = nBitPosition;
-              for (;(!nStartFlag)&&(nNumBytesInNALunit < nTotalInBytes-3); )
+            /* offset to NumBytesInNALunit, just past the next start code */
+            nNumBytesInNALunit = OMX_TI_FindStartCode(nBitStream, nTotalInBytes, nInBytePosition);
+            if (nNumBytesInNALunit + 3 < nTotalInBytes)
             {
-                if (VIDDEC_GetBits(&sParserParam->nBitPosTemp, 24, nBitStream, OMX_FALSE) != 0x000001)
-                /*find start code*/
-                {
-                    sParserParam->nBitPosTemp += 8;
-                    nNumBytesInNALunit++;
-                }
-                else
-                {
-                   /*Start Code found*/
-                    nStartFlag = OMX_TRUE;
-                    sParserParam->nBitPosTemp += 24;
-                    nNumBytesInNALunit += 3;
-                }
+               /*Start Code found*/
+                nStartFlag = OMX_TRUE;
+                nNumBytesInNALunit += 3;
             }
+            sParserParam->nBitPosTemp = nNumBytesInNALunit * 8;
 
             if (!nStartFlag)
             {
@@ -4730,11 +4699,11 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
                 goto EXIT;
             }
             /* forbidden_zero_bit */
-            sParserParam->nForbiddenZeroBit = VIDDEC_GetBits(&nBitPosition, 1, nBitStream, OMX_TRUE);
+            sParserParam->nForbiddenZeroBit = OMX_TI_ReadBits(&sBits, 1);
             /* nal_ref_idc */
-            sParserParam->nNalRefIdc = VIDDEC_GetBits(&nBitPosition, 2, nBitStream, OMX_TRUE);
+            sParserParam->nNalRefIdc = OMX_TI_ReadBits(&sBits, 2);
             /* nal_unit_type */
-            nNalUnitType = VIDDEC_GetBits(&nBitPosition, 5, nBitStream, OMX_TRUE);
+            nNalUnitType = OMX_TI_ReadBits(&sBits, 5);
             nInBytePosition++;
 
             /* This code is to ensure we will get parameter info */
@@ -4747,6 +4716,7 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
     }
     else {
          pDataBuf = (OMX_U8*)nBitStream;
+         OMX_TI_BitReaderInit(&sBits, nBitStream, nTotalInBytes);
          do {
         /* iOMXComponentUsesNALStartCodes is set to OMX_FALSE on opencore */
 #ifndef ANDROID
@@ -4779,7 +4749,7 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
                 goto EXIT;
             }
 #endif
-            nBitPosition = (nInPositionTemp + nType) * 8;
+            OMX_TI_BitReaderSeek(&sBits, (nInPositionTemp + nType) * 8);
             nInBytePosition = nInPositionTemp + nType;
             nInPositionTemp += nNumBytesInNALunit + nType;
             if (nInBytePosition > nTotalInBytes) {
@@ -4787,29 +4757,33 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
                 goto EXIT;
             }
             /* forbidden_zero_bit */
-            sParserParam->nForbiddenZeroBit = VIDDEC_GetBits(&nBitPosition, 1, nBitStream, OMX_TRUE);
+            sParserParam->nForbiddenZeroBit = OMX_TI_ReadBits(&sBits, 1);
             /* nal_ref_idc */
-            sParserParam->nNalRefIdc = VIDDEC_GetBits(&nBitPosition, 2, nBitStream, OMX_TRUE);
+            sParserParam->nNalRefIdc = OMX_TI_ReadBits(&sBits, 2);
             /* nal_unit_type */
-            nNalUnitType = VIDDEC_GetBits(&nBitPosition, 5, nBitStream, OMX_TRUE);
+            nNalUnitType = OMX_TI_ReadBits(&sBits, 5);
             nInBytePosition++;
             /* This code is to ensure we will get parameter info */
             if (nNalUnitType != 7) {
                 /*nBitPosition += (nNumBytesInNALunit - 1) * 8;
                 nInBytePosition += (nNumBytesInNALunit - 1);*/
-                nBitPosition = (nInPositionTemp) * 8;
+                OMX_TI_BitReaderSeek(&sBits, nInPositionTemp * 8);
                 nInBytePosition = (nInPositionTemp);
 
             }
         } while (nNalUnitType != 7);
         nNumBytesInNALunit += 8 + nInBytePosition;/*sum to keep the code flow*/
                                 /*the buffer must had enough space to enter this number*/
+        if (nNumBytesInNALunit > (OMX_S32)nTotalInBytes + 3) {
+            nNumBytesInNALunit = nTotalInBytes + 3;
+        }
     }
     for (i=0; nInBytePosition < nNumBytesInNALunit - 3; )
     {
 
         if (((nInBytePosition + 2) < nNumBytesInNALunit - 3)&&
-            (VIDDEC_GetBits(&nBitPosition, 24, nBitStream, OMX_FALSE) == 0x000003))
+            nBitStream[nInBytePosition] == 0 && nBitStream[nInBytePosition + 1] == 0 &&
+            nBitStream[nInBytePosition + 2] == 3)
         {
             OMX_PRINT2(pComponentPrivate->dbg, "discard emulation prev byte\n");
             nRbspByte[i++] = nBitStream[nInBytePosition++];
@@ -4817,82 +4791,78 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
             nNumOfBytesInRbsp += 2;
             /* discard emulation prev byte */
             nInBytePosition++;
-            nBitPosition += 24;
         }
         else
         {
             nRbspByte[i++] = nBitStream[nInBytePosition++];
             nNumOfBytesInRbsp++;
-            nBitPosition += 8;
         }
     }
 
 
     /*Parse RBSP sequence*/
     /*///////////////////*/
+    OMX_TI_BitReaderInit(&sBits, nRbspByte, nNumOfBytesInRbsp);
     /*  profile_idc u(8) */
-    sParserParam->nProfileIdc = VIDDEC_GetBits(&nRbspPosition, 8, nRbspByte, OMX_TRUE);
+    sParserParam->nProfileIdc = OMX_TI_ReadBits(&sBits, 8);
     /* constraint_set0_flag u(1)*/
-    sParserParam->nConstraintSet0Flag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nConstraintSet0Flag = OMX_TI_ReadBits(&sBits, 1);
     /* constraint_set1_flag u(1)*/
-    sParserParam->nConstraintSet1Flag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nConstraintSet1Flag = OMX_TI_ReadBits(&sBits, 1);
     /* constraint_set2_flag u(1)*/
-    sParserParam->nConstraintSet2Flag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nConstraintSet2Flag = OMX_TI_ReadBits(&sBits, 1);
     /* reserved_zero_5bits u(5)*/
-    sParserParam->nReservedZero5bits = VIDDEC_GetBits(&nRbspPosition, 5, nRbspByte, OMX_TRUE);
+    sParserParam->nReservedZero5bits = OMX_TI_ReadBits(&sBits, 5);
     /* level_idc*/
-    sParserParam->nLevelIdc = VIDDEC_GetBits(&nRbspPosition, 8, nRbspByte, OMX_TRUE);
-    sParserParam->nSeqParameterSetId = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-    sParserParam->nLog2MaxFrameNumMinus4 = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-    sParserParam->nPicOrderCntType = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+    sParserParam->nLevelIdc = OMX_TI_ReadBits(&sBits, 8);
+    sParserParam->nSeqParameterSetId = OMX_TI_ReadUE(&sBits);
+    sParserParam->nLog2MaxFrameNumMinus4 = OMX_TI_ReadUE(&sBits);
+    sParserParam->nPicOrderCntType = OMX_TI_ReadUE(&sBits);
 
     if ( sParserParam->nPicOrderCntType == 0 )
     {
-        sParserParam->nLog2MaxPicOrderCntLsbMinus4 = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+        sParserParam->nLog2MaxPicOrderCntLsbMinus4 = OMX_TI_ReadUE(&sBits);
     }
     else if( sParserParam->nPicOrderCntType == 1 )
     {
         /* delta_pic_order_always_zero_flag*/
-        VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
-        sParserParam->nOffsetForNonRefPic = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        if (sParserParam->nOffsetForNonRefPic > 1)
-              sParserParam->nOffsetForNonRefPic = sParserParam->nOffsetForNonRefPic & 0x1 ?
-                                                sParserParam->nOffsetForNonRefPic >> 1 :
-                                              -(sParserParam->nOffsetForNonRefPic >> 1);
-        sParserParam->nOffsetForTopToBottomField = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        sParserParam->nNumRefFramesInPicOrderCntCycle = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        for(i = 0; i < sParserParam->nNumRefFramesInPicOrderCntCycle; i++ )
-            VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte); /*offset_for_ref_frame[i]*/
-    }
-
-    sParserParam->nNumRefFrames = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-    sParserParam->nGapsInFrameNumValueAllowedFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
-    sParserParam->nPicWidthInMbsMinus1 = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+        OMX_TI_ReadBits(&sBits, 1);
+        sParserParam->nOffsetForNonRefPic = OMX_TI_ReadSE(&sBits);
+        sParserParam->nOffsetForTopToBottomField = OMX_TI_ReadSE(&sBits);
+        sParserParam->nNumRefFramesInPicOrderCntCycle = OMX_TI_ReadUE(&sBits);
+        for(i = 0; i < sParserParam->nNumRefFramesInPicOrderCntCycle && !sBits.bError; i++ )
+            (void)OMX_TI_ReadSE(&sBits); /*offset_for_ref_frame[i]*/
+    }
+
+    sParserParam->nNumRefFrames = OMX_TI_ReadUE(&sBits);
+    sParserParam->nGapsInFrameNumValueAllowedFlag = OMX_TI_ReadBits(&sBits, 1);
+    sParserParam->nPicWidthInMbsMinus1 = OMX_TI_ReadUE(&sBits);
     (*nWidth) = (sParserParam->nPicWidthInMbsMinus1 + 1) * 16;
-    sParserParam->nPicHeightInMapUnitsMinus1 = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+    sParserParam->nPicHeightInMapUnitsMinus1 = OMX_TI_ReadUE(&sBits);
     (*nHeight) = (sParserParam->nPicHeightInMapUnitsMinus1 + 1) * 16;
     /* Checking for cropping in picture saze */
     /* getting frame_mbs_only_flag */
-    sParserParam->nFrameMbsOnlyFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nFrameMbsOnlyFlag = OMX_TI_ReadBits(&sBits, 1);
     if (!sParserParam->nFrameMbsOnlyFlag)
     {
-        sParserParam->nMBAdaptiveFrameFieldFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+        sParserParam->nMBAdaptiveFrameFieldFlag = OMX_TI_ReadBits(&sBits, 1);
     }
     /*getting direct_8x8_inference_flag and frame_cropping_flag*/
-    sParserParam->nDirect8x8InferenceFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
-    sParserParam->nFrameCroppingFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nDirect8x8InferenceFlag = OMX_TI_ReadBits(&sBits, 1);
+    sParserParam->nFrameCroppingFlag = OMX_TI_ReadBits(&sBits, 1);
     /*getting the crop values if exist*/
     if (sParserParam->nFrameCroppingFlag)
     {
-        sParserParam->nFrameCropLeftOffset = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        sParserParam->nFrameCropRightOffset = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        sParserParam->nFrameCropTopOffset = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        sParserParam->nFrameCropBottomOffset = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+        sParserParam->nFrameCropLeftOffset = OMX_TI_ReadUE(&sBits);
+        sParserParam->nFrameCropRightOffset = OMX_TI_ReadUE(&sBits);
+        sParserParam->nFrameCropTopOffset = OMX_TI_ReadUE(&sBits);
+        sParserParam->nFrameCropBottomOffset = OMX_TI_ReadUE(&sBits);
         /* Update framesize taking into account the cropping values */
         (*nCropWidth) = (2 * sParserParam->nFrameCropLeftOffset + 2 * sParserParam->nFrameCropRightOffset);
         (*nCropHeight) = (2 * sParserParam->nFrameCropTopOffset + 2 * sParserParam->nFrameCropBottomOffset);
     }
-    eError = OMX_ErrorNone;
+    /* an SPS cut short or with an invalid ue(v) code */
+    eError = sBits.bError ? OMX_ErrorStreamCorrupt : OMX_ErrorNone;
 
 EXIT:
     if (nRbspByte)
@@ -4903,89 +4873,6 @@ EXIT:
 }
 #endif
 
-#ifdef VIDDEC_ACTIVATEPARSER
-/*  =========================================================================*/
-/*  func    GetBits                                                          */
-/*                                                                           */
-/*  desc    Gets aBits number of bits from position aPosition of one buffer  */
-/*            and returns the value in a TUint value.                        */
-/*  =========================================================================*/
-OMX_U32 VIDDEC_GetBits(OMX_U32* nPosition, OMX_U8 nBits, OMX_U8* pBuffer, OMX_BOOL bIcreasePosition)
-{
-    OMX_U32 nOutput;
-    OMX_U32 nNumBitsRead = 0;
-    OMX_U32 nBytePosition = 0;
-    OMX_U8  nBitPosition =  0;
-    nBytePosition = *nPosition / 8;
-    nBitPosition =  *nPosition % 8;
-
-    if (bIcreasePosition)
-        *nPosition += nBits;
-    nOutput = ((OMX_U32)pBuffer[nBytePosition] << (24+nBitPosition) );
-    nNumBitsRead = nNumBitsRead + (8 - nBitPosition);
-    if (nNumBitsRead < nBits)
-    {
-        nOutput = nOutput | ( pBuffer[nBytePosition + 1] << (16+nBitPosition));
-        nNumBitsRead = nNumBitsRead + 8;
-    }
-    if (nNumBitsRead < nBits)
-    {
-        nOutput = nOutput | ( pBuffer[nBytePosition + 2] << (8+nBitPosition));
-        nNumBitsRead = nNumBitsRead + 8;
-    }
-    if (nNumBitsRead < nBits)
-    {
-        nOutput = nOutput | ( pBuffer[nBytePosition + 3] << (nBitPosition));
-        nNumBitsRead = nNumBitsRead + 8;
-    }
-    nOutput = nOutput >> (32 - nBits) ;
-    return nOutput;
-}
-
-
-OMX_S32 VIDDEC_UVLC_dec(OMX_U32 *nPosition, OMX_U8* pBuffer)
-{
-
-    OMX_U32 nBytePosition = (*nPosition) / 8;
-    OMX_U8 cBitPosition =  (*nPosition) % 8;
-    OMX_U32 nLen = 1;
-    OMX_U32 nCtrBit = 0;
-    OMX_U32 nVal = 1;
-    OMX_S32 nInfoBit=0;
-
-    nCtrBit = pBuffer[nBytePosition] & (0x1 << (7-cBitPosition));
-    while (nCtrBit==0)
-    {
-        nLen++;
-        cBitPosition++;
-        (*nPosition)++;
-        if (!(cBitPosition%8))
-        {
-            cBitPosition=0;
-            nBytePosition++;
-        }
-        nCtrBit = pBuffer[nBytePosition] & (0x1<<(7-cBitPosition));
-    }
-    for(nInfoBit=0; (nInfoBit<(nLen-1)); nInfoBit++)
-    {
-        cBitPosition++;
-        (*nPosition)++;
-
-        if (!(cBitPosition%8))
-        {
-            cBitPosition=0;
-            nBytePosition++;
-        }
-        nVal=(nVal << 1);
-        if(pBuffer[nBytePosition] & (0x01 << (7 - cBitPosition)))
-            nVal |= 1;
-    }
-    (*nPosition)++;
-    nVal -= 1;
-    return nVal;
-}
-#endif
-
 #ifdef VIDDEC_ACTIVATEPARSER
 /* ========================================================================== */
 /**
@@ -5046,12 +4933,12 @@ OMX_ERRORTYPE VIDDEC_ParseHeader(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate, OM
         }
         else if( pComponentPrivate->pInPortDef->format.video.eCompressionFormat == OMX_VIDEO_CodingMPEG4  ||
                 pComponentPrivate->pInPortDef->format.video.eCompressionFormat == OMX_VIDEO_CodingH263) {
-            VIDDEC_ParseVideo_MPEG4( &nWidth, &nHeight, pBuffHead);
+            eError = VIDDEC_ParseVideo_MPEG4( &nWidth, &nHeight, pBuffHead);
             /* Work around force reconfiguration */
             bOutPortSettingsChanged = OMX_TRUE;
         }
         else if( pComponentPrivate->pInPortDef->format.video.eCompressionFormat == OMX_VIDEO_CodingMPEG2) {
-            VIDDEC_ParseVideo_MPEG2( &nWidth, &nHeight, pBuffHead);
+            eError = VIDDEC_ParseVideo_MPEG2( &nWidth, &nHeight, pBuffHead);
         }
         else if( pComponentPrivate->pInPortDef->format.video.eCompressionFormat == OMX_VIDEO_CodingWMV) {
             if (pComponentPrivate->nWMVFileType == VIDDEC_WMV_ELEMSTREAM) {
@@ -5061,6 +4948,11 @@ OMX_ERRORTYPE VIDDEC_ParseHeader(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate, OM
                 eError = VIDDEC_ParseVideo_WMV9_RCV( &nWidth, &nHeight, pBuffHead);
             }
         }
+        if (eError == OMX_ErrorStreamCorrupt) {
+            /* no frame size can be trusted, leave the ports as they are */
+            OMX_ERROR4(pComponentPrivate->dbg, "Corrupt or truncated stream header\n");
+            goto EXIT;
+        }
 
         nPadWidth = nWidth;
         nPadHeight = nHeight;
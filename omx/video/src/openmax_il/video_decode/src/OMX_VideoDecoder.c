@@ -2594,6 +2594,7 @@ static OMX_ERRORTYPE VIDDEC_ComponentDeInit(OMX_HANDLETYPE hComponent)
             pComponentPrivate->eLCMLState = VidDec_LCML_State_Unload;
         }
     }
+    VIDDEC_ReleaseDspLoad(pComponentPrivate);
     eError = write(pComponentPrivate->cmdPipe[VIDDEC_PIPE_WRITE], &Cmd, sizeof(Cmd));
     if (eError == -1) {
         eError = OMX_ErrorUndefined;
@@ -3085,6 +3086,7 @@ static OMX_ERRORTYPE VIDDEC_FreeBuffer (OMX_IN OMX_HANDLETYPE hComponent,
     OMX_U32 buffcount = 0;
     OMX_STATETYPE TunnelState = OMX_StateInvalid;
     OMX_BOOL bTransIdle = OMX_FALSE;
+    OMX_ERRORTYPE eRelease = OMX_ErrorNone;
 
     OMX_CONF_CHECK_CMD(hComponent, pBuffHead, OMX_TRUE);
 
@@ -3202,7 +3204,24 @@ static OMX_ERRORTYPE VIDDEC_FreeBuffer (OMX_IN OMX_HANDLETYPE hComponent,
     }
     OMX_PRBUFFER1(pComponentPrivate->dbg, "bAllocByComponent 0x%x pBuffer 0x%p\n", (int )pBufferPrivate->bAllocByComponent, 
         pBuffHead->pBuffer);
-    if (pBufferPrivate->bAllocByComponent == OMX_TRUE) {
+    /* tunneled buffers stay mapped in LCML until they are freed */
+    if (pCompPort->hTunnelComponent != NULL &&
+        pComponentPrivate->eLCMLState != VidDec_LCML_State_Destroy &&
+        pComponentPrivate->pLCML != NULL) {
+        void *aRelease[3];
+        aRelease[0] = pBuffHead->pBuffer;
+        aRelease[1] = (void *)pBuffHead->nAllocLen;
+        aRelease[2] = (void *)(LCML_RELEASE_WAIT |
+                               (pBufferPrivate->bAllocByComponent == OMX_TRUE ? LCML_RELEASE_OWNER : 0));
+        eRelease = LCML_ControlCodec(((LCML_DSP_INTERFACE*)pComponentPrivate->pLCML)->pCodecinterfacehandle,
+                                     EMMCodecControlReleaseBuffer, aRelease);
+        if (eRelease != OMX_ErrorNone) {
+            /* the DSP still maps it: keep the memory rather than free it under the DSP */
+            OMX_ERROR4(pComponentPrivate->dbg, "buffer %p still mapped in the DSP (0x%x), not freed\n",
+                       pBuffHead->pBuffer, eRelease);
+        }
+    }
+    if (pBufferPrivate->bAllocByComponent == OMX_TRUE && eRelease == OMX_ErrorNone) {
         if(pBuffHead->pBuffer != NULL){
 #ifdef __PERF_INSTRUMENTATION__
            PERF_SendingFrame(pComponentPrivate->pPERFcomp,
@@ -3699,6 +3718,7 @@ static OMX_ERRORTYPE VIDDEC_ComponentTunnelRequest (OMX_IN OMX_HANDLETYPE hCompo
 
     if (pTunnelSetup == NULL || hTunneledComp == 0) {
         pPort->hTunnelComponent = NULL;
+        pPort->bDspTunnelPeer = OMX_FALSE;
         pPort->nTunnelPort = 0;
         pPort->eSupplierSetting = OMX_BufferSupplyUnspecified;
     }
@@ -3715,6 +3735,7 @@ static OMX_ERRORTYPE VIDDEC_ComponentTunnelRequest (OMX_IN OMX_HANDLETYPE hCompo
         }
 #endif
         pPort->hTunnelComponent = hTunneledComp;
+        pPort->bDspTunnelPeer = LCML_IsDspTunnelPeer(hTunneledComp);
         pPort->nTunnelPort = nTunneledPort;
 
         if (pPortDef->eDir == OMX_DirOutput) {
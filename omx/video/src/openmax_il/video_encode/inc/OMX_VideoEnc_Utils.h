@@ -509,6 +509,7 @@ typedef struct VIDEOENC_PORT_TYPE
     OMX_U32 nBufferCnt;
     OMX_U32 nTunnelPort;
     OMX_HANDLETYPE hTunnelComponent;
+    OMX_BOOL bDspTunnelPeer;    /* peer is in LCML_DSP_TUNNEL_PEERS */
     OMX_BUFFERSUPPLIERTYPE eSupplierSetting;
     OMX_PARAM_PORTDEFINITIONTYPE* pPortDef;
     OMX_VIDEO_PARAM_PORTFORMATTYPE* pPortFormat;
@@ -2614,7 +2614,9 @@ OMX_ERRORTYPE OMX_VIDENC_Process_FilledInBuf(VIDENC_COMPONENT_PRIVATE* pComponen
         OMX_PRBUFFER1(pComponentPrivate->dbg, " %p\n", (void*)pBufHead);
         pBufferPrivate->eBufferOwner = VIDENC_BUFFER_WITH_DSP;
         eError = LCML_QueueBuffer(pLcmlHandle->pCodecinterfacehandle,
-                                  EMMCodecInputBuffer,
+                                  EMMCodecInputBuffer |
+                                  ((pComponentPrivate->pCompPort[VIDENC_INPUT_PORT]->hTunnelComponent != NULL &&
+                                    pComponentPrivate->pCompPort[VIDENC_INPUT_PORT]->bDspTunnelPeer) ? LCML_BUFFER_TUNNEL : 0),
                                   pBufHead->pBuffer,
                                   pBufHead->nAllocLen,
                                   pBufHead->nFilledLen,
@@ -2761,7 +2763,9 @@ OMX_ERRORTYPE OMX_VIDENC_Queue_Mpeg4_Buffer(VIDENC_COMPONENT_PRIVATE* pComponent
         OMX_PRBUFFER1(pComponentPrivate->dbg, " %p\n", (void*)pBufHead);
         pBufferPrivate->eBufferOwner = VIDENC_BUFFER_WITH_DSP;
         eError = LCML_QueueBuffer(pLcmlHandle->pCodecinterfacehandle,
-                                  EMMCodecInputBuffer,
+                                  EMMCodecInputBuffer |
+                                  ((pComponentPrivate->pCompPort[VIDENC_INPUT_PORT]->hTunnelComponent != NULL &&
+                                    pComponentPrivate->pCompPort[VIDENC_INPUT_PORT]->bDspTunnelPeer) ? LCML_BUFFER_TUNNEL : 0),
                                   pBufHead->pBuffer,
                                   pBufHead->nAllocLen,
                                   pBufHead->nFilledLen,
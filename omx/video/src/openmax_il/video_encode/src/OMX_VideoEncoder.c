@@ -3492,6 +3492,7 @@ OMX_ERRORTYPE FreeBuffer(OMX_IN  OMX_HANDLETYPE hComponent,
     OMX_U8 nCount                               = 0;
     VIDENC_BUFFER_PRIVATE* pBufferPrivate       = NULL;
     VIDENC_NODE* pMemoryListHead                = NULL;
+    OMX_ERRORTYPE eRelease                      = OMX_ErrorNone;
 
     OMX_CONF_CHECK_CMD(hComponent, ((OMX_COMPONENTTYPE *) hComponent)->pComponentPrivate, 1);
 
@@ -3576,7 +3577,25 @@ OMX_ERRORTYPE FreeBuffer(OMX_IN  OMX_HANDLETYPE hComponent,
                        PERF_ModuleHLMM);
 #endif
 
-    if (pBufferPrivate->bAllocByComponent == OMX_TRUE)
+    /* tunneled buffers stay mapped in LCML until they are freed */
+    if (pCompPort->hTunnelComponent != NULL && pComponentPrivate->pLCML != NULL)
+    {
+        void* aRelease[3];
+        aRelease[0] = pBufHead->pBuffer;
+        aRelease[1] = (void*)pBufHead->nAllocLen;
+        aRelease[2] = (void*)(LCML_RELEASE_WAIT |
+                              (pBufferPrivate->bAllocByComponent == OMX_TRUE ? LCML_RELEASE_OWNER : 0));
+        eRelease = LCML_ControlCodec(((LCML_DSP_INTERFACE*)pComponentPrivate->pLCML)->pCodecinterfacehandle,
+                                     EMMCodecControlReleaseBuffer, aRelease);
+        if (eRelease != OMX_ErrorNone)
+        {
+            /* the DSP still maps it: keep the memory rather than free it under the DSP */
+            OMX_ERROR4(pComponentPrivate->dbg, "buffer %p still mapped in the DSP (0x%x), not freed\n",
+                       pBufHead->pBuffer, eRelease);
+        }
+    }
+
+    if (pBufferPrivate->bAllocByComponent == OMX_TRUE && eRelease == OMX_ErrorNone)
     {
         if (pBufHead->pBuffer != NULL)
         {
@@ -3955,9 +3974,6 @@ EXIT:
     return bResult;
 } /* End of IsTIOMXComponent */
 
-
-
-
 /*----------------------------------------------------------------------------*/
 /**
   *  ComponentTunnelRequest() Sets application callbacks to the component
@@ -3989,6 +4005,7 @@ OMX_ERRORTYPE ComponentTunnelRequest(OMX_IN  OMX_HANDLETYPE hComponent,
     {
         /* cancel previous tunnel */
         pPort->hTunnelComponent = 0;
+        pPort->bDspTunnelPeer = OMX_FALSE;
         pPort->nTunnelPort = 0;
         pPort->eSupplierSetting = OMX_BufferSupplyUnspecified;
     }
@@ -4015,6 +4032,7 @@ OMX_ERRORTYPE ComponentTunnelRequest(OMX_IN  OMX_HANDLETYPE hComponent,
             goto OMX_CONF_CMD_BAIL;
         }
         pPort->hTunnelComponent = hTunneledComp;
+        pPort->bDspTunnelPeer = LCML_IsDspTunnelPeer(hTunneledComp);
         pPort->nTunnelPort = nTunneledPort;
 
         if (pPort->pPortDef->eDir == OMX_DirOutput)